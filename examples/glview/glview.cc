@@ -251,9 +251,9 @@ static void SetupGLState(tinygltf::Scene &scene, GLuint progId) {
       GLBufferState state;
       glGenBuffers(1, &state.vb);
       glBindBuffer(bufferView.target, state.vb);
-      std::cout << "buffer.size= " << buffer.data.size() << ", byteOffset = " << bufferView.byteOffset << std::endl;
+      std::cout << "buffer.size= " << buffer.Size() << ", byteOffset = " << bufferView.byteOffset << std::endl;
       glBufferData(bufferView.target, bufferView.byteLength,
-                   &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
+                   buffer.Data() + bufferView.byteOffset, GL_STATIC_DRAW);
       glBindBuffer(bufferView.target, 0);
 
       gBufferState[it->first] = state;
@@ -374,26 +374,29 @@ static void SetupCurvesState(tinygltf::Scene &scene, GLuint progId) {
         }
 
         // Construct curves buffer
-        const tinygltf::Accessor &vtx_accessor = scene.accessors[primitive.attributes.find("POSITION")->second];
-        const tinygltf::Accessor &nverts_accessor = scene.accessors[primitive.attributes.find("NVERTS")->second];
-        const tinygltf::BufferView &vtx_bufferView = scene.bufferViews[vtx_accessor.bufferView];
-        const tinygltf::BufferView &nverts_bufferView = scene.bufferViews[nverts_accessor.bufferView];
-        const tinygltf::Buffer &vtx_buffer = scene.buffers[vtx_bufferView.buffer];
-        const tinygltf::Buffer &nverts_buffer = scene.buffers[nverts_bufferView.buffer];
-
-        //std::cout << "vtx_bufferView = " << vtx_accessor.bufferView << std::endl;
-        //std::cout << "nverts_bufferView = " << nverts_accessor.bufferView << std::endl;
-        //std::cout << "vtx_buffer.size = " << vtx_buffer.data.size() << std::endl;
-        //std::cout << "nverts_buffer.size = " << nverts_buffer.data.size() << std::endl;
+        std::string err;
+        tinygltf::AccessorReader vtx_reader;
+        tinygltf::AccessorReader nverts_reader;
+        if (!vtx_reader.Init(scene, primitive.attributes.find("POSITION")->second, &err) ||
+            !nverts_reader.Init(scene, primitive.attributes.find("NVERTS")->second, &err)) {
+          std::cerr << err << std::endl;
+          continue;
+        }
 
-        const int *nverts = reinterpret_cast<const int*>(nverts_buffer.data.data());
-        const float *vtx  = reinterpret_cast<const float*>(vtx_buffer.data.data());
+        // Honors byteOffset and byteStride of the accessors.
+        std::vector<float> vtx(vtx_reader.Count() * vtx_reader.NumComponents());
+        vtx_reader.ReadAsFloat(vtx.data());
+        std::vector<unsigned int> nverts(nverts_reader.Count() * nverts_reader.NumComponents());
+        if (!nverts_reader.ReadAsUInt32(nverts.data())) {
+          std::cerr << "NVERTS must be integers." << std::endl;
+          continue;
+        }
 
         // Convert to GL_LINES data.
         std::vector<float> line_pts;
         size_t vtx_offset = 0;
-        for (int k = 0; k < static_cast<int>(nverts_accessor.count); k++) {
-            for (int n = 0; n < nverts[k] - 1; n++) {
+        for (size_t k = 0; k < nverts.size(); k++) {
+            for (int n = 0; n < static_cast<int>(nverts[k]) - 1; n++) {
               //std::cout << "vn[" << k << "] " << nverts[k] << std::endl;
 
               line_pts.push_back(vtx[3 * (vtx_offset + n) + 0]);
@@ -608,13 +611,35 @@ void DrawCurves(tinygltf::Scene &scene, const tinygltf::Mesh &mesh) {
   }
 }
 
-void DrawScene(tinygltf::Scene &scene) {
-  std::map<std::string, tinygltf::Mesh>::const_iterator it(scene.meshes.begin());
-  std::map<std::string, tinygltf::Mesh>::const_iterator itEnd(scene.meshes.end());
+void DrawScene(tinygltf::Scene &scene,
+               const tinygltf::CompiledScene &compiled,
+               const tinygltf::TransformHierarchy &transforms) {
+  if (compiled.nodes.size() == 0) {
+    // No node hierarchy. Draw all meshes as is.
+    std::map<std::string, tinygltf::Mesh>::const_iterator it(scene.meshes.begin());
+    std::map<std::string, tinygltf::Mesh>::const_iterator itEnd(scene.meshes.end());
 
-  for (; it != itEnd; it++) {
-    DrawMesh(scene, it->second);
-    DrawCurves(scene, it->second);
+    for (; it != itEnd; it++) {
+      DrawMesh(scene, it->second);
+      DrawCurves(scene, it->second);
+    }
+    return;
+  }
+
+  for (size_t i = 0; i < compiled.nodes.size(); i++) {
+    const tinygltf::CompiledNode &node = compiled.nodes[i];
+    if (node.meshes.empty()) {
+      continue;
+    }
+
+    glPushMatrix();
+    glMultMatrixf(transforms.WorldMatrix(static_cast<int>(i)));
+    for (size_t k = 0; k < node.meshes.size(); k++) {
+      const tinygltf::Mesh &mesh = *compiled.meshes[node.meshes[k]].mesh;
+      DrawMesh(scene, mesh);
+      DrawCurves(scene, mesh);
+    }
+    glPopMatrix();
   }
 }
 
@@ -668,6 +693,17 @@ int main(int argc, char **argv) {
     exit(-1);
   }
 
+  // World transforms of the nodes. Errors(e.g. a cycle) are reported, and
+  // the rest is still drawn.
+  tinygltf::CompiledScene compiled;
+  tinygltf::TransformHierarchy transforms;
+  err.clear();
+  tinygltf::CompileScene(&compiled, &err, scene);
+  transforms.Build(compiled, &err);
+  if (!err.empty()) {
+    printf("ERR: %s\n", err.c_str());
+  }
+
   Init();
 
   if (!glfwInit()) {
@@ -761,7 +797,7 @@ int main(int argc, char **argv) {
 
     glScalef(scale, scale, scale);
 
-    DrawScene(scene);
+    DrawScene(scene, compiled, transforms);
 
     glMatrixMode(GL_PROJECTION);
     glPopMatrix();
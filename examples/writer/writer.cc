@@ -2,6 +2,7 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <set>
 
 #define TINYGLTF_LOADER_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -94,13 +95,12 @@ bool EncodeBuffers(picojson::object* o,
   for (; it != itEnd; it++) {
     // @todo { Support external file resource. }
     picojson::object buf;
-    std::string b64_data =
-        base64_encode(it->second.data.data(), it->second.data.size());
+    std::string b64_data = base64_encode(it->second.Data(), it->second.Size());
     buf["type"] = picojson::value("arraybuffer");
     buf["uri"] = picojson::value(
         std::string("data:application/octet-stream;base64,") + b64_data);
     buf["byteLength"] =
-        picojson::value(static_cast<double>(it->second.data.size()));
+        picojson::value(static_cast<double>(it->second.Size()));
 
     (*o)[it->first] = picojson::value(buf);
   }
@@ -148,6 +148,33 @@ bool EncodeStringArray(picojson::array* arr,
   return true;
 }
 
+void EncodeValue(picojson::value* v, const tinygltf::Value& value) {
+  if (value.IsBool()) {
+    *v = picojson::value(value.Get<bool>());
+  } else if (value.IsInt()) {
+    *v = picojson::value(static_cast<double>(value.Get<int>()));
+  } else if (value.IsNumber()) {
+    *v = picojson::value(value.Get<double>());
+  } else if (value.IsString()) {
+    *v = picojson::value(value.Get<std::string>());
+  } else if (value.IsArray()) {
+    picojson::array arr(value.ArrayLen());
+    for (size_t i = 0; i < arr.size(); i++) {
+      EncodeValue(&arr[i], value.Get(static_cast<int>(i)));
+    }
+    *v = picojson::value(arr);
+  } else if (value.IsObject()) {
+    picojson::object obj;
+    std::vector<std::string> keys = value.Keys();
+    for (size_t i = 0; i < keys.size(); i++) {
+      EncodeValue(&obj[keys[i]], value.Get(keys[i]));
+    }
+    *v = picojson::value(obj);
+  } else {
+    *v = picojson::value();
+  }
+}
+
 bool EncodeNode(picojson::object* o, const tinygltf::Node& node) {
   (*o)["name"] = picojson::value(node.name);
   (*o)["camera"] = picojson::value(node.camera);
@@ -186,6 +213,20 @@ bool EncodeNode(picojson::object* o, const tinygltf::Node& node) {
     (*o)["children"] = picojson::value(arr);
   }
 
+  if (!node.jointName.empty()) {
+    (*o)["jointName"] = picojson::value(node.jointName);
+  }
+
+  if (!node.skeletons.empty()) {
+    picojson::array arr;
+    EncodeStringArray(&arr, node.skeletons);
+    (*o)["skeletons"] = picojson::value(arr);
+  }
+
+  if (!node.skin.empty()) {
+    (*o)["skin"] = picojson::value(node.skin);
+  }
+
   return true;
 }
 
@@ -257,6 +298,10 @@ bool EncodeAccessors(
       buf["max"] = picojson::value(arr);
     }
 
+    if (it->second.extensions.IsObject()) {
+      EncodeValue(&buf["extensions"], it->second.extensions);
+    }
+
     (*o)[it->first] = picojson::value(buf);
   }
 
@@ -307,6 +352,87 @@ bool EncodeMeshes(picojson::object* o,
   return true;
 }
 
+bool EncodeAnimations(
+    picojson::object* o,
+    const std::map<std::string, tinygltf::Animation>& animations) {
+  std::map<std::string, tinygltf::Animation>::const_iterator it(
+      animations.begin());
+  std::map<std::string, tinygltf::Animation>::const_iterator itEnd(
+      animations.end());
+  for (; it != itEnd; it++) {
+    picojson::object buf;
+    if (!it->second.name.empty()) {
+      buf["name"] = picojson::value(it->second.name);
+    }
+
+    picojson::array channels;
+    for (size_t i = 0; i < it->second.channels.size(); i++) {
+      const tinygltf::AnimationChannel& channel = it->second.channels[i];
+      picojson::object target;
+      target["id"] = picojson::value(channel.target_id);
+      target["path"] = picojson::value(channel.target_path);
+      picojson::object c;
+      c["sampler"] = picojson::value(channel.sampler);
+      c["target"] = picojson::value(target);
+      channels.push_back(picojson::value(c));
+    }
+    buf["channels"] = picojson::value(channels);
+
+    picojson::object parameters;
+    std::map<std::string, tinygltf::Parameter>::const_iterator param(
+        it->second.parameters.begin());
+    for (; param != it->second.parameters.end(); param++) {
+      parameters[param->first] = picojson::value(param->second.string_value);
+    }
+    buf["parameters"] = picojson::value(parameters);
+
+    picojson::object samplers;
+    std::map<std::string, tinygltf::AnimationSampler>::const_iterator sampler(
+        it->second.samplers.begin());
+    for (; sampler != it->second.samplers.end(); sampler++) {
+      picojson::object s;
+      s["input"] = picojson::value(sampler->second.input);
+      s["output"] = picojson::value(sampler->second.output);
+      if (!sampler->second.interpolation.empty()) {
+        s["interpolation"] = picojson::value(sampler->second.interpolation);
+      }
+      samplers[sampler->first] = picojson::value(s);
+    }
+    buf["samplers"] = picojson::value(samplers);
+
+    (*o)[it->first] = picojson::value(buf);
+  }
+  return true;
+}
+
+bool EncodeSkins(picojson::object* o,
+                 const std::map<std::string, tinygltf::Skin>& skins) {
+  std::map<std::string, tinygltf::Skin>::const_iterator it(skins.begin());
+  std::map<std::string, tinygltf::Skin>::const_iterator itEnd(skins.end());
+  for (; it != itEnd; it++) {
+    picojson::object buf;
+    if (!it->second.name.empty()) {
+      buf["name"] = picojson::value(it->second.name);
+    }
+
+    if (!it->second.bindShapeMatrix.empty()) {
+      picojson::array arr;
+      EncodeFloatArray(&arr, it->second.bindShapeMatrix);
+      buf["bindShapeMatrix"] = picojson::value(arr);
+    }
+
+    buf["inverseBindMatrices"] =
+        picojson::value(it->second.inverseBindMatrices);
+
+    picojson::array arr;
+    EncodeStringArray(&arr, it->second.jointNames);
+    buf["jointNames"] = picojson::value(arr);
+
+    (*o)[it->first] = picojson::value(buf);
+  }
+  return true;
+}
+
 bool SaveGLTF(const std::string& output_filename,
               const tinygltf::Scene& scene) {
   picojson::object root;
@@ -323,6 +449,24 @@ bool SaveGLTF(const std::string& output_filename,
     root["assets"] = picojson::value(asset);
   }
 
+  {
+    std::set<std::string> used;
+    std::map<std::string, tinygltf::Accessor>::const_iterator it(
+        scene.accessors.begin());
+    for (; it != scene.accessors.end(); it++) {
+      std::vector<std::string> keys = it->second.extensions.Keys();
+      used.insert(keys.begin(), keys.end());
+    }
+    if (!used.empty()) {
+      picojson::array arr;
+      std::set<std::string>::const_iterator name(used.begin());
+      for (; name != used.end(); name++) {
+        arr.push_back(picojson::value(*name));
+      }
+      root["extensionsUsed"] = picojson::value(arr);
+    }
+  }
+
   {
     picojson::object buffers;
     bool ret = EncodeBuffers(&buffers, scene.buffers);
@@ -358,6 +502,20 @@ bool SaveGLTF(const std::string& output_filename,
     root["nodes"] = picojson::value(nodes);
   }
 
+  {
+    picojson::object animations;
+    bool ret = EncodeAnimations(&animations, scene.animations);
+    assert(ret);
+    root["animations"] = picojson::value(animations);
+  }
+
+  {
+    picojson::object skins;
+    bool ret = EncodeSkins(&skins, scene.skins);
+    assert(ret);
+    root["skins"] = picojson::value(skins);
+  }
+
   root["scene"] = picojson::value(scene.defaultScene);
   {
     picojson::object scenes;
@@ -371,12 +529,10 @@ bool SaveGLTF(const std::string& output_filename,
   picojson::object programs;
   picojson::object techniques;
   picojson::object materials;
-  picojson::object skins;
   root["shaders"] = picojson::value(shaders);
   root["programs"] = picojson::value(programs);
   root["techniques"] = picojson::value(techniques);
   root["materials"] = picojson::value(materials);
-  root["skins"] = picojson::value(skins);
 
   picojson::value v = picojson::value(root);
 
@@ -395,14 +551,63 @@ bool SaveGLTF(const std::string& output_filename,
 
 // ----------------------------------------------------------------
 
+static void PrintUsage() {
+  printf("Needs input.gltf output.gltf [options]\n");
+  printf("Animation compression options:\n");
+  printf("  --sample-rate <keys per second>\n");
+  printf("  --translation-step <step>\n");
+  printf("  --rotation-bits <bits>\n");
+  printf("  --tolerance <distance>          (translations and scales)\n");
+  printf("  --angle-tolerance <radians>     (rotations)\n");
+  printf("Attribute quantization options(8 or 16 bits):\n");
+  printf("  --quantize-positions <bits>\n");
+  printf("  --quantize-normals <bits>\n");
+  printf("  --quantize-texcoords <bits>\n");
+}
+
 int main(int argc, char** argv) {
   if (argc < 3) {
-    printf("Needs input.gltf output.gltf\n");
+    PrintUsage();
     exit(1);
   }
 
+  tinygltf::AnimationCompression compression;
+  int position_bits = 0;
+  int normal_bits = 0;
+  int texcoord_bits = 0;
+  for (int i = 3; i < argc; i++) {
+    std::string option(argv[i]);
+    if (i + 1 >= argc) {
+      PrintUsage();
+      exit(1);
+    }
+    double value = atof(argv[++i]);
+    if (option.compare("--sample-rate") == 0) {
+      compression.sampleRate = value;
+    } else if (option.compare("--translation-step") == 0) {
+      compression.translationStep = value;
+    } else if (option.compare("--rotation-bits") == 0) {
+      compression.rotationBits = static_cast<int>(value);
+    } else if (option.compare("--tolerance") == 0) {
+      compression.translationTolerance = value;
+      compression.scaleTolerance = value;
+    } else if (option.compare("--angle-tolerance") == 0) {
+      compression.rotationTolerance = value;
+    } else if (option.compare("--quantize-positions") == 0) {
+      position_bits = static_cast<int>(value);
+    } else if (option.compare("--quantize-normals") == 0) {
+      normal_bits = static_cast<int>(value);
+    } else if (option.compare("--quantize-texcoords") == 0) {
+      texcoord_bits = static_cast<int>(value);
+    } else {
+      PrintUsage();
+      exit(1);
+    }
+  }
+
   tinygltf::Scene scene;
   tinygltf::TinyGLTFLoader loader;
+  loader.SetAnimationCompression(compression);
   std::string err;
   std::string input_filename(argv[1]);
   std::string ext = GetFilePathExtension(input_filename);
@@ -425,6 +630,30 @@ int main(int argc, char** argv) {
     return -1;
   }
 
+  // Normals are signed, positions and texcoords are offset to unsigned.
+  err.clear();
+  if ((position_bits > 0) &&
+      !tinygltf::QuantizeAttributes(
+          &scene, &err, "POSITION",
+          (position_bits > 8) ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+                              : TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)) {
+    printf("Err: %s\n", err.c_str());
+  }
+  if ((normal_bits > 0) &&
+      !tinygltf::QuantizeAttributes(&scene, &err, "NORMAL",
+                                    (normal_bits > 8)
+                                        ? TINYGLTF_COMPONENT_TYPE_SHORT
+                                        : TINYGLTF_COMPONENT_TYPE_BYTE)) {
+    printf("Err: %s\n", err.c_str());
+  }
+  if ((texcoord_bits > 0) &&
+      !tinygltf::QuantizeAttributes(
+          &scene, &err, "TEXCOORD_0",
+          (texcoord_bits > 8) ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+                              : TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)) {
+    printf("Err: %s\n", err.c_str());
+  }
+
   ret = SaveGLTF(argv[2], scene);
 
   return ret ? EXIT_SUCCESS : EXIT_FAILURE;
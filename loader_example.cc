@@ -170,7 +170,7 @@ static std::string PrintFilterMode(int mode) {
   return "**UNKNOWN**";
 }
 
-static std::string PrintFloatArray(const std::vector<double> &arr) {
+static std::string PrintFloatArray(const tinygltf::NumberArray &arr) {
   if (arr.size() == 0) {
     return "";
   }
@@ -185,7 +185,7 @@ static std::string PrintFloatArray(const std::vector<double> &arr) {
   return ss.str();
 }
 
-static std::string PrintStringArray(const std::vector<std::string> &arr) {
+static std::string PrintStringArray(const tinygltf::StringArray &arr) {
   if (arr.size() == 0) {
     return "";
   }
@@ -269,12 +269,22 @@ static void DumpNode(const tinygltf::Node &node, int indent) {
 
   std::cout << Indent(indent)
             << "children    : " << PrintStringArray(node.children) << std::endl;
+
+  if (!node.jointName.empty()) {
+    std::cout << Indent(indent) << "jointName   : " << node.jointName
+              << std::endl;
+  }
+  if (!node.skin.empty()) {
+    std::cout << Indent(indent) << "skin        : " << node.skin << std::endl;
+    std::cout << Indent(indent)
+              << "skeletons   : " << PrintStringArray(node.skeletons)
+              << std::endl;
+  }
 }
 
-static void DumpStringMap(const std::map<std::string, std::string> &map,
-                          int indent) {
-  std::map<std::string, std::string>::const_iterator it(map.begin());
-  std::map<std::string, std::string>::const_iterator itEnd(map.end());
+static void DumpStringMap(const tinygltf::StringMap &map, int indent) {
+  tinygltf::StringMap::const_iterator it(map.begin());
+  tinygltf::StringMap::const_iterator itEnd(map.end());
   for (; it != itEnd; it++) {
     std::cout << Indent(indent) << it->first << ": " << it->second << std::endl;
   }
@@ -324,9 +334,9 @@ static void Dump(const tinygltf::Scene &scene) {
   std::cout << "defaultScene: " << scene.defaultScene << std::endl;
 
   {
-    std::map<std::string, std::vector<std::string> >::const_iterator it(
+    tinygltf::SceneMap<tinygltf::StringArray>::type::const_iterator it(
         scene.scenes.begin());
-    std::map<std::string, std::vector<std::string> >::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::StringArray>::type::const_iterator itEnd(
         scene.scenes.end());
     std::cout << "scenes(items=" << scene.scenes.size() << ")" << std::endl;
     for (; it != itEnd; it++) {
@@ -341,9 +351,9 @@ static void Dump(const tinygltf::Scene &scene) {
   }
 
   {
-    std::map<std::string, tinygltf::Mesh>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::Mesh>::type::const_iterator it(
         scene.meshes.begin());
-    std::map<std::string, tinygltf::Mesh>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::Mesh>::type::const_iterator itEnd(
         scene.meshes.end());
     std::cout << "meshes(item=" << scene.meshes.size() << ")" << std::endl;
     for (; it != itEnd; it++) {
@@ -359,9 +369,9 @@ static void Dump(const tinygltf::Scene &scene) {
   }
 
   {
-    std::map<std::string, tinygltf::Accessor>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::Accessor>::type::const_iterator it(
         scene.accessors.begin());
-    std::map<std::string, tinygltf::Accessor>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::Accessor>::type::const_iterator itEnd(
         scene.accessors.end());
     std::cout << "accessors(items=" << scene.accessors.size() << ")"
               << std::endl;
@@ -400,9 +410,9 @@ static void Dump(const tinygltf::Scene &scene) {
   }
 
   {
-    std::map<std::string, tinygltf::Animation>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::Animation>::type::const_iterator it(
         scene.animations.begin());
-    std::map<std::string, tinygltf::Animation>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::Animation>::type::const_iterator itEnd(
         scene.animations.end());
     std::cout << "animations(items=" << scene.animations.size() << ")"
               << std::endl;
@@ -424,9 +434,9 @@ static void Dump(const tinygltf::Scene &scene) {
       }
       std::cout << "  ]" << std::endl;
 
-      std::map<std::string, tinygltf::AnimationSampler>::const_iterator
+      tinygltf::SceneMap<tinygltf::AnimationSampler>::type::const_iterator
           samplerIt(it->second.samplers.begin());
-      std::map<std::string, tinygltf::AnimationSampler>::const_iterator
+      tinygltf::SceneMap<tinygltf::AnimationSampler>::type::const_iterator
           samplerItEnd(it->second.samplers.end());
       std::cout << Indent(1) << "samplers(items=" << it->second.samplers.size()
                 << ")" << std::endl;
@@ -458,9 +468,9 @@ static void Dump(const tinygltf::Scene &scene) {
   }
 
   {
-    std::map<std::string, tinygltf::BufferView>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::BufferView>::type::const_iterator it(
         scene.bufferViews.begin());
-    std::map<std::string, tinygltf::BufferView>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::BufferView>::type::const_iterator itEnd(
         scene.bufferViews.end());
     std::cout << "bufferViews(items=" << scene.bufferViews.size() << ")"
               << std::endl;
@@ -479,22 +489,22 @@ static void Dump(const tinygltf::Scene &scene) {
   }
 
   {
-    std::map<std::string, tinygltf::Buffer>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::Buffer>::type::const_iterator it(
         scene.buffers.begin());
-    std::map<std::string, tinygltf::Buffer>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::Buffer>::type::const_iterator itEnd(
         scene.buffers.end());
     std::cout << "buffers(items=" << scene.buffers.size() << ")" << std::endl;
     for (; it != itEnd; it++) {
       std::cout << Indent(1) << "name         : " << it->first << std::endl;
-      std::cout << Indent(2) << "byteLength   : " << it->second.data.size()
+      std::cout << Indent(2) << "byteLength   : " << it->second.Size()
                 << std::endl;
     }
   }
 
   {
-    std::map<std::string, tinygltf::Material>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::Material>::type::const_iterator it(
         scene.materials.begin());
-    std::map<std::string, tinygltf::Material>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::Material>::type::const_iterator itEnd(
         scene.materials.end());
     std::cout << "materials(items=" << scene.materials.size() << ")"
               << std::endl;
@@ -515,9 +525,9 @@ static void Dump(const tinygltf::Scene &scene) {
   }
 
   {
-    std::map<std::string, tinygltf::Node>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::Node>::type::const_iterator it(
         scene.nodes.begin());
-    std::map<std::string, tinygltf::Node>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::Node>::type::const_iterator itEnd(
         scene.nodes.end());
     std::cout << "nodes(items=" << scene.nodes.size() << ")" << std::endl;
     for (; it != itEnd; it++) {
@@ -528,9 +538,9 @@ static void Dump(const tinygltf::Scene &scene) {
   }
 
   {
-    std::map<std::string, tinygltf::Image>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::Image>::type::const_iterator it(
         scene.images.begin());
-    std::map<std::string, tinygltf::Image>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::Image>::type::const_iterator itEnd(
         scene.images.end());
     std::cout << "images(items=" << scene.images.size() << ")" << std::endl;
     for (; it != itEnd; it++) {
@@ -546,9 +556,9 @@ static void Dump(const tinygltf::Scene &scene) {
   }
 
   {
-    std::map<std::string, tinygltf::Texture>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::Texture>::type::const_iterator it(
         scene.textures.begin());
-    std::map<std::string, tinygltf::Texture>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::Texture>::type::const_iterator itEnd(
         scene.textures.end());
     std::cout << "textures(items=" << scene.textures.size() << ")" << std::endl;
     for (; it != itEnd; it++) {
@@ -569,9 +579,9 @@ static void Dump(const tinygltf::Scene &scene) {
   }
 
   {
-    std::map<std::string, tinygltf::Shader>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::Shader>::type::const_iterator it(
         scene.shaders.begin());
-    std::map<std::string, tinygltf::Shader>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::Shader>::type::const_iterator itEnd(
         scene.shaders.end());
 
     std::cout << "shaders(items=" << scene.shaders.size() << ")" << std::endl;
@@ -605,9 +615,9 @@ static void Dump(const tinygltf::Scene &scene) {
   }
 
   {
-    std::map<std::string, tinygltf::Program>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::Program>::type::const_iterator it(
         scene.programs.begin());
-    std::map<std::string, tinygltf::Program>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::Program>::type::const_iterator itEnd(
         scene.programs.end());
 
     std::cout << "programs(items=" << scene.programs.size() << ")" << std::endl;
@@ -625,9 +635,9 @@ static void Dump(const tinygltf::Scene &scene) {
   }
 
   {
-    std::map<std::string, tinygltf::Technique>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::Technique>::type::const_iterator it(
         scene.techniques.begin());
-    std::map<std::string, tinygltf::Technique>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::Technique>::type::const_iterator itEnd(
         scene.techniques.end());
 
     std::cout << "techniques(items=" << scene.techniques.size() << ")"
@@ -645,9 +655,9 @@ static void Dump(const tinygltf::Scene &scene) {
                 << "parameters(items=" << it->second.parameters.size() << ")"
                 << std::endl;
 
-      std::map<std::string, tinygltf::TechniqueParameter>::const_iterator
+      tinygltf::SceneMap<tinygltf::TechniqueParameter>::type::const_iterator
           paramIt(it->second.parameters.begin());
-      std::map<std::string, tinygltf::TechniqueParameter>::const_iterator
+      tinygltf::SceneMap<tinygltf::TechniqueParameter>::type::const_iterator
           paramItEnd(it->second.parameters.end());
 
       for (; paramIt != paramItEnd; ++paramIt) {
@@ -668,9 +678,9 @@ static void Dump(const tinygltf::Scene &scene) {
   }
 
   {
-    std::map<std::string, tinygltf::Sampler>::const_iterator it(
+    tinygltf::SceneMap<tinygltf::Sampler>::type::const_iterator it(
         scene.samplers.begin());
-    std::map<std::string, tinygltf::Sampler>::const_iterator itEnd(
+    tinygltf::SceneMap<tinygltf::Sampler>::type::const_iterator itEnd(
         scene.samplers.end());
 
     std::cout << "samplers(items=" << scene.samplers.size() << ")" << std::endl;
@@ -691,11 +701,32 @@ static void Dump(const tinygltf::Scene &scene) {
                 << std::endl;
     }
   }
+
+  {
+    tinygltf::SceneMap<tinygltf::Skin>::type::const_iterator it(
+        scene.skins.begin());
+    tinygltf::SceneMap<tinygltf::Skin>::type::const_iterator itEnd(
+        scene.skins.end());
+
+    std::cout << "skins(items=" << scene.skins.size() << ")" << std::endl;
+
+    for (; it != itEnd; it++) {
+      std::cout << Indent(1) << "name (id)    : " << it->first << std::endl;
+      std::cout << Indent(2) << "name         : " << it->second.name
+                << std::endl;
+      std::cout << Indent(2) << "bindShapeMatrix     : "
+                << PrintFloatArray(it->second.bindShapeMatrix) << std::endl;
+      std::cout << Indent(2) << "inverseBindMatrices : "
+                << it->second.inverseBindMatrices << std::endl;
+      std::cout << Indent(2) << "jointNames          : "
+                << PrintStringArray(it->second.jointNames) << std::endl;
+    }
+  }
 }
 
 int main(int argc, char **argv) {
   if (argc < 2) {
-    printf("Needs input.gltf\n");
+    printf("Needs input.gltf [--open3dgc]\n");
     exit(1);
   }
 
@@ -703,6 +734,11 @@ int main(int argc, char **argv) {
   tinygltf::TinyGLTFLoader loader;
   std::string err;
   std::string input_filename(argv[1]);
+  if ((argc > 2) && (std::string(argv[2]) == "--open3dgc")) {
+    // Decodes meshes compressed with Open3DGC(experimental).
+    loader.SetMeshDecoder("Open3DGC-compression",
+                          tinygltf::DecodeOpen3DGCMesh);
+  }
   std::string ext = GetFilePathExtension(input_filename);
 
   bool ret = false;
@@ -0,0 +1,1638 @@
+// Regression checks of the tiny_gltf_loader.h API on small scenes built in
+// code: accessor reading, interleaving, bounds, transforms, animation,
+// skinning, quantization, the load modes, and the SIMD kernels against the
+// scalar ones. Run from the directory of box.gltf(`make test`). Returns non
+// zero if any check fails.
+
+#define TINYGLTF_LOADER_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#include "tiny_gltf_loader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+using namespace tinygltf;
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+      g_failures++;                                                     \
+    }                                                                   \
+  } while (0)
+
+static const float kPi = 3.14159265358979f;
+
+// Deterministic pseudo random numbers, so a failure can be reproduced.
+static unsigned int g_seed = 1;
+
+static unsigned int Random() {
+  g_seed = g_seed * 1103515245u + 12345u;
+  return (g_seed >> 8) & 0xffffff;  // 24 bits.
+}
+
+static float RandomFloat(float lo, float hi) {
+  return lo + (hi - lo) * (static_cast<float>(Random()) / 16777216.0f);
+}
+
+template <typename T>
+static T RandomValue() {
+  return static_cast<T>((Random() << 8) ^ Random());
+}
+
+template <>
+float RandomValue<float>() {
+  return RandomFloat(-1000.0f, 1000.0f);
+}
+
+template <>
+double RandomValue<double>() {
+  return static_cast<double>(RandomFloat(-1000.0f, 1000.0f)) / 3.0;
+}
+
+static bool Near(float a, float b, float eps) {
+  return std::fabs(a - b) <= eps * (1.0f + std::fabs(b));
+}
+
+// Compares `n` floats within a relative `eps`, and reports the first
+// mismatch under `name`.
+static bool NearFloats(const char *name, const float *a, const float *b,
+                       size_t n, float eps) {
+  for (size_t i = 0; i < n; i++) {
+    if (!Near(a[i], b[i], eps)) {
+      printf("%s: mismatch at %lu: %.9g vs %.9g\n", name,
+             static_cast<unsigned long>(i), a[i], b[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+static int TypeOfComponents(int n) {
+  return (n == 1) ? TINYGLTF_TYPE_SCALAR : n;  // VEC2 = 2, ...
+}
+
+// Appends `size` bytes to buffer "buffer" of `scene` in a bufferView of
+// their own, and adds accessor `id` of `count` elements over them,
+// `byte_stride` bytes apart(0 when tightly packed).
+static void AddAccessor(Scene *scene, const std::string &id, const void *data,
+                        size_t size, int component_type, int type,
+                        size_t count, size_t byte_stride = 0) {
+  Buffer &buffer = scene->buffers["buffer"];
+  buffer.data.resize((buffer.data.size() + 3) & ~static_cast<size_t>(3));
+  BufferView &view = scene->bufferViews[id + "_view"];
+  view.buffer = "buffer";
+  view.byteOffset = buffer.data.size();
+  view.byteLength = size;
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  buffer.data.insert(buffer.data.end(), bytes, bytes + size);
+
+  Accessor &accessor = scene->accessors[id];
+  accessor.bufferView = id + "_view";
+  accessor.byteOffset = 0;
+  accessor.byteStride = byte_stride;
+  accessor.componentType = component_type;
+  accessor.count = count;
+  accessor.type = type;
+}
+
+static void AddFloatAccessor(Scene *scene, const std::string &id,
+                             const std::vector<float> &values, int type) {
+  AddAccessor(scene, id, &values[0], values.size() * sizeof(float),
+              TINYGLTF_COMPONENT_TYPE_FLOAT, type,
+              values.size() /
+                  static_cast<size_t>(GetTypeSizeInComponents(type)));
+}
+
+// Runs the tasks in reverse order on the calling thread, as a task system
+// running them out of order would.
+static void ReverseExecutor(void *user_ptr, TaskFunc task, void *task_data,
+                            size_t count) {
+  (void)user_ptr;
+  for (size_t i = count; i > 0; i--) {
+    task(task_data, i - 1);
+  }
+}
+
+//
+// AccessorReader
+//
+
+// Reads `count` random elements of 3 components of type T, `pad` bytes apart,
+// and compares with the stored values.
+template <typename T>
+static void CheckAccessorReader(size_t count, size_t pad) {
+  const int n = 3;
+  const size_t stride = n * sizeof(T) + pad;
+  std::vector<unsigned char> data(count * stride);
+  for (size_t i = 0; i < count; i++) {
+    for (int c = 0; c < n; c++) {
+      T v = RandomValue<T>();
+      memcpy(&data[i * stride + c * sizeof(T)], &v, sizeof(T));
+    }
+  }
+
+  Scene scene;
+  AddAccessor(&scene, "a", &data[0], data.size(), ComponentTypeOf<T>::value,
+              TINYGLTF_TYPE_VEC3, count, pad ? stride : 0);
+  AccessorReader reader;
+  std::string err;
+  CHECK(reader.Init(scene, "a", &err));
+  CHECK(err.empty());
+  CHECK(reader.Count() == count);
+  CHECK(reader.NumComponents() == n);
+  CHECK(reader.ByteStride() == stride);
+
+  std::vector<float> values(count * n);
+  std::vector<float> normalized(count * n);
+  std::vector<unsigned int> ints(count * n);
+  reader.ReadAsFloat(&values[0]);
+  reader.ReadAsFloat(&normalized[0], true);
+  bool is_integer = std::numeric_limits<T>::is_integer;
+  CHECK(reader.ReadAsUInt32(&ints[0]) == is_integer);
+
+  AccessorView<T> view = reader.View<T>();
+  CHECK(!view.Empty());
+  CHECK(reader.View<double>().Empty());
+
+  float scale = 1.0f / static_cast<float>(std::numeric_limits<T>::max());
+  std::vector<float> expected(count * n);
+  std::vector<float> expected_normalized(count * n);
+  size_t bad_views = 0;
+  size_t bad_ints = 0;
+  for (size_t i = 0; i < count; i++) {
+    for (int c = 0; c < n; c++) {
+      T v;
+      memcpy(&v, &data[i * stride + c * sizeof(T)], sizeof(T));
+      size_t k = i * n + static_cast<size_t>(c);
+      expected[k] = static_cast<float>(v);
+      expected_normalized[k] = expected[k];
+      if (is_integer) {
+        float f = static_cast<float>(v) * scale;
+        expected_normalized[k] = (f < -1.0f) ? -1.0f : f;
+        bad_ints += (ints[k] != static_cast<unsigned int>(v));
+      }
+      bad_views += (view.Get(i, c) != v);
+    }
+  }
+  CHECK(NearFloats("ReadAsFloat", &values[0], &expected[0], values.size(),
+                   1e-6f));
+  CHECK(NearFloats("ReadAsFloat(normalized)", &normalized[0],
+                   &expected_normalized[0], normalized.size(), 1e-6f));
+  CHECK(bad_views == 0);
+  CHECK(bad_ints == 0);
+
+  // A slice reads the same elements.
+  AccessorReader slice = reader.Slice(count / 3, count / 2);
+  std::vector<float> sliced(slice.Count() * n);
+  slice.ReadAsFloat(&sliced[0]);
+  CHECK(NearFloats("Slice", &sliced[0], &expected[(count / 3) * n],
+                   sliced.size(), 0.0f));
+}
+
+static void TestAccessorReader() {
+  CheckAccessorReader<signed char>(1003, 0);
+  CheckAccessorReader<signed char>(41, 5);
+  CheckAccessorReader<unsigned char>(1003, 0);
+  CheckAccessorReader<unsigned char>(41, 1);
+  CheckAccessorReader<short>(1003, 0);
+  CheckAccessorReader<short>(41, 2);
+  CheckAccessorReader<unsigned short>(1003, 0);
+  CheckAccessorReader<unsigned short>(41, 4);
+  CheckAccessorReader<unsigned int>(257, 0);
+  CheckAccessorReader<float>(257, 0);
+  CheckAccessorReader<float>(41, 4);
+
+  // Elements past the end of the bufferView are an error.
+  Scene scene;
+  std::vector<float> values(9, 1.0f);
+  AddFloatAccessor(&scene, "a", values, TINYGLTF_TYPE_VEC3);
+  scene.accessors["a"].count = 4;
+  AccessorReader reader;
+  std::string err;
+  CHECK(!reader.Init(scene, "a", &err));
+  CHECK(!err.empty());
+  err.clear();
+  CHECK(!reader.Init(scene, "missing", &err));
+  CHECK(!err.empty());
+}
+
+//
+// InterleaveVertices
+//
+
+static void AddPrimitiveAttributes(Scene *scene, Primitive *primitive,
+                                   const std::string &prefix, size_t count) {
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::vector<unsigned short> uvs;
+  for (size_t i = 0; i < count; i++) {
+    float a = RandomFloat(0.0f, 2.0f * kPi);
+    for (int c = 0; c < 3; c++) {
+      positions.push_back(RandomFloat(-10.0f, 10.0f));
+    }
+    normals.push_back(std::cos(a));
+    normals.push_back(std::sin(a));
+    normals.push_back(0.0f);
+    uvs.push_back(static_cast<unsigned short>(Random()));
+    uvs.push_back(static_cast<unsigned short>(Random()));
+  }
+  AddFloatAccessor(scene, prefix + "positions", positions, TINYGLTF_TYPE_VEC3);
+  AddFloatAccessor(scene, prefix + "normals", normals, TINYGLTF_TYPE_VEC3);
+  AddAccessor(scene, prefix + "uvs", &uvs[0], uvs.size() * 2,
+              TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_VEC2,
+              count);
+  primitive->mode = TINYGLTF_MODE_TRIANGLES;
+  primitive->attributes["POSITION"] = prefix + "positions";
+  primitive->attributes["NORMAL"] = prefix + "normals";
+  primitive->attributes["TEXCOORD_0"] = prefix + "uvs";
+}
+
+static signed char ToNormalizedByte(float f) {
+  float v = f * 127.0f;
+  return static_cast<signed char>(v + ((v < 0.0f) ? -0.5f : 0.5f));
+}
+
+static void TestInterleaveVertices() {
+  const size_t count = 37;
+  Scene scene;
+  Primitive primitive;
+  AddPrimitiveAttributes(&scene, &primitive, "", count);
+
+  VertexLayout layout;
+  layout.Add("POSITION", TINYGLTF_COMPONENT_TYPE_FLOAT, 3);
+  // The missing 4th component is filled with 1.
+  layout.Add("NORMAL", TINYGLTF_COMPONENT_TYPE_BYTE, 4, true);
+  layout.Add("TEXCOORD_0", TINYGLTF_COMPONENT_TYPE_FLOAT, 2, true);
+  layout.Add("COLOR", TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, 4, true, true);
+  CHECK(layout.stride == 28);
+  CHECK(layout.elements.size() == 4);
+  CHECK(layout.elements[1].offset == 12);
+  CHECK(layout.elements[2].offset == 16);
+  CHECK(layout.elements[3].offset == 24);
+
+  std::vector<unsigned char> out;
+  std::string err;
+  CHECK(InterleaveVertices(&out, &err, scene, primitive, layout));
+  CHECK(err.empty());
+  CHECK(out.size() == count * layout.stride);
+  if (out.size() != count * layout.stride) {
+    return;
+  }
+
+  AccessorReader positions, normals, uvs;
+  CHECK(positions.Init(scene, "positions", &err));
+  CHECK(normals.Init(scene, "normals", &err));
+  CHECK(uvs.Init(scene, "uvs", &err));
+  size_t bad = 0;
+  for (size_t i = 0; i < count; i++) {
+    const unsigned char *vertex = &out[i * layout.stride];
+    float p[3], uv[2];
+    memcpy(p, vertex, sizeof(p));
+    memcpy(uv, vertex + 16, sizeof(uv));
+    for (int c = 0; c < 3; c++) {
+      bad += (p[c] != positions.View<float>().Get(i, c));
+      signed char b = static_cast<signed char>(vertex[12 + c]);
+      bad += (b != ToNormalizedByte(normals.View<float>().Get(i, c)));
+    }
+    bad += (static_cast<signed char>(vertex[15]) != 127);
+    for (int c = 0; c < 2; c++) {
+      float expected = uvs.View<unsigned short>().Get(i, c) / 65535.0f;
+      bad += !Near(uv[c], expected, 1e-6f);
+    }
+    bad += (vertex[24] != 0) + (vertex[25] != 0) + (vertex[26] != 0) +
+           (vertex[27] != 255);
+  }
+  CHECK(bad == 0);
+
+  // Several primitives on threads, or by an executor, give the same bytes.
+  Primitive other;
+  AddPrimitiveAttributes(&scene, &other, "other_", 1000);
+  const Primitive *primitives[3] = {&primitive, &other, &primitive};
+  for (int mode = 0; mode < 2; mode++) {
+    std::vector<unsigned char> outs[3];
+    err.clear();
+    if (mode == 0) {
+      CHECK(InterleaveVertices(outs, &err, scene, primitives, 3, layout, 3));
+    } else {
+      CHECK(InterleaveVertices(outs, &err, scene, primitives, 3, layout, 1,
+                               ReverseExecutor));
+    }
+    std::vector<unsigned char> single;
+    CHECK(InterleaveVertices(&single, &err, scene, other, layout));
+    CHECK(outs[0] == out);
+    CHECK(outs[1] == single);
+    CHECK(outs[2] == out);
+  }
+
+  // A missing attribute which isn't optional is an error.
+  VertexLayout missing;
+  missing.Add("TANGENT", TINYGLTF_COMPONENT_TYPE_FLOAT, 4);
+  err.clear();
+  CHECK(!InterleaveVertices(&out, &err, scene, primitive, missing));
+  CHECK(!err.empty());
+}
+
+//
+// ComputeAccessorBounds and UpdateAccessorBounds
+//
+
+// Compares the bounds of `count` random elements of `n` components of type
+// T, `pad` bytes apart, with the ones computed here.
+template <typename T>
+static void CheckBounds(size_t count, int n, size_t pad, int num_threads,
+                        TaskExecutor executor = NULL) {
+  const size_t stride = static_cast<size_t>(n) * sizeof(T) + pad;
+  std::vector<unsigned char> data(count * stride);
+  std::vector<double> min_values(static_cast<size_t>(n), 1e300);
+  std::vector<double> max_values(static_cast<size_t>(n), -1e300);
+  for (size_t i = 0; i < count; i++) {
+    for (int c = 0; c < n; c++) {
+      T v = RandomValue<T>();
+      if (!std::numeric_limits<T>::is_integer && (i % 97 == 5)) {
+        v = std::numeric_limits<T>::quiet_NaN();  // Ignored.
+      } else {
+        min_values[c] = std::min(min_values[c], static_cast<double>(v));
+        max_values[c] = std::max(max_values[c], static_cast<double>(v));
+      }
+      memcpy(&data[i * stride + c * sizeof(T)], &v, sizeof(T));
+    }
+  }
+
+  Scene scene;
+  AddAccessor(&scene, "a", &data[0], data.size(), ComponentTypeOf<T>::value,
+              TypeOfComponents(n), count, pad ? stride : 0);
+  AccessorReader reader;
+  std::string err;
+  CHECK(reader.Init(scene, "a", &err));
+  std::vector<double> lo, hi;
+  ComputeAccessorBounds(&lo, &hi, reader, num_threads, executor);
+  CHECK(lo == min_values);
+  CHECK(hi == max_values);
+}
+
+template <typename T>
+static void CheckBoundsOfType() {
+  for (int n = 1; n <= 4; n++) {
+    CheckBounds<T>(1001, n, 0, 1);
+    CheckBounds<T>(77, n, 3 * sizeof(T), 1);
+  }
+}
+
+static void TestAccessorBounds() {
+  CheckBoundsOfType<signed char>();
+  CheckBoundsOfType<unsigned char>();
+  CheckBoundsOfType<short>();
+  CheckBoundsOfType<unsigned short>();
+  CheckBoundsOfType<int>();
+  CheckBoundsOfType<unsigned int>();
+  CheckBoundsOfType<float>();
+  CheckBoundsOfType<double>();
+  // Large accessors are split into tasks.
+  CheckBounds<float>(200003, 3, 0, 4);
+  CheckBounds<float>(200003, 3, 4, 1, ReverseExecutor);
+
+  // No elements, no bounds.
+  Scene scene;
+  std::vector<float> values(6, 1.0f);
+  AddFloatAccessor(&scene, "a", values, TINYGLTF_TYPE_VEC3);
+  scene.accessors["a"].count = 0;
+  AccessorReader reader;
+  std::string err;
+  CHECK(reader.Init(scene, "a", &err));
+  std::vector<double> lo(1), hi(1);
+  ComputeAccessorBounds(&lo, &hi, reader);
+  CHECK(lo.empty() && hi.empty());
+
+  // Filling, verifying and recomputing the bounds of a scene.
+  values[0] = -2.0f;
+  values[5] = 3.0f;
+  scene.accessors.clear();
+  AddFloatAccessor(&scene, "b", values, TINYGLTF_TYPE_VEC3);
+  CHECK(UpdateAccessorBounds(&scene, &err, BOUNDS_FILL_MISSING));
+  Accessor &accessor = scene.accessors["b"];
+  CHECK(accessor.minValues.size() == 3);
+  CHECK(accessor.maxValues.size() == 3);
+  if (accessor.minValues.size() == 3 && accessor.maxValues.size() == 3) {
+    CHECK(accessor.minValues[0] == -2.0 && accessor.minValues[1] == 1.0);
+    CHECK(accessor.maxValues[0] == 1.0 && accessor.maxValues[2] == 3.0);
+  }
+  CHECK(UpdateAccessorBounds(&scene, &err, BOUNDS_VERIFY));
+  CHECK(err.empty());
+  accessor.maxValues[2] = 4.0;
+  CHECK(!UpdateAccessorBounds(&scene, &err, BOUNDS_VERIFY));
+  CHECK(!err.empty());
+  CHECK(accessor.maxValues[2] == 4.0);
+  err.clear();
+  CHECK(UpdateAccessorBounds(&scene, &err, BOUNDS_RECOMPUTE, 2));
+  CHECK(accessor.maxValues[2] == 3.0);
+}
+
+//
+// TransformHierarchy
+//
+
+static void SetNumbers(NumberArray *array, double a, double b, double c) {
+  array->clear();
+  array->push_back(a);
+  array->push_back(b);
+  array->push_back(c);
+}
+
+static void TestTransformHierarchy() {
+  // root: T(1, 2, 3), arm: Rz(90), hand: T(1, 0, 0) S(2)
+  Scene scene;
+  Node &root = scene.nodes["root"];
+  SetNumbers(&root.translation, 1.0, 2.0, 3.0);
+  root.children.push_back("arm");
+  Node &arm = scene.nodes["arm"];
+  arm.rotation.push_back(0.0);
+  arm.rotation.push_back(0.0);
+  arm.rotation.push_back(std::sin(kPi / 4.0));
+  arm.rotation.push_back(std::cos(kPi / 4.0));
+  arm.children.push_back("hand");
+  Node &hand = scene.nodes["hand"];
+  SetNumbers(&hand.translation, 1.0, 0.0, 0.0);
+  SetNumbers(&hand.scale, 2.0, 2.0, 2.0);
+  Node &fixed = scene.nodes["fixed"];
+  for (int i = 0; i < 16; i++) {
+    fixed.matrix.push_back((i % 5 == 0) ? 1.0 : 0.0);
+  }
+  fixed.matrix[14] = 5.0;
+
+  CompiledScene compiled;
+  std::string err;
+  CHECK(CompileScene(&compiled, &err, scene));
+  TransformHierarchy hierarchy;
+  CHECK(hierarchy.Build(compiled, &err));
+  CHECK(err.empty());
+  CHECK(hierarchy.NumNodes() == 4);
+  int root_index = compiled.nodes.Find("root");
+  int arm_index = compiled.nodes.Find("arm");
+  int hand_index = compiled.nodes.Find("hand");
+  int fixed_index = compiled.nodes.Find("fixed");
+  CHECK(hierarchy.Parent(root_index) == -1);
+  CHECK(hierarchy.Parent(arm_index) == root_index);
+  CHECK(hierarchy.Parent(hand_index) == arm_index);
+
+  // Parents come first.
+  const std::vector<int> &order = hierarchy.Order();
+  std::vector<size_t> positions(order.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    positions[static_cast<size_t>(order[i])] = i;
+  }
+  CHECK(positions[root_index] < positions[arm_index]);
+  CHECK(positions[arm_index] < positions[hand_index]);
+
+  const float *world = hierarchy.WorldMatrix(hand_index);
+  const float expected[16] = {0, 2, 0, 0, -2, 0, 0, 0,
+                              0, 0, 2, 0, 1,  3, 3, 1};
+  CHECK(NearFloats("world", world, expected, 16, 1e-6f));
+  const float translation[3] = {0, 0, 5};
+  CHECK(NearFloats("decomposed", hierarchy.Translation(fixed_index),
+                   translation, 3, 1e-6f));
+
+  // Changes are applied to the subtrees by Update.
+  const float origin[3] = {0, 0, 0};
+  hierarchy.SetTranslation(root_index, origin);
+  hierarchy.Update();
+  const float moved[3] = {0, 1, 0};
+  CHECK(NearFloats("moved", hierarchy.WorldMatrix(hand_index) + 12, moved, 3,
+                   1e-6f));
+  const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0,
+                              0, 0, 1, 0, 0, 0, 0, 1};
+  hierarchy.SetLocalMatrix(arm_index, identity);
+  hierarchy.Update();
+  const float straight[3] = {1, 0, 0};
+  CHECK(NearFloats("straight", hierarchy.WorldMatrix(hand_index) + 12,
+                   straight, 3, 1e-6f));
+  CHECK(NearFloats("fixed", hierarchy.WorldMatrix(fixed_index) + 12,
+                   translation, 3, 1e-6f));
+
+  // A cycle is an error, and is broken at one of its nodes.
+  Scene cycle;
+  cycle.nodes["a"].children.push_back("b");
+  cycle.nodes["b"].children.push_back("a");
+  CompiledScene compiled_cycle;
+  err.clear();
+  CompileScene(&compiled_cycle, &err, cycle);
+  TransformHierarchy broken;
+  err.clear();
+  CHECK(!broken.Build(compiled_cycle, &err));
+  CHECK(!err.empty());
+  CHECK(broken.NumNodes() == 2);
+  CHECK((broken.Parent(0) == -1) != (broken.Parent(1) == -1));
+}
+
+//
+// AnimationSet and AnimationState
+//
+
+// Adds a LINEAR(or STEP) channel of `path` of `node` to animation "anim", with
+// keys at `times`.
+static void AddChannel(Scene *scene, const std::string &node,
+                       const std::string &path,
+                       const std::vector<float> &times,
+                       const std::vector<float> &values, bool step = false) {
+  Animation &animation = scene->animations["anim"];
+  std::string name = node + "_" + path;
+  AddFloatAccessor(scene, name + "_time", times, TINYGLTF_TYPE_SCALAR);
+  AddFloatAccessor(scene, name, values,
+                   TypeOfComponents(static_cast<int>(values.size() /
+                                                     times.size())));
+  animation.parameters[name + "_TIME"].string_value = name + "_time";
+  animation.parameters[name].string_value = name;
+  AnimationSampler &sampler = animation.samplers[name];
+  sampler.input = name + "_TIME";
+  sampler.output = name;
+  sampler.interpolation = step ? "STEP" : "LINEAR";
+  AnimationChannel channel;
+  channel.sampler = name;
+  channel.target_id = node;
+  channel.target_path = path;
+  animation.channels.push_back(channel);
+}
+
+static std::string NodeName(int i) {
+  std::string name("n");
+  name += static_cast<char>('0' + i);
+  return name;
+}
+
+static void AxisRotation(float *q, int axis, float angle) {
+  q[0] = q[1] = q[2] = 0.0f;
+  q[axis] = std::sin(angle / 2.0f);
+  q[3] = std::cos(angle / 2.0f);
+}
+
+// Nodes "n0" to "n5" turn about an axis from 0 to a different angle, and move
+// from the origin, in 2 seconds. "step" jumps along x every second.
+static void BuildAnimatedScene(Scene *scene) {
+  std::vector<float> times;
+  times.push_back(0.0f);
+  times.push_back(2.0f);
+  for (int i = 0; i < 6; i++) {
+    std::string node = NodeName(i);
+    scene->nodes[node];
+    std::vector<float> rotations(8);
+    AxisRotation(&rotations[0], i % 3, 0.0f);
+    AxisRotation(&rotations[4], i % 3, (30.0f + 20.0f * i) * kPi / 180.0f);
+    AddChannel(scene, node, "rotation", times, rotations);
+    std::vector<float> translations(6, 0.0f);
+    translations[3] = 2.0f;
+    translations[4] = static_cast<float>(i);
+    AddChannel(scene, node, "translation", times, translations);
+  }
+  scene->nodes["step"];
+  std::vector<float> step_times;
+  std::vector<float> steps;
+  for (int i = 0; i < 3; i++) {
+    step_times.push_back(static_cast<float>(i));
+    steps.push_back(static_cast<float>(i));
+    steps.push_back(0.0f);
+    steps.push_back(0.0f);
+  }
+  AddChannel(scene, "step", "translation", step_times, steps, true);
+}
+
+static void CheckAnimatedNodes(const CompiledScene &compiled,
+                               const TransformHierarchy &hierarchy,
+                               float time) {
+  float t = std::min(std::max(time, 0.0f), 2.0f) / 2.0f;
+  for (int i = 0; i < 6; i++) {
+    std::string node = NodeName(i);
+    int index = compiled.nodes.Find(node);
+    float rotation[4];
+    AxisRotation(rotation, i % 3, t * (30.0f + 20.0f * i) * kPi / 180.0f);
+    CHECK(NearFloats("rotation", hierarchy.Rotation(index), rotation, 4,
+                     3e-6f));
+    float translation[3] = {2.0f * t, i * t, 0.0f};
+    CHECK(NearFloats("translation", hierarchy.Translation(index),
+                     translation, 3, 1e-6f));
+    // A root's world matrix is its local matrix.
+    CHECK(NearFloats("world", hierarchy.WorldMatrix(index) + 12, translation,
+                     3, 1e-6f));
+  }
+  int step = compiled.nodes.Find("step");
+  float x = std::floor(std::min(std::max(time, 0.0f), 2.0f));
+  CHECK(hierarchy.Translation(step)[0] == x);
+}
+
+static void TestAnimation() {
+  Scene scene;
+  BuildAnimatedScene(&scene);
+  CompiledScene compiled;
+  std::string err;
+  CHECK(CompileScene(&compiled, &err, scene));
+  AnimationSet set;
+  CHECK(set.Build(scene, compiled, &err));
+  CHECK(err.empty());
+  CHECK(set.rotationTracks.size() == 6);
+  CHECK(set.translationTracks.size() == 7);
+  CHECK(set.durations.size() == 1 && set.durations[0] == 2.0f);
+
+  // Two instances of the same set, played at different times.
+  TransformHierarchy first, second;
+  CHECK(first.Build(compiled, &err));
+  CHECK(second.Build(compiled, &err));
+  AnimationState first_state, second_state;
+  first_state.Init(&set);
+  second_state.Init(&set);
+  const float times[] = {-1.0f, 0.0f,  0.25f, 0.5f, 0.999f, 1.0f,
+                         1.5f,  0.75f, 1.99f, 2.0f, 5.0f};
+  for (size_t i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+    first_state.Evaluate(times[i], &first);
+    first.Update();
+    float other = 2.0f - times[i];
+    second_state.Evaluate(&other, &second);  // Per animation times.
+    second.Update();
+    CheckAnimatedNodes(compiled, first, times[i]);
+    CheckAnimatedNodes(compiled, second, other);
+  }
+
+  // An unknown path is an error, and only its channel is skipped.
+  scene.animations["anim"].channels[0].target_path = "shear";
+  err.clear();
+  CHECK(!set.Build(scene, compiled, &err));
+  CHECK(!err.empty());
+  CHECK(set.rotationTracks.size() == 5);
+}
+
+//
+// CompressAnimations
+//
+
+// Samples node `node` of `scene` at `time` into `trs`(translation, rotation
+// and scale).
+static void SampleNode(const Scene &scene, const std::string &node, float time,
+                       float *trs) {
+  CompiledScene compiled;
+  std::string err;
+  CompileScene(&compiled, &err, scene);
+  AnimationSet set;
+  set.Build(scene, compiled, &err);
+  TransformHierarchy hierarchy;
+  hierarchy.Build(compiled, &err);
+  AnimationState state;
+  state.Init(&set);
+  state.Evaluate(time, &hierarchy);
+  int index = compiled.nodes.Find(node);
+  memcpy(trs, hierarchy.Translation(index), 3 * sizeof(float));
+  memcpy(trs + 3, hierarchy.Rotation(index), 4 * sizeof(float));
+  memcpy(trs + 7, hierarchy.Scale(index), 3 * sizeof(float));
+}
+
+// 241 keys in 2 seconds: a linear translation and rotation, which reduce to
+// their end keys, and a scale which doesn't.
+static void BuildDenseAnimation(Scene *scene) {
+  std::vector<float> times, translations, rotations, scales;
+  for (int k = 0; k <= 240; k++) {
+    float t = k / 120.0f;
+    times.push_back(t);
+    translations.push_back(1.0f + 3.0f * t);
+    translations.push_back(-t);
+    translations.push_back(0.5f);
+    float q[4];
+    AxisRotation(q, 1, t * kPi / 4.0f);
+    rotations.insert(rotations.end(), q, q + 4);
+    scales.push_back(1.0f + 0.5f * std::sin(3.0f * t));
+    scales.push_back(1.0f);
+    scales.push_back(1.0f);
+  }
+  scene->nodes["node"];
+  AddChannel(scene, "node", "translation", times, translations);
+  AddChannel(scene, "node", "rotation", times, rotations);
+  AddChannel(scene, "node", "scale", times, scales);
+}
+
+static void TestCompressAnimations() {
+  Scene original;
+  BuildDenseAnimation(&original);
+  Scene scene;
+  BuildDenseAnimation(&scene);
+  size_t size = scene.buffers["buffer"].Size();
+
+  AnimationCompression options;
+  options.translationTolerance = 1e-4;
+  options.rotationTolerance = 1e-4;
+  options.scaleTolerance = 1e-3;
+  std::string err;
+  CHECK(CompressAnimations(&scene, &err, options));
+  CHECK(err.empty());
+  CHECK(scene.buffers["buffer"].Size() < size / 3);
+  CHECK(scene.accessors["node_translation"].count == 2);
+  CHECK(scene.accessors["node_rotation"].count == 2);
+  CHECK(scene.accessors["node_scale"].count < 241);
+
+  float max_error[3] = {0.0f, 0.0f, 0.0f};
+  for (int i = -10; i <= 2010; i += 7) {
+    float time = i / 1000.0f;
+    float expected[10], trs[10];
+    SampleNode(original, "node", time, expected);
+    SampleNode(scene, "node", time, trs);
+    for (int c = 0; c < 10; c++) {
+      int part = (c < 3) ? 0 : (c < 7) ? 1 : 2;
+      max_error[part] =
+          std::max(max_error[part], std::fabs(trs[c] - expected[c]));
+    }
+  }
+  CHECK(max_error[0] < 2e-4f);
+  CHECK(max_error[1] < 2e-4f);
+  CHECK(max_error[2] < 2e-3f);
+
+  // Resampling keeps the first and the last key time.
+  Scene resampled;
+  BuildDenseAnimation(&resampled);
+  AnimationCompression rate;
+  rate.sampleRate = 30.0;
+  CHECK(CompressAnimations(&resampled, &err, rate));
+  CHECK(resampled.accessors["node_translation"].count == 61);
+
+  // Invalid settings are an error.
+  AnimationCompression invalid;
+  invalid.rotationBits = 1;
+  CHECK(!CompressAnimations(&resampled, &err, invalid));
+  CHECK(!err.empty());
+}
+
+//
+// SkinJoints, SkinnedPrimitive and SkinVertices
+//
+
+// Column major rotation of `angle` about `axis`(normalized) and translation.
+static void RotationMatrix(float *m, const float *axis, float angle,
+                           const float *translation) {
+  float c = std::cos(angle);
+  float s = std::sin(angle);
+  float x = axis[0], y = axis[1], z = axis[2];
+  m[0] = c + x * x * (1 - c);
+  m[1] = y * x * (1 - c) + z * s;
+  m[2] = z * x * (1 - c) - y * s;
+  m[4] = x * y * (1 - c) - z * s;
+  m[5] = c + y * y * (1 - c);
+  m[6] = z * y * (1 - c) + x * s;
+  m[8] = x * z * (1 - c) + y * s;
+  m[9] = y * z * (1 - c) - x * s;
+  m[10] = c + z * z * (1 - c);
+  m[3] = m[7] = m[11] = 0.0f;
+  m[12] = translation[0];
+  m[13] = translation[1];
+  m[14] = translation[2];
+  m[15] = 1.0f;
+}
+
+// Skins the vertices of `primitive` in double precision.
+static void SkinReference(std::vector<float> *positions,
+                          std::vector<float> *normals,
+                          const SkinnedPrimitive &primitive,
+                          const float *matrices) {
+  size_t count = primitive.NumVertices();
+  positions->resize(3 * count);
+  normals->resize(3 * count);
+  for (size_t v = 0; v < count; v++) {
+    double m[16] = {0};
+    for (int k = 0; k < 4; k++) {
+      const float *joint = matrices + 16 * primitive.joints[4 * v + k];
+      for (int i = 0; i < 16; i++) {
+        m[i] += static_cast<double>(joint[i]) * primitive.weights[4 * v + k];
+      }
+    }
+    const float *p = &primitive.positions[3 * v];
+    const float *n = &primitive.normals[3 * v];
+    double normal[3];
+    double length = 0.0;
+    for (int r = 0; r < 3; r++) {
+      (*positions)[3 * v + r] = static_cast<float>(
+          m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r]);
+      normal[r] = m[r] * n[0] + m[4 + r] * n[1] + m[8 + r] * n[2];
+      length += normal[r] * normal[r];
+    }
+    length = std::sqrt(length);
+    for (int r = 0; r < 3; r++) {
+      (*normals)[3 * v + r] = static_cast<float>(normal[r] / length);
+    }
+  }
+}
+
+// `count` vertices of 4 random joints of `num_joints`, with random
+// transforms in `matrices`.
+static void BuildRandomSkin(SkinnedPrimitive *primitive,
+                            std::vector<float> *matrices, size_t count,
+                            size_t num_joints) {
+  for (size_t v = 0; v < count; v++) {
+    float weights[4];
+    float sum = 0.0f;
+    for (int k = 0; k < 4; k++) {
+      weights[k] = RandomFloat(0.0f, 1.0f);
+      sum += weights[k];
+      primitive->joints.push_back(
+          static_cast<unsigned short>(Random() % num_joints));
+    }
+    for (int k = 0; k < 4; k++) {
+      primitive->weights.push_back(weights[k] / sum);
+    }
+    for (int c = 0; c < 3; c++) {
+      primitive->positions.push_back(RandomFloat(-2.0f, 2.0f));
+      primitive->normals.push_back(RandomFloat(-1.0f, 1.0f));
+    }
+  }
+  primitive->numJoints = num_joints;
+  matrices->resize(16 * num_joints);
+  for (size_t j = 0; j < num_joints; j++) {
+    float axis[3] = {RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f),
+                     RandomFloat(-1.0f, 1.0f)};
+    float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] +
+                             axis[2] * axis[2]);
+    for (int c = 0; c < 3; c++) {
+      axis[c] /= length;
+    }
+    float translation[3] = {RandomFloat(-1.0f, 1.0f),
+                            RandomFloat(-1.0f, 1.0f),
+                            RandomFloat(-1.0f, 1.0f)};
+    RotationMatrix(&(*matrices)[16 * j], axis, RandomFloat(-kPi, kPi),
+                   translation);
+  }
+}
+
+static void TestSkinning() {
+  // j1 is 1 above j0. Vertices: on j0, on j1, halfway, on j0.
+  Scene scene;
+  Node &j0 = scene.nodes["j0"];
+  j0.jointName = "J0";
+  j0.children.push_back("j1");
+  Node &j1 = scene.nodes["j1"];
+  j1.jointName = "J1";
+  SetNumbers(&j1.translation, 0.0, 1.0, 0.0);
+  Node &mesh_node = scene.nodes["mesh_node"];
+  mesh_node.skin = "skin";
+  mesh_node.skeletons.push_back("j0");
+  mesh_node.meshes.push_back("mesh");
+
+  float bind[32];
+  const float zero[3] = {0, 0, 0};
+  const float below[3] = {0, -1, 0};
+  const float axis[3] = {0, 0, 1};
+  RotationMatrix(bind, axis, 0.0f, zero);
+  RotationMatrix(bind + 16, axis, 0.0f, below);
+  std::vector<float> matrices(bind, bind + 32);
+  AddFloatAccessor(&scene, "ibm", matrices, TINYGLTF_TYPE_MAT4);
+  Skin &skin = scene.skins["skin"];
+  skin.inverseBindMatrices = "ibm";
+  skin.jointNames.push_back("J0");
+  skin.jointNames.push_back("J1");
+
+  const float positions[] = {0, 0, 0, 0, 1.5f, 0, 0, 1, 0, 1, 0, 0};
+  const float normals[] = {0, 1, 0, 1, 0, 0, 1, 0, 0, 0, 0, 1};
+  const float joints[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0};
+  const float weights[] = {1, 0, 0, 0,    1, 0, 0, 0,
+                           0.5f, 0.5f, 0, 0, 1, 0, 0, 0};
+  AddFloatAccessor(&scene, "positions",
+                   std::vector<float>(positions, positions + 12),
+                   TINYGLTF_TYPE_VEC3);
+  AddFloatAccessor(&scene, "normals",
+                   std::vector<float>(normals, normals + 12),
+                   TINYGLTF_TYPE_VEC3);
+  AddFloatAccessor(&scene, "joints", std::vector<float>(joints, joints + 16),
+                   TINYGLTF_TYPE_VEC4);
+  AddFloatAccessor(&scene, "weights",
+                   std::vector<float>(weights, weights + 16),
+                   TINYGLTF_TYPE_VEC4);
+  Primitive primitive;
+  primitive.mode = TINYGLTF_MODE_TRIANGLES;
+  primitive.attributes["POSITION"] = "positions";
+  primitive.attributes["NORMAL"] = "normals";
+  primitive.attributes["JOINT"] = "joints";
+  primitive.attributes["WEIGHT"] = "weights";
+  scene.meshes["mesh"].primitives.push_back(primitive);
+
+  CompiledScene compiled;
+  std::string err;
+  CHECK(CompileScene(&compiled, &err, scene));
+  TransformHierarchy hierarchy;
+  CHECK(hierarchy.Build(compiled, &err));
+  SkinJoints skin_joints;
+  CHECK(skin_joints.Init(scene, compiled, compiled.nodes.Find("mesh_node"),
+                         &err));
+  CHECK(skin_joints.NumJoints() == 2);
+  CHECK(!skin_joints.Init(scene, compiled, compiled.nodes.Find("j0"), &err));
+  CHECK(skin_joints.Init(scene, compiled, compiled.nodes.Find("mesh_node"),
+                         &err));
+  SkinnedPrimitive skinned;
+  err.clear();
+  CHECK(skinned.Init(scene, primitive, &err));
+  CHECK(err.empty());
+  CHECK(skinned.NumVertices() == 4);
+  CHECK(skinned.numJoints == 2);
+
+  // The rest pose leaves the vertices as they are.
+  std::vector<float> joint_matrices;
+  skin_joints.ComputeMatrices(&joint_matrices, hierarchy);
+  CHECK(joint_matrices.size() == 32);
+  float out[12], out_normals[12];
+  CHECK(SkinVertices(out, out_normals, &err, skinned, &joint_matrices[0], 2));
+  CHECK(NearFloats("rest", out, positions, 12, 1e-6f));
+  CHECK(NearFloats("rest normals", out_normals, normals, 12, 1e-6f));
+
+  // Turning j1 by 90 degrees about z.
+  float rotation[4];
+  AxisRotation(rotation, 2, kPi / 2.0f);
+  hierarchy.SetRotation(compiled.nodes.Find("j1"), rotation);
+  hierarchy.Update();
+  skin_joints.ComputeMatrices(&joint_matrices, hierarchy);
+  CHECK(SkinVertices(out, out_normals, &err, skinned, &joint_matrices[0], 2));
+  const float turned[] = {0, 0, 0, -0.5f, 1, 0, 0, 1, 0, 1, 0, 0};
+  CHECK(NearFloats("turned", out, turned, 12, 1e-6f));
+  const float turned_normal[3] = {0, 1, 0};
+  CHECK(NearFloats("turned normal", out_normals + 3, turned_normal, 3,
+                   1e-6f));
+
+  // Joint indices beyond the matrices are an error.
+  err.clear();
+  CHECK(!SkinVertices(out, NULL, &err, skinned, &joint_matrices[0], 1));
+  CHECK(!err.empty());
+
+  // Many vertices, on threads and by an executor.
+  SkinnedPrimitive large;
+  std::vector<float> large_matrices;
+  BuildRandomSkin(&large, &large_matrices, 20003, 40);
+  std::vector<float> expected, expected_normals;
+  SkinReference(&expected, &expected_normals, large, &large_matrices[0]);
+  for (int mode = 0; mode < 3; mode++) {
+    std::vector<float> p(expected.size()), n(expected.size());
+    TaskExecutor executor = (mode == 2) ? ReverseExecutor : NULL;
+    err.clear();
+    CHECK(SkinVertices(&p[0], &n[0], &err, large, &large_matrices[0], 40,
+                       (mode == 1) ? 4 : 1, executor));
+    CHECK(NearFloats("skinned", &p[0], &expected[0], p.size(), 2e-5f));
+    CHECK(NearFloats("skinned normals", &n[0], &expected_normals[0],
+                     n.size(), 2e-5f));
+  }
+}
+
+//
+// QuantizeAttributes and QuantizedAttribute
+//
+
+static void TestQuantizeAttributes() {
+  const size_t count = 333;
+  Scene scene;
+  std::vector<float> positions, normals;
+  for (size_t i = 0; i < count; i++) {
+    positions.push_back(RandomFloat(-3.0f, 5.0f));
+    positions.push_back(RandomFloat(0.0f, 1.0f));
+    positions.push_back(RandomFloat(10.0f, 20.0f));
+    for (int c = 0; c < 3; c++) {
+      normals.push_back(RandomFloat(-1.0f, 1.0f));
+    }
+  }
+  AddFloatAccessor(&scene, "positions", positions, TINYGLTF_TYPE_VEC3);
+  AddFloatAccessor(&scene, "normals", normals, TINYGLTF_TYPE_VEC3);
+  Primitive primitive;
+  primitive.mode = TINYGLTF_MODE_TRIANGLES;
+  primitive.attributes["POSITION"] = "positions";
+  primitive.attributes["NORMAL"] = "normals";
+  scene.meshes["mesh"].primitives.push_back(primitive);
+  size_t size = scene.buffers["buffer"].Size();
+
+  std::string err;
+  CHECK(QuantizeAttributes(&scene, &err, "POSITION",
+                           TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT));
+  CHECK(err.empty());
+  CHECK(QuantizeAttributes(&scene, &err, "NORMAL",
+                           TINYGLTF_COMPONENT_TYPE_BYTE));
+  CHECK(err.empty());
+  CHECK(scene.buffers["buffer"].Size() < size / 2);
+
+  const char *ids[2] = {"positions", "normals"};
+  const std::vector<float> *originals[2] = {&positions, &normals};
+  const int component_types[2] = {TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT,
+                                  TINYGLTF_COMPONENT_TYPE_BYTE};
+  const float steps[2] = {65535.0f, 254.0f};
+  for (int a = 0; a < 2; a++) {
+    const Accessor &accessor = scene.accessors[ids[a]];
+    CHECK(accessor.componentType == component_types[a]);
+    CHECK(accessor.extensions.Has("WEB3D_quantized_attributes"));
+    QuantizedAttribute quantized;
+    CHECK(quantized.Init(accessor, &err));
+    CHECK(quantized.IsQuantized());
+    CHECK(quantized.numComponents == 3);
+    AccessorReader reader;
+    CHECK(reader.Init(scene, accessor, &err));
+    std::vector<float> decoded(count * 3);
+    quantized.Dequantize(&decoded[0], reader);
+
+    // Within half a step of the range of each component.
+    const std::vector<float> &original = *originals[a];
+    size_t bad = 0;
+    for (int c = 0; c < 3; c++) {
+      float lo = original[c], hi = original[c];
+      for (size_t i = 0; i < count; i++) {
+        lo = std::min(lo, original[3 * i + c]);
+        hi = std::max(hi, original[3 * i + c]);
+      }
+      float tolerance = 0.5f * (hi - lo) / steps[a] * 1.01f + 1e-5f;
+      for (size_t i = 0; i < count; i++) {
+        bad += (std::fabs(decoded[3 * i + c] - original[3 * i + c]) >
+                tolerance);
+      }
+    }
+    CHECK(bad == 0);
+  }
+
+  // Float is not a quantized type.
+  Scene other;
+  AddFloatAccessor(&other, "positions", positions, TINYGLTF_TYPE_VEC3);
+  other.meshes["mesh"].primitives.push_back(primitive);
+  CHECK(!QuantizeAttributes(&other, &err, "POSITION",
+                            TINYGLTF_COMPONENT_TYPE_FLOAT));
+  CHECK(!err.empty());
+
+  // Accessors without the extension are not quantized.
+  QuantizedAttribute plain;
+  err.clear();
+  CHECK(plain.Init(other.accessors["positions"], &err));
+  CHECK(!plain.IsQuantized());
+}
+
+//
+// Load modes
+//
+
+static const char kBinaryJSON[] =
+    "{\"asset\": {\"version\": \"1.0\"}, \"scene\": \"s\","
+    " \"scenes\": {\"s\": {\"nodes\": [\"n\"]}},"
+    " \"nodes\": {\"n\": {\"meshes\": [\"m\"],"
+    " \"extras\": {\"name\": \"triangle\", \"values\": [1, 2.5, true]}}},"
+    " \"meshes\": {\"m\": {\"primitives\": [{\"attributes\":"
+    " {\"POSITION\": \"p\"}, \"indices\": \"i\", \"mode\": 4,"
+    " \"material\": \"mat\"}]}},"
+    " \"materials\": {\"mat\": {}},"
+    " \"accessors\": {"
+    " \"p\": {\"bufferView\": \"v\", \"byteOffset\": 0, \"byteStride\": 12,"
+    " \"componentType\": 5126, \"count\": 3, \"type\": \"VEC3\"},"
+    " \"i\": {\"bufferView\": \"v\", \"byteOffset\": 36, \"byteStride\": 0,"
+    " \"componentType\": 5123, \"count\": 3, \"type\": \"SCALAR\"}},"
+    " \"bufferViews\": {\"v\": {\"buffer\": \"BUFFER\", \"byteOffset\": 0,"
+    " \"byteLength\": 42}},"
+    " \"buffers\": {\"BUFFER\": {\"byteLength\": 42, \"uri\": \"URI\"}}}";
+
+static std::string Replace(std::string s, const std::string &from,
+                           const std::string &to) {
+  size_t pos = s.find(from);
+  if (pos != std::string::npos) {
+    s.replace(pos, from.size(), to);
+  }
+  return s;
+}
+
+// The 42 bytes of the buffer of kBinaryJSON: a triangle and its indices.
+static std::vector<unsigned char> TriangleBytes() {
+  const float positions[9] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+  const unsigned short indices[3] = {0, 1, 2};
+  std::vector<unsigned char> bytes(42);
+  memcpy(&bytes[0], positions, sizeof(positions));
+  memcpy(&bytes[36], indices, sizeof(indices));
+  return bytes;
+}
+
+// A .glb(KHR_binary_glTF) with the triangle in its body.
+static std::vector<unsigned char> TriangleGLB() {
+  std::string json = Replace(kBinaryJSON, "BUFFER", "binary_glTF");
+  json = Replace(json, "URI", "data:,");
+  json = Replace(json, "BUFFER", "binary_glTF");
+  std::vector<unsigned char> body = TriangleBytes();
+  unsigned int header[5] = {0, 1, 0, 0, 0};
+  memcpy(header, "glTF", 4);
+  header[2] = static_cast<unsigned int>(20 + json.size() + body.size());
+  header[3] = static_cast<unsigned int>(json.size());
+  std::vector<unsigned char> glb(reinterpret_cast<unsigned char *>(header),
+                                 reinterpret_cast<unsigned char *>(header) +
+                                     20);
+  glb.insert(glb.end(), json.begin(), json.end());
+  glb.insert(glb.end(), body.begin(), body.end());
+  return glb;
+}
+
+static bool WriteFile(const std::string &filename, const void *data,
+                      size_t size) {
+  FILE *fp = fopen(filename.c_str(), "wb");
+  if (!fp) {
+    return false;
+  }
+  bool ok = (fwrite(data, 1, size, fp) == size);
+  fclose(fp);
+  return ok;
+}
+
+// true if `a` and `b` have the same buffers(by contents, regardless of the
+// storage mode) and the same accessors.
+static bool SameScene(const Scene &a, const Scene &b) {
+  if ((a.buffers.size() != b.buffers.size()) ||
+      (a.accessors.size() != b.accessors.size()) ||
+      (a.nodes.size() != b.nodes.size()) ||
+      (a.shaders.size() != b.shaders.size())) {
+    return false;
+  }
+  SceneMap<Buffer>::type::const_iterator it = a.buffers.begin();
+  SceneMap<Buffer>::type::const_iterator jt = b.buffers.begin();
+  for (; it != a.buffers.end(); ++it, ++jt) {
+    if ((it->first != jt->first) || (it->second.Size() != jt->second.Size()) ||
+        (memcmp(it->second.Data(), jt->second.Data(), it->second.Size()) !=
+         0)) {
+      return false;
+    }
+  }
+  SceneMap<Shader>::type::const_iterator st = a.shaders.begin();
+  SceneMap<Shader>::type::const_iterator su = b.shaders.begin();
+  for (; st != a.shaders.end(); ++st, ++su) {
+    if (st->second.source != su->second.source) {
+      return false;
+    }
+  }
+  SceneMap<Accessor>::type::const_iterator at = a.accessors.begin();
+  SceneMap<Accessor>::type::const_iterator au = b.accessors.begin();
+  for (; at != a.accessors.end(); ++at, ++au) {
+    if ((at->first != au->first) || (at->second.count != au->second.count) ||
+        (at->second.bufferView != au->second.bufferView)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void CheckTriangle(const Scene &scene) {
+  SceneMap<Node>::type::const_iterator node = scene.nodes.find("n");
+  CHECK(node != scene.nodes.end());
+  if (node == scene.nodes.end()) {
+    return;
+  }
+  const Value &extras = node->second.extras;
+  CHECK(extras.IsObject());
+  CHECK(extras.Get("name").Get<std::string>() == "triangle");
+  CHECK(extras.Get("values").ArrayLen() == 3);
+  CHECK(extras.Get("values").Get(2).Get<bool>());
+
+  AccessorReader reader;
+  std::string err;
+  CHECK(reader.Init(scene, "i", &err));
+  unsigned int indices[3] = {9, 9, 9};
+  CHECK(reader.ReadAsUInt32(indices));
+  CHECK(indices[0] == 0 && indices[1] == 1 && indices[2] == 2);
+}
+
+// The loads of .glb only check the result: the loader reports the "data:,"
+// uri of the binary body as a missing file, as it always did.
+static void TestLoadModes() {
+  std::vector<unsigned char> glb = TriangleGLB();
+  std::string err;
+
+  // Copied from memory.
+  Scene copied;
+  {
+    TinyGLTFLoader loader;
+    CHECK(loader.LoadBinaryFromMemory(
+        &copied, &err, &glb[0], static_cast<unsigned int>(glb.size())));
+    CheckTriangle(copied);
+    CHECK(!copied.buffers["binary_glTF"].IsView());
+    CHECK(copied.buffers["binary_glTF"].data.size() == 42);
+  }
+
+  // Shared storage, and lazy extras.
+  {
+    TinyGLTFLoader loader;
+    loader.SetLazyExtras(true);
+    Scene shared;
+    CHECK(loader.LoadBinaryFromStorage(&shared, &err,
+                                       SharedStorage(&glb[0], glb.size())));
+    CHECK(shared.nodes["n"].extras.IsRawJSON());
+    CheckTriangle(shared);
+    CHECK(!shared.nodes["n"].extras.IsRawJSON());
+    const Buffer &buffer = shared.buffers["binary_glTF"];
+    CHECK(buffer.IsView());
+    CHECK(buffer.data.empty());
+    CHECK(buffer.Data() == &glb[glb.size() - 42]);
+    CHECK(SameScene(shared, copied));
+  }
+
+  // Files, memory mapped or not: a .glb, and a .gltf with a .bin.
+  std::vector<unsigned char> bin = TriangleBytes();
+  std::string gltf = Replace(kBinaryJSON, "BUFFER", "b");
+  gltf = Replace(gltf, "URI", "loader_test.bin");
+  gltf = Replace(gltf, "BUFFER", "b");
+  CHECK(WriteFile("loader_test.glb", &glb[0], glb.size()));
+  CHECK(WriteFile("loader_test.bin", &bin[0], bin.size()));
+  CHECK(WriteFile("loader_test.gltf", gltf.data(), gltf.size()));
+  for (int mmap = 0; mmap < 2; mmap++) {
+    TinyGLTFLoader loader;
+    loader.SetMemoryMapping(mmap != 0);
+    Scene binary, ascii;
+    CHECK(loader.LoadBinaryFromFile(&binary, &err, "loader_test.glb"));
+    CHECK(SameScene(binary, copied));
+    CHECK(binary.buffers["binary_glTF"].data.empty() == (mmap != 0));
+    err.clear();
+    CHECK(loader.LoadASCIIFromFile(&ascii, &err, "loader_test.gltf"));
+    CHECK(err.empty());
+    CheckTriangle(ascii);
+    CHECK(ascii.buffers["b"].Size() == 42);
+    CHECK(memcmp(ascii.buffers["b"].Data(), &bin[0], 42) == 0);
+  }
+  remove("loader_test.glb");
+  remove("loader_test.bin");
+  remove("loader_test.gltf");
+
+  // Threads, an executor, recycled scenes and an arena load the same.
+  TinyGLTFLoader loader;
+  Scene box;
+  err.clear();
+  CHECK(loader.LoadASCIIFromFile(&box, &err, "box.gltf"));
+  CHECK(err.empty());
+  CHECK(box.buffers.size() == 1 && box.shaders.size() == 2);
+  for (int mode = 0; mode < 4; mode++) {
+    TinyGLTFLoader other;
+    other.SetAccessorBounds(BOUNDS_VERIFY);
+    Scene scene;
+    if (mode == 0) {
+      other.SetNumThreads(4);
+    } else if (mode == 1) {
+      other.SetTaskExecutor(ReverseExecutor);
+    } else if (mode == 2) {
+      CHECK(other.LoadASCIIFromFile(&scene, &err, "box.gltf"));
+      other.RecycleScene(&scene);
+      CHECK(scene.buffers.empty() && scene.accessors.empty());
+    }
+#ifdef TINYGLTF_USE_ARENA
+    Arena arena(4096);
+    if (mode == 3) {
+      other.SetArena(&arena);
+    }
+#endif
+    {
+      Scene loaded;
+      CHECK(other.LoadASCIIFromFile(mode == 2 ? &scene : &loaded, &err,
+                                    "box.gltf"));
+      CHECK(err.empty());
+      CHECK(SameScene(mode == 2 ? scene : loaded, box));
+    }
+#ifdef TINYGLTF_USE_ARENA
+    arena.Reset();
+#endif
+  }
+}
+
+//
+// SIMD kernels against the scalar ones
+//
+
+#if defined(TINYGLTF_SIMD_X86)
+
+static std::string Base64Encode(const std::vector<unsigned char> &bytes) {
+  static const char kChars[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string s;
+  for (size_t i = 0; i < bytes.size(); i += 3) {
+    unsigned int v = static_cast<unsigned int>(bytes[i]) << 16;
+    if (i + 1 < bytes.size()) v |= static_cast<unsigned int>(bytes[i + 1]) << 8;
+    if (i + 2 < bytes.size()) v |= bytes[i + 2];
+    s += kChars[(v >> 18) & 63];
+    s += kChars[(v >> 12) & 63];
+    s += (i + 1 < bytes.size()) ? kChars[(v >> 6) & 63] : '=';
+    s += (i + 2 < bytes.size()) ? kChars[v & 63] : '=';
+  }
+  return s;
+}
+
+// The kernels decode whole groups of 4 characters, and the padded group at
+// the end is left to base64_decode.
+static void CheckBase64Kernels(int features) {
+  for (size_t size = 0; size < 400; size += 37) {
+    std::vector<unsigned char> bytes(size);
+    for (size_t i = 0; i < size; i++) {
+      bytes[i] = static_cast<unsigned char>(Random());
+    }
+    std::string text = Base64Encode(bytes);
+    std::string decoded = base64_decode(text);
+    CHECK(decoded == std::string(bytes.begin(), bytes.end()));
+
+    bytes.resize(size - size % 3);
+    text.resize(bytes.size() / 3 * 4);
+    for (int kernel = 0; kernel < 3; kernel++) {
+      if (((kernel == 1) && !(features & TINYGLTF_SIMD_SSSE3)) ||
+          ((kernel == 2) && !(features & TINYGLTF_SIMD_AVX2))) {
+        continue;
+      }
+      std::vector<unsigned char> out(bytes.size() + 1);
+      size_t consumed = 0;
+      size_t o = 0;
+      if (kernel == 1) {
+        o = Base64DecodeSSSE3(&out[0], out.size(), text.data(), text.size(),
+                              &consumed);
+      } else if (kernel == 2) {
+        o = Base64DecodeAVX2(&out[0], out.size(), text.data(), text.size(),
+                             &consumed);
+      }
+      size_t rest = 0;
+      o += Base64DecodeScalar(&out[o], text.data() + consumed,
+                              text.size() - consumed, &rest);
+      CHECK(consumed + rest == text.size());
+      CHECK(o == bytes.size());
+      out.resize(bytes.size());
+      CHECK(out == bytes);
+    }
+  }
+}
+
+template <typename T>
+static void CheckConvertKernels(int features) {
+  const size_t n = 1000;
+  std::vector<unsigned char> src(n * sizeof(T));
+  for (size_t i = 0; i < src.size(); i++) {
+    src[i] = static_cast<unsigned char>(Random());
+  }
+  for (int normalized = 0; normalized < 2; normalized++) {
+    float scale = normalized ? NormalizedScale<T>() : 1.0f;
+    float lo = (normalized && std::numeric_limits<T>::is_signed)
+                   ? -1.0f
+                   : -std::numeric_limits<float>::infinity();
+    std::vector<float> scalar(n), sse(n, -9.0f), avx2(n, -9.0f);
+    ConvertElementsToFloat<T, 1>(&scalar[0], &src[0], n, sizeof(T), scale, lo);
+    if (features & TINYGLTF_SIMD_SSSE3) {
+      size_t i = ConvertToFloatSSE<T>(&sse[0], &src[0], n, scale, lo);
+      CHECK(i == n);
+      CHECK(sse == scalar);
+    }
+    if (features & TINYGLTF_SIMD_AVX2) {
+      size_t i = ConvertToFloatAVX2<T>(&avx2[0], &src[0], n, scale, lo);
+      CHECK(i == n);
+      CHECK(avx2 == scalar);
+    }
+  }
+  std::vector<unsigned int> scalar(n), sse(n), avx2(n);
+  ConvertElementsToUInt32<T, 1>(&scalar[0], &src[0], n, sizeof(T));
+  if (features & TINYGLTF_SIMD_SSSE3) {
+    CHECK(ConvertToUInt32SSE<T>(&sse[0], &src[0], n) == n);
+    CHECK(sse == scalar);
+  }
+  if (features & TINYGLTF_SIMD_AVX2) {
+    CHECK(ConvertToUInt32AVX2<T>(&avx2[0], &src[0], n) == n);
+    CHECK(avx2 == scalar);
+  }
+}
+
+template <typename T, int N>
+static void CheckBoundsKernels(int features) {
+  const size_t count = 501;
+  const size_t pad = 2 * sizeof(T);
+  std::vector<unsigned char> src(count * (N * sizeof(T) + pad));
+  for (size_t i = 0; i < src.size() / sizeof(T); i++) {
+    T v = RandomValue<T>();
+    if (!std::numeric_limits<T>::is_integer && (i % 89 == 3)) {
+      v = std::numeric_limits<T>::quiet_NaN();
+    }
+    memcpy(&src[i * sizeof(T)], &v, sizeof(T));
+  }
+
+  // Tightly packed, then strided, elements.
+  for (int strided = 0; strided < 2; strided++) {
+    const size_t stride = N * sizeof(T) + (strided ? pad : 0);
+    T scalar_lo[N], scalar_hi[N];
+    std::fill(scalar_lo, scalar_lo + N, BoundsMinStart<T>());
+    std::fill(scalar_hi, scalar_hi + N, BoundsMaxStart<T>());
+    UpdateBoundsScalar(scalar_lo, scalar_hi, &src[0], count, stride, N);
+    for (int kernel = 0; kernel < 2; kernel++) {
+      if (!(features & ((kernel == 0) ? TINYGLTF_SIMD_SSSE3
+                                      : TINYGLTF_SIMD_AVX2)) ||
+          (strided && ((kernel == 1) || (N * sizeof(T) > 16)))) {
+        continue;  // Strided elements are read by 16 byte SSE loads only.
+      }
+      T lo[N], hi[N];
+      std::fill(lo, lo + N, BoundsMinStart<T>());
+      std::fill(hi, hi + N, BoundsMaxStart<T>());
+      size_t i;
+      if (strided) {
+        i = UpdateBoundsStridedSSE<T>(lo, hi, &src[0], count, stride, N);
+      } else if (kernel == 0) {
+        i = UpdateBoundsPackedSSE<T, N>(lo, hi, &src[0], count);
+      } else {
+        i = UpdateBoundsPackedAVX2<T, N>(lo, hi, &src[0], count);
+      }
+      CHECK(i > 0);
+      UpdateBoundsScalar(lo, hi, &src[i * stride], count - i, stride, N);
+      CHECK(std::equal(lo, lo + N, scalar_lo));
+      CHECK(std::equal(hi, hi + N, scalar_hi));
+    }
+  }
+}
+
+template <typename T>
+static void CheckBoundsKernelsOfType(int features) {
+  CheckBoundsKernels<T, 1>(features);
+  CheckBoundsKernels<T, 2>(features);
+  CheckBoundsKernels<T, 3>(features);
+  CheckBoundsKernels<T, 4>(features);
+}
+
+template <typename T>
+static void CheckQuantizeKernels(int features) {
+  if (!(features & TINYGLTF_SIMD_SSSE3)) {
+    return;
+  }
+  const size_t n = 1000;
+  std::vector<float> in(n);
+  for (size_t i = 0; i < n; i++) {
+    in[i] = RandomFloat(-1.2f, 1.2f);  // Some are clamped.
+  }
+  in[7] = std::numeric_limits<float>::quiet_NaN();
+  float scale = static_cast<float>(std::numeric_limits<T>::max());
+  float hi = QuantizeMax<T>();
+  float lo = std::numeric_limits<T>::is_signed ? -hi : 0.0f;
+  std::vector<unsigned char> scalar(n * sizeof(T)), sse(n * sizeof(T));
+  QuantizeScalar<T>(&scalar[0], &in[0], n, scale, lo, hi);
+  CHECK(QuantizeSSSE3<T>(&sse[0], &in[0], n, scale, lo, hi) == n);
+  CHECK(sse == scalar);
+}
+
+static void CheckKeyKernels(int features) {
+  if (!(features & TINYGLTF_SIMD_SSSE3)) {
+    return;
+  }
+  const size_t n = 103;
+  std::vector<float> from(4 * n), to(4 * n), factors(n);
+  for (size_t i = 0; i < n; i++) {
+    float a[3] = {RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(-1, 1)};
+    float length = std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    float angle = RandomFloat(-kPi, kPi);
+    for (int c = 0; c < 3; c++) {
+      from[4 * i + c] = a[c] / length * std::sin(angle / 2.0f);
+      to[4 * i + c] = RandomFloat(-1.0f, 1.0f);
+    }
+    from[4 * i + 3] = std::cos(angle / 2.0f);
+    to[4 * i + 3] = RandomFloat(-1.0f, 1.0f);
+    float l = 0.0f;
+    for (int c = 0; c < 4; c++) {
+      l += to[4 * i + c] * to[4 * i + c];
+    }
+    for (int c = 0; c < 4; c++) {
+      to[4 * i + c] /= std::sqrt(l);
+    }
+    factors[i] = (i % 10 == 0) ? 0.0f : (i % 10 == 1) ? 1.0f
+                                                     : RandomFloat(0, 1);
+  }
+  // Nearly equal and opposite keys.
+  for (int c = 0; c < 4; c++) {
+    to[c] = from[c];
+    to[4 + c] = -from[4 + c];
+  }
+
+  std::vector<float> scalar(4 * n), sse(4 * n);
+  LerpKeysScalar(&scalar[0], &from[0], &to[0], &factors[0], n);
+  LerpKeysSSE(&sse[0], &from[0], &to[0], &factors[0], n);
+  CHECK(NearFloats("lerp", &sse[0], &scalar[0], 4 * n, 1e-6f));
+
+  SlerpKeysScalar(&scalar[0], &from[0], &to[0], &factors[0], n);
+  size_t i = SlerpKeysSSE(&sse[0], &from[0], &to[0], &factors[0], n);
+  CHECK(i == n - n % 4);
+  SlerpKeysScalar(&sse[4 * i], &from[4 * i], &to[4 * i], &factors[i], n - i);
+  CHECK(NearFloats("slerp", &sse[0], &scalar[0], 4 * n, 1e-6f));
+}
+
+static void CheckDequantizeKernels(int features) {
+  const size_t count = 3 * 1001;
+  float scale[kDequantizePeriod], offset[kDequantizePeriod];
+  for (size_t i = 0; i < 3; i++) {
+    scale[i] = RandomFloat(0.0f, 0.01f);
+    offset[i] = RandomFloat(-5.0f, 5.0f);
+  }
+  for (size_t i = 3; i < kDequantizePeriod; i++) {
+    scale[i] = scale[i % 3];
+    offset[i] = offset[i % 3];
+  }
+  std::vector<float> values(count);
+  for (size_t i = 0; i < count; i++) {
+    values[i] = static_cast<float>(Random() & 0xffff);
+  }
+  std::vector<float> scalar(values);
+  ScaleOffsetScalar(&scalar[0], count, scale, offset, 3);
+  for (int kernel = 0; kernel < 2; kernel++) {
+    if (!(features &
+          ((kernel == 0) ? TINYGLTF_SIMD_SSSE3 : TINYGLTF_SIMD_AVX2))) {
+      continue;
+    }
+    std::vector<float> simd(values);
+    size_t i = (kernel == 0)
+                   ? ScaleOffsetSSE(&simd[0], count, scale, offset)
+                   : ScaleOffsetAVX2(&simd[0], count, scale, offset);
+    CHECK((i > 0) && (i % kDequantizePeriod == 0));
+    // The kernels keep the phase of the components.
+    ScaleOffsetScalar(&simd[i], count - i, scale, offset, 3);
+    CHECK(NearFloats("dequantize", &simd[0], &scalar[0], count, 1e-6f));
+  }
+}
+
+static void CheckMatrixKernels(int features) {
+  if (!(features & TINYGLTF_SIMD_SSSE3)) {
+    return;
+  }
+  // A chain and some roots.
+  const size_t count = 50;
+  std::vector<float> locals(16 * count);
+  std::vector<int> parents(count);
+  for (size_t i = 0; i < count; i++) {
+    float axis[3] = {0.6f, 0.8f, 0.0f};
+    float translation[3] = {RandomFloat(-1, 1), RandomFloat(-1, 1),
+                            RandomFloat(-1, 1)};
+    RotationMatrix(&locals[16 * i], axis, RandomFloat(-kPi, kPi),
+                   translation);
+    parents[i] = (i % 7 == 0) ? -1 : static_cast<int>(i) - 1;
+  }
+  std::vector<float> scalar(16 * count), sse(16 * count);
+  ComputeWorldMatricesScalar(&scalar[0], &locals[0], &parents[0], 0, count);
+  ComputeWorldMatricesSSE(&sse[0], &locals[0], &parents[0], 0, count);
+  CHECK(NearFloats("world matrices", &sse[0], &scalar[0], sse.size(), 1e-5f));
+}
+
+static void CheckSkinKernels(int features) {
+  SkinnedPrimitive primitive;
+  std::vector<float> matrices;
+  BuildRandomSkin(&primitive, &matrices, 1001, 20);
+  size_t n = 3 * primitive.NumVertices();
+  std::vector<float> scalar(n), scalar_normals(n);
+  SkinVerticesScalar(&scalar[0], &scalar_normals[0], primitive, &matrices[0],
+                     0, primitive.NumVertices());
+  for (int kernel = 0; kernel < 2; kernel++) {
+    if (!(features &
+          ((kernel == 0) ? TINYGLTF_SIMD_SSSE3 : TINYGLTF_SIMD_AVX2))) {
+      continue;
+    }
+    std::vector<float> p(n), normals(n);
+    if (kernel == 0) {
+      SkinVerticesSSE(&p[0], &normals[0], primitive, &matrices[0], 0,
+                      primitive.NumVertices());
+    } else {
+      SkinVerticesAVX2(&p[0], &normals[0], primitive, &matrices[0], 0,
+                       primitive.NumVertices());
+    }
+    CHECK(NearFloats("skin", &p[0], &scalar[0], n, 1e-5f));
+    CHECK(NearFloats("skin normals", &normals[0], &scalar_normals[0], n,
+                     1e-5f));
+  }
+}
+
+static void TestSIMDKernels() {
+  int features = GetSIMDFeatures();
+  printf("SIMD kernels checked: SSSE3 %s, AVX2 %s\n",
+         (features & TINYGLTF_SIMD_SSSE3) ? "yes" : "no",
+         (features & TINYGLTF_SIMD_AVX2) ? "yes" : "no");
+  CheckBase64Kernels(features);
+  CheckConvertKernels<signed char>(features);
+  CheckConvertKernels<unsigned char>(features);
+  CheckConvertKernels<short>(features);
+  CheckConvertKernels<unsigned short>(features);
+  CheckBoundsKernelsOfType<signed char>(features);
+  CheckBoundsKernelsOfType<unsigned char>(features);
+  CheckBoundsKernelsOfType<short>(features);
+  CheckBoundsKernelsOfType<unsigned short>(features);
+  CheckBoundsKernelsOfType<int>(features);
+  CheckBoundsKernelsOfType<unsigned int>(features);
+  CheckBoundsKernelsOfType<float>(features);
+  CheckBoundsKernelsOfType<double>(features);
+  CheckQuantizeKernels<signed char>(features);
+  CheckQuantizeKernels<unsigned char>(features);
+  CheckQuantizeKernels<short>(features);
+  CheckQuantizeKernels<unsigned short>(features);
+  CheckKeyKernels(features);
+  CheckDequantizeKernels(features);
+  CheckMatrixKernels(features);
+  CheckSkinKernels(features);
+}
+
+#else
+
+static void TestSIMDKernels() { printf("SIMD kernels: not compiled\n"); }
+
+#endif
+
+int main() {
+  TestAccessorReader();
+  TestInterleaveVertices();
+  TestAccessorBounds();
+  TestTransformHierarchy();
+  TestAnimation();
+  TestCompressAnimations();
+  TestSkinning();
+  TestQuantizeAttributes();
+  TestLoadModes();
+  TestSIMDKernels();
+
+  if (g_failures > 0) {
+    printf("%d check(s) failed\n", g_failures);
+    return EXIT_FAILURE;
+  }
+  printf("All checks passed\n");
+  return EXIT_SUCCESS;
+}
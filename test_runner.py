@@ -14,15 +14,19 @@ import subprocess
 base_model_dir = "/home/syoyo/work/glTF/sampleModels"
 
 kinds = [ "glTF", "glTF-Binary", "glTF-Embedded", "glTF-MaterialsCommon"]
+
+# Absolute path to .gltf files with meshes compressed by Open3DGC(e.g. the
+# output of COLLADA2GLTF with Open3DGC compression). Skipped when empty.
+o3dgc_model_dir = ""
 # ---------------------------------
 
 failed = []
 success = []
 
-def run(filename):
+def run(filename, options = []):
 
     print("Testing: " + filename)
-    cmd = ["./loader_example", filename]
+    cmd = ["./loader_example", filename] + options
     try:
         p = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
         (stdout, stderr) = p.communicate()
@@ -49,6 +53,11 @@ def test():
                 for gltf in g:
                     run(gltf)
 
+    # Loading fails if a compressed mesh can't be decoded.
+    if o3dgc_model_dir:
+        for gltf in glob.glob(o3dgc_model_dir + "/*.gltf"):
+            run(gltf, ["--open3dgc"])
+
 
 def main():
 
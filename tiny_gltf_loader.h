@@ -42,12 +42,35 @@
 #ifndef TINY_GLTF_LOADER_H_
 #define TINY_GLTF_LOADER_H_
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <deque>
+#include <list>
 #include <map>
 #include <string>
 #include <vector>
 
+// C++11 move semantics are used to avoid deep copies while loading when the
+// compiler supports them. Define TINYGLTF_NO_CPP11 to stick to C++03.
+#if !defined(TINYGLTF_USE_CPP11) && !defined(TINYGLTF_NO_CPP11)
+#if (__cplusplus >= 201103L) || (defined(_MSC_VER) && (_MSC_VER >= 1900))
+#define TINYGLTF_USE_CPP11
+#endif
+#endif
+
+#ifdef TINYGLTF_USE_CPP11
+#include <utility>
+#endif
+
+#ifdef TINYGLTF_USE_ARENA
+#include <cstddef>
+#include <new>
+#if (__cplusplus >= 201103L) || (defined(_MSC_VER) && (_MSC_VER >= 1900))
+#include <type_traits>
+#endif
+#endif
+
 namespace tinygltf {
 
 #define TINYGLTF_MODE_POINTS (0)
@@ -148,60 +171,305 @@ typedef enum {
   OBJECT_TYPE = 7
 } Type;
 
-// Simple class to represent JSON object
+#ifdef TINYGLTF_USE_ARENA
+/// Monotonic allocator for the storage of the `Scene` containers only: the
+/// arrays of `SceneVector` and the nodes of `SceneMap`. Allocation bumps a
+/// pointer in the current block, freeing does nothing, and `Reset`/`Release`
+/// drop everything at once. Not thread-safe.
+///
+/// It is not an arena for the whole `Scene`:
+/// - Strings(ids, names, URIs) are `std::string`, so those longer than its
+///   inline buffer still come from the heap.
+/// - The payloads of buffers, images and shaders come from the heap(see
+///   `TinyGLTFLoader::RecycleScene` to reuse them instead).
+/// - A `Scene` must still be destroyed or cleared before `Reset`, and its
+///   destructor walks every container, so teardown is not O(1).
+class Arena {
+ public:
+  /// Allocates blocks of `block_size` bytes(or larger, for a large request)
+  /// from the heap.
+  explicit Arena(size_t block_size = 64 * 1024);
+  /// Allocates from the caller's [buffer, buffer + size) first, then from
+  /// heap blocks. `buffer` must be 8 byte aligned and outlive the arena.
+  Arena(void *buffer, size_t size, size_t block_size = 64 * 1024);
+  ~Arena();
+
+  /// Returns 8 byte aligned storage of `size` bytes.
+  void *Allocate(size_t size);
+
+  /// Makes all the memory available again, keeping the blocks for reuse.
+  /// Objects whose containers were allocated from the arena(e.g. a `Scene`)
+  /// must be destroyed or cleared before, since their destructors read it.
+  void Reset();
+
+  /// Same as `Reset`, but also frees the heap blocks.
+  void Release();
+
+  size_t Used() const { return used_; }          // Bytes handed out.
+  size_t Reserved() const { return reserved_; }  // Bytes of all blocks.
+
+ private:
+  struct Block {
+    Block *next;
+    size_t size;  // Usable bytes following the header.
+  };
+
+  Arena(const Arena &);
+  Arena &operator=(const Arena &);
+
+  void Init(void *buffer, size_t size, size_t block_size);
+  void NextBlock(size_t size);
+
+  Block *blocks_;   // Heap blocks in allocation order.
+  Block *current_;  // Block being allocated from. NULL for `buffer_`.
+  char *buffer_;
+  size_t buffer_size_;
+  char *cur_;
+  char *end_;
+  size_t block_size_;
+  size_t used_;
+  size_t reserved_;
+};
+
+/// Allocates from `arena`, or from the heap if it is NULL. Every block records
+/// where it came from, so it may be freed in any scope.
+void *ArenaAllocate(Arena *arena, size_t size);
+void ArenaFree(void *ptr);
+
+/// Returns the current `Arena` of this thread(see `ScopedArena`), or NULL.
+Arena *CurrentArena();
+
+/// Makes `arena` the current one of this thread in the scope. Containers
+/// constructed in the scope(and `Scene`s cleared in it, see `Scene::Clear`)
+/// allocate from it.
+class ScopedArena {
+ public:
+  explicit ScopedArena(Arena *arena);
+  ~ScopedArena();
+
+ private:
+  ScopedArena(const ScopedArena &);
+  ScopedArena &operator=(const ScopedArena &);
+
+  Arena *prev_;
+};
+
+/// Allocator of an `Arena`, or of the heap when it is NULL. A default
+/// constructed one takes the current arena of the thread(`CurrentArena`) and
+/// keeps it, so a container always grows in the arena it was constructed
+/// with, and a copy of it allocates from the same arena.
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef ArenaAllocator<U> other;
+  };
+
+#if (__cplusplus >= 201103L) || (defined(_MSC_VER) && (_MSC_VER >= 1900))
+  // The arena follows the storage when containers are moved or swapped.
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+#endif
+
+  ArenaAllocator() : arena_(CurrentArena()) {}
+  explicit ArenaAllocator(Arena *arena) : arena_(arena) {}
+  ArenaAllocator(const ArenaAllocator &rhs) : arena_(rhs.arena_) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &rhs) : arena_(rhs.arena()) {}
+
+  Arena *arena() const { return arena_; }
+
+  pointer address(reference x) const { return &x; }
+  const_pointer address(const_reference x) const { return &x; }
+
+  pointer allocate(size_type n, const void * = 0) {
+    return static_cast<pointer>(ArenaAllocate(arena_, n * sizeof(T)));
+  }
+  void deallocate(pointer p, size_type) { ArenaFree(p); }
+
+  size_type max_size() const { return size_type(-1) / sizeof(T); }
+
+  void construct(pointer p, const T &val) {
+    new (static_cast<void *>(p)) T(val);
+  }
+  void destroy(pointer p) { p->~T(); }
+
+  bool operator==(const ArenaAllocator &rhs) const {
+    return (arena_ == rhs.arena_);
+  }
+  bool operator!=(const ArenaAllocator &rhs) const {
+    return (arena_ != rhs.arena_);
+  }
+
+ private:
+  Arena *arena_;
+};
+
+#endif
+
+/// Allocator of the containers owned by `Scene`: `ArenaAllocator` when
+/// `TINYGLTF_USE_ARENA` is defined, otherwise the standard one.
+template <typename T>
+struct SceneAllocator {
+#ifdef TINYGLTF_USE_ARENA
+  typedef ArenaAllocator<T> type;
+#else
+  typedef std::allocator<T> type;
+#endif
+};
+
+template <typename T>
+struct SceneVector {
+  typedef std::vector<T, typename SceneAllocator<T>::type> type;
+};
+
+template <typename T>
+struct SceneMap {
+  typedef std::pair<const std::string, T> value_type;
+  typedef std::map<std::string, T, std::less<std::string>,
+                   typename SceneAllocator<value_type>::type> type;
+};
+
+typedef SceneVector<double>::type NumberArray;
+typedef SceneVector<std::string>::type StringArray;
+typedef SceneMap<std::string>::type StringMap;
+
+// Simple class to represent JSON object. A tagged union: bool, int and double
+// are stored inline, the other kinds are allocated on the heap only when the
+// value holds them, so a null `Value` is just two words.
+//
+// A value may also hold unparsed JSON text(see `FromJSON`), which is parsed on
+// the first access through any accessor. Such a value is not safe to access
+// from multiple threads until it has been parsed.
 class Value {
  public:
-  typedef std::vector<Value> Array;
-  typedef std::map<std::string, Value> Object;
+  typedef SceneVector<Value>::type Array;
+  typedef SceneMap<Value>::type Object;
+
+  Value() : type_(NULL_TYPE), pad0(0) { u_.number_value = 0.0; }
+
+  explicit Value(bool b) : type_(BOOL_TYPE), pad0(0) {
+    u_.number_value = 0.0;
+    u_.boolean_value = b;
+  }
+  explicit Value(int i) : type_(INT_TYPE), pad0(0) {
+    u_.number_value = 0.0;
+    u_.int_value = i;
+  }
+  explicit Value(double n) : type_(NUMBER_TYPE), pad0(0) {
+    u_.number_value = n;
+  }
+  explicit Value(const std::string &s) : type_(STRING_TYPE), pad0(0) {
+    u_.string_value = new std::string(s);
+  }
+  explicit Value(const unsigned char *p, size_t n)
+      : type_(BINARY_TYPE), pad0(0) {
+    u_.binary_value = new std::vector<unsigned char>(p, p + n);
+  }
+  explicit Value(const Array &a) : type_(ARRAY_TYPE), pad0(0) {
+    u_.array_value = new Array(a);
+  }
+  explicit Value(const Object &o) : type_(OBJECT_TYPE), pad0(0) {
+    u_.object_value = new Object(o);
+  }
 
-  Value() : type_(NULL_TYPE) {}
+  Value(const Value &rhs);
+  ~Value() { Clear(); }
 
-  explicit Value(bool b) : type_(BOOL_TYPE) { boolean_value_ = b; }
-  explicit Value(int i) : type_(INT_TYPE) { int_value_ = i; }
-  explicit Value(double n) : type_(NUMBER_TYPE) { number_value_ = n; }
-  explicit Value(const std::string &s) : type_(STRING_TYPE) {
-    string_value_ = s;
+  // Takes `rhs` by value, so assigning a temporary doesn't copy twice.
+  Value &operator=(Value rhs) {
+    Swap(rhs);
+    return *this;
   }
-  explicit Value(const unsigned char *p, size_t n) : type_(BINARY_TYPE) {
-    binary_value_.resize(n);
-    memcpy(binary_value_.data(), p, n);
+
+#ifdef TINYGLTF_USE_CPP11
+  Value(Value &&rhs) noexcept : type_(rhs.type_), pad0(0), u_(rhs.u_) {
+    rhs.type_ = NULL_TYPE;
+  }
+  explicit Value(std::string &&s) : type_(STRING_TYPE), pad0(0) {
+    u_.string_value = new std::string(std::move(s));
+  }
+  explicit Value(Array &&a) : type_(ARRAY_TYPE), pad0(0) {
+    u_.array_value = new Array(std::move(a));
+  }
+  explicit Value(Object &&o) : type_(OBJECT_TYPE), pad0(0) {
+    u_.object_value = new Object(std::move(o));
   }
-  explicit Value(const Array &a) : type_(ARRAY_TYPE) {
-    array_value_ = Array(a);
+#endif
+
+  // Creates a value from JSON text `json`, which is kept as is and parsed on
+  // first access. Invalid JSON then yields a null value.
+  static Value FromJSON(const std::string &json) {
+    Value v;
+    v.type_ = RAW_JSON_TYPE;
+    v.u_.string_value = new std::string(json);
+    return v;
+  }
+
+  // true if the value still holds the JSON text given to `FromJSON`.
+  bool IsRawJSON() const { return (type_ == RAW_JSON_TYPE); }
+
+  // The JSON text of a value which is not parsed yet. Empty otherwise.
+  const std::string &RawJSON() const {
+    static std::string &empty = *(new std::string());
+    return IsRawJSON() ? *u_.string_value : empty;
   }
-  explicit Value(const Object &o) : type_(OBJECT_TYPE) {
-    object_value_ = Object(o);
+
+  void Swap(Value &rhs) {
+    std::swap(type_, rhs.type_);
+    std::swap(u_, rhs.u_);
   }
 
-  char Type() const { return static_cast<const char>(type_); }
+  char Type() const {
+    Materialize();
+    return static_cast<char>(type_);
+  }
 
-  bool IsBool() const { return (type_ == BOOL_TYPE); }
+  bool IsBool() const { return (Type() == BOOL_TYPE); }
 
-  bool IsInt() const { return (type_ == INT_TYPE); }
+  bool IsInt() const { return (Type() == INT_TYPE); }
 
-  bool IsNumber() const { return (type_ == NUMBER_TYPE); }
+  bool IsNumber() const { return (Type() == NUMBER_TYPE); }
 
-  bool IsString() const { return (type_ == STRING_TYPE); }
+  bool IsString() const { return (Type() == STRING_TYPE); }
 
-  bool IsBinary() const { return (type_ == BINARY_TYPE); }
+  bool IsBinary() const { return (Type() == BINARY_TYPE); }
 
-  bool IsArray() const { return (type_ == ARRAY_TYPE); }
+  bool IsArray() const { return (Type() == ARRAY_TYPE); }
 
-  bool IsObject() const { return (type_ == OBJECT_TYPE); }
+  bool IsObject() const { return (Type() == OBJECT_TYPE); }
 
-  // Accessor
+  // Accessor. The const version returns an empty `T` if the value holds
+  // another type, and the value is left as is. The non-const version asserts
+  // that the value holds a `T`(use `SetType` first to change its type); with
+  // asserts disabled, a value of another type is made an empty `T`.
   template <typename T>
   const T &Get() const;
   template <typename T>
   T &Get();
 
+  // Makes the value an empty value of `type`(e.g. OBJECT_TYPE), unless it
+  // already holds that type.
+  void SetType(int type) {
+    if (Type() != type) Reset(type);
+  }
+
   // Lookup value from an array
   const Value &Get(int idx) const {
     static Value &null_value = *(new Value());
     assert(IsArray());
     assert(idx >= 0);
-    return (static_cast<size_t>(idx) < array_value_.size())
-               ? array_value_[static_cast<size_t>(idx)]
+    return (IsArray() && (static_cast<size_t>(idx) < u_.array_value->size()))
+               ? (*u_.array_value)[static_cast<size_t>(idx)]
                : null_value;
   }
 
@@ -209,20 +477,21 @@ class Value {
   const Value &Get(const std::string &key) const {
     static Value &null_value = *(new Value());
     assert(IsObject());
-    Object::const_iterator it = object_value_.find(key);
-    return (it != object_value_.end()) ? it->second : null_value;
+    if (!IsObject()) return null_value;
+    Object::const_iterator it = u_.object_value->find(key);
+    return (it != u_.object_value->end()) ? it->second : null_value;
   }
 
   size_t ArrayLen() const {
     if (!IsArray()) return 0;
-    return array_value_.size();
+    return u_.array_value->size();
   }
 
   // Valid only for object type.
   bool Has(const std::string &key) const {
     if (!IsObject()) return false;
-    Object::const_iterator it = object_value_.find(key);
-    return (it != object_value_.end()) ? true : false;
+    Object::const_iterator it = u_.object_value->find(key);
+    return (it != u_.object_value->end()) ? true : false;
   }
 
   // List keys
@@ -230,8 +499,8 @@ class Value {
     std::vector<std::string> keys;
     if (!IsObject()) return keys;  // empty
 
-    for (Object::const_iterator it = object_value_.begin();
-         it != object_value_.end(); ++it) {
+    for (Object::const_iterator it = u_.object_value->begin();
+         it != u_.object_value->end(); ++it) {
       keys.push_back(it->first);
     }
 
@@ -239,50 +508,70 @@ class Value {
   }
 
  protected:
-  int type_;
-
-  int int_value_;
-  double number_value_;
-  std::string string_value_;
-  std::vector<unsigned char> binary_value_;
-  Array array_value_;
-  Object object_value_;
-  bool boolean_value_;
-  char pad[3];
-
+  // Type of a value created by `FromJSON` until it is parsed. Its text is
+  // held in `string_value`.
+  enum { RAW_JSON_TYPE = OBJECT_TYPE + 1 };
+
+  // Frees the heap storage and makes the value null.
+  void Clear();
+  // Makes the value an empty value of `type`.
+  void Reset(int type);
+  // Parses the JSON text of a `FromJSON` value.
+  void Materialize() const {
+    if (type_ == RAW_JSON_TYPE) ParseRawJSON();
+  }
+  void ParseRawJSON() const;
+
+  // Mutable so that const accessors can parse JSON text on demand.
+  mutable int type_;
   int pad0;
+
+  mutable union {
+    bool boolean_value;
+    int int_value;
+    double number_value;
+    std::string *string_value;
+    std::vector<unsigned char> *binary_value;
+    Array *array_value;
+    Object *object_value;
+  } u_;
 };
 
-#define TINYGLTF_VALUE_GET(ctype, var)            \
+#define TINYGLTF_VALUE_GET(ctype, tag, var)       \
   template <>                                     \
   inline const ctype &Value::Get<ctype>() const { \
-    return var;                                   \
+    static ctype &empty = *(new ctype());         \
+    return (Type() == tag) ? var : empty;         \
   }                                               \
   template <>                                     \
   inline ctype &Value::Get<ctype>() {             \
+    assert(Type() == tag);                        \
+    SetType(tag);                                 \
     return var;                                   \
   }
-TINYGLTF_VALUE_GET(bool, boolean_value_)
-TINYGLTF_VALUE_GET(double, number_value_)
-TINYGLTF_VALUE_GET(int, int_value_)
-TINYGLTF_VALUE_GET(std::string, string_value_)
-TINYGLTF_VALUE_GET(std::vector<unsigned char>, binary_value_)
-TINYGLTF_VALUE_GET(Value::Array, array_value_)
-TINYGLTF_VALUE_GET(Value::Object, object_value_)
+TINYGLTF_VALUE_GET(bool, BOOL_TYPE, u_.boolean_value)
+TINYGLTF_VALUE_GET(double, NUMBER_TYPE, u_.number_value)
+TINYGLTF_VALUE_GET(int, INT_TYPE, u_.int_value)
+TINYGLTF_VALUE_GET(std::string, STRING_TYPE, *u_.string_value)
+TINYGLTF_VALUE_GET(std::vector<unsigned char>, BINARY_TYPE,
+                   *u_.binary_value)
+TINYGLTF_VALUE_GET(Value::Array, ARRAY_TYPE, *u_.array_value)
+TINYGLTF_VALUE_GET(Value::Object, OBJECT_TYPE, *u_.object_value)
 #undef TINYGLTF_VALUE_GET
 
 typedef struct {
   std::string string_value;
-  std::vector<double> number_array;
+  NumberArray number_array;
 } Parameter;
 
-typedef std::map<std::string, Parameter> ParameterMap;
+typedef SceneMap<Parameter>::type ParameterMap;
 
 typedef struct {
   std::string sampler;
   std::string target_id;
   std::string target_path;
   Value extras;
+  Value extensions;
 } AnimationChannel;
 
 typedef struct {
@@ -290,14 +579,16 @@ typedef struct {
   std::string interpolation;
   std::string output;
   Value extras;
+  Value extensions;
 } AnimationSampler;
 
 typedef struct {
   std::string name;
-  std::vector<AnimationChannel> channels;
-  std::map<std::string, AnimationSampler> samplers;
+  SceneVector<AnimationChannel>::type channels;
+  SceneMap<AnimationSampler>::type samplers;
   ParameterMap parameters;
   Value extras;
+  Value extensions;
 } Animation;
 
 typedef struct {
@@ -309,6 +600,7 @@ typedef struct {
   int wrapR;  // TinyGLTF extension
   int pad0;
   Value extras;
+  Value extensions;
 } Sampler;
 
 typedef struct {
@@ -322,7 +614,14 @@ typedef struct {
   std::string bufferView;  // KHR_binary_glTF extenstion.
   std::string mimeType;    // KHR_binary_glTF extenstion.
 
+  // Source of an image which is not decoded yet(see
+  // `TinyGLTFLoader::SetDeferredImageDecoding`): an external file, the
+  // encoded bytes of a data URI, or `bufferView`.
+  std::string encodedPath;
+  std::vector<unsigned char> encoded;
+
   Value extras;
+  Value extensions;
 } Image;
 
 typedef struct {
@@ -334,6 +633,7 @@ typedef struct {
   int type;
   std::string name;
   Value extras;
+  Value extensions;
 } Texture;
 
 typedef struct {
@@ -342,6 +642,7 @@ typedef struct {
   ParameterMap values;
 
   Value extras;
+  Value extensions;
 } Material;
 
 typedef struct {
@@ -352,6 +653,7 @@ typedef struct {
   int target;
   int pad0;
   Value extras;
+  Value extensions;
 } BufferView;
 
 typedef struct {
@@ -364,9 +666,10 @@ typedef struct {
   size_t count;
   int type;  // One of TINYGLTF_TYPE_***
   int pad1;
-  std::vector<double> minValues;  // Optional
-  std::vector<double> maxValues;  // Optional
+  NumberArray minValues;  // Optional
+  NumberArray maxValues;  // Optional
   Value extras;
+  Value extensions;
 } Accessor;
 
 class Camera {
@@ -385,48 +688,153 @@ class Camera {
 };
 
 typedef struct {
-  std::map<std::string, std::string> attributes;  // A dictionary object of
-                                                  // strings, where each string
-                                                  // is the ID of the accessor
-                                                  // containing an attribute.
+  StringMap attributes;  // A dictionary object of strings, where each string
+                         // is the ID of the accessor containing an attribute.
   std::string material;  // The ID of the material to apply to this primitive
                          // when rendering.
   std::string indices;   // The ID of the accessor that contains the indices.
   int mode;              // one of TINYGLTF_MODE_***
   int pad0;
 
-  Value extras;  // "extra" property
+  Value extras;      // "extra" property
+  Value extensions;  // "extensions" property
 } Primitive;
 
 typedef struct {
   std::string name;
-  std::vector<Primitive> primitives;
+  SceneVector<Primitive>::type primitives;
   Value extras;
+  Value extensions;
 } Mesh;
 
 class Node {
  public:
   Node() {}
   ~Node() {}
+#ifdef TINYGLTF_USE_CPP11
+  Node(const Node &) = default;
+  Node(Node &&) = default;
+  Node &operator=(const Node &) = default;
+  Node &operator=(Node &&) = default;
+#endif
 
   std::string camera;  // camera object referenced by this node.
 
   std::string name;
-  std::vector<std::string> children;
-  std::vector<double> rotation;     // length must be 0 or 4
-  std::vector<double> scale;        // length must be 0 or 3
-  std::vector<double> translation;  // length must be 0 or 3
-  std::vector<double> matrix;       // length must be 0 or 16
-  std::vector<std::string> meshes;
+  StringArray children;
+  NumberArray rotation;     // length must be 0 or 4
+  NumberArray scale;        // length must be 0 or 3
+  NumberArray translation;  // length must be 0 or 3
+  NumberArray matrix;       // length must be 0 or 16
+  StringArray meshes;
+
+  std::string jointName;  // Name of the node as a joint of skins.
+  StringArray skeletons;  // Roots of the joint hierarchies of `skin`.
+  std::string skin;       // Skin of `meshes`.
 
   Value extras;
+  Value extensions;
 };
 
 typedef struct {
   std::string name;
+  NumberArray bindShapeMatrix;      // Column major 4x4. Identity when empty.
+  std::string inverseBindMatrices;  // Required. Accessor of MAT4, per joint.
+  StringArray jointNames;           // Required. `Node::jointName` of joints.
+  Value extras;
+  Value extensions;
+} Skin;
+
+// Reference counted handle to an immutable block of bytes which is not owned
+// by a single `Buffer`(e.g. a memory mapped file or a caller's cache entry).
+// `release` is called once the last handle referencing the block goes away.
+// Without `release` the block is just borrowed and the owner must keep it
+// alive while any handle exists.
+class SharedStorage {
+ public:
+  typedef void (*ReleaseFunc)(void *user_ptr, const unsigned char *data,
+                              size_t size);
+
+  SharedStorage() : block_(NULL) {}
+  SharedStorage(const unsigned char *data, size_t size,
+                ReleaseFunc release = NULL, void *user_ptr = NULL);
+  SharedStorage(const SharedStorage &rhs);
+  SharedStorage &operator=(const SharedStorage &rhs);
+  ~SharedStorage();
+
+  const unsigned char *Data() const { return block_ ? block_->data : NULL; }
+  size_t Size() const { return block_ ? block_->size : 0; }
+  bool Empty() const { return (block_ == NULL); }
+
+ private:
+  struct Block {
+    long refcount;
+    const unsigned char *data;
+    size_t size;
+    ReleaseFunc release;
+    void *user_ptr;
+  };
+
+  Block *block_;
+};
+
+// Contents of a glTF buffer. They are in `data` as before, unless the buffer
+// was loaded as a view(`IsView`): with `TinyGLTFLoader::SetMemoryMapping`
+// enabled, or by `LoadBinaryFromStorage`. `data` is then EMPTY, and the bytes
+// are only reachable through `Data()` and `Size()`, which work in both cases.
+class Buffer {
+ public:
+  Buffer() : view_data_(NULL), view_size_(0) {}
+  ~Buffer() {}
+#ifdef TINYGLTF_USE_CPP11
+  Buffer(const Buffer &) = default;
+  Buffer(Buffer &&) = default;
+  Buffer &operator=(const Buffer &) = default;
+  Buffer &operator=(Buffer &&) = default;
+#endif
+
+  std::string name;
+  // Owned storage. EMPTY when IsView(): read through Data()/Size().
   std::vector<unsigned char> data;
   Value extras;
-} Buffer;
+  Value extensions;
+
+  // Contents of the buffer regardless of the storage mode.
+  const unsigned char *Data() const {
+    if (view_data_) return view_data_;
+    return data.empty() ? NULL : &data.at(0);
+  }
+  size_t Size() const { return view_data_ ? view_size_ : data.size(); }
+
+  // true when the contents are a view into `SharedStorage` instead of `data`.
+  bool IsView() const { return (view_data_ != NULL); }
+
+  // Lets the buffer refer to [ptr, ptr + size) in `storage` without copying.
+  void SetView(const SharedStorage &storage, const unsigned char *ptr,
+               size_t size) {
+    data.clear();
+    storage_ = storage;
+    view_data_ = ptr;
+    view_size_ = size;
+  }
+
+  // Copies the viewed bytes into `data` and drops the storage reference.
+  void MakeOwned() {
+    if (!view_data_) return;
+    std::vector<unsigned char> owned(view_data_, view_data_ + view_size_);
+    data.swap(owned);
+    storage_ = SharedStorage();
+    view_data_ = NULL;
+    view_size_ = 0;
+  }
+
+  const SharedStorage &Storage() const { return storage_; }
+
+ private:
+  SharedStorage storage_;
+  const unsigned char *view_data_;
+  size_t view_size_;
+};
 
 typedef struct {
   std::string name;
@@ -435,15 +843,17 @@ typedef struct {
   std::vector<unsigned char> source;
 
   Value extras;
+  Value extensions;
 } Shader;
 
 typedef struct {
   std::string name;
   std::string vertexShader;
   std::string fragmentShader;
-  std::vector<std::string> attributes;
+  StringArray attributes;
 
   Value extras;
+  Value extensions;
 } Program;
 
 typedef struct {
@@ -459,11 +869,12 @@ typedef struct {
 typedef struct {
   std::string name;
   std::string program;
-  std::map<std::string, TechniqueParameter> parameters;
-  std::map<std::string, std::string> attributes;
-  std::map<std::string, std::string> uniforms;
+  SceneMap<TechniqueParameter>::type parameters;
+  StringMap attributes;
+  StringMap uniforms;
 
   Value extras;
+  Value extensions;
 } Technique;
 
 typedef struct {
@@ -474,1681 +885,11700 @@ typedef struct {
   bool premultipliedAlpha;
   char pad[7];
   Value extras;
+  Value extensions;
 } Asset;
 
 class Scene {
  public:
-  Scene() {}
+  Scene();
   ~Scene() {}
 
-  std::map<std::string, Accessor> accessors;
-  std::map<std::string, Animation> animations;
-  std::map<std::string, Buffer> buffers;
-  std::map<std::string, BufferView> bufferViews;
-  std::map<std::string, Material> materials;
-  std::map<std::string, Mesh> meshes;
-  std::map<std::string, Node> nodes;
-  std::map<std::string, Texture> textures;
-  std::map<std::string, Image> images;
-  std::map<std::string, Shader> shaders;
-  std::map<std::string, Program> programs;
-  std::map<std::string, Technique> techniques;
-  std::map<std::string, Sampler> samplers;
-  std::map<std::string, std::vector<std::string> > scenes;  // list of nodes
+  /// Removes everything, as in a newly constructed `Scene`. With
+  /// `TINYGLTF_USE_ARENA`, the containers then allocate from the current arena
+  /// of the thread(see `ScopedArena`). See also `TinyGLTFLoader::RecycleScene`.
+  void Clear();
+
+  /// Changes whenever the scene is constructed, cleared or loaded, so caches
+  /// of its data(e.g. `ImageCache`) tell a reloaded scene from the old one.
+  long generation;
+
+  SceneMap<Accessor>::type accessors;
+  SceneMap<Animation>::type animations;
+  SceneMap<Buffer>::type buffers;
+  SceneMap<BufferView>::type bufferViews;
+  SceneMap<Material>::type materials;
+  SceneMap<Mesh>::type meshes;
+  SceneMap<Node>::type nodes;
+  SceneMap<Texture>::type textures;
+  SceneMap<Image>::type images;
+  SceneMap<Shader>::type shaders;
+  SceneMap<Program>::type programs;
+  SceneMap<Technique>::type techniques;
+  SceneMap<Sampler>::type samplers;
+  SceneMap<Skin>::type skins;
+  SceneMap<StringArray>::type scenes;  // list of nodes
 
   std::string defaultScene;
 
   Asset asset;
 
   Value extras;
+  Value extensions;
 };
 
-enum SectionCheck {
-  NO_REQUIRE = 0x00,
-  REQUIRE_SCENE = 0x01,
-  REQUIRE_SCENES = 0x02,
-  REQUIRE_NODES = 0x04,
-  REQUIRE_ACCESSORS = 0x08,
-  REQUIRE_BUFFERS = 0x10,
-  REQUIRE_BUFFER_VIEWS = 0x20,
-  REQUIRE_ALL = 0x3f
-};
-
-class TinyGLTFLoader {
+/// A top level section of `CompiledScene`. Items are stored in the order of
+/// their ids, so an id is looked up by binary search.
+template <typename T>
+class CompiledSection {
  public:
-  TinyGLTFLoader() : bin_data_(NULL), bin_size_(0), is_binary_(false) {
-    pad[0] = pad[1] = pad[2] = pad[3] = pad[4] = pad[5] = pad[6] = 0;
+  std::vector<T> items;
+  std::vector<std::string> ids;  // Sorted. `ids[i]` is the id of `items[i]`.
+
+  size_t size() const { return items.size(); }
+  const T &operator[](size_t i) const { return items[i]; }
+
+  /// Returns the index of `id`, or -1 if there's no such item.
+  int Find(const std::string &id) const {
+    std::vector<std::string>::const_iterator it =
+        std::lower_bound(ids.begin(), ids.end(), id);
+    if ((it == ids.end()) || (*it != id)) {
+      return -1;
+    }
+    return static_cast<int>(it - ids.begin());
   }
-  ~TinyGLTFLoader() {}
+};
 
-  /// Loads glTF ASCII asset from a file.
-  /// Returns false and set error string to `err` if there's an error.
-  bool LoadASCIIFromFile(Scene *scene, std::string *err,
-                         const std::string &filename,
-                         unsigned int check_sections = REQUIRE_ALL);
+// Items of `CompiledScene`. They point to the object in the source `Scene`,
+// and references to other objects are indices(-1 if not specified).
 
-  /// Loads glTF ASCII asset from string(memory).
-  /// `length` = strlen(str);
-  /// Returns false and set error string to `err` if there's an error.
-  bool LoadASCIIFromString(Scene *scene, std::string *err, const char *str,
-                           const unsigned int length,
-                           const std::string &base_dir,
-                           unsigned int check_sections = REQUIRE_ALL);
+typedef struct {
+  const Buffer *buffer;
+} CompiledBuffer;
 
-  /// Loads glTF binary asset from a file.
-  /// Returns false and set error string to `err` if there's an error.
-  bool LoadBinaryFromFile(Scene *scene, std::string *err,
-                          const std::string &filename,
-                          unsigned int check_sections = REQUIRE_ALL);
+typedef struct {
+  const BufferView *bufferView;
+  int buffer;
+  int pad0;
+} CompiledBufferView;
 
-  /// Loads glTF binary asset from memory.
-  /// `length` = strlen(str);
-  /// Returns false and set error string to `err` if there's an error.
-  bool LoadBinaryFromMemory(Scene *scene, std::string *err,
-                            const unsigned char *bytes,
-                            const unsigned int length,
-                            const std::string &base_dir = "",
-                            unsigned int check_sections = REQUIRE_ALL);
+typedef struct {
+  const Accessor *accessor;
+  int bufferView;
+  int pad0;
+} CompiledAccessor;
 
- private:
-  /// Loads glTF asset from string(memory).
-  /// `length` = strlen(str);
-  /// Returns false and set error string to `err` if there's an error.
-  bool LoadFromString(Scene *scene, std::string *err, const char *str,
-                      const unsigned int length, const std::string &base_dir,
-                      unsigned int check_sections);
+typedef struct {
+  const std::string *semantic;  // e.g. "POSITION"
+  int accessor;
+  int pad0;
+} CompiledAttribute;
 
-  const unsigned char *bin_data_;
-  size_t bin_size_;
-  bool is_binary_;
-  char pad[7];
-};
+typedef struct {
+  const Primitive *primitive;
+  std::vector<CompiledAttribute> attributes;  // In the order of semantics.
+  int material;
+  int indices;
+} CompiledPrimitive;
 
-}  // namespace tinygltf
+typedef struct {
+  const Mesh *mesh;
+  std::vector<CompiledPrimitive> primitives;
+} CompiledMesh;
 
-#ifdef TINYGLTF_LOADER_IMPLEMENTATION
-#include <algorithm>
-//#include <cassert>
-#include <fstream>
-#include <sstream>
+typedef struct {
+  const Node *node;
+  std::vector<int> children;
+  std::vector<int> meshes;
+  // Joints of `skin` in the order of `Skin::jointNames`, found under
+  // `Node::skeletons`(-1 for a missing one).
+  std::vector<int> joints;
+  int parent;  // -1 for a root node.
+  int skin;
+} CompiledNode;
 
-#ifdef __clang__
-// Disable some warnings for external files.
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wfloat-equal"
-#pragma clang diagnostic ignored "-Wexit-time-destructors"
-#pragma clang diagnostic ignored "-Wconversion"
-#pragma clang diagnostic ignored "-Wold-style-cast"
-#pragma clang diagnostic ignored "-Wdouble-promotion"
-#pragma clang diagnostic ignored "-Wglobal-constructors"
-#pragma clang diagnostic ignored "-Wreserved-id-macro"
-#pragma clang diagnostic ignored "-Wdisabled-macro-expansion"
-#pragma clang diagnostic ignored "-Wpadded"
-#endif
+typedef struct {
+  std::vector<int> nodes;  // Root nodes.
+} CompiledSceneNodes;
 
-#define PICOJSON_USE_INT64
-#include "./picojson.h"
-#include "./stb_image.h"
-#ifdef __clang__
-#pragma clang diagnostic pop
-#endif
+typedef struct {
+  const Material *material;
+  int technique;
+  int pad0;
+} CompiledMaterial;
 
-#ifdef _WIN32
-#include <Windows.h>
-#else
-#include <wordexp.h>
-#endif
+typedef struct {
+  const Image *image;
+  int bufferView;
+  int pad0;
+} CompiledImage;
 
-#if defined(__sparcv9)
-// Big endian
-#else
-#if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || MINIZ_X86_OR_X64_CPU
-#define TINYGLTF_LITTLE_ENDIAN 1
-#endif
-#endif
+typedef struct {
+  const Texture *texture;
+  int sampler;
+  int source;  // image
+} CompiledTexture;
 
-namespace tinygltf {
+typedef struct {
+  const Shader *shader;
+} CompiledShader;
 
-static void swap4(unsigned int *val) {
-#ifdef TINYGLTF_LITTLE_ENDIAN
-  (void)val;
-#else
-  unsigned int tmp = *val;
-  unsigned char *dst = reinterpret_cast<unsigned char *>(val);
-  unsigned char *src = reinterpret_cast<unsigned char *>(&tmp);
+typedef struct {
+  const Program *program;
+  int vertexShader;
+  int fragmentShader;
+} CompiledProgram;
 
-  dst[0] = src[3];
-  dst[1] = src[2];
-  dst[2] = src[1];
-  dst[3] = src[0];
-#endif
-}
+typedef struct {
+  const Technique *technique;
+  int program;
+  int pad0;
+} CompiledTechnique;
 
-static bool FileExists(const std::string &abs_filename) {
-  bool ret;
-#ifdef _WIN32
-  FILE *fp;
-  errno_t err = fopen_s(&fp, abs_filename.c_str(), "rb");
-  if (err != 0) {
-    return false;
-  }
-#else
-  FILE *fp = fopen(abs_filename.c_str(), "rb");
-#endif
-  if (fp) {
-    ret = true;
-    fclose(fp);
-  } else {
-    ret = false;
-  }
+typedef struct {
+  const Sampler *sampler;
+} CompiledSampler;
 
-  return ret;
-}
+typedef struct {
+  const Skin *skin;
+  int inverseBindMatrices;  // accessor
+  int pad0;
+} CompiledSkin;
 
-static std::string ExpandFilePath(const std::string &filepath) {
-#ifdef _WIN32
+typedef struct {
+  const AnimationChannel *channel;
+  int sampler;  // Index into `CompiledAnimation::samplers`.
+  int node;
+} CompiledAnimationChannel;
+
+typedef struct {
+  const AnimationSampler *sampler;
+  int input;   // accessor, resolved through `Animation::parameters`.
+  int output;  // accessor, resolved through `Animation::parameters`.
+} CompiledAnimationSampler;
+
+typedef struct {
+  const Animation *animation;
+  std::vector<CompiledAnimationChannel> channels;
+  std::vector<CompiledAnimationSampler> samplers;  // In the order of ids.
+} CompiledAnimation;
+
+/// Index based form of `Scene`(see `CompileScene`), for traversals without
+/// map lookups by string ids. It refers to the source `Scene`, which must
+/// outlive it and must not be modified.
+class CompiledScene {
+ public:
+  CompiledScene() : defaultScene(-1), pad0(0) {}
+  ~CompiledScene() {}
+
+  CompiledSection<CompiledAccessor> accessors;
+  CompiledSection<CompiledAnimation> animations;
+  CompiledSection<CompiledBuffer> buffers;
+  CompiledSection<CompiledBufferView> bufferViews;
+  CompiledSection<CompiledMaterial> materials;
+  CompiledSection<CompiledMesh> meshes;
+  CompiledSection<CompiledNode> nodes;
+  CompiledSection<CompiledTexture> textures;
+  CompiledSection<CompiledImage> images;
+  CompiledSection<CompiledShader> shaders;
+  CompiledSection<CompiledProgram> programs;
+  CompiledSection<CompiledTechnique> techniques;
+  CompiledSection<CompiledSampler> samplers;
+  CompiledSection<CompiledSkin> skins;
+  CompiledSection<CompiledSceneNodes> scenes;
+
+  int defaultScene;
+  int pad0;
+};
+
+/// Builds `compiled` from `scene`, resolving every reference to an index.
+/// Returns false and set error string to `err` if there's a reference to a
+/// missing object. `compiled` is still usable then, with -1 for such
+/// references.
+bool CompileScene(CompiledScene *compiled, std::string *err,
+                  const Scene &scene);
+
+/// Local and world transforms of the nodes of a `CompiledScene`, for
+/// evaluating the node hierarchy every frame. Nodes are stored parents first
+/// in depth first order, so a subtree is a contiguous range, with the
+/// translations, rotations, scales, local and world matrices in separate
+/// float arrays. Matrices are column major. Nodes are identified by their
+/// index in `CompiledScene::nodes`.
+class TransformHierarchy {
+ public:
+  TransformHierarchy() {}
+  ~TransformHierarchy() {}
+
+  /// Orders the nodes of `compiled`, reads their local transforms and
+  /// computes the world transforms. The source `Scene` is not referred to
+  /// afterwards.
+  /// Returns false and set error string to `err` if the node hierarchy has a
+  /// cycle. Each cycle is broken at one of its nodes, which becomes a root,
+  /// so the hierarchy is still usable then.
+  bool Build(const CompiledScene &compiled, std::string *err);
+
+  size_t NumNodes() const { return order_.size(); }
+
+  /// Parent of `node`, or -1 for a root node.
+  int Parent(int node) const;
+
+  /// Nodes in the order they are evaluated, parents first.
+  const std::vector<int> &Order() const { return order_; }
+
+  /// Set a part of the local transform of `node`. The rotation is a unit
+  /// quaternion(x, y, z, w). A node whose local transform was a matrix
+  /// switches to translation, rotation and scale, with the other parts
+  /// decomposed from that matrix(see `Translation`). Applied by the next
+  /// `Update`.
+  void SetTranslation(int node, const float translation[3]);
+  void SetRotation(int node, const float rotation[4]);
+  void SetScale(int node, const float scale[3]);
+
+  /// Sets the local transform of `node` to `matrix`. Applied by the next
+  /// `Update`.
+  void SetLocalMatrix(int node, const float matrix[16]);
+
+  /// Recomputes the local matrices of the nodes changed since the last
+  /// `Update`, and the world matrices of them and their descendants.
+  void Update();
+
+  /// Parts of the local transform. For a matrix, its decomposition
+  /// assuming no shear.
+  const float *Translation(int node) const;  // 3 floats.
+  const float *Rotation(int node) const;     // 4 floats.
+  const float *Scale(int node) const;        // 3 floats.
+  const float *LocalMatrix(int node) const;  // 16 floats.
+  const float *WorldMatrix(int node) const;  // 16 floats.
+
+ private:
+  // Marks position `pos` to be updated, with `trs` telling whether its local
+  // matrix is composed from translation, rotation and scale.
+  void MarkChanged(size_t pos, bool trs);
+
+  std::vector<int> order_;        // Node at each position.
+  std::vector<int> positions_;    // Position of each node.
+  std::vector<int> parents_;      // Position of the parent, -1 for a root.
+  std::vector<int> subtree_end_;  // End of the subtree at each position.
+  std::vector<float> translations_;  // 3 per position.
+  std::vector<float> rotations_;     // 4 per position.
+  std::vector<float> scales_;        // 3 per position.
+  std::vector<float> locals_;        // 16 per position.
+  std::vector<float> worlds_;        // 16 per position.
+  std::vector<unsigned char> flags_;  // TransformFlags per position.
+  std::vector<int> changed_;  // Positions changed since the last `Update`.
+};
+
+/// Keyframes of an animation channel of an `AnimationSet`.
+typedef struct {
+  size_t times;   // Offset of the first key time in `AnimationSet::times`.
+  size_t values;  // Offset of the first key value in `AnimationSet::values`.
+  size_t count;   // Number of keys, at least 1.
+  int node;       // Target, index in `CompiledScene::nodes`.
+  int animation;  // Index in `CompiledScene::animations`.
+  bool step;      // "STEP" interpolation instead of "LINEAR".
+  char pad[7];
+} AnimationTrack;
+
+/// The keyframes of all animations of a scene, flattened for evaluation by
+/// `AnimationState`. Each key value takes 4 floats(translations and scales
+/// are padded). Key times of a sampler input shared by several channels are
+/// stored once. Not modified by evaluation, so one set can be shared by any
+/// number of animated instances.
+class AnimationSet {
+ public:
+  AnimationSet() {}
+  ~AnimationSet() {}
+
+  /// Reads the keyframes of the animations of `scene`, compiled into
+  /// `compiled`.
+  /// Returns false and set error string to `err` if there's an error(e.g.
+  /// an unknown target path or interpolation, or an accessor of the wrong
+  /// type). Such channels are skipped, and the others are still usable.
+  bool Build(const Scene &scene, const CompiledScene &compiled,
+             std::string *err);
+
+  std::vector<AnimationTrack> translationTracks;
+  std::vector<AnimationTrack> rotationTracks;
+  std::vector<AnimationTrack> scaleTracks;
+  std::vector<float> times;
+  std::vector<float> values;
+  std::vector<float> durations;  // Last key time of each animation.
+};
+
+/// Playback state of one animated instance of an `AnimationSet`: a keyframe
+/// cursor per track, so that sampling at increasing(or slowly changing)
+/// times finds the keys in constant time.
+class AnimationState {
+ public:
+  AnimationState() : set_(NULL) {}
+  ~AnimationState() {}
+
+  /// Plays `set`, which must outlive the state, from the beginning. Call
+  /// again whenever `set` is built again(`AnimationSet::Build`), since the
+  /// state keeps positions in its arrays.
+  void Init(const AnimationSet *set);
+
+  /// Samples all tracks at `time` and sets the translation, rotation and
+  /// scale of their nodes in `transforms`(built from the same
+  /// `CompiledScene`). Times outside of the keys are clamped. Translations
+  /// and scales are interpolated linearly, rotations spherically(slerp
+  /// weights from a series, within 2.3e-6). Call `TransformHierarchy::Update`
+  /// afterwards.
+  void Evaluate(float time, TransformHierarchy *transforms);
+
+  /// Same as above with a time for each animation, `times[i]` for
+  /// `CompiledScene::animations[i]`.
+  void Evaluate(const float *times, TransformHierarchy *transforms);
+
+ private:
+  // Finds the keys of each of `tracks` around its time(`times[0]`, or
+  // `times[animation]` with `per_animation`) and stages them.
+  void GatherKeys(const std::vector<AnimationTrack> &tracks,
+                  std::vector<size_t> *cursors, const float *times,
+                  bool per_animation);
+  void Evaluate(const float *times, bool per_animation,
+                TransformHierarchy *transforms);
+
+  const AnimationSet *set_;
+  std::vector<size_t> translation_cursors_;
+  std::vector<size_t> rotation_cursors_;
+  std::vector<size_t> scale_cursors_;
+  // Staging of a batch: the keys around the time, 4 floats each, the
+  // interpolation factors and the results.
+  std::vector<float> from_;
+  std::vector<float> to_;
+  std::vector<float> factors_;
+  std::vector<float> results_;
+};
+
+/// Decodes image `id` of `scene` loaded with deferred decoding into
+/// `Image::image`, and releases its encoded bytes. Does nothing when the image
+/// is already decoded.
+/// Returns false and set error string to `err` if there's an error.
+bool DecodeImage(Scene *scene, const std::string &id, std::string *err);
+
+/// Decodes images loaded with deferred decoding on first access and keeps the
+/// pixels of recently used ones, up to `capacity` bytes in total.
+class ImageCache {
+ public:
+  explicit ImageCache(size_t capacity = 256 * 1024 * 1024)
+      : capacity_(capacity), size_(0) {}
+  ~ImageCache() {}
+
+  /// Returns decoded image `id` of `scene`, or NULL with an error message in
+  /// `err` if there's an error. An image already decoded in `scene` is
+  /// returned as is. The pointer is valid until the next `Get` or `Clear`.
+  /// Entries are keyed on the `Scene::generation` too, so the images of a
+  /// scene which was cleared or reloaded since are decoded again(the old
+  /// entries are evicted as the cache fills up).
+  const Image *Get(const Scene &scene, const std::string &id,
+                   std::string *err);
+
+  void Clear();
+
+  /// Bytes of decoded pixels in the cache.
+  size_t Size() const { return size_; }
+
+  size_t Capacity() const { return capacity_; }
+  void SetCapacity(size_t capacity);
+
+ private:
+  // The scene, its generation and the image id.
+  typedef std::pair<std::pair<const Scene *, long>, std::string> Key;
+  typedef std::list<std::pair<Key, Image> > EntryList;
+
+  void Evict();
+
+  EntryList entries_;  // Most recently used first.
+  std::map<Key, EntryList::iterator> index_;
+  size_t capacity_;
+  size_t size_;
+};
+
+/// Bytes of a component of `componentType`(TINYGLTF_COMPONENT_TYPE_***), or 0
+/// if it is unknown.
+int GetComponentSizeInBytes(int componentType);
+
+/// Number of components of an element of `type`(TINYGLTF_TYPE_***), or 0 if it
+/// is unknown.
+int GetTypeSizeInComponents(int type);
+
+/// `componentType` of the C++ type `T`, e.g. `ComponentTypeOf<short>::value`
+/// is TINYGLTF_COMPONENT_TYPE_SHORT.
+template <typename T>
+struct ComponentTypeOf {};
+
+template <>
+struct ComponentTypeOf<signed char> {
+  enum { value = TINYGLTF_COMPONENT_TYPE_BYTE };
+};
+template <>
+struct ComponentTypeOf<unsigned char> {
+  enum { value = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE };
+};
+template <>
+struct ComponentTypeOf<short> {
+  enum { value = TINYGLTF_COMPONENT_TYPE_SHORT };
+};
+template <>
+struct ComponentTypeOf<unsigned short> {
+  enum { value = TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT };
+};
+template <>
+struct ComponentTypeOf<int> {
+  enum { value = TINYGLTF_COMPONENT_TYPE_INT };
+};
+template <>
+struct ComponentTypeOf<unsigned int> {
+  enum { value = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT };
+};
+template <>
+struct ComponentTypeOf<float> {
+  enum { value = TINYGLTF_COMPONENT_TYPE_FLOAT };
+};
+template <>
+struct ComponentTypeOf<double> {
+  enum { value = TINYGLTF_COMPONENT_TYPE_DOUBLE };
+};
+
+/// Elements of an accessor whose components are of type `T`, `byteStride`
+/// bytes apart(see `AccessorReader::View`). Components are copied out with
+/// memcpy, so the storage need not be aligned.
+template <typename T>
+class AccessorView {
+ public:
+  AccessorView()
+      : data_(NULL), count_(0), byte_stride_(0), num_components_(0), pad0(0) {}
+  AccessorView(const unsigned char *data, size_t count, size_t byte_stride,
+               int num_components)
+      : data_(data),
+        count_(count),
+        byte_stride_(byte_stride),
+        num_components_(num_components),
+        pad0(0) {}
+
+  /// true when the accessor was not resolved, or has another component type.
+  bool Empty() const { return (data_ == NULL); }
+
+  size_t Count() const { return count_; }
+  size_t ByteStride() const { return byte_stride_; }
+  int NumComponents() const { return num_components_; }
+
+  /// Component `component` of element `index`.
+  T Get(size_t index, int component = 0) const {
+    T v;
+    memcpy(&v,
+           data_ + index * byte_stride_ +
+               static_cast<size_t>(component) * sizeof(T),
+           sizeof(T));
+    return v;
+  }
+
+  /// Copies the `NumComponents()` components of element `index` to `out`.
+  void GetElement(size_t index, T *out) const {
+    memcpy(out, data_ + index * byte_stride_,
+           static_cast<size_t>(num_components_) * sizeof(T));
+  }
+
+ private:
+  const unsigned char *data_;
+  size_t count_;
+  size_t byte_stride_;
+  int num_components_;
+  int pad0;
+};
+
+/// Reads the elements of an accessor. `Init` resolves the accessor, its
+/// bufferView and buffer once and checks that every element lies within the
+/// bufferView, so nothing is looked up or checked while reading. The reader
+/// refers to the buffer in `Scene`, and is valid as long as it is.
+class AccessorReader {
+ public:
+  AccessorReader()
+      : data_(NULL),
+        count_(0),
+        byte_stride_(0),
+        component_type_(0),
+        type_(0),
+        num_components_(0),
+        pad0(0) {}
+
+  /// Resolves accessor `id` of `scene`.
+  /// Returns false and set error string to `err` if there's an error.
+  bool Init(const Scene &scene, const std::string &id, std::string *err);
+
+  /// Same as above, for an accessor of `scene` found otherwise(e.g. through
+  /// `CompiledScene`).
+  bool Init(const Scene &scene, const Accessor &accessor, std::string *err);
+
+  int ComponentType() const { return component_type_; }
+  int Type() const { return type_; }
+  int NumComponents() const { return num_components_; }
+  size_t Count() const { return count_; }
+  /// Bytes between elements, which is the element size when the elements are
+  /// tightly packed.
+  size_t ByteStride() const { return byte_stride_; }
+  /// The first element. NULL if `Init` failed.
+  const unsigned char *Data() const { return data_; }
+
+  /// Reader of the `count` elements from `first`, which must lie within
+  /// `Count()`.
+  AccessorReader Slice(size_t first, size_t count) const {
+    AccessorReader slice(*this);
+    slice.data_ = data_ + first * byte_stride_;
+    slice.count_ = count;
+    return slice;
+  }
+
+  /// Typed view of the elements. Empty unless `T` is the C++ type of
+  /// `ComponentType()`(see `ComponentTypeOf`).
+  template <typename T>
+  AccessorView<T> View() const {
+    if (!data_ || (ComponentTypeOf<T>::value != component_type_)) {
+      return AccessorView<T>();
+    }
+    return AccessorView<T>(data_, count_, byte_stride_, num_components_);
+  }
+
+  /// Converts the components of all elements to float into `out`, which must
+  /// have room for `Count() * NumComponents()` values. With `normalized`,
+  /// integers are mapped to [0, 1](unsigned) or [-1, 1](signed) like
+  /// normalized vertex attributes.
+  void ReadAsFloat(float *out, bool normalized = false) const;
+
+  /// Converts the components of all elements to unsigned int(e.g. indices)
+  /// into `out`, which must have room for `Count() * NumComponents()` values.
+  /// Returns false without writing for float and double components.
+  bool ReadAsUInt32(unsigned int *out) const;
+
+ private:
+  const unsigned char *data_;
+  size_t count_;
+  size_t byte_stride_;
+  int component_type_;
+  int type_;
+  int num_components_;
+  int pad0;
+};
+
+/// Estimated memory usage of a `Scene` in bytes(`ComputeMemoryUsage`).
+/// Counts the objects, the heap blocks of strings and vectors, and the nodes
+/// of maps, but not the bookkeeping of the allocator.
+typedef struct {
+  // Per top level section: the map and everything owned by its items.
+  size_t accessors;
+  size_t animations;
+  size_t buffers;
+  size_t bufferViews;
+  size_t materials;
+  size_t meshes;
+  size_t nodes;
+  size_t textures;
+  size_t images;
+  size_t shaders;
+  size_t programs;
+  size_t techniques;
+  size_t samplers;
+  size_t skins;
+  size_t scenes;
+  size_t other;  // `Scene` itself, `asset`, `defaultScene` and `extras`.
+
+  // Breakdown of the above across all sections.
+  size_t strings;        // Heap blocks of std::string, including map keys.
+  size_t extras;         // `extras` and `extensions` of all objects.
+  size_t pixels;         // Decoded `Image::image`.
+  size_t encodedImages;  // `Image::encoded`.
+  size_t bufferData;     // `Buffer::data`.
+
+  // Bytes referred by `Buffer` views(memory mapped files or storage owned by
+  // the caller). Not included in `total`.
+  size_t sharedData;
+
+  size_t total;
+} MemoryUsage;
+
+/// Computes the memory usage of `scene`.
+void ComputeMemoryUsage(MemoryUsage *usage, const Scene &scene);
+
+/// Transient allocations while loading(`TinyGLTFLoader::SetLoadStats`): the
+/// contents of the file, the JSON DOM of objects being converted, and encoded
+/// and decoded image data on the way to `Image::image`.
+typedef struct {
+  size_t current;  // Bytes alive now.
+  size_t peak;     // Maximum of `current`. An upper bound with parallel loads.
+  size_t total;    // Sum of all allocations.
+  size_t count;    // Number of allocations.
+} LoadStats;
+
+/// Summary of a glTF asset read by `TinyGLTFLoader::ScanFromFile`.
+typedef struct {
+  Asset asset;
+  std::string defaultScene;
+
+  // Number of items in each top level section.
+  int numBuffers;
+  int numBufferViews;
+  int numAccessors;
+  int numMeshes;
+  int numNodes;
+  int numScenes;
+  int numMaterials;
+  int numImages;
+  int numTextures;
+  int numShaders;
+  int numPrograms;
+  int numTechniques;
+  int numAnimations;
+  int numSamplers;
+  int numSkins;
+
+  int numPrimitives;
+  size_t vertexCount;  // Sum of `count` of POSITION accessors of primitives.
+  size_t indexCount;   // Sum of `count` of index accessors of primitives.
+  size_t binaryLength;  // Size of the binary body of a .glb, otherwise 0.
+
+  bool isBinary;
+  char pad[7];
+} SceneSummary;
+
+/// Top level sections to be loaded(`TinyGLTFLoader::SetLoadSections`).
+enum SectionLoad {
+  LOAD_BUFFERS = 0x0001,
+  LOAD_BUFFER_VIEWS = 0x0002,
+  LOAD_ACCESSORS = 0x0004,
+  LOAD_MESHES = 0x0008,
+  LOAD_NODES = 0x0010,
+  LOAD_SCENES = 0x0020,
+  LOAD_MATERIALS = 0x0040,
+  LOAD_IMAGES = 0x0080,
+  LOAD_TEXTURES = 0x0100,
+  LOAD_SHADERS = 0x0200,
+  LOAD_PROGRAMS = 0x0400,
+  LOAD_TECHNIQUES = 0x0800,
+  LOAD_ANIMATIONS = 0x1000,
+  LOAD_SAMPLERS = 0x2000,
+  LOAD_SKINS = 0x4000,
+  // buffers, bufferViews, accessors, meshes, nodes and scenes.
+  LOAD_GEOMETRY = 0x003f,
+  LOAD_ALL = 0x7fff
+};
+
+enum SectionCheck {
+  NO_REQUIRE = 0x00,
+  REQUIRE_SCENE = 0x01,
+  REQUIRE_SCENES = 0x02,
+  REQUIRE_NODES = 0x04,
+  REQUIRE_ACCESSORS = 0x08,
+  REQUIRE_BUFFERS = 0x10,
+  REQUIRE_BUFFER_VIEWS = 0x20,
+  REQUIRE_ALL = 0x3f
+};
+
+/// A single task of parallel work(e.g. loading). Called with the `task_data`
+/// and `index` given to `TaskExecutor`.
+typedef void (*TaskFunc)(void *task_data, size_t index);
+
+/// Runs `task(task_data, i)` for every i in [0, count), in any order and on
+/// any thread, and returns once all of them have finished.
+typedef void (*TaskExecutor)(void *user_ptr, TaskFunc task, void *task_data,
+                             size_t count);
+
+/// Where and in which format an attribute of a `Primitive` is stored in a
+/// vertex of a `VertexLayout`.
+typedef struct {
+  std::string semantic;  // Key of `Primitive::attributes`, e.g. "NORMAL".
+  size_t offset;         // Bytes from the beginning of the vertex.
+  int componentType;     // TINYGLTF_COMPONENT_TYPE_*** except DOUBLE.
+  int numComponents;     // 1 to 4.
+  // Integer components are normalized values, in the accessor and in the
+  // vertex. Otherwise integers are converted by value.
+  bool normalized;
+  // A missing attribute is filled with (0, 0, 0, 1) instead of being an
+  // error.
+  bool optional;
+  char pad[6];
+} VertexElement;
+
+/// Vertex format of `InterleaveVertices`.
+class VertexLayout {
+ public:
+  VertexLayout() : stride(0), alignment(4) {}
+  ~VertexLayout() {}
+
+  /// Appends an element at the end of the vertex, aligned to `alignment`, and
+  /// grows `stride` accordingly.
+  void Add(const std::string &semantic, int componentType, int numComponents,
+           bool normalized = false, bool optional = false);
+
+  std::vector<VertexElement> elements;
+  size_t stride;     // Bytes per vertex.
+  size_t alignment;  // Of the offsets and the stride set by `Add`.
+};
+
+/// Packs the attributes of `primitive` named in `layout` into `out`, one
+/// vertex of `layout.stride` bytes after another, converting the components
+/// as needed. Bytes not covered by `layout` are zero. A layout of a single
+/// element de-interleaves an attribute into the given format.
+/// Returns false and set error string to `err` if there's an error(e.g. a
+/// missing attribute, or attributes of different counts).
+bool InterleaveVertices(std::vector<unsigned char> *out, std::string *err,
+                        const Scene &scene, const Primitive &primitive,
+                        const VertexLayout &layout);
+
+/// Same as above for `count` primitives at once, `out[i]` for
+/// `primitives[i]`. Runs on `num_threads` threads(with
+/// `TINYGLTF_USE_THREADS`), or with `executor` when given. Error messages are
+/// in the order of `primitives`.
+bool InterleaveVertices(std::vector<unsigned char> *out, std::string *err,
+                        const Scene &scene, const Primitive *const *primitives,
+                        size_t count, const VertexLayout &layout,
+                        int num_threads = 1, TaskExecutor executor = NULL,
+                        void *user_ptr = NULL);
+
+/// Computes the minimum and maximum of each component over the elements of
+/// `reader`, as stored(integers are not normalized), into `min_values` and
+/// `max_values`. NaNs are ignored. Both are empty when there are no
+/// elements. Large accessors are split over `num_threads` threads(with
+/// `TINYGLTF_USE_THREADS`), or over tasks of `executor` when given.
+void ComputeAccessorBounds(std::vector<double> *min_values,
+                           std::vector<double> *max_values,
+                           const AccessorReader &reader, int num_threads = 1,
+                           TaskExecutor executor = NULL,
+                           void *user_ptr = NULL);
+
+/// What to do with `Accessor::minValues` and `maxValues`
+/// (`TinyGLTFLoader::SetAccessorBounds`, `UpdateAccessorBounds`).
+enum AccessorBounds {
+  BOUNDS_KEEP = 0,           // Keep them as in the asset.
+  BOUNDS_FILL_MISSING = 1,   // Compute them for accessors without them.
+  BOUNDS_VERIFY = 2,         // Fill missing ones, and check the others.
+  BOUNDS_RECOMPUTE = 3       // Compute them for all accessors.
+};
+
+/// Computes `minValues` and `maxValues` of the accessors of `scene` as
+/// selected by `mode`, one accessor per task. With `BOUNDS_VERIFY`, supplied
+/// bounds which don't match the data(beyond a relative 1e-5 for float
+/// components, exactly for integers) are an error and left as is.
+/// Returns false and set error string to `err` if there's an error(e.g. an
+/// accessor outside of its bufferView).
+bool UpdateAccessorBounds(Scene *scene, std::string *err, AccessorBounds mode,
+                          int num_threads = 1, TaskExecutor executor = NULL,
+                          void *user_ptr = NULL);
+
+/// Decoding of an accessor of integers with the WEB3D_quantized_attributes
+/// extension(e.g. quantized positions or normals): each element decodes to
+/// `decodeMatrix` * (components, 1). The data stays quantized in the
+/// `Scene`, and is decoded to float when read with `Dequantize`.
+class QuantizedAttribute {
+ public:
+  QuantizedAttribute() : numComponents(0), pad0(0) {}
+  ~QuantizedAttribute() {}
+
+  /// Reads the extension of `accessor`. An accessor without it is not
+  /// quantized, which is not an error.
+  /// Returns false and set error string to `err` if the extension is invalid
+  /// (e.g. a decodeMatrix of the wrong size).
+  bool Init(const Accessor &accessor, std::string *err);
+
+  bool IsQuantized() const { return (numComponents > 0); }
+
+  /// Converts the components of all elements of `reader`(a reader of the
+  /// accessor given to `Init`) to float into `out`, which must have room for
+  /// `Count() * NumComponents()` values, and decodes them when quantized.
+  /// SSSE3/AVX2/NEON accelerated for decode matrices of a scale and an
+  /// offset per component(as written by `QuantizeAttributes`).
+  void Dequantize(float *out, const AccessorReader &reader) const;
+
+  std::vector<float> decodeMatrix;  // (numComponents + 1)^2, column major.
+  std::vector<double> decodedMin;   // Optional in the extension.
+  std::vector<double> decodedMax;
+  int numComponents;  // 0 when not quantized.
+  int pad0;
+};
+
+/// Quantizes the FLOAT accessors of attribute `semantic`(e.g. "POSITION") of
+/// the primitives of `scene` to `component_type`(BYTE, UNSIGNED_BYTE, SHORT or
+/// UNSIGNED_SHORT) over the range of each component, and adds the
+/// WEB3D_quantized_attributes extension to decode them. `minValues` and
+/// `maxValues` become the quantized bounds. The data is written to a new
+/// bufferView at the end of the buffer which held it, and the replaced
+/// bufferViews and buffer bytes are removed once nothing else refers to them.
+/// Returns false and set error string to `err` if there's an error(e.g. a
+/// missing accessor). The accessors in error are left as is.
+bool QuantizeAttributes(Scene *scene, std::string *err,
+                        const std::string &semantic, int component_type);
+
+/// Steps of `CompressAnimations`, applied in this order. A step is disabled
+/// when its setting is 0, which is the default.
+class AnimationCompression {
+ public:
+  AnimationCompression()
+      : sampleRate(0.0),
+        translationStep(0.0),
+        rotationBits(0),
+        pad0(0),
+        translationTolerance(0.0),
+        rotationTolerance(0.0),
+        scaleTolerance(0.0) {}
+  ~AnimationCompression() {}
+
+  /// Resamples "LINEAR" channels at `sampleRate` keys per second, from their
+  /// first to their last key time(which is kept).
+  double sampleRate;
+
+  /// Rounds translations to multiples of `translationStep`, and the
+  /// components of rotations to `rotationBits` bit signed fixed point
+  /// (2 to 24, e.g. 16), renormalized.
+  double translationStep;
+  int rotationBits;
+  int pad0;
+
+  /// Removes keys which interpolating the remaining ones reproduces within
+  /// the tolerance: a distance for translations and scales, an angle in
+  /// radians for rotations. "STEP" channels only lose repeated values.
+  double translationTolerance;
+  double rotationTolerance;
+  double scaleTolerance;
+};
+
+/// Compresses the keyframes of the translation, rotation and scale channels
+/// of all animations in `scene` as set by `options`. The keys of each sampler
+/// are written to new FLOAT accessors(key times shared where equal) in a new
+/// bufferView at the end of the buffer which held them, and the animation
+/// parameters are pointed to them. The replaced accessors, bufferViews and
+/// buffer bytes are removed once nothing else refers to them. The first and
+/// last key times of each channel are kept, so durations don't change.
+/// Returns false and set error string to `err` if there's an error(e.g. a
+/// missing accessor, or an invalid setting). The samplers in error are left
+/// as is.
+bool CompressAnimations(Scene *scene, std::string *err,
+                        const AnimationCompression &options);
+
+/// Joints of a skinned node(`CompiledNode::skin`), for computing the joint
+/// matrices of `SkinVertices` every frame.
+class SkinJoints {
+ public:
+  SkinJoints() : node(-1), pad0(0) {}
+  ~SkinJoints() {}
+
+  /// Reads the joints of node `node_index` of `compiled` and their inverse
+  /// bind matrices(a MAT4 accessor of at least one element per joint)
+  /// multiplied by the bind shape matrix. The source `Scene` is not referred
+  /// to afterwards.
+  /// Returns false and set error string to `err` if there's an error(e.g.
+  /// the node has no skin).
+  bool Init(const Scene &scene, const CompiledScene &compiled, int node_index,
+            std::string *err);
+
+  size_t NumJoints() const { return joints.size(); }
+
+  /// Computes the joint matrices for the world transforms of `hierarchy`,
+  /// 16 floats per joint(column major) into `matrices`: the inverse of the
+  /// world matrix of the skinned node, times the world matrix of the joint,
+  /// times its bind matrix. A missing joint(-1) gets the identity.
+  void ComputeMatrices(std::vector<float> *matrices,
+                       const TransformHierarchy &hierarchy) const;
+
+  std::vector<int> joints;          // Index in `CompiledScene::nodes`.
+  std::vector<float> bindMatrices;  // 16 per joint.
+  int node;                         // The skinned node.
+  int pad0;
+};
+
+/// Vertex data of a `Primitive` for `SkinVertices`, converted to float once:
+/// POSITION, NORMAL(if any), and up to 4 JOINT indices and WEIGHT factors per
+/// vertex(unused ones have weight 0). All of them are dequantized(see
+/// `QuantizedAttribute`).
+class SkinnedPrimitive {
+ public:
+  SkinnedPrimitive() : numJoints(0) {}
+  ~SkinnedPrimitive() {}
+
+  /// Reads the attributes of `primitive`. JOINT must be integers in
+  /// [0, 65535](rounded when quantized), with as many components as WEIGHT.
+  /// Integer weights which are not quantized are normalized.
+  /// Returns false and set error string to `err` if there's an error(e.g. a
+  /// missing attribute, or attributes of different counts).
+  bool Init(const Scene &scene, const Primitive &primitive, std::string *err);
+
+  size_t NumVertices() const { return positions.size() / 3; }
+
+  std::vector<float> positions;        // 3 per vertex.
+  std::vector<float> normals;          // 3 per vertex, or empty.
+  std::vector<unsigned short> joints;  // 4 per vertex.
+  std::vector<float> weights;          // 4 per vertex.
+  size_t numJoints;                    // Largest joint index + 1.
+};
+
+/// Skins the vertices of `primitive` with `num_joints` joint matrices(see
+/// `SkinJoints::ComputeMatrices`), writing 3 floats per vertex to
+/// `positions` and, unless NULL, the normalized normals to `normals`(which
+/// requires `primitive.normals`). Normals are transformed by the upper 3x3
+/// of the blended matrix. Ranges of vertices run on `num_threads`
+/// threads(with `TINYGLTF_USE_THREADS`), or with `executor` when given.
+/// Returns false and set error string to `err` if a joint index is out of
+/// `num_joints`, or normals are requested but missing.
+bool SkinVertices(float *positions, float *normals, std::string *err,
+                  const SkinnedPrimitive &primitive,
+                  const float *joint_matrices, size_t num_joints,
+                  int num_threads = 1, TaskExecutor executor = NULL,
+                  void *user_ptr = NULL);
+
+/// Decoded data of an accessor of a compressed mesh(`MeshDecodeFunc`).
+typedef struct {
+  std::string accessor;  // Id in `Scene::accessors`.
+  // `count` elements of the `componentType` and `type` of the accessor,
+  // tightly packed.
+  std::vector<unsigned char> data;
+} DecodedAccessor;
+
+/// Decodes a mesh compressed with a glTF extension(e.g.
+/// "Open3DGC-compression"). Called with the extension object of `mesh` and
+/// the bytes of its "compressedData"(`bufferView`, `byteOffset` and `count`
+/// bytes), and appends to `out` the data of the accessors of the primitives
+/// of `mesh`. Called for several meshes at once when loading on several
+/// threads, so it may only read `scene`.
+/// Returns false and set error string to `err` if there's an error. Messages
+/// set to `err` when returning true are kept as warnings.
+typedef bool (*MeshDecodeFunc)(std::vector<DecodedAccessor> *out,
+                               std::string *err, const Scene &scene,
+                               const Mesh &mesh, const Value &extension,
+                               const unsigned char *data, size_t size,
+                               void *user_ptr);
+
+/// Decodes the meshes of `scene` which have `extension` in their
+/// `extensions` with `decoder`, one mesh per task on `num_threads`
+/// threads(with `TINYGLTF_USE_THREADS`), or with `executor` when given. The
+/// decoded accessors are stored in a new buffer, in a bufferView per mesh,
+/// and `extension` is removed from the meshes. The compressed bytes are
+/// removed once no accessor refers to them.
+/// Returns false and set error string to `err` if there's an error(e.g. a
+/// missing compressedData, or decoded data of the wrong size). Meshes in
+/// error are left as is.
+bool DecodeMeshes(Scene *scene, std::string *err, const std::string &extension,
+                  MeshDecodeFunc decoder, void *decoder_data,
+                  int num_threads = 1, TaskExecutor executor = NULL,
+                  void *user_ptr = NULL);
+
+/// Decodes a mesh compressed with "Open3DGC-compression"(`MeshDecodeFunc`),
+/// ascii or binary streams of the o3dgc TFAN encoder. POSITION and NORMAL
+/// are the positions and normals of the stream, other attributes its float
+/// attributes given by "floatAttributesIndexes", and the indices of the
+/// primitives(triangles) follow each other in its triangles. Streams with a
+/// permuted vertex order are not supported, and int attributes are skipped
+/// with a warning in `err`. Not registered by default: it is not yet checked
+/// against files of other encoders. Enable it with
+/// `SetMeshDecoder("Open3DGC-compression", DecodeOpen3DGCMesh)`.
+bool DecodeOpen3DGCMesh(std::vector<DecodedAccessor> *out, std::string *err,
+                        const Scene &scene, const Mesh &mesh,
+                        const Value &extension, const unsigned char *data,
+                        size_t size, void *user_ptr);
+
+class TinyGLTFLoader {
+ public:
+  TinyGLTFLoader()
+      : bin_data_(NULL),
+        bin_size_(0),
+        load_stats_(NULL),
+        executor_(NULL),
+        executor_data_(NULL),
+        num_threads_(1),
+        load_sections_(LOAD_ALL),
+        is_binary_(false),
+        use_mmap_(false),
+        accessor_bounds_(BOUNDS_KEEP),
+        mesh_decoder_(NULL),
+        mesh_decoder_data_(NULL),
+        defer_image_decoding_(false),
+        lazy_extras_(false) {
+#ifdef TINYGLTF_USE_ARENA
+    arena_ = NULL;
+#endif
+  }
+  ~TinyGLTFLoader() {}
+
+  /// Use memory mapped file I/O in `LoadASCIIFromFile` and
+  /// `LoadBinaryFromFile`. Disabled by default. The embedded binary body of
+  /// .glb and external `.bin` files are not copied: `Buffer`s become views
+  /// into the mapping, which stays alive as long as any `Buffer` refers to
+  /// it. Their `Buffer::data` is then EMPTY: read them with `Buffer::Data()`
+  /// and `Buffer::Size()`(or `Buffer::MakeOwned()` to fill `data`).
+  void SetMemoryMapping(bool enabled) { use_mmap_ = enabled; }
+
+  /// Counts the transient allocations of the following loads in `stats`.
+  /// `stats` is reset at the beginning of each load. Pass NULL to disable it.
+  void SetLoadStats(LoadStats *stats) { load_stats_ = stats; }
+
+  /// Loads only the top level sections in `sections`(combination of
+  /// `SectionLoad`), e.g. `LOAD_GEOMETRY` or
+  /// `LOAD_ALL & ~(LOAD_IMAGES | LOAD_SHADERS)`. The JSON of other sections is
+  /// skipped without being parsed(nor validated), and they stay empty in
+  /// `Scene`. Images stored in a bufferView are not decoded unless both
+  /// buffers and bufferViews are loaded.
+  void SetLoadSections(unsigned int sections) { load_sections_ = sections; }
+
+  /// Do not decode images while loading. `Image` keeps the location of the
+  /// encoded image instead, and `width`, `height` and `component` are 0(or
+  /// the values of KHR_binary_glTF). Use `DecodeImage` or `ImageCache` to get
+  /// the pixels.
+  void SetDeferredImageDecoding(bool enabled) {
+    defer_image_decoding_ = enabled;
+  }
+
+  /// Keep `extras` and `extensions` as JSON text while loading, and parse
+  /// them on the first access through the `Value` API(see
+  /// `Value::FromJSON`). Their JSON is not validated while loading.
+  /// `extensions` of images and shaders are always parsed, since
+  /// KHR_binary_glTF is read from them.
+  void SetLazyExtras(bool enabled) { lazy_extras_ = enabled; }
+
+  /// Computes or verifies the `minValues` and `maxValues` of accessors once
+  /// the buffers are loaded(see `UpdateAccessorBounds`), on the threads set
+  /// by `SetNumThreads` or `SetTaskExecutor`. Requires buffers, bufferViews
+  /// and accessors to be loaded(`SetLoadSections`), otherwise does nothing.
+  void SetAccessorBounds(AccessorBounds mode) { accessor_bounds_ = mode; }
+
+  /// Compresses the keyframes of animations once the buffers are loaded(see
+  /// `CompressAnimations`). Requires animations, buffers, bufferViews and
+  /// accessors to be loaded(`SetLoadSections`), otherwise does nothing.
+  void SetAnimationCompression(const AnimationCompression &options) {
+    animation_compression_ = options;
+  }
+
+  /// Decodes the meshes compressed with `extension`(e.g.
+  /// "Open3DGC-compression") with `decoder` once the buffers are loaded(see
+  /// `DecodeMeshes`), on the threads set by `SetNumThreads` or
+  /// `SetTaskExecutor`. Requires meshes, buffers, bufferViews and accessors to
+  /// be loaded(`SetLoadSections`), otherwise does nothing. No decoder by
+  /// default(see `DecodeOpen3DGCMesh`). Pass NULL to disable it.
+  void SetMeshDecoder(const std::string &extension, MeshDecodeFunc decoder,
+                      void *user_ptr = NULL) {
+    mesh_extension_ = extension;
+    mesh_decoder_ = decoder;
+    mesh_decoder_data_ = user_ptr;
+  }
+
+#ifdef TINYGLTF_USE_ARENA
+  /// Allocates the storage of the `Scene` containers(not its strings or
+  /// payloads, see `Arena`) from `arena` in the following loads(on the
+  /// calling thread; tasks on other threads use the heap). `arena` must
+  /// outlive the `Scene`s. Pass NULL to allocate from the heap.
+  void SetArena(Arena *arena) { arena_ = arena; }
+#endif
+
+  /// Empties `scene` for the next load like `Scene::Clear`, but keeps the
+  /// memory of its buffers, images and shaders in this loader. The next load
+  /// reads and decodes each payload into the smallest kept vector which holds
+  /// it(but not one more than twice as large), so reloading assets of similar
+  /// size repeatedly reaches a steady state. The memory which that load does
+  /// not reuse is freed at its end. Images decoded by parallel tasks from
+  /// files or data URIs are not decoded into kept memory, since their size is
+  /// unknown until then. With `TINYGLTF_USE_ARENA`, also `Reset` the arena
+  /// afterwards to reuse the memory of the containers.
+  void RecycleScene(Scene *scene);
+
+  /// Frees the memory kept for reuse by `RecycleScene` before the next load.
+  void ReleaseScratch();
+
+  /// Loads buffers and decodes images on `num_threads` threads(including the
+  /// calling thread) once the JSON is parsed. The result and the error
+  /// messages are the same as loading with a single thread.
+  /// Requires `TINYGLTF_USE_THREADS`, otherwise everything is loaded on the
+  /// calling thread.
+  void SetNumThreads(int num_threads) { num_threads_ = num_threads; }
+
+  /// Same as `SetNumThreads`, but runs the tasks with `executor`(e.g. the job
+  /// system of the application) instead of the built-in threads.
+  /// Pass NULL to disable it.
+  void SetTaskExecutor(TaskExecutor executor, void *user_ptr = NULL) {
+    executor_ = executor;
+    executor_data_ = user_ptr;
+  }
+
+  /// Loads glTF ASCII asset from a file.
+  /// Returns false and set error string to `err` if there's an error.
+  bool LoadASCIIFromFile(Scene *scene, std::string *err,
+                         const std::string &filename,
+                         unsigned int check_sections = REQUIRE_ALL);
+
+  /// Loads glTF ASCII asset from string(memory).
+  /// `length` = strlen(str);
+  /// Returns false and set error string to `err` if there's an error.
+  bool LoadASCIIFromString(Scene *scene, std::string *err, const char *str,
+                           const unsigned int length,
+                           const std::string &base_dir,
+                           unsigned int check_sections = REQUIRE_ALL);
+
+  /// Loads glTF binary asset from a file.
+  /// Returns false and set error string to `err` if there's an error.
+  bool LoadBinaryFromFile(Scene *scene, std::string *err,
+                          const std::string &filename,
+                          unsigned int check_sections = REQUIRE_ALL);
+
+  /// Loads glTF binary asset from memory.
+  /// `length` = strlen(str);
+  /// Returns false and set error string to `err` if there's an error.
+  bool LoadBinaryFromMemory(Scene *scene, std::string *err,
+                            const unsigned char *bytes,
+                            const unsigned int length,
+                            const std::string &base_dir = "",
+                            unsigned int check_sections = REQUIRE_ALL);
+
+  /// Loads glTF binary asset from memory shared with the caller.
+  /// The embedded binary body is not copied: `Buffer`s refer to `storage` and
+  /// keep their own reference to it. Use `SharedStorage(bytes, length)` to
+  /// borrow memory owned by the caller, which then must outlive the `Scene`,
+  /// or pass a `ReleaseFunc` to hand over a ref-counted block(e.g. an entry
+  /// of a cache). `storage` must be smaller than 4 GiB. As with
+  /// `SetMemoryMapping`, `Buffer::data` of those buffers is empty: read them
+  /// with `Buffer::Data()` and `Buffer::Size()`.
+  /// Returns false and set error string to `err` if there's an error.
+  bool LoadBinaryFromStorage(Scene *scene, std::string *err,
+                             const SharedStorage &storage,
+                             const std::string &base_dir = "",
+                             unsigned int check_sections = REQUIRE_ALL);
+
+  /// Reads only the JSON of a glTF ASCII or binary asset and summarizes it.
+  /// For .glb only the header and the JSON chunk are read, and external
+  /// files(.bin, images, shaders) are never opened.
+  /// Returns false and set error string to `err` if there's an error.
+  bool ScanFromFile(SceneSummary *summary, std::string *err,
+                    const std::string &filename);
+
+ private:
+  /// Loads glTF asset from string(memory).
+  /// `length` = strlen(str);
+  /// Returns false and set error string to `err` if there's an error.
+  bool LoadFromString(Scene *scene, std::string *err, const char *str,
+                      const unsigned int length, const std::string &base_dir,
+                      unsigned int check_sections);
+
+  /// Loads glTF binary asset from memory. When `storage` is not empty, the
+  /// embedded binary body is referenced from it instead of being copied.
+  bool LoadBinary(Scene *scene, std::string *err, const unsigned char *bytes,
+                  const unsigned int length, const SharedStorage &storage,
+                  const std::string &base_dir, unsigned int check_sections);
+
+  const unsigned char *bin_data_;
+  size_t bin_size_;
+  SharedStorage bin_storage_;
+  // Vectors kept by RecycleScene, by capacity.
+  std::multimap<size_t, std::vector<unsigned char> > payloads_;
+  LoadStats *load_stats_;
+  TaskExecutor executor_;
+  void *executor_data_;
+  int num_threads_;
+  unsigned int load_sections_;
+  bool is_binary_;
+  bool use_mmap_;
+  AccessorBounds accessor_bounds_;
+  AnimationCompression animation_compression_;
+  std::string mesh_extension_;
+  MeshDecodeFunc mesh_decoder_;
+  void *mesh_decoder_data_;
+  bool defer_image_decoding_;
+  bool lazy_extras_;
+#ifdef TINYGLTF_USE_ARENA
+  Arena *arena_;
+#endif
+};
+
+}  // namespace tinygltf
+
+#ifdef TINYGLTF_LOADER_IMPLEMENTATION
+#include <algorithm>
+//#include <cassert>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <new>
+#include <set>
+#include <sstream>
+
+#ifdef __clang__
+// Disable some warnings for external files.
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wfloat-equal"
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wconversion"
+#pragma clang diagnostic ignored "-Wold-style-cast"
+#pragma clang diagnostic ignored "-Wdouble-promotion"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+#pragma clang diagnostic ignored "-Wreserved-id-macro"
+#pragma clang diagnostic ignored "-Wdisabled-macro-expansion"
+#pragma clang diagnostic ignored "-Wpadded"
+#endif
+
+#define PICOJSON_USE_INT64
+#include "./picojson.h"
+#include "./stb_image.h"
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <wordexp.h>
+#ifndef TINYGLTF_NO_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef TINYGLTF_USE_THREADS
+#include <pthread.h>
+#endif
+#endif
+
+// SIMD code paths. Define TINYGLTF_NO_SIMD to use scalar code only.
+// x86 code paths are selected at runtime by the CPU features, so the
+// library does not need to be compiled with -mssse3/-mavx2.
+#if !defined(TINYGLTF_NO_SIMD)
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define TINYGLTF_SIMD_X86
+#define TINYGLTF_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TINYGLTF_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define TINYGLTF_SIMD_X86
+#define TINYGLTF_TARGET_SSSE3
+#define TINYGLTF_TARGET_AVX2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TINYGLTF_SIMD_NEON
+#endif
+#endif
+
+#if defined(TINYGLTF_SIMD_X86)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(TINYGLTF_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(__sparcv9)
+// Big endian
+#else
+#if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || MINIZ_X86_OR_X64_CPU
+#define TINYGLTF_LITTLE_ENDIAN 1
+#endif
+#endif
+
+namespace tinygltf {
+
+Value::Value(const Value &rhs) : type_(rhs.type_), pad0(0), u_(rhs.u_) {
+  switch (type_) {
+    case STRING_TYPE:
+    case RAW_JSON_TYPE:
+      u_.string_value = new std::string(*rhs.u_.string_value);
+      break;
+    case BINARY_TYPE:
+      u_.binary_value =
+          new std::vector<unsigned char>(*rhs.u_.binary_value);
+      break;
+    case ARRAY_TYPE:
+      u_.array_value = new Array(*rhs.u_.array_value);
+      break;
+    case OBJECT_TYPE:
+      u_.object_value = new Object(*rhs.u_.object_value);
+      break;
+    default:
+      break;
+  }
+}
+
+void Value::Clear() {
+  switch (type_) {
+    case STRING_TYPE:
+    case RAW_JSON_TYPE:
+      delete u_.string_value;
+      break;
+    case BINARY_TYPE:
+      delete u_.binary_value;
+      break;
+    case ARRAY_TYPE:
+      delete u_.array_value;
+      break;
+    case OBJECT_TYPE:
+      delete u_.object_value;
+      break;
+    default:
+      break;
+  }
+  type_ = NULL_TYPE;
+  u_.number_value = 0.0;
+}
+
+void Value::Reset(int type) {
+  Clear();
+  switch (type) {
+    case STRING_TYPE:
+      u_.string_value = new std::string();
+      break;
+    case BINARY_TYPE:
+      u_.binary_value = new std::vector<unsigned char>();
+      break;
+    case ARRAY_TYPE:
+      u_.array_value = new Array();
+      break;
+    case OBJECT_TYPE:
+      u_.object_value = new Object();
+      break;
+    default:
+      break;
+  }
+  type_ = type;
+}
+
+// Converts a picojson value into `ret`. Numbers become NUMBER_TYPE.
+static void ConvertJSONValue(Value *ret, const picojson::value &v) {
+  if (v.is<bool>()) {
+    Value(v.get<bool>()).Swap(*ret);
+  } else if (v.is<double>()) {
+    Value(v.get<double>()).Swap(*ret);
+  } else if (v.is<std::string>()) {
+    Value(v.get<std::string>()).Swap(*ret);
+  } else if (v.is<picojson::array>()) {
+    const picojson::array &a = v.get<picojson::array>();
+    ret->SetType(ARRAY_TYPE);
+    Value::Array &array = ret->Get<Value::Array>();
+    array.clear();
+    array.resize(a.size());
+    for (size_t i = 0; i < a.size(); i++) {
+      ConvertJSONValue(&array[i], a[i]);
+    }
+  } else if (v.is<picojson::object>()) {
+    const picojson::object &o = v.get<picojson::object>();
+    ret->SetType(OBJECT_TYPE);
+    Value::Object &object = ret->Get<Value::Object>();
+    object.clear();
+    picojson::object::const_iterator it(o.begin());
+    for (; it != o.end(); it++) {
+      ConvertJSONValue(&object[it->first], it->second);
+    }
+  } else {
+    Value().Swap(*ret);
+  }
+}
+
+void Value::ParseRawJSON() const {
+  std::string *json = u_.string_value;
+  picojson::value v;
+  std::string perr;
+  // Parses from pointers, as the loader does, to share its instantiation.
+  const char *begin = json->c_str();
+  picojson::parse(v, begin, begin + json->size(), &perr);
+
+  Value parsed;
+  if (perr.empty()) {
+    ConvertJSONValue(&parsed, v);
+  }
+  // Take over the parsed storage. `type_` and `u_` are mutable.
+  type_ = parsed.type_;
+  u_ = parsed.u_;
+  parsed.type_ = NULL_TYPE;
+  delete json;
+}
+
+static long AtomicIncrement(long *v) {
+#if defined(_WIN32)
+  return InterlockedIncrement(v);
+#else
+  return __sync_add_and_fetch(v, 1);
+#endif
+}
+
+static long AtomicDecrement(long *v) {
+#if defined(_WIN32)
+  return InterlockedDecrement(v);
+#else
+  return __sync_sub_and_fetch(v, 1);
+#endif
+}
+
+SharedStorage::SharedStorage(const unsigned char *data, size_t size,
+                             ReleaseFunc release, void *user_ptr)
+    : block_(new Block()) {
+  block_->refcount = 1;
+  block_->data = data;
+  block_->size = size;
+  block_->release = release;
+  block_->user_ptr = user_ptr;
+}
+
+SharedStorage::SharedStorage(const SharedStorage &rhs) : block_(rhs.block_) {
+  if (block_) {
+    AtomicIncrement(&block_->refcount);
+  }
+}
+
+SharedStorage &SharedStorage::operator=(const SharedStorage &rhs) {
+  if (block_ != rhs.block_) {
+    SharedStorage tmp(rhs);
+    std::swap(block_, tmp.block_);
+  }
+  return *this;
+}
+
+SharedStorage::~SharedStorage() {
+  if (block_ && (AtomicDecrement(&block_->refcount) == 0)) {
+    if (block_->release) {
+      block_->release(block_->user_ptr, block_->data, block_->size);
+    }
+    delete block_;
+  }
+}
+
+#if defined(_MSC_VER)
+#define TINYGLTF_THREAD_LOCAL __declspec(thread)
+#else
+#define TINYGLTF_THREAD_LOCAL __thread
+#endif
+
+// Statistics of the load running on this thread(see SetLoadStats).
+static TINYGLTF_THREAD_LOCAL LoadStats *g_load_stats = NULL;
+
+static void TrackAlloc(size_t bytes) {
+  LoadStats *stats = g_load_stats;
+  if (stats) {
+    stats->current += bytes;
+    stats->total += bytes;
+    stats->count++;
+    stats->peak = std::max(stats->peak, stats->current);
+  }
+}
+
+static void TrackFree(size_t bytes) {
+  if (g_load_stats) {
+    g_load_stats->current -= bytes;
+  }
+}
+
+// Directs TrackAlloc()/TrackFree() on this thread to `stats` in the scope.
+// `stats` is reset unless it is already in use by an enclosing scope.
+class ScopedLoadStats {
+ public:
+  explicit ScopedLoadStats(LoadStats *stats) : prev_(g_load_stats) {
+    if (stats && (stats != prev_)) {
+      stats->current = stats->peak = stats->total = stats->count = 0;
+    }
+    g_load_stats = stats;
+  }
+  ~ScopedLoadStats() { g_load_stats = prev_; }
+
+ private:
+  ScopedLoadStats(const ScopedLoadStats &);
+  ScopedLoadStats &operator=(const ScopedLoadStats &);
+
+  LoadStats *prev_;
+};
+
+// true while converting a DOM built by LazyItemContext, in which `extras` and
+// `extensions` of glTF objects hold their JSON text as a string(see
+// SetLazyExtras).
+static TINYGLTF_THREAD_LOCAL bool g_raw_properties = false;
+
+// Sets g_raw_properties on this thread in the scope.
+class ScopedRawProperties {
+ public:
+  explicit ScopedRawProperties(bool enabled) : prev_(g_raw_properties) {
+    g_raw_properties = enabled;
+  }
+  ~ScopedRawProperties() { g_raw_properties = prev_; }
+
+ private:
+  ScopedRawProperties(const ScopedRawProperties &);
+  ScopedRawProperties &operator=(const ScopedRawProperties &);
+
+  bool prev_;
+};
+
+// Vectors kept by TinyGLTFLoader::RecycleScene, by capacity.
+typedef std::multimap<size_t, std::vector<unsigned char> > PayloadPool;
+
+// Pool of the load running on this thread(see ScopedPayloadPool).
+static TINYGLTF_THREAD_LOCAL PayloadPool *g_payload_pool = NULL;
+
+// Lets TakePayload() on this thread reuse the vectors in `pool` in the scope.
+// The vectors which are left at its end are freed, so that the pool holds
+// memory only from RecycleScene() until the next load.
+class ScopedPayloadPool {
+ public:
+  explicit ScopedPayloadPool(PayloadPool *pool) : prev_(g_payload_pool) {
+    g_payload_pool = pool;
+  }
+  ~ScopedPayloadPool() {
+    if (g_payload_pool) {
+      PayloadPool().swap(*g_payload_pool);
+    }
+    g_payload_pool = prev_;
+  }
+
+ private:
+  ScopedPayloadPool(const ScopedPayloadPool &);
+  ScopedPayloadPool &operator=(const ScopedPayloadPool &);
+
+  PayloadPool *prev_;
+};
+
+// Swaps the smallest pooled vector which holds `size` bytes into `v`, which
+// will hold `size` bytes, unless `v` has room already. A vector more than
+// twice as large is not used, so that a small payload does not pin a large
+// allocation.
+static void TakePayload(std::vector<unsigned char> *v, size_t size) {
+  PayloadPool *pool = g_payload_pool;
+  if (!pool || (size == 0) || (v->capacity() >= size)) {
+    return;
+  }
+  PayloadPool::iterator it = pool->lower_bound(size);
+  if ((it != pool->end()) && (it->first / 2 <= size)) {
+    v->swap(it->second);
+    pool->erase(it);
+  }
+}
+
+// Moves the storage of `v` into `pool` if it has any.
+static void PoolPayload(PayloadPool *pool, std::vector<unsigned char> *v) {
+  if (v->capacity() == 0) {
+    return;
+  }
+  v->clear();
+  PayloadPool::iterator it =
+      pool->insert(std::make_pair(v->capacity(), std::vector<unsigned char>()));
+  it->second.swap(*v);
+}
+
+#ifdef TINYGLTF_USE_ARENA
+// Arena of ArenaAllocate() on this thread(see ScopedArena).
+static TINYGLTF_THREAD_LOCAL Arena *g_arena = NULL;
+
+// Every block of ArenaAllocate() starts with the Arena it came from, or NULL
+// for the heap. 8 bytes keep the payload aligned for doubles and pointers.
+static const size_t kArenaHeaderSize = 8;
+
+Arena::Arena(size_t block_size) { Init(NULL, 0, block_size); }
+
+Arena::Arena(void *buffer, size_t size, size_t block_size) {
+  Init(buffer, size, block_size);
+}
+
+Arena::~Arena() { Release(); }
+
+void Arena::Init(void *buffer, size_t size, size_t block_size) {
+  blocks_ = NULL;
+  buffer_ = static_cast<char *>(buffer);
+  buffer_size_ = buffer ? size : 0;
+  block_size_ = std::max(block_size, static_cast<size_t>(1024));
+  reserved_ = buffer_size_;
+  Reset();
+}
+
+void *Arena::Allocate(size_t size) {
+  size = (size + 7) & ~static_cast<size_t>(7);
+  if (size > static_cast<size_t>(end_ - cur_)) {
+    NextBlock(size);
+  }
+  void *p = cur_;
+  cur_ += size;
+  used_ += size;
+  return p;
+}
+
+// Moves on to the next kept block which fits `size` bytes, or a new one.
+void Arena::NextBlock(size_t size) {
+  Block *block = current_ ? current_->next : blocks_;
+  while (block && (block->size < size)) {
+    block = block->next;
+  }
+
+  if (!block) {
+    size_t n = std::max(block_size_, size);
+    block = static_cast<Block *>(::operator new(sizeof(Block) + n));
+    block->size = n;
+    if (current_) {
+      block->next = current_->next;
+      current_->next = block;
+    } else {
+      block->next = blocks_;
+      blocks_ = block;
+    }
+    reserved_ += n;
+  }
+
+  current_ = block;
+  cur_ = reinterpret_cast<char *>(block + 1);
+  end_ = cur_ + block->size;
+}
+
+void Arena::Reset() {
+  current_ = NULL;
+  cur_ = buffer_;
+  end_ = buffer_ + buffer_size_;
+  used_ = 0;
+}
+
+void Arena::Release() {
+  while (blocks_) {
+    Block *next = blocks_->next;
+    ::operator delete(blocks_);
+    blocks_ = next;
+  }
+  reserved_ = buffer_size_;
+  Reset();
+}
+
+void *ArenaAllocate(Arena *arena, size_t size) {
+  char *p;
+  if (arena) {
+    p = static_cast<char *>(arena->Allocate(kArenaHeaderSize + size));
+  } else {
+    p = static_cast<char *>(::operator new(kArenaHeaderSize + size));
+  }
+  *reinterpret_cast<Arena **>(p) = arena;
+  return p + kArenaHeaderSize;
+}
+
+void ArenaFree(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+  char *p = static_cast<char *>(ptr) - kArenaHeaderSize;
+  if (*reinterpret_cast<Arena **>(p) == NULL) {
+    ::operator delete(p);
+  }
+  // Arena blocks are freed by Arena::Reset()/Release().
+}
+
+Arena *CurrentArena() { return g_arena; }
+
+ScopedArena::ScopedArena(Arena *arena) : prev_(g_arena) { g_arena = arena; }
+
+ScopedArena::~ScopedArena() { g_arena = prev_; }
+#endif
+
+// Counts `bytes` as a transient allocation during its lifetime.
+class TransientAlloc {
+ public:
+  explicit TransientAlloc(size_t bytes) : bytes_(bytes) { TrackAlloc(bytes); }
+  ~TransientAlloc() { TrackFree(bytes_); }
+
+ private:
+  TransientAlloc(const TransientAlloc &);
+  TransientAlloc &operator=(const TransientAlloc &);
+
+  size_t bytes_;
+};
+
+// Estimated size of a node of std::map(red-black tree links and color),
+// excluding the value.
+static const size_t kMapNodeOverhead = 4 * sizeof(void *);
+
+// Heap block of `s`, or 0 when it is stored in place(small string
+// optimization).
+static size_t StringHeapSize(const std::string &s) {
+  const char *p = s.data();
+  const char *self = reinterpret_cast<const char *>(&s);
+  if ((p >= self) && (p < self + sizeof(std::string))) {
+    return 0;
+  }
+  return s.capacity() + 1;
+}
+
+// Heap usage of a picojson DOM.
+static size_t JSONHeapSize(const picojson::value &v) {
+  size_t n = 0;
+  if (v.is<std::string>()) {
+    n += sizeof(std::string) + StringHeapSize(v.get<std::string>());
+  } else if (v.is<picojson::array>()) {
+    const picojson::array &a = v.get<picojson::array>();
+    n += sizeof(picojson::array) + a.capacity() * sizeof(picojson::value);
+    for (size_t i = 0; i < a.size(); i++) {
+      n += JSONHeapSize(a[i]);
+    }
+  } else if (v.is<picojson::object>()) {
+    const picojson::object &o = v.get<picojson::object>();
+    n += sizeof(picojson::object);
+    for (picojson::object::const_iterator it = o.begin(); it != o.end();
+         ++it) {
+      n += kMapNodeOverhead + sizeof(picojson::object::value_type) +
+           StringHeapSize(it->first) + JSONHeapSize(it->second);
+    }
+  }
+  return n;
+}
+
+#if defined(TINYGLTF_SIMD_X86)
+#define TINYGLTF_SIMD_SSSE3 (1)
+#define TINYGLTF_SIMD_AVX2 (2)
+
+static int DetectSIMDFeatures() {
+  int features = 0;
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  int max_id = info[0];
+  if (max_id >= 1) {
+    __cpuid(info, 1);
+    if (info[2] & (1 << 9)) {
+      features |= TINYGLTF_SIMD_SSSE3;
+    }
+    // AVX2 needs OS support for saving YMM registers.
+    bool os_avx = ((info[2] & (1 << 27)) != 0) &&
+                  ((info[2] & (1 << 28)) != 0) && ((_xgetbv(0) & 6) == 6);
+    if (os_avx && (max_id >= 7)) {
+      __cpuidex(info, 7, 0);
+      if (info[1] & (1 << 5)) {
+        features |= TINYGLTF_SIMD_AVX2;
+      }
+    }
+  }
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("ssse3")) {
+    features |= TINYGLTF_SIMD_SSSE3;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    features |= TINYGLTF_SIMD_AVX2;
+  }
+#endif
+  return features;
+}
+
+// Returns TINYGLTF_SIMD_*** flags supported by the running CPU. Safe to call
+// from concurrent tasks.
+static int GetSIMDFeatures() {
+#if (__cplusplus >= 201103L) || (defined(_MSC_VER) && (_MSC_VER >= 1900))
+  static const int features = DetectSIMDFeatures();
+  return features;
+#else
+  // No thread safe statics: the first caller publishes the flags with a
+  // compare-and-swap. Racing callers detect the same flags.
+  static long features = -1;
+#if defined(_MSC_VER)
+  long f = InterlockedCompareExchange(&features, -1, -1);
+  if (f < 0) {
+    f = DetectSIMDFeatures();
+    InterlockedCompareExchange(&features, f, -1);
+  }
+#else
+  long f = __sync_val_compare_and_swap(&features, -1, -1);
+  if (f < 0) {
+    f = DetectSIMDFeatures();
+    __sync_val_compare_and_swap(&features, -1, f);
+  }
+#endif
+  return static_cast<int>(f);
+#endif
+}
+#endif
+
+static void swap4(unsigned int *val) {
+#ifdef TINYGLTF_LITTLE_ENDIAN
+  (void)val;
+#else
+  unsigned int tmp = *val;
+  unsigned char *dst = reinterpret_cast<unsigned char *>(val);
+  unsigned char *src = reinterpret_cast<unsigned char *>(&tmp);
+
+  dst[0] = src[3];
+  dst[1] = src[2];
+  dst[2] = src[1];
+  dst[3] = src[0];
+#endif
+}
+
+static bool FileExists(const std::string &abs_filename) {
+  bool ret;
+#ifdef _WIN32
+  FILE *fp;
+  errno_t err = fopen_s(&fp, abs_filename.c_str(), "rb");
+  if (err != 0) {
+    return false;
+  }
+#else
+  FILE *fp = fopen(abs_filename.c_str(), "rb");
+#endif
+  if (fp) {
+    ret = true;
+    fclose(fp);
+  } else {
+    ret = false;
+  }
+
+  return ret;
+}
+
+static std::string ExpandFilePath(const std::string &filepath) {
+#ifdef _WIN32
   DWORD len = ExpandEnvironmentStringsA(filepath.c_str(), NULL, 0);
   char *str = new char[len];
   ExpandEnvironmentStringsA(filepath.c_str(), str, len);
 
-  std::string s(str);
+  std::string s(str);
+
+  delete[] str;
+
+  return s;
+#else
+
+#if defined(TARGET_OS_IPHONE) || defined(TARGET_IPHONE_SIMULATOR)
+  // no expansion
+  std::string s = filepath;
+#else
+  std::string s;
+  wordexp_t p;
+
+  if (filepath.empty()) {
+    return "";
+  }
+
+  // char** w;
+  int ret = wordexp(filepath.c_str(), &p, 0);
+  if (ret) {
+    // err
+    s = filepath;
+    return s;
+  }
+
+  // Use first element only.
+  if (p.we_wordv) {
+    s = std::string(p.we_wordv[0]);
+    wordfree(&p);
+  } else {
+    s = filepath;
+  }
+
+#endif
+
+  return s;
+#endif
+}
+
+static std::string JoinPath(const std::string &path0,
+                            const std::string &path1) {
+  if (path0.empty()) {
+    return path1;
+  } else {
+    // check '/'
+    char lastChar = *path0.rbegin();
+    if (lastChar != '/') {
+      return path0 + std::string("/") + path1;
+    } else {
+      return path0 + path1;
+    }
+  }
+}
+
+static std::string FindFile(const std::vector<std::string> &paths,
+                            const std::string &filepath) {
+  for (size_t i = 0; i < paths.size(); i++) {
+    std::string absPath = ExpandFilePath(JoinPath(paths[i], filepath));
+    if (FileExists(absPath)) {
+      return absPath;
+    }
+  }
+
+  return std::string();
+}
+
+// std::string GetFilePathExtension(const std::string& FileName)
+//{
+//    if(FileName.find_last_of(".") != std::string::npos)
+//        return FileName.substr(FileName.find_last_of(".")+1);
+//    return "";
+//}
+
+static std::string GetBaseDir(const std::string &filepath) {
+  if (filepath.find_last_of("/\\") != std::string::npos)
+    return filepath.substr(0, filepath.find_last_of("/\\"));
+  return "";
+}
+
+// std::string base64_encode(unsigned char const* , unsigned int len);
+std::string base64_decode(std::string const &s);
+
+/*
+   base64.cpp and base64.h
+
+   Copyright (C) 2004-2008 René Nyffenegger
+
+   This source code is provided 'as-is', without any express or implied
+   warranty. In no event will the author be held liable for any damages
+   arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any purpose,
+   including commercial applications, and to alter it and redistribute it
+   freely, subject to the following restrictions:
+
+   1. The origin of this source code must not be misrepresented; you must not
+      claim that you wrote the original source code. If you use this source code
+      in a product, an acknowledgment in the product documentation would be
+      appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+      misrepresented as being the original source code.
+
+   3. This notice may not be removed or altered from any source distribution.
+
+   René Nyffenegger rene.nyffenegger@adp-gmbh.ch
+
+*/
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#pragma clang diagnostic ignored "-Wconversion"
+#pragma clang diagnostic ignored "-Wcast-align"
+#endif
+
+// Modified from the original base64.cpp: decoding is table driven and has
+// SSSE3/AVX2/NEON code paths. Decoding stops at the first padding or
+// non-base64 character as the original code does.
+
+// Maps a character to its 6-bit value, or 0xff for a non-base64 character.
+static const unsigned char kBase64DecodeTable[256] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 62,   0xff, 0xff, 0xff, 63,
+    52,   53,   54,   55,   56,   57,   58,   59,   60,   61,   0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0,    1,    2,    3,    4,    5,    6,
+    7,    8,    9,    10,   11,   12,   13,   14,   15,   16,   17,   18,
+    19,   20,   21,   22,   23,   24,   25,   0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 26,   27,   28,   29,   30,   31,   32,   33,   34,   35,   36,
+    37,   38,   39,   40,   41,   42,   43,   44,   45,   46,   47,   48,
+    49,   50,   51,   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff};
+
+// Size of the decoded data for `len` base64 characters. Exact for a well
+// formed input, otherwise an upper bound.
+static size_t Base64DecodedSize(const char *in, size_t len) {
+  while ((len > 0) && (in[len - 1] == '=')) {
+    len--;
+  }
+  size_t sz = (len / 4) * 3;
+  if ((len % 4) > 1) {
+    sz += (len % 4) - 1;
+  }
+  return sz;
+}
+
+// Decodes whole 4-character groups. Stops at the first group containing a
+// padding or non-base64 character. Returns the number of bytes written and
+// the number of characters consumed in `consumed`.
+static size_t Base64DecodeScalar(unsigned char *out, const char *in,
+                                 size_t len, size_t *consumed) {
+  const unsigned char *src = reinterpret_cast<const unsigned char *>(in);
+  size_t i = 0;
+  size_t o = 0;
+  for (; i + 4 <= len; i += 4) {
+    unsigned int a = kBase64DecodeTable[src[i + 0]];
+    unsigned int b = kBase64DecodeTable[src[i + 1]];
+    unsigned int c = kBase64DecodeTable[src[i + 2]];
+    unsigned int d = kBase64DecodeTable[src[i + 3]];
+    if ((a | b | c | d) & 0x80) {
+      break;
+    }
+    unsigned int v = (a << 18) | (b << 12) | (c << 6) | d;
+    out[o++] = static_cast<unsigned char>(v >> 16);
+    out[o++] = static_cast<unsigned char>(v >> 8);
+    out[o++] = static_cast<unsigned char>(v);
+  }
+  (*consumed) = i;
+  return o;
+}
+
+#if defined(TINYGLTF_SIMD_X86)
+
+// Base64 decoding with SSSE3/AVX2. Based on the algorithm by Wojciech Mula
+// and Alfred Klomp: characters are validated and translated with nibble
+// lookup tables, then 6-bit values are packed with multiply-add.
+
+TINYGLTF_TARGET_SSSE3
+static size_t Base64DecodeSSSE3(unsigned char *out, size_t out_size,
+                                const char *in, size_t len,
+                                size_t *consumed) {
+  const __m128i lut_lo =
+      _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                    0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i lut_hi =
+      _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10,
+                    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0,
+                                         0, 0, 0, 0, 0, 0, 0);
+  const __m128i mask_2f = _mm_set1_epi8(0x2f);
+  const __m128i pack_mul0 = _mm_set1_epi32(0x01400140);
+  const __m128i pack_mul1 = _mm_set1_epi32(0x00011000);
+  const __m128i pack_shuf = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13,
+                                          12, -1, -1, -1, -1);
+
+  size_t i = 0;
+  size_t o = 0;
+  // 16 characters are decoded into 12 bytes, but 16 bytes are stored.
+  while ((i + 16 <= len) && (o + 16 <= out_size)) {
+    __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+
+    const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+    const __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+    const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi),
+                                         _mm_setzero_si128())) != 0) {
+      // Padding or invalid character. Let the scalar code handle it.
+      break;
+    }
+
+    const __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+    const __m128i roll =
+        _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+    str = _mm_add_epi8(str, roll);
+
+    str = _mm_maddubs_epi16(str, pack_mul0);
+    str = _mm_madd_epi16(str, pack_mul1);
+    str = _mm_shuffle_epi8(str, pack_shuf);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + o), str);
+
+    i += 16;
+    o += 12;
+  }
+
+  (*consumed) = i;
+  return o;
+}
+
+TINYGLTF_TARGET_AVX2
+static size_t Base64DecodeAVX2(unsigned char *out, size_t out_size,
+                               const char *in, size_t len, size_t *consumed) {
+  const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,
+      0x1B, 0x1B, 0x1B, 0x1A, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 19, 4,
+      -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+  const __m256i pack_mul0 = _mm256_set1_epi32(0x01400140);
+  const __m256i pack_mul1 = _mm256_set1_epi32(0x00011000);
+  const __m256i pack_shuf = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4,
+      10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i pack_perm = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+  size_t i = 0;
+  size_t o = 0;
+  // 32 characters are decoded into 24 bytes, but 32 bytes are stored.
+  while ((i + 32 <= len) && (o + 32 <= out_size)) {
+    __m256i str =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+
+    const __m256i hi_nibbles =
+        _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+    const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    if (!_mm256_testz_si256(lo, hi)) {
+      break;
+    }
+
+    const __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+    const __m256i roll =
+        _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    str = _mm256_add_epi8(str, roll);
+
+    str = _mm256_maddubs_epi16(str, pack_mul0);
+    str = _mm256_madd_epi16(str, pack_mul1);
+    str = _mm256_shuffle_epi8(str, pack_shuf);
+    str = _mm256_permutevar8x32_epi32(str, pack_perm);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + o), str);
+
+    i += 32;
+    o += 24;
+  }
+
+  (*consumed) = i;
+  return o;
+}
+
+#elif defined(TINYGLTF_SIMD_NEON)
+
+// Translates 16 characters into 6-bit values. Invalid characters become 0xff.
+static inline uint8x16_t Base64TranslateNEON(uint8x16_t c) {
+  uint8x16_t v = vdupq_n_u8(0xff);
+  uint8x16_t upper =
+      vandq_u8(vcgeq_u8(c, vdupq_n_u8('A')), vcleq_u8(c, vdupq_n_u8('Z')));
+  uint8x16_t lower =
+      vandq_u8(vcgeq_u8(c, vdupq_n_u8('a')), vcleq_u8(c, vdupq_n_u8('z')));
+  uint8x16_t digit =
+      vandq_u8(vcgeq_u8(c, vdupq_n_u8('0')), vcleq_u8(c, vdupq_n_u8('9')));
+  v = vbslq_u8(upper, vsubq_u8(c, vdupq_n_u8(65)), v);
+  v = vbslq_u8(lower, vsubq_u8(c, vdupq_n_u8(71)), v);
+  v = vbslq_u8(digit, vaddq_u8(c, vdupq_n_u8(4)), v);
+  v = vbslq_u8(vceqq_u8(c, vdupq_n_u8('+')), vdupq_n_u8(62), v);
+  v = vbslq_u8(vceqq_u8(c, vdupq_n_u8('/')), vdupq_n_u8(63), v);
+  return v;
+}
+
+static inline bool HasHighBitNEON(uint8x16_t v) {
+  uint8x8_t r = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+  r = vpmax_u8(r, r);
+  r = vpmax_u8(r, r);
+  r = vpmax_u8(r, r);
+  return (vget_lane_u8(r, 0) & 0x80) != 0;
+}
+
+static size_t Base64DecodeNEON(unsigned char *out, size_t out_size,
+                               const char *in, size_t len, size_t *consumed) {
+  size_t i = 0;
+  size_t o = 0;
+  // 64 characters are decoded into 48 bytes.
+  while ((i + 64 <= len) && (o + 48 <= out_size)) {
+    uint8x16x4_t str = vld4q_u8(reinterpret_cast<const uint8_t *>(in + i));
+    uint8x16_t a = Base64TranslateNEON(str.val[0]);
+    uint8x16_t b = Base64TranslateNEON(str.val[1]);
+    uint8x16_t c = Base64TranslateNEON(str.val[2]);
+    uint8x16_t d = Base64TranslateNEON(str.val[3]);
+    if (HasHighBitNEON(vorrq_u8(vorrq_u8(a, b), vorrq_u8(c, d)))) {
+      break;
+    }
+
+    uint8x16x3_t dst;
+    dst.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+    dst.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+    dst.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+    vst3q_u8(reinterpret_cast<uint8_t *>(out + o), dst);
+
+    i += 64;
+    o += 48;
+  }
+
+  (*consumed) = i;
+  return o;
+}
+
+#endif
+
+// Decodes base64 characters into `out`, which must have room for
+// Base64DecodedSize(in, len) bytes. Returns the number of bytes written.
+static size_t Base64Decode(unsigned char *out, size_t out_size, const char *in,
+                           size_t len) {
+  size_t i = 0;
+  size_t o = 0;
+  size_t consumed = 0;
+
+#if defined(TINYGLTF_SIMD_X86)
+  int features = GetSIMDFeatures();
+  if (features & TINYGLTF_SIMD_AVX2) {
+    o += Base64DecodeAVX2(out + o, out_size - o, in + i, len - i, &consumed);
+    i += consumed;
+  }
+  if (features & TINYGLTF_SIMD_SSSE3) {
+    o += Base64DecodeSSSE3(out + o, out_size - o, in + i, len - i, &consumed);
+    i += consumed;
+  }
+#elif defined(TINYGLTF_SIMD_NEON)
+  o += Base64DecodeNEON(out + o, out_size - o, in + i, len - i, &consumed);
+  i += consumed;
+#else
+  (void)out_size;
+#endif
+
+  o += Base64DecodeScalar(out + o, in + i, len - i, &consumed);
+  i += consumed;
+
+  // Trailing partial group, terminated by the end of input, padding or a
+  // non-base64 character.
+  unsigned int v = 0;
+  int n = 0;
+  for (; (i < len) && (n < 4); i++, n++) {
+    unsigned int c = kBase64DecodeTable[static_cast<unsigned char>(in[i])];
+    if (c & 0x80) {
+      break;
+    }
+    v = (v << 6) | c;
+  }
+  if (n >= 2) {
+    v <<= 6 * (4 - n);
+    out[o++] = static_cast<unsigned char>(v >> 16);
+    if (n >= 3) {
+      out[o++] = static_cast<unsigned char>(v >> 8);
+    }
+  }
+
+  return o;
+}
+
+std::string base64_decode(std::string const &encoded_string) {
+  const char *in = encoded_string.data();
+  size_t len = encoded_string.size();
+
+  std::string ret(Base64DecodedSize(in, len), '\0');
+  if (ret.empty()) {
+    return ret;
+  }
+
+  size_t n = Base64Decode(reinterpret_cast<unsigned char *>(&ret[0]),
+                          ret.size(), in, len);
+  ret.resize(n);
+
+  return ret;
+}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+// Finds `filename` in `basedir` or in the current directory.
+static bool FindExternalFile(std::string *filepath, std::string *err,
+                             const std::string &filename,
+                             const std::string &basedir) {
+  std::vector<std::string> paths;
+  paths.push_back(basedir);
+  paths.push_back(".");
+
+  (*filepath) = FindFile(paths, filename);
+  if (filepath->empty()) {
+    if (err) {
+      (*err) += "File not found : " + filename + "\n";
+    }
+    return false;
+  }
+
+  return true;
+}
+
+static bool ReadWholeFile(std::vector<unsigned char> *out, std::string *err,
+                          const std::string &filepath) {
+  std::ifstream f(filepath.c_str(), std::ifstream::binary);
+  if (!f) {
+    if (err) {
+      (*err) += "File open error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  f.seekg(0, f.end);
+  size_t sz = static_cast<size_t>(f.tellg());
+  out->resize(sz);
+
+  if (sz > 0) {
+    f.seekg(0, f.beg);
+    f.read(reinterpret_cast<char *>(&out->at(0)),
+           static_cast<std::streamsize>(sz));
+  }
+  f.close();
+
+  return true;
+}
+
+static bool LoadExternalFile(std::vector<unsigned char> *out, std::string *err,
+                             const std::string &filename,
+                             const std::string &basedir, size_t reqBytes,
+                             bool checkSize) {
+  out->clear();
+
+  std::string filepath;
+  if (!FindExternalFile(&filepath, err, filename, basedir)) {
+    return false;
+  }
+
+  // Read in place, so a recycled `out` is reused.
+  if (!ReadWholeFile(out, err, filepath)) {
+    return false;
+  }
+  size_t sz = out->size();
+
+  if (checkSize) {
+    if (reqBytes == sz) {
+      return true;
+    } else {
+      out->clear();
+      std::stringstream ss;
+      ss << "File size mismatch : " << filepath << ", requestedBytes "
+         << reqBytes << ", but got " << sz << std::endl;
+      if (err) {
+        (*err) += ss.str();
+      }
+      return false;
+    }
+  }
+
+  return true;
+}
+
+#if !defined(_WIN32) && !defined(TINYGLTF_NO_MMAP)
+static void UnmapFile(void *user_ptr, const unsigned char *data, size_t size) {
+  (void)user_ptr;
+  munmap(const_cast<unsigned char *>(data), size);
+}
+#elif defined(_WIN32) && !defined(TINYGLTF_NO_MMAP)
+static void UnmapFile(void *user_ptr, const unsigned char *data, size_t size) {
+  (void)user_ptr;
+  (void)size;
+  UnmapViewOfFile(data);
+}
+#else
+static void FreeFileData(void *user_ptr, const unsigned char *data,
+                         size_t size) {
+  (void)user_ptr;
+  (void)size;
+  delete[] data;
+}
+#endif
+
+// Maps the whole file read-only into memory. The mapping is released when
+// the last `SharedStorage` handle referencing it goes away.
+// When TINYGLTF_NO_MMAP is defined, the file is read into a heap block
+// instead.
+static bool MapFile(SharedStorage *storage, std::string *err,
+                    const std::string &filepath) {
+#if !defined(_WIN32) && !defined(TINYGLTF_NO_MMAP)
+  int fd = open(filepath.c_str(), O_RDONLY);
+  if (fd == -1) {
+    if (err) {
+      (*err) += "File open error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  struct stat sb;
+  if ((fstat(fd, &sb) == -1) || (sb.st_size <= 0)) {
+    close(fd);
+    if (err) {
+      (*err) += "Empty or invalid file : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  size_t sz = static_cast<size_t>(sb.st_size);
+  void *addr = mmap(NULL, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    if (err) {
+      (*err) += "Failed to map file : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  (*storage) = SharedStorage(reinterpret_cast<const unsigned char *>(addr), sz,
+                             UnmapFile);
+  return true;
+#elif defined(_WIN32) && !defined(TINYGLTF_NO_MMAP)
+  HANDLE file =
+      CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    if (err) {
+      (*err) += "File open error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  LARGE_INTEGER fsize;
+  if (!GetFileSizeEx(file, &fsize) || (fsize.QuadPart <= 0)) {
+    CloseHandle(file);
+    if (err) {
+      (*err) += "Empty or invalid file : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) {
+    if (err) {
+      (*err) += "Failed to map file : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  // The view keeps the mapping object alive.
+  void *addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (addr == NULL) {
+    if (err) {
+      (*err) += "Failed to map file : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  (*storage) = SharedStorage(reinterpret_cast<const unsigned char *>(addr),
+                             static_cast<size_t>(fsize.QuadPart), UnmapFile);
+  return true;
+#else
+  std::ifstream f(filepath.c_str(), std::ifstream::binary);
+  if (!f) {
+    if (err) {
+      (*err) += "File open error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  f.seekg(0, f.end);
+  size_t sz = static_cast<size_t>(f.tellg());
+  if (sz == 0) {
+    if (err) {
+      (*err) += "Empty or invalid file : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  unsigned char *buf = new unsigned char[sz];
+  f.seekg(0, f.beg);
+  f.read(reinterpret_cast<char *>(buf), static_cast<std::streamsize>(sz));
+  f.close();
+
+  (*storage) = SharedStorage(buf, sz, FreeFileData);
+  return true;
+#endif
+}
+
+// Same as LoadExternalFile(), but maps the file instead of copying it.
+static bool MapExternalFile(SharedStorage *storage, std::string *err,
+                            const std::string &filename,
+                            const std::string &basedir, size_t reqBytes,
+                            bool checkSize) {
+  std::string filepath;
+  if (!FindExternalFile(&filepath, err, filename, basedir)) {
+    return false;
+  }
+
+  SharedStorage mapped;
+  if (!MapFile(&mapped, err, filepath)) {
+    return false;
+  }
+
+  if (checkSize && (reqBytes != mapped.Size())) {
+    std::stringstream ss;
+    ss << "File size mismatch : " << filepath << ", requestedBytes "
+       << reqBytes << ", but got " << mapped.Size() << std::endl;
+    if (err) {
+      (*err) += ss.str();
+    }
+    return false;
+  }
+
+  (*storage) = mapped;
+  return true;
+}
+
+static bool LoadImageData(Image *image, std::string *err, int req_width,
+                          int req_height, const unsigned char *bytes,
+                          int size) {
+  int w, h, comp;
+  unsigned char *data = stbi_load_from_memory(bytes, size, &w, &h, &comp, 0);
+  if (!data) {
+    if (err) {
+      (*err) += "Unknown image format.\n";
+    }
+    return false;
+  }
+
+  TransientAlloc decoded((w > 0 && h > 0) ? static_cast<size_t>(w * h * comp)
+                                         : 0);
+
+  const char *msg = NULL;
+  if (w < 1 || h < 1) {
+    msg = "Unknown image format.\n";
+  } else if ((req_width > 0) && (req_width != w)) {
+    msg = "Image width mismatch.\n";
+  } else if ((req_height > 0) && (req_height != h)) {
+    msg = "Image height mismatch.\n";
+  }
+
+  if (msg) {
+    stbi_image_free(data);
+    if (err) {
+      (*err) += msg;
+    }
+    return false;
+  }
+
+  image->width = w;
+  image->height = h;
+  image->component = comp;
+  TakePayload(&image->image, static_cast<size_t>(w * h * comp));
+  image->image.assign(data, data + w * h * comp);
+  stbi_image_free(data);
+
+  return true;
+}
+
+static bool HasPrefixAt(const std::string &in, size_t pos,
+                        const char *prefix) {
+  size_t n = strlen(prefix);
+  return (in.size() >= pos + n) && (in.compare(pos, n, prefix) == 0);
+}
+
+// Returns the offset of the base64 payload when `in` is a data URI with a
+// supported MIME type, otherwise 0. Only the header at the beginning of `in`
+// is examined, so this is cheap even for a large data URI.
+static size_t DataURIPayloadOffset(const std::string &in) {
+  static const char *const kMimeTypes[] = {
+      "application/octet-stream", "image/png", "image/jpeg", "text/plain"};
+
+  if (!HasPrefixAt(in, 0, "data:")) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < sizeof(kMimeTypes) / sizeof(kMimeTypes[0]); i++) {
+    size_t pos = 5 + strlen(kMimeTypes[i]);
+    if (HasPrefixAt(in, 5, kMimeTypes[i]) &&
+        HasPrefixAt(in, pos, ";base64,")) {
+      return pos + 8;
+    }
+  }
+
+  return 0;
+}
+
+// Decodes the base64 payload of a data URI starting at `offset` (obtained by
+// DataURIPayloadOffset()) straight into `out`.
+static bool DecodeDataURI(std::vector<unsigned char> *out,
+                          const std::string &in, size_t offset,
+                          size_t reqBytes, bool checkSize) {
+  const char *payload = in.data() + offset;
+  size_t len = in.size() - offset;
+
+  // Exact for a well formed payload, so the size can be checked up front.
+  size_t sz = Base64DecodedSize(payload, len);
+  if ((sz == 0) || (checkSize && (sz < reqBytes))) {
+    return false;
+  }
+
+  out->resize(sz);
+  size_t n = Base64Decode(&out->at(0), sz, payload, len);
+  if ((n == 0) || (checkSize && (n != reqBytes))) {
+    out->clear();
+    return false;
+  }
+  out->resize(n);
+
+  return true;
+}
+
+// Parses `property` of `o`, which may be any JSON value, into `ret`. Returns
+// false if there's no such property.
+static bool ParseJSONProperty(Value *ret, const picojson::object &o,
+                              const char *property) {
+  picojson::object::const_iterator it = o.find(property);
+  if (it == o.end()) {
+    return false;
+  }
+
+  if (g_raw_properties && it->second.is<std::string>()) {
+    // JSON text captured by LazyItemContext.
+    Value::FromJSON(it->second.get<std::string>()).Swap(*ret);
+  } else {
+    ConvertJSONValue(ret, it->second);
+  }
+
+  return true;
+}
+
+static bool ParseExtrasProperty(Value *ret, const picojson::object &o) {
+  return ParseJSONProperty(ret, o, "extras");
+}
+
+static bool ParseExtensionsProperty(Value *ret, const picojson::object &o) {
+  return ParseJSONProperty(ret, o, "extensions");
+}
+
+static bool ParseBooleanProperty(bool *ret, std::string *err,
+                                 const picojson::object &o,
+                                 const std::string &property, bool required) {
+  picojson::object::const_iterator it = o.find(property);
+  if (it == o.end()) {
+    if (required) {
+      if (err) {
+        (*err) += "'" + property + "' property is missing.\n";
+      }
+    }
+    return false;
+  }
+
+  if (!it->second.is<bool>()) {
+    if (required) {
+      if (err) {
+        (*err) += "'" + property + "' property is not a bool type.\n";
+      }
+    }
+    return false;
+  }
+
+  if (ret) {
+    (*ret) = it->second.get<bool>();
+  }
+
+  return true;
+}
+
+static bool ParseNumberProperty(double *ret, std::string *err,
+                                const picojson::object &o,
+                                const std::string &property, bool required) {
+  picojson::object::const_iterator it = o.find(property);
+  if (it == o.end()) {
+    if (required) {
+      if (err) {
+        (*err) += "'" + property + "' property is missing.\n";
+      }
+    }
+    return false;
+  }
+
+  if (!it->second.is<double>()) {
+    if (required) {
+      if (err) {
+        (*err) += "'" + property + "' property is not a number type.\n";
+      }
+    }
+    return false;
+  }
+
+  if (ret) {
+    (*ret) = it->second.get<double>();
+  }
+
+  return true;
+}
+
+static bool ParseNumberArrayProperty(NumberArray *ret, std::string *err,
+                                     const picojson::object &o,
+                                     const std::string &property,
+                                     bool required) {
+  picojson::object::const_iterator it = o.find(property);
+  if (it == o.end()) {
+    if (required) {
+      if (err) {
+        (*err) += "'" + property + "' property is missing.\n";
+      }
+    }
+    return false;
+  }
+
+  if (!it->second.is<picojson::array>()) {
+    if (required) {
+      if (err) {
+        (*err) += "'" + property + "' property is not an array.\n";
+      }
+    }
+    return false;
+  }
+
+  ret->clear();
+  const picojson::array &arr = it->second.get<picojson::array>();
+  for (size_t i = 0; i < arr.size(); i++) {
+    if (!arr[i].is<double>()) {
+      if (required) {
+        if (err) {
+          (*err) += "'" + property + "' property is not a number.\n";
+        }
+      }
+      return false;
+    }
+    ret->push_back(arr[i].get<double>());
+  }
+
+  return true;
+}
+
+// Same as ParseStringProperty(), but refers to the string stored in `o`
+// instead of copying it. Used for `uri`, which may be a large data URI.
+static const std::string *FindStringProperty(
+    std::string *err, const picojson::object &o, const std::string &property,
+    bool required, const std::string &parent_node = std::string()) {
+  picojson::object::const_iterator it = o.find(property);
+  if (it == o.end()) {
+    if (required) {
+      if (err) {
+        (*err) += "'" + property + "' property is missing";
+        if (parent_node.empty()) {
+          (*err) += ".\n";
+        } else {
+          (*err) += " in `" + parent_node + "'.\n";
+        }
+      }
+    }
+    return NULL;
+  }
+
+  if (!it->second.is<std::string>()) {
+    if (required) {
+      if (err) {
+        (*err) += "'" + property + "' property is not a string type.\n";
+      }
+    }
+    return NULL;
+  }
+
+  return &(it->second.get<std::string>());
+}
+
+static bool ParseStringProperty(
+    std::string *ret, std::string *err, const picojson::object &o,
+    const std::string &property, bool required,
+    const std::string &parent_node = std::string()) {
+  const std::string *value =
+      FindStringProperty(err, o, property, required, parent_node);
+  if (!value) {
+    return false;
+  }
+
+  if (ret) {
+    (*ret) = (*value);
+  }
+
+  return true;
+}
+
+static bool ParseStringArrayProperty(StringArray *ret, std::string *err,
+                                     const picojson::object &o,
+                                     const std::string &property,
+                                     bool required) {
+  picojson::object::const_iterator it = o.find(property);
+  if (it == o.end()) {
+    if (required) {
+      if (err) {
+        (*err) += "'" + property + "' property is missing.\n";
+      }
+    }
+    return false;
+  }
+
+  if (!it->second.is<picojson::array>()) {
+    if (required) {
+      if (err) {
+        (*err) += "'" + property + "' property is not an array.\n";
+      }
+    }
+    return false;
+  }
+
+  ret->clear();
+  const picojson::array &arr = it->second.get<picojson::array>();
+  for (size_t i = 0; i < arr.size(); i++) {
+    if (!arr[i].is<std::string>()) {
+      if (required) {
+        if (err) {
+          (*err) += "'" + property + "' property is not a string.\n";
+        }
+      }
+      return false;
+    }
+    ret->push_back(arr[i].get<std::string>());
+  }
+
+  return true;
+}
+
+static bool ParseStringMapProperty(StringMap *ret,
+                                   std::string *err, const picojson::object &o,
+                                   const std::string &property, bool required) {
+  picojson::object::const_iterator it = o.find(property);
+  if (it == o.end()) {
+    if (required) {
+      if (err) {
+        (*err) += "'" + property + "' property is missing.\n";
+      }
+    }
+    return false;
+  }
+
+  // Make sure we are dealing with an object / dictionary.
+  if (!it->second.is<picojson::object>()) {
+    if (required) {
+      if (err) {
+        (*err) += "'" + property + "' property is not an object.\n";
+      }
+    }
+    return false;
+  }
+
+  ret->clear();
+  const picojson::object &dict = it->second.get<picojson::object>();
+
+  picojson::object::const_iterator dictIt(dict.begin());
+  picojson::object::const_iterator dictItEnd(dict.end());
+
+  for (; dictIt != dictItEnd; ++dictIt) {
+    // Check that the value is a string.
+    if (!dictIt->second.is<std::string>()) {
+      if (required) {
+        if (err) {
+          (*err) += "'" + property + "' value is not a string.\n";
+        }
+      }
+      return false;
+    }
+
+    // Insert into the list.
+    (*ret)[dictIt->first] = dictIt->second.get<std::string>();
+  }
+  return true;
+}
+
+static bool ParseKHRBinaryExtension(const picojson::object &o, std::string *err,
+                                    std::string *buffer_view,
+                                    std::string *mime_type, int *image_width,
+                                    int *image_height) {
+  picojson::object j = o;
+
+  if (j.find("extensions") == j.end()) {
+    if (err) {
+      (*err) += "`extensions' property is missing.\n";
+    }
+    return false;
+  }
+
+  if (!(j["extensions"].is<picojson::object>())) {
+    if (err) {
+      (*err) += "Invalid `extensions' property.\n";
+    }
+    return false;
+  }
+
+  picojson::object ext = j["extensions"].get<picojson::object>();
+
+  if (ext.find("KHR_binary_glTF") == ext.end()) {
+    if (err) {
+      (*err) +=
+          "`KHR_binary_glTF' property is missing in extension property.\n";
+    }
+    return false;
+  }
+
+  if (!(ext["KHR_binary_glTF"].is<picojson::object>())) {
+    if (err) {
+      (*err) += "Invalid `KHR_binary_glTF' property.\n";
+    }
+    return false;
+  }
+
+  picojson::object k = ext["KHR_binary_glTF"].get<picojson::object>();
+
+  if (!ParseStringProperty(buffer_view, err, k, "bufferView", true)) {
+    return false;
+  }
+
+  if (mime_type) {
+    ParseStringProperty(mime_type, err, k, "mimeType", false);
+  }
+
+  if (image_width) {
+    double width = 0.0;
+    if (ParseNumberProperty(&width, err, k, "width", false)) {
+      (*image_width) = static_cast<int>(width);
+    }
+  }
+
+  if (image_height) {
+    double height = 0.0;
+    if (ParseNumberProperty(&height, err, k, "height", false)) {
+      (*image_height) = static_cast<int>(height);
+    }
+  }
+
+  return true;
+}
+
+static bool ParseAsset(Asset *asset, std::string *err,
+                       const picojson::object &o) {
+  ParseStringProperty(&asset->generator, err, o, "generator", false);
+  ParseBooleanProperty(&asset->premultipliedAlpha, err, o, "premultipliedAlpha",
+                       false);
+
+  ParseStringProperty(&asset->version, err, o, "version", false);
+
+  picojson::object::const_iterator profile = o.find("profile");
+  if (profile != o.end()) {
+    const picojson::value &v = profile->second;
+    if (v.contains("api") & v.get("api").is<std::string>()) {
+      asset->profile_api = v.get("api").get<std::string>();
+    }
+    if (v.contains("version") & v.get("version").is<std::string>()) {
+      asset->profile_version = v.get("version").get<std::string>();
+    }
+  }
+
+  ParseExtrasProperty(&(asset->extras), o);
+  ParseExtensionsProperty(&(asset->extensions), o);
+
+  return true;
+}
+
+static bool ParseImage(Image *image, std::string *err,
+                       const picojson::object &o, const std::string &basedir,
+                       bool use_mmap, bool defer_decode, bool is_binary,
+                       const unsigned char *bin_data, size_t bin_size) {
+  // Refer to the (possibly large) uri string in `o` instead of copying it.
+  const std::string *uri_str = FindStringProperty(err, o, "uri", true);
+  if (!uri_str) {
+    return false;
+  }
+  const std::string &uri = *uri_str;
+  const size_t uri_payload = DataURIPayloadOffset(uri);
+
+  ParseStringProperty(&image->name, err, o, "name", false);
+  ParseExtrasProperty(&(image->extras), o);
+  ParseExtensionsProperty(&(image->extensions), o);
+
+  if (defer_decode) {
+    image->width = image->height = image->component = 0;
+  }
+
+  std::vector<unsigned char> img;
+  SharedStorage mapped;  // Used instead of `img` for memory mapped files.
+  if (defer_decode) {
+    img.swap(image->encoded);  // Recycled storage, if any.
+  }
+
+  if (is_binary) {
+    // Still binary glTF accepts external dataURI. First try external resources.
+    bool loaded = false;
+    if (uri_payload > 0) {
+      loaded = DecodeDataURI(&img, uri, uri_payload, 0, false);
+    } else if (defer_decode) {
+      loaded = FindExternalFile(&image->encodedPath, err, uri, basedir);
+    } else if (use_mmap) {
+      loaded = MapExternalFile(&mapped, err, uri, basedir, 0, false);
+    } else {
+      // Assume external .bin file.
+      loaded = LoadExternalFile(&img, err, uri, basedir, 0, false);
+    }
+
+    if (!loaded) {
+      // load data from (embedded) binary data
+
+      if ((bin_size == 0) || (bin_data == NULL)) {
+        if (err) {
+          (*err) += "Invalid binary data.\n";
+        }
+        return false;
+      }
+
+      // There should be "extensions" property.
+      // "extensions":{"KHR_binary_glTF":{"bufferView": "id", ...
+
+      std::string buffer_view;
+      std::string mime_type;
+      int image_width;
+      int image_height;
+      bool ret = ParseKHRBinaryExtension(o, err, &buffer_view, &mime_type,
+                                         &image_width, &image_height);
+      if (!ret) {
+        return false;
+      }
+
+      if (uri.compare("data:,") == 0) {
+        // ok
+      } else {
+        if (err) {
+          (*err) += "Invalid URI for binary data.\n";
+        }
+        return false;
+      }
+
+      // Just only save some information here. Loading actual image data from
+      // bufferView is done in other place.
+      image->bufferView = buffer_view;
+      image->mimeType = mime_type;
+      image->width = image_width;
+      image->height = image_height;
+
+      return true;
+    }
+  } else {
+    if (uri_payload > 0) {
+      if (!DecodeDataURI(&img, uri, uri_payload, 0, false)) {
+        if (err) {
+          (*err) += "Failed to decode 'uri' for image parameter.\n";
+        }
+        return false;
+      }
+    } else if (defer_decode) {
+      if (!FindExternalFile(&image->encodedPath, err, uri, basedir)) {
+        if (err) {
+          (*err) += "Failed to load external 'uri'. for image parameter\n";
+        }
+        return false;
+      }
+    } else if (use_mmap) {
+      if (!MapExternalFile(&mapped, err, uri, basedir, 0, false)) {
+        if (err) {
+          (*err) += "Failed to load external 'uri'. for image parameter\n";
+        }
+        return false;
+      }
+    } else {
+      // Assume external file
+      if (!LoadExternalFile(&img, err, uri, basedir, 0, false)) {
+        if (err) {
+          (*err) += "Failed to load external 'uri'. for image parameter\n";
+        }
+        return false;
+      }
+      if (img.empty()) {
+        if (err) {
+          (*err) += "Image is empty.\n";
+        }
+        return false;
+      }
+    }
+  }
+
+  if (defer_decode) {
+    // Keep the encoded bytes(if any) for DecodeImage().
+    image->encoded.swap(img);
+    return true;
+  }
+
+  if (!mapped.Empty()) {
+    // Decode directly from the mapped file.
+    return LoadImageData(image, err, 0, 0, mapped.Data(),
+                         static_cast<int>(mapped.Size()));
+  }
+
+  TransientAlloc encoded(img.size());
+  return LoadImageData(image, err, 0, 0, &img.at(0),
+                       static_cast<int>(img.size()));
+}
+
+static bool ParseTexture(Texture *texture, std::string *err,
+                         const picojson::object &o,
+                         const std::string &basedir) {
+  (void)basedir;
+
+  if (!ParseStringProperty(&texture->sampler, err, o, "sampler", true)) {
+    return false;
+  }
+
+  if (!ParseStringProperty(&texture->source, err, o, "source", true)) {
+    return false;
+  }
+
+  ParseStringProperty(&texture->name, err, o, "name", false);
+
+  double format = TINYGLTF_TEXTURE_FORMAT_RGBA;
+  ParseNumberProperty(&format, err, o, "format", false);
+
+  double internalFormat = TINYGLTF_TEXTURE_FORMAT_RGBA;
+  ParseNumberProperty(&internalFormat, err, o, "internalFormat", false);
+
+  double target = TINYGLTF_TEXTURE_TARGET_TEXTURE2D;
+  ParseNumberProperty(&target, err, o, "target", false);
+
+  double type = TINYGLTF_TEXTURE_TYPE_UNSIGNED_BYTE;
+  ParseNumberProperty(&type, err, o, "type", false);
+
+  texture->format = static_cast<int>(format);
+  texture->internalFormat = static_cast<int>(internalFormat);
+  texture->target = static_cast<int>(target);
+  texture->type = static_cast<int>(type);
+
+  ParseExtrasProperty(&(texture->extras), o);
+  ParseExtensionsProperty(&(texture->extensions), o);
+
+  return true;
+}
+
+static bool LoadBufferFile(Buffer *buffer, std::string *err,
+                           const std::string &uri, const std::string &basedir,
+                           size_t bytes, bool use_mmap) {
+  if (use_mmap) {
+    SharedStorage mapped;
+    if (!MapExternalFile(&mapped, err, uri, basedir, bytes, true)) {
+      return false;
+    }
+    buffer->SetView(mapped, mapped.Data(), mapped.Size());
+    return true;
+  }
+
+  return LoadExternalFile(&buffer->data, err, uri, basedir, bytes, true);
+}
+
+static bool ParseBuffer(Buffer *buffer, std::string *err,
+                        const picojson::object &o, const std::string &basedir,
+                        bool use_mmap, bool is_binary,
+                        const unsigned char *bin_data, size_t bin_size,
+                        const SharedStorage &bin_storage) {
+  double byteLength;
+  if (!ParseNumberProperty(&byteLength, err, o, "byteLength", true)) {
+    return false;
+  }
+
+  // Refer to the (possibly large) uri string in `o` instead of copying it.
+  const std::string *uri_str = FindStringProperty(err, o, "uri", true);
+  if (!uri_str) {
+    return false;
+  }
+  const std::string &uri = *uri_str;
+  const size_t uri_payload = DataURIPayloadOffset(uri);
+
+  picojson::object::const_iterator type = o.find("type");
+  if (type != o.end()) {
+    if (type->second.is<std::string>()) {
+      const std::string &ty = (type->second).get<std::string>();
+      if (ty.compare("arraybuffer") == 0) {
+        // buffer.type = "arraybuffer";
+      }
+    }
+  }
+
+  size_t bytes = static_cast<size_t>(byteLength);
+  if (is_binary) {
+    // Still binary glTF accepts external dataURI. First try external resources.
+    bool loaded = false;
+    if (uri_payload > 0) {
+      loaded = DecodeDataURI(&buffer->data, uri, uri_payload, bytes, true);
+    } else {
+      // Assume external .bin file.
+      loaded = LoadBufferFile(buffer, err, uri, basedir, bytes, use_mmap);
+    }
+
+    if (!loaded) {
+      // load data from (embedded) binary data
+
+      if ((bin_size == 0) || (bin_data == NULL)) {
+        if (err) {
+          (*err) += "Invalid binary data.\n";
+        }
+        return false;
+      }
+
+      if (byteLength > bin_size) {
+        if (err) {
+          std::stringstream ss;
+          ss << "Invalid `byteLength'. Must be equal or less than binary size: "
+                "`byteLength' = "
+             << byteLength << ", binary size = " << bin_size << std::endl;
+          (*err) += ss.str();
+        }
+        return false;
+      }
+
+      if (uri.compare("data:,") == 0) {
+        // @todo { check uri }
+        if (!bin_storage.Empty()) {
+          // Refer to the binary body without copying.
+          buffer->SetView(bin_storage, bin_data, bytes);
+        } else {
+          buffer->data.resize(static_cast<size_t>(byteLength));
+          memcpy(&(buffer->data.at(0)), bin_data,
+                 static_cast<size_t>(byteLength));
+        }
+
+      } else {
+        if (err) {
+          (*err) += "Invalid URI for binary data.\n";
+        }
+        return false;
+      }
+    }
+
+  } else {
+    if (uri_payload > 0) {
+      if (!DecodeDataURI(&buffer->data, uri, uri_payload, bytes, true)) {
+        if (err) {
+          (*err) += "Failed to decode 'uri'.\n";
+        }
+        return false;
+      }
+    } else {
+      // Assume external .bin file.
+      if (!LoadBufferFile(buffer, err, uri, basedir, bytes, use_mmap)) {
+        return false;
+      }
+    }
+  }
+
+  ParseStringProperty(&buffer->name, err, o, "name", false);
+
+  ParseExtrasProperty(&(buffer->extras), o);
+  ParseExtensionsProperty(&(buffer->extensions), o);
+
+  return true;
+}
+
+static bool ParseBufferView(BufferView *bufferView, std::string *err,
+                            const picojson::object &o) {
+  std::string buffer;
+  if (!ParseStringProperty(&buffer, err, o, "buffer", true)) {
+    return false;
+  }
+
+  double byteOffset;
+  if (!ParseNumberProperty(&byteOffset, err, o, "byteOffset", true)) {
+    return false;
+  }
+
+  double byteLength = 0.0;
+  ParseNumberProperty(&byteLength, err, o, "byteLength", false);
+
+  double target = 0.0;
+  ParseNumberProperty(&target, err, o, "target", false);
+  int targetValue = static_cast<int>(target);
+  if ((targetValue == TINYGLTF_TARGET_ARRAY_BUFFER) ||
+      (targetValue == TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER)) {
+    // OK
+  } else {
+    targetValue = 0;
+  }
+  bufferView->target = targetValue;
+
+  ParseStringProperty(&bufferView->name, err, o, "name", false);
+
+  bufferView->buffer = buffer;
+  bufferView->byteOffset = static_cast<size_t>(byteOffset);
+  bufferView->byteLength = static_cast<size_t>(byteLength);
+
+  ParseExtrasProperty(&(bufferView->extras), o);
+  ParseExtensionsProperty(&(bufferView->extensions), o);
+
+  return true;
+}
+
+static bool ParseAccessor(Accessor *accessor, std::string *err,
+                          const picojson::object &o) {
+  std::string bufferView;
+  if (!ParseStringProperty(&bufferView, err, o, "bufferView", true)) {
+    return false;
+  }
+
+  double byteOffset;
+  if (!ParseNumberProperty(&byteOffset, err, o, "byteOffset", true)) {
+    return false;
+  }
+
+  double componentType;
+  if (!ParseNumberProperty(&componentType, err, o, "componentType", true)) {
+    return false;
+  }
+
+  double count = 0.0;
+  if (!ParseNumberProperty(&count, err, o, "count", true)) {
+    return false;
+  }
+
+  std::string type;
+  if (!ParseStringProperty(&type, err, o, "type", true)) {
+    return false;
+  }
+
+  if (type.compare("SCALAR") == 0) {
+    accessor->type = TINYGLTF_TYPE_SCALAR;
+  } else if (type.compare("VEC2") == 0) {
+    accessor->type = TINYGLTF_TYPE_VEC2;
+  } else if (type.compare("VEC3") == 0) {
+    accessor->type = TINYGLTF_TYPE_VEC3;
+  } else if (type.compare("VEC4") == 0) {
+    accessor->type = TINYGLTF_TYPE_VEC4;
+  } else if (type.compare("MAT2") == 0) {
+    accessor->type = TINYGLTF_TYPE_MAT2;
+  } else if (type.compare("MAT3") == 0) {
+    accessor->type = TINYGLTF_TYPE_MAT3;
+  } else if (type.compare("MAT4") == 0) {
+    accessor->type = TINYGLTF_TYPE_MAT4;
+  } else {
+    std::stringstream ss;
+    ss << "Unsupported `type` for accessor object. Got \"" << type << "\"\n";
+    if (err) {
+      (*err) += ss.str();
+    }
+    return false;
+  }
+
+  double byteStride = 0.0;
+  ParseNumberProperty(&byteStride, err, o, "byteStride", false);
+
+  ParseStringProperty(&accessor->name, err, o, "name", false);
+
+  accessor->minValues.clear();
+  accessor->maxValues.clear();
+  ParseNumberArrayProperty(&accessor->minValues, err, o, "min", false);
+  ParseNumberArrayProperty(&accessor->maxValues, err, o, "max", false);
+
+  accessor->count = static_cast<size_t>(count);
+  accessor->bufferView = bufferView;
+  accessor->byteOffset = static_cast<size_t>(byteOffset);
+  accessor->byteStride = static_cast<size_t>(byteStride);
+
+  {
+    int comp = static_cast<int>(componentType);
+    if (comp >= TINYGLTF_COMPONENT_TYPE_BYTE &&
+        comp <= TINYGLTF_COMPONENT_TYPE_DOUBLE) {
+      // OK
+      accessor->componentType = comp;
+    } else {
+      std::stringstream ss;
+      ss << "Invalid `componentType` in accessor. Got " << comp << "\n";
+      if (err) {
+        (*err) += ss.str();
+      }
+      return false;
+    }
+  }
+
+  ParseExtrasProperty(&(accessor->extras), o);
+  ParseExtensionsProperty(&(accessor->extensions), o);
+
+  return true;
+}
+
+static bool ParsePrimitive(Primitive *primitive, std::string *err,
+                           const picojson::object &o) {
+  if (!ParseStringProperty(&primitive->material, err, o, "material", true,
+                           "mesh.primitive")) {
+    return false;
+  }
+
+  double mode = static_cast<double>(TINYGLTF_MODE_TRIANGLES);
+  ParseNumberProperty(&mode, err, o, "mode", false);
+
+  int primMode = static_cast<int>(mode);
+  primitive->mode = primMode;
+
+  primitive->indices = "";
+  ParseStringProperty(&primitive->indices, err, o, "indices", false);
+
+  ParseStringMapProperty(&primitive->attributes, err, o, "attributes", false);
+
+  ParseExtrasProperty(&(primitive->extras), o);
+  ParseExtensionsProperty(&(primitive->extensions), o);
+
+  return true;
+}
+
+static bool ParseMesh(Mesh *mesh, std::string *err, const picojson::object &o) {
+  ParseStringProperty(&mesh->name, err, o, "name", false);
+
+  mesh->primitives.clear();
+  picojson::object::const_iterator primObject = o.find("primitives");
+  if ((primObject != o.end()) && (primObject->second).is<picojson::array>()) {
+    const picojson::array &primArray =
+        (primObject->second).get<picojson::array>();
+    for (size_t i = 0; i < primArray.size(); i++) {
+      Primitive primitive;
+      if (ParsePrimitive(&primitive, err,
+                         primArray[i].get<picojson::object>())) {
+        // Only add the primitive if the parsing succeeds.
+        mesh->primitives.push_back(primitive);
+      }
+    }
+  }
+
+  ParseExtrasProperty(&(mesh->extras), o);
+  ParseExtensionsProperty(&(mesh->extensions), o);
+
+  return true;
+}
+
+static bool ParseNode(Node *node, std::string *err, const picojson::object &o) {
+  ParseStringProperty(&node->name, err, o, "name", false);
+
+  ParseNumberArrayProperty(&node->rotation, err, o, "rotation", false);
+  ParseNumberArrayProperty(&node->scale, err, o, "scale", false);
+  ParseNumberArrayProperty(&node->translation, err, o, "translation", false);
+  ParseNumberArrayProperty(&node->matrix, err, o, "matrix", false);
+  ParseStringArrayProperty(&node->meshes, err, o, "meshes", false);
+  ParseStringProperty(&node->jointName, err, o, "jointName", false);
+  ParseStringArrayProperty(&node->skeletons, err, o, "skeletons", false);
+  ParseStringProperty(&node->skin, err, o, "skin", false);
+
+  node->children.clear();
+  picojson::object::const_iterator childrenObject = o.find("children");
+  if ((childrenObject != o.end()) &&
+      (childrenObject->second).is<picojson::array>()) {
+    const picojson::array &childrenArray =
+        (childrenObject->second).get<picojson::array>();
+    for (size_t i = 0; i < childrenArray.size(); i++) {
+      if (!childrenArray[i].is<std::string>()) {
+        if (err) {
+          (*err) += "Invalid `children` array.\n";
+        }
+        return false;
+      }
+      const std::string &childrenNode = childrenArray[i].get<std::string>();
+      node->children.push_back(childrenNode);
+    }
+  }
+
+  ParseExtrasProperty(&(node->extras), o);
+  ParseExtensionsProperty(&(node->extensions), o);
+
+  return true;
+}
+
+static bool ParseParameterProperty(Parameter *param, std::string *err,
+                                   const picojson::object &o,
+                                   const std::string &prop, bool required) {
+  double num_val;
+
+  // A parameter value can either be a string or an array of either a boolean or
+  // a number. Booleans of any kind aren't supported here. Granted, it
+  // complicates the Parameter structure and breaks it semantically in the sense
+  // that the client probably works off the assumption that if the string is
+  // empty the vector is used, etc. Would a tagged union work?
+  if (ParseStringProperty(&param->string_value, err, o, prop, false)) {
+    // Found string property.
+    return true;
+  } else if (ParseNumberArrayProperty(&param->number_array, err, o, prop,
+                                      false)) {
+    // Found a number array.
+    return true;
+  } else if (ParseNumberProperty(&num_val, err, o, prop, false)) {
+    param->number_array.push_back(num_val);
+    return true;
+  } else {
+    if (required) {
+      if (err) {
+        (*err) += "parameter must be a string or number / number array.\n";
+      }
+    }
+    return false;
+  }
+}
+
+static bool ParseMaterial(Material *material, std::string *err,
+                          const picojson::object &o) {
+  ParseStringProperty(&material->name, err, o, "name", false);
+  ParseStringProperty(&material->technique, err, o, "technique", false);
+
+  material->values.clear();
+  picojson::object::const_iterator valuesIt = o.find("values");
+
+  if ((valuesIt != o.end()) && (valuesIt->second).is<picojson::object>()) {
+    const picojson::object &values_object =
+        (valuesIt->second).get<picojson::object>();
+
+    picojson::object::const_iterator it(values_object.begin());
+    picojson::object::const_iterator itEnd(values_object.end());
+
+    for (; it != itEnd; it++) {
+      Parameter param;
+      if (ParseParameterProperty(&param, err, values_object, it->first,
+                                 false)) {
+        material->values[it->first] = param;
+      }
+    }
+  }
+
+  ParseExtrasProperty(&(material->extras), o);
+  ParseExtensionsProperty(&(material->extensions), o);
+
+  return true;
+}
+
+static bool ParseShader(Shader *shader, std::string *err,
+                        const picojson::object &o, const std::string &basedir,
+                        bool is_binary = false,
+                        const unsigned char *bin_data = NULL,
+                        size_t bin_size = 0) {
+  // Refer to the (possibly large) uri string in `o` instead of copying it.
+  const std::string *uri_str = FindStringProperty(err, o, "uri", true);
+  if (!uri_str) {
+    return false;
+  }
+  const std::string &uri = *uri_str;
+  const size_t uri_payload = DataURIPayloadOffset(uri);
+
+  if (is_binary) {
+    // Still binary glTF accepts external dataURI. First try external resources.
+    bool loaded = false;
+    if (uri_payload > 0) {
+      loaded = DecodeDataURI(&shader->source, uri, uri_payload, 0, false);
+    } else {
+      // Assume external .bin file.
+      loaded = LoadExternalFile(&shader->source, err, uri, basedir, 0, false);
+    }
+
+    if (!loaded) {
+      // load data from (embedded) binary data
+
+      if ((bin_size == 0) || (bin_data == NULL)) {
+        if (err) {
+          (*err) += "Invalid binary data.\n";
+        }
+        return false;
+      }
+
+      // There should be "extensions" property.
+      // "extensions":{"KHR_binary_glTF":{"bufferView": "id", ...
+
+      std::string buffer_view;
+      std::string mime_type;
+      int image_width;
+      int image_height;
+      bool ret = ParseKHRBinaryExtension(o, err, &buffer_view, &mime_type,
+                                         &image_width, &image_height);
+      if (!ret) {
+        return false;
+      }
+
+      if (uri.compare("data:,") == 0) {
+        // ok
+      } else {
+        if (err) {
+          (*err) += "Invalid URI for binary data.\n";
+        }
+        return false;
+      }
+    }
+  } else {
+    // Load shader source from data uri
+    // TODO(syoyo): Support ascii or utf-8 data uris.
+    if (uri_payload > 0) {
+      if (!DecodeDataURI(&shader->source, uri, uri_payload, 0, false)) {
+        if (err) {
+          (*err) += "Failed to decode 'uri' for shader parameter.\n";
+        }
+        return false;
+      }
+    } else {
+      // Assume external file
+      if (!LoadExternalFile(&shader->source, err, uri, basedir, 0, false)) {
+        if (err) {
+          (*err) += "Failed to load external 'uri' for shader parameter.\n";
+        }
+        return false;
+      }
+      if (shader->source.empty()) {
+        if (err) {
+          (*err) += "shader is empty.\n";  // This may be OK?
+        }
+        return false;
+      }
+    }
+  }
+
+  double type;
+  if (!ParseNumberProperty(&type, err, o, "type", true)) {
+    return false;
+  }
+
+  shader->type = static_cast<int>(type);
+
+  ParseExtrasProperty(&(shader->extras), o);
+  ParseExtensionsProperty(&(shader->extensions), o);
+
+  return true;
+}
+
+static bool ParseProgram(Program *program, std::string *err,
+                         const picojson::object &o) {
+  ParseStringProperty(&program->name, err, o, "name", false);
+
+  if (!ParseStringProperty(&program->vertexShader, err, o, "vertexShader",
+                           true)) {
+    return false;
+  }
+  if (!ParseStringProperty(&program->fragmentShader, err, o, "fragmentShader",
+                           true)) {
+    return false;
+  }
+
+  // I suppose the list of attributes isn't needed, but a technique doesn't
+  // really make sense without it.
+  ParseStringArrayProperty(&program->attributes, err, o, "attributes", false);
+
+  ParseExtrasProperty(&(program->extras), o);
+  ParseExtensionsProperty(&(program->extensions), o);
+
+  return true;
+}
+
+static bool ParseTechniqueParameter(TechniqueParameter *param, std::string *err,
+                                    const picojson::object &o) {
+  double count = 1;
+  ParseNumberProperty(&count, err, o, "count", false);
+
+  double type;
+  if (!ParseNumberProperty(&type, err, o, "type", true)) {
+    return false;
+  }
+
+  ParseStringProperty(&param->node, err, o, "node", false);
+  ParseStringProperty(&param->semantic, err, o, "semantic", false);
+
+  ParseParameterProperty(&param->value, err, o, "value", false);
+
+  param->count = static_cast<int>(count);
+  param->type = static_cast<int>(type);
+
+  return true;
+}
+
+static bool ParseTechnique(Technique *technique, std::string *err,
+                           const picojson::object &o) {
+  ParseStringProperty(&technique->name, err, o, "name", false);
+
+  if (!ParseStringProperty(&technique->program, err, o, "program", true)) {
+    return false;
+  }
+
+  ParseStringMapProperty(&technique->attributes, err, o, "attributes", false);
+  ParseStringMapProperty(&technique->uniforms, err, o, "uniforms", false);
+
+  technique->parameters.clear();
+  picojson::object::const_iterator paramsIt = o.find("parameters");
+
+  // Verify parameters is an object
+  if ((paramsIt != o.end()) && (paramsIt->second).is<picojson::object>()) {
+    // For each parameter in params_object.
+    const picojson::object &params_object =
+        (paramsIt->second).get<picojson::object>();
+
+    picojson::object::const_iterator it(params_object.begin());
+    picojson::object::const_iterator itEnd(params_object.end());
+
+    for (; it != itEnd; it++) {
+      TechniqueParameter param;
+
+      // Skip non-objects
+      if (!it->second.is<picojson::object>()) continue;
+
+      // Parse the technique parameter
+      const picojson::object &param_obj = it->second.get<picojson::object>();
+      if (ParseTechniqueParameter(&param, err, param_obj)) {
+        // Add if successful
+        technique->parameters[it->first] = param;
+      }
+    }
+  }
+
+  ParseExtrasProperty(&(technique->extras), o);
+  ParseExtensionsProperty(&(technique->extensions), o);
+
+  return true;
+}
+
+static bool ParseAnimationChannel(AnimationChannel *channel, std::string *err,
+                                  const picojson::object &o) {
+  if (!ParseStringProperty(&channel->sampler, err, o, "sampler", true)) {
+    if (err) {
+      (*err) += "`sampler` field is missing in animation channels\n";
+    }
+    return false;
+  }
+
+  picojson::object::const_iterator targetIt = o.find("target");
+  if ((targetIt != o.end()) && (targetIt->second).is<picojson::object>()) {
+    const picojson::object &target_object =
+        (targetIt->second).get<picojson::object>();
+
+    if (!ParseStringProperty(&channel->target_id, err, target_object, "id",
+                             true)) {
+      if (err) {
+        (*err) += "`id` field is missing in animation.channels.target\n";
+      }
+      return false;
+    }
+
+    if (!ParseStringProperty(&channel->target_path, err, target_object, "path",
+                             true)) {
+      if (err) {
+        (*err) += "`path` field is missing in animation.channels.target\n";
+      }
+      return false;
+    }
+  }
+
+  ParseExtrasProperty(&(channel->extras), o);
+  ParseExtensionsProperty(&(channel->extensions), o);
+
+  return true;
+}
+
+static bool ParseAnimation(Animation *animation, std::string *err,
+                           const picojson::object &o) {
+  {
+    picojson::object::const_iterator channelsIt = o.find("channels");
+    if ((channelsIt != o.end()) && (channelsIt->second).is<picojson::array>()) {
+      const picojson::array &channelArray =
+          (channelsIt->second).get<picojson::array>();
+      for (size_t i = 0; i < channelArray.size(); i++) {
+        AnimationChannel channel;
+        if (ParseAnimationChannel(&channel, err,
+                                  channelArray[i].get<picojson::object>())) {
+          // Only add the channel if the parsing succeeds.
+          animation->channels.push_back(channel);
+        }
+      }
+    }
+  }
+
+  {
+    picojson::object::const_iterator samplerIt = o.find("samplers");
+    if ((samplerIt != o.end()) && (samplerIt->second).is<picojson::object>()) {
+      const picojson::object &sampler_object =
+          (samplerIt->second).get<picojson::object>();
+
+      picojson::object::const_iterator it = sampler_object.begin();
+      picojson::object::const_iterator itEnd = sampler_object.end();
+
+      for (; it != itEnd; it++) {
+        // Skip non-objects
+        if (!it->second.is<picojson::object>()) continue;
+
+        const picojson::object &s = it->second.get<picojson::object>();
+
+        AnimationSampler sampler;
+        if (!ParseStringProperty(&sampler.input, err, s, "input", true)) {
+          if (err) {
+            (*err) += "`input` field is missing in animation.sampler\n";
+          }
+          return false;
+        }
+        if (!ParseStringProperty(&sampler.interpolation, err, s,
+                                 "interpolation", true)) {
+          if (err) {
+            (*err) += "`interpolation` field is missing in animation.sampler\n";
+          }
+          return false;
+        }
+        if (!ParseStringProperty(&sampler.output, err, s, "output", true)) {
+          if (err) {
+            (*err) += "`output` field is missing in animation.sampler\n";
+          }
+          return false;
+        }
+
+        ParseExtrasProperty(&(sampler.extras), s);
+        ParseExtensionsProperty(&(sampler.extensions), s);
+
+        animation->samplers[it->first] = sampler;
+      }
+    }
+  }
+
+  picojson::object::const_iterator parametersIt = o.find("parameters");
+  if ((parametersIt != o.end()) &&
+      (parametersIt->second).is<picojson::object>()) {
+    const picojson::object &parameters_object =
+        (parametersIt->second).get<picojson::object>();
+
+    picojson::object::const_iterator it(parameters_object.begin());
+    picojson::object::const_iterator itEnd(parameters_object.end());
+
+    for (; it != itEnd; it++) {
+      Parameter param;
+      if (ParseParameterProperty(&param, err, parameters_object, it->first,
+                                 false)) {
+        animation->parameters[it->first] = param;
+      }
+    }
+  }
+  ParseStringProperty(&animation->name, err, o, "name", false);
+
+  ParseExtrasProperty(&(animation->extras), o);
+  ParseExtensionsProperty(&(animation->extensions), o);
+
+  return true;
+}
+
+static bool ParseSampler(Sampler *sampler, std::string *err,
+                         const picojson::object &o) {
+  ParseStringProperty(&sampler->name, err, o, "name", false);
+
+  double minFilter =
+      static_cast<double>(TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR);
+  double magFilter = static_cast<double>(TINYGLTF_TEXTURE_FILTER_LINEAR);
+  double wrapS = static_cast<double>(TINYGLTF_TEXTURE_WRAP_RPEAT);
+  double wrapT = static_cast<double>(TINYGLTF_TEXTURE_WRAP_RPEAT);
+  ParseNumberProperty(&minFilter, err, o, "minFilter", false);
+  ParseNumberProperty(&magFilter, err, o, "magFilter", false);
+  ParseNumberProperty(&wrapS, err, o, "wrapS", false);
+  ParseNumberProperty(&wrapT, err, o, "wrapT", false);
+
+  sampler->minFilter = static_cast<int>(minFilter);
+  sampler->magFilter = static_cast<int>(magFilter);
+  sampler->wrapS = static_cast<int>(wrapS);
+  sampler->wrapT = static_cast<int>(wrapT);
+
+  ParseExtrasProperty(&(sampler->extras), o);
+  ParseExtensionsProperty(&(sampler->extensions), o);
+
+  return true;
+}
+
+static bool ParseSkin(Skin *skin, std::string *err, const picojson::object &o) {
+  if (!ParseStringProperty(&skin->inverseBindMatrices, err, o,
+                           "inverseBindMatrices", true, "skin")) {
+    return false;
+  }
+  if (!ParseStringArrayProperty(&skin->jointNames, err, o, "jointNames",
+                                true)) {
+    return false;
+  }
+
+  ParseNumberArrayProperty(&skin->bindShapeMatrix, err, o, "bindShapeMatrix",
+                           false);
+  if (!skin->bindShapeMatrix.empty() && (skin->bindShapeMatrix.size() != 16)) {
+    if (err) {
+      (*err) += "'bindShapeMatrix' property must have 16 elements.\n";
+    }
+    return false;
+  }
+  ParseStringProperty(&skin->name, err, o, "name", false);
+
+  ParseExtrasProperty(&(skin->extras), o);
+  ParseExtensionsProperty(&(skin->extensions), o);
+
+  return true;
+}
+
+// Top level sections of glTF which hold a dictionary of objects.
+enum SectionKind {
+  SECTION_BUFFERS = 0,
+  SECTION_BUFFER_VIEWS,
+  SECTION_ACCESSORS,
+  SECTION_MESHES,
+  SECTION_NODES,
+  SECTION_SCENES,
+  SECTION_MATERIALS,
+  SECTION_IMAGES,
+  SECTION_TEXTURES,
+  SECTION_SHADERS,
+  SECTION_PROGRAMS,
+  SECTION_TECHNIQUES,
+  SECTION_ANIMATIONS,
+  SECTION_SAMPLERS,
+  SECTION_SKINS,
+  SECTION_UNKNOWN
+};
+
+static SectionKind FindSectionKind(const std::string &key) {
+  static const char *const kNames[] = {
+      "buffers",  "bufferViews", "accessors",  "meshes",  "nodes",
+      "scenes",   "materials",   "images",     "textures", "shaders",
+      "programs", "techniques",  "animations", "samplers", "skins"};
+  for (int i = 0; i < SECTION_UNKNOWN; i++) {
+    if (key.compare(kNames[i]) == 0) {
+      return static_cast<SectionKind>(i);
+    }
+  }
+  return SECTION_UNKNOWN;
+}
+
+#ifdef TINYGLTF_USE_THREADS
+struct ThreadJob {
+  TaskFunc task;
+  void *task_data;
+  long count;
+  long next;
+};
+
+static void RunThreadJob(ThreadJob *job) {
+  for (;;) {
+    long i = AtomicIncrement(&job->next) - 1;
+    if (i >= job->count) {
+      break;
+    }
+    job->task(job->task_data, static_cast<size_t>(i));
+  }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI ThreadJobEntry(LPVOID arg) {
+  RunThreadJob(static_cast<ThreadJob *>(arg));
+  return 0;
+}
+#else
+static void *ThreadJobEntry(void *arg) {
+  RunThreadJob(static_cast<ThreadJob *>(arg));
+  return NULL;
+}
+#endif
+#endif
+
+// Runs `count` tasks with `executor`, or with up to `num_threads` threads.
+static void RunTasks(TaskExecutor executor, void *executor_data,
+                     int num_threads, TaskFunc task, void *task_data,
+                     size_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  if (executor) {
+    executor(executor_data, task, task_data, count);
+    return;
+  }
+
+#ifdef TINYGLTF_USE_THREADS
+  ThreadJob job;
+  job.task = task;
+  job.task_data = task_data;
+  job.count = static_cast<long>(count);
+  job.next = 0;
+
+  // The calling thread is one of the workers.
+  size_t num_workers = (num_threads > 1) ? static_cast<size_t>(num_threads) : 1;
+  num_workers = std::min(num_workers, count) - 1;
+
+#ifdef _WIN32
+  std::vector<HANDLE> threads;
+  for (size_t i = 0; i < num_workers; i++) {
+    HANDLE h = CreateThread(NULL, 0, ThreadJobEntry, &job, 0, NULL);
+    if (h) {
+      threads.push_back(h);
+    }
+  }
+  RunThreadJob(&job);
+  for (size_t i = 0; i < threads.size(); i++) {
+    WaitForSingleObject(threads[i], INFINITE);
+    CloseHandle(threads[i]);
+  }
+#else
+  std::vector<pthread_t> threads;
+  for (size_t i = 0; i < num_workers; i++) {
+    pthread_t th;
+    if (pthread_create(&th, NULL, ThreadJobEntry, &job) == 0) {
+      threads.push_back(th);
+    }
+  }
+  RunThreadJob(&job);
+  for (size_t i = 0; i < threads.size(); i++) {
+    pthread_join(threads[i], NULL);
+  }
+#endif
+#else
+  (void)num_threads;
+  for (size_t i = 0; i < count; i++) {
+    task(task_data, i);
+  }
+#endif
+}
+
+// Assigns `src` to `dst`, leaving `src` in a valid but unspecified state.
+// Moves with C++11. With C++03 the payloads of buffers, images and shaders are
+// swapped instead of copied, and only the small metadata is copied.
+template <typename T>
+static void MoveAssign(T *dst, T *src) {
+#ifdef TINYGLTF_USE_CPP11
+  (*dst) = std::move(*src);
+#else
+  (*dst) = (*src);
+#endif
+}
+
+#ifndef TINYGLTF_USE_CPP11
+static void MoveAssign(Image *dst, Image *src) {
+  std::vector<unsigned char> pixels;
+  std::vector<unsigned char> encoded;
+  pixels.swap(src->image);
+  encoded.swap(src->encoded);
+  (*dst) = (*src);
+  dst->image.swap(pixels);
+  dst->encoded.swap(encoded);
+}
+
+static void MoveAssign(Buffer *dst, Buffer *src) {
+  std::vector<unsigned char> bytes;
+  bytes.swap(src->data);
+  (*dst) = (*src);
+  dst->data.swap(bytes);
+}
+
+static void MoveAssign(Shader *dst, Shader *src) {
+  std::vector<unsigned char> source;
+  source.swap(src->source);
+  (*dst) = (*src);
+  dst->source.swap(source);
+}
+#endif
+
+// Skips a JSON value only by matching brackets and quotes. Much cheaper than
+// null_parse_context, which parses numbers and unescapes strings, but the
+// skipped value is not validated.
+template <typename Iter>
+static bool SkipJSONValue(picojson::input<Iter> &in) {
+  int depth = 0;
+  for (;;) {
+    int ch = in.getc();
+    switch (ch) {
+      case -1:
+        return false;
+      case '"':
+        for (ch = in.getc(); ch != '"'; ch = in.getc()) {
+          if ((ch == -1) || ((ch == '\\') && (in.getc() == -1))) {
+            return false;
+          }
+        }
+        break;
+      case '{':
+      case '[':
+        depth++;
+        break;
+      case '}':
+      case ']':
+      case ',':
+        if (depth == 0) {
+          // End of a scalar value.
+          in.ungetc();
+          return true;
+        }
+        if (ch != ',') {
+          depth--;
+        }
+        break;
+      default:
+        break;
+    }
+
+    if ((depth == 0) && ((ch == '"') || (ch == '}') || (ch == ']'))) {
+      return true;
+    }
+  }
+}
+
+// Stores the text of the JSON value at `in` into `out` as a string, without
+// parsing(nor validating) it.
+template <typename Iter>
+static bool CaptureJSONValue(picojson::input<Iter> &in, picojson::value *out) {
+  in.skip_ws();
+  int ch = in.getc();
+  if (ch == -1) {
+    return false;
+  }
+  Iter first = in.cur();
+  --first;
+  in.ungetc();
+
+  if (!SkipJSONValue(in)) {
+    return false;
+  }
+
+  Iter last = in.cur();
+  if ((ch != '{') && (ch != '[') && (ch != '"')) {
+    // A scalar ends at the delimiter which SkipJSONValue() put back.
+    --last;
+    while ((last != first) &&
+           ((*(last - 1) == ' ') || (*(last - 1) == '\t') ||
+            (*(last - 1) == '\n') || (*(last - 1) == '\r'))) {
+      --last;
+    }
+  }
+
+  *out = picojson::value(picojson::string_type, false);
+  out->get<std::string>().assign(first, last);
+  return true;
+}
+
+// picojson parse context for an item of a top level section, which keeps
+// `extras` and `extensions` of glTF objects as their JSON text(see
+// CaptureJSONValue). The glTF objects are the item itself, its `primitives`
+// and `channels`, and the values of its `samplers` dictionary. Everything else
+// is parsed as default_parse_context does. ParseJSONProperty() turns the text
+// into a `Value::FromJSON`.
+class LazyItemContext {
+ public:
+  enum Role {
+    ITEM_ROOT,       // The item itself.
+    ITEM_OBJECT,     // A glTF object inside the item.
+    ITEM_ARRAY,      // An array of glTF objects.
+    ITEM_DICTIONARY  // A dictionary of glTF objects.
+  };
+
+  LazyItemContext(picojson::value *out, Role role, bool keep_extensions)
+      : out_(out), role_(role), keep_extensions_(keep_extensions) {}
+
+  // Values are made in place: moving a null picojson::value copies its
+  // uninitialized union(-Wmaybe-uninitialized).
+  bool set_null() {
+    out_->~value();
+    new (out_) picojson::value();
+    return true;
+  }
+  bool set_bool(bool b) {
+    *out_ = picojson::value(b);
+    return true;
+  }
+#ifdef PICOJSON_USE_INT64
+  bool set_int64(int64_t i) {
+    *out_ = picojson::value(i);
+    return true;
+  }
+#endif
+  bool set_number(double f) {
+    *out_ = picojson::value(f);
+    return true;
+  }
+  template <typename Iter>
+  bool parse_string(picojson::input<Iter> &in) {
+    *out_ = picojson::value(picojson::string_type, false);
+    return picojson::_parse_string(out_->get<std::string>(), in);
+  }
+  bool parse_array_start() {
+    *out_ = picojson::value(picojson::array_type, false);
+    return true;
+  }
+  template <typename Iter>
+  bool parse_array_item(picojson::input<Iter> &in, size_t) {
+    picojson::array &a = out_->get<picojson::array>();
+    a.resize(a.size() + 1);
+    if (role_ == ITEM_ARRAY) {
+      LazyItemContext ctx(&a.back(), ITEM_OBJECT, keep_extensions_);
+      return picojson::_parse(ctx, in);
+    }
+    picojson::default_parse_context ctx(&a.back());
+    return picojson::_parse(ctx, in);
+  }
+  bool parse_array_stop(size_t) { return true; }
+  bool parse_object_start() {
+    *out_ = picojson::value(picojson::object_type, false);
+    return true;
+  }
+  template <typename Iter>
+  bool parse_object_item(picojson::input<Iter> &in, const std::string &key) {
+    picojson::value *v = &out_->get<picojson::object>()[key];
+
+    Role role = ITEM_OBJECT;
+    bool nested = false;
+    if (role_ == ITEM_DICTIONARY) {
+      nested = true;
+    } else if ((role_ == ITEM_ROOT) || (role_ == ITEM_OBJECT)) {
+      if ((key.compare("extras") == 0) ||
+          (!keep_extensions_ && (key.compare("extensions") == 0))) {
+        return CaptureJSONValue(in, v);
+      }
+      if (role_ == ITEM_ROOT) {
+        if ((key.compare("primitives") == 0) ||
+            (key.compare("channels") == 0)) {
+          role = ITEM_ARRAY;
+          nested = true;
+        } else if (key.compare("samplers") == 0) {
+          role = ITEM_DICTIONARY;
+          nested = true;
+        }
+      }
+    }
+
+    if (nested) {
+      LazyItemContext ctx(v, role, keep_extensions_);
+      return picojson::_parse(ctx, in);
+    }
+    picojson::default_parse_context ctx(v);
+    return picojson::_parse(ctx, in);
+  }
+
+ private:
+  LazyItemContext(const LazyItemContext &);
+  LazyItemContext &operator=(const LazyItemContext &);
+
+  picojson::value *out_;
+  Role role_;
+  bool keep_extensions_;
+};
+
+// Returns the bytes of `bufferView` in `scene`, or NULL if it does not exist
+// or exceeds its buffer.
+static const unsigned char *FindBufferViewData(size_t *size, std::string *err,
+                                               const Scene &scene,
+                                               const std::string &bufferView) {
+  SceneMap<BufferView>::type::const_iterator view =
+      scene.bufferViews.find(bufferView);
+  if (view == scene.bufferViews.end()) {
+    if (err) {
+      std::stringstream ss;
+      ss << "bufferView \"" << bufferView << "\" not found in the scene."
+         << std::endl;
+      (*err) += ss.str();
+    }
+    return NULL;
+  }
+
+  SceneMap<Buffer>::type::const_iterator buffer =
+      scene.buffers.find(view->second.buffer);
+  if ((buffer == scene.buffers.end()) ||
+      (view->second.byteOffset + view->second.byteLength >
+       buffer->second.Size())) {
+    if (err) {
+      std::stringstream ss;
+      ss << "Invalid buffer for bufferView \"" << bufferView << "\"."
+         << std::endl;
+      (*err) += ss.str();
+    }
+    return NULL;
+  }
+
+  (*size) = view->second.byteLength;
+  return buffer->second.Data() + view->second.byteOffset;
+}
+
+// Converts glTF JSON into `Scene` while it is being parsed.
+// Only one object of a section(e.g. a single accessor) is materialized as
+// picojson DOM at a time. It is converted and then discarded, so the whole
+// document is never held in memory as DOM.
+class SceneParser {
+ public:
+  SceneParser(Scene *scene, std::string *err, const std::string &base_dir,
+              bool use_mmap, bool is_binary, const unsigned char *bin_data,
+              size_t bin_size, const SharedStorage &bin_storage)
+      : scene_(scene),
+        err_(err),
+        base_dir_(base_dir),
+        bin_data_(bin_data),
+        bin_size_(bin_size),
+        bin_storage_(bin_storage),
+        stats_(g_load_stats),
+        executor_(NULL),
+        executor_data_(NULL),
+        num_threads_(1),
+        load_sections_(LOAD_ALL),
+        use_mmap_(use_mmap),
+        is_binary_(is_binary),
+        defer_image_decoding_(false),
+        lazy_extras_(false),
+        failed_(false),
+        has_default_scene_(false),
+        parallel_(false) {
+    for (int i = 0; i < SECTION_UNKNOWN; i++) {
+      has_section_[i] = false;
+    }
+  }
+
+  // true when parsing was aborted by an invalid glTF object(not by a JSON
+  // syntax error).
+  bool Failed() const { return failed_; }
+  bool HasSection(SectionKind kind) const { return has_section_[kind]; }
+  bool HasDefaultScene() const { return has_default_scene_; }
+
+  // Skips the sections which are not in `sections`(SectionLoad flags).
+  void SetLoadSections(unsigned int sections) { load_sections_ = sections; }
+
+  // Keeps encoded images instead of decoding them.
+  void SetDeferredImageDecoding(bool enabled) {
+    defer_image_decoding_ = enabled;
+  }
+
+  // Keeps `extras` and `extensions` as JSON text(see LazyItemContext).
+  void SetLazyExtras(bool enabled) { lazy_extras_ = enabled; }
+
+  // Defers loading of buffers and images, which are then run as parallel
+  // tasks by FinishLoadTasks().
+  void SetParallel(TaskExecutor executor, void *executor_data,
+                   int num_threads) {
+    executor_ = executor;
+    executor_data_ = executor_data;
+    num_threads_ = num_threads;
+    parallel_ = true;
+  }
+
+  // Runs the deferred loads and stores the results in document order, as if
+  // they had been loaded serially: error messages are inserted where they
+  // would have been reported, and results after the first failed load are
+  // discarded. Returns false if any load failed.
+  bool FinishLoadTasks();
+
+  // Loads images which are stored in a bufferView. Must be called after all
+  // buffers and bufferViews are parsed.
+  bool LoadBufferViewImages();
+
+  // -- picojson parse context interface for the root object --
+
+  bool set_null() { return true; }
+  bool set_bool(bool) { return true; }
+#ifdef PICOJSON_USE_INT64
+  bool set_int64(int64_t) { return true; }
+#endif
+  bool set_number(double) { return true; }
+  template <typename Iter>
+  bool parse_string(picojson::input<Iter> &in) {
+    picojson::null_parse_context ctx;
+    return ctx.parse_string(in);
+  }
+  bool parse_array_start() { return true; }
+  template <typename Iter>
+  bool parse_array_item(picojson::input<Iter> &in, size_t) {
+    picojson::null_parse_context ctx;
+    return picojson::_parse(ctx, in);
+  }
+  bool parse_array_stop(size_t) { return true; }
+  bool parse_object_start() { return true; }
+  template <typename Iter>
+  bool parse_object_item(picojson::input<Iter> &in, const std::string &key);
+
+  // Converts an object of the section `kind` into the Scene.
+  bool ParseSectionItem(SectionKind kind, const std::string &id,
+                        const picojson::object &o);
+
+ private:
+  // Parse context for the dictionary of a top level section.
+  class SectionContext {
+   public:
+    SectionContext(SceneParser *parser, SectionKind kind)
+        : parser_(parser), kind_(kind) {}
+
+    // Non-object sections are ignored.
+    bool set_null() { return true; }
+    bool set_bool(bool) { return true; }
+#ifdef PICOJSON_USE_INT64
+    bool set_int64(int64_t) { return true; }
+#endif
+    bool set_number(double) { return true; }
+    template <typename Iter>
+    bool parse_string(picojson::input<Iter> &in) {
+      picojson::null_parse_context ctx;
+      return ctx.parse_string(in);
+    }
+    bool parse_array_start() { return true; }
+    template <typename Iter>
+    bool parse_array_item(picojson::input<Iter> &in, size_t) {
+      picojson::null_parse_context ctx;
+      return picojson::_parse(ctx, in);
+    }
+    bool parse_array_stop(size_t) { return true; }
+    bool parse_object_start() {
+      parser_->has_section_[kind_] = true;
+      return true;
+    }
+    template <typename Iter>
+    bool parse_object_item(picojson::input<Iter> &in, const std::string &id) {
+      picojson::value v;
+      if (!parser_->ParseItemJSON(in, &v, kind_)) {
+        return false;
+      }
+      if (!v.is<picojson::object>()) {
+        return parser_->ParseInvalidItem(kind_);
+      }
+
+      size_t dom_bytes = parser_->stats_ ? JSONHeapSize(v) : 0;
+      if (parser_->parallel_ &&
+          ((kind_ == SECTION_BUFFERS) || (kind_ == SECTION_IMAGES))) {
+        // Released by FinishLoadTasks().
+        TrackAlloc(dom_bytes);
+        return parser_->DeferSectionItem(kind_, id, &v, dom_bytes);
+      }
+
+      TransientAlloc dom(dom_bytes);
+      return parser_->ParseSectionItem(kind_, id, v.get<picojson::object>());
+    }
+
+   private:
+    SectionContext(const SectionContext &);
+    SectionContext &operator=(const SectionContext &);
+
+    SceneParser *parser_;
+    SectionKind kind_;
+  };
+
+  // Buffer or image whose loading is deferred until FinishLoadTasks().
+  struct LoadTask {
+    LoadTask()
+        : kind(SECTION_UNKNOWN),
+          dom_bytes(0),
+          image_dst(NULL),
+          bytes(NULL),
+          size(0),
+          err_pos(0),
+          ret(false) {
+      stats.current = stats.peak = stats.total = stats.count = 0;
+    }
+
+    SectionKind kind;
+    std::string id;
+    picojson::value json;  // The buffer or image object.
+    size_t dom_bytes;      // Heap usage of `json` for LoadStats.
+    Buffer buffer;
+    Image image;
+
+    // Image stored in a bufferView, decoded in place from [bytes, bytes+size).
+    Image *image_dst;
+    const unsigned char *bytes;
+    size_t size;
+
+    size_t err_pos;  // Position in `err` where errors are to be inserted.
+    std::string err;
+    LoadStats stats;  // Transient allocations of the task.
+    bool ret;
+  };
+
+  // Parses the JSON of an item of the section `kind`(SECTION_UNKNOWN for
+  // `asset`) into `v`.
+  template <typename Iter>
+  bool ParseItemJSON(picojson::input<Iter> &in, picojson::value *v,
+                     SectionKind kind) {
+    if (lazy_extras_) {
+      // KHR_binary_glTF is read from extensions of images and shaders.
+      bool keep_extensions =
+          (kind == SECTION_IMAGES) || (kind == SECTION_SHADERS);
+      LazyItemContext ctx(v, LazyItemContext::ITEM_ROOT, keep_extensions);
+      return picojson::_parse(ctx, in);
+    }
+    picojson::default_parse_context ctx(v);
+    return picojson::_parse(ctx, in);
+  }
+
+  bool ParseInvalidItem(SectionKind kind);
+  bool DeferSectionItem(SectionKind kind, const std::string &id,
+                        picojson::value *v, size_t dom_bytes);
+  void DeferImageData(Image *image, const unsigned char *bytes, size_t size);
+  void RunLoadTask(LoadTask *task);
+  static void RunLoadTaskFunc(void *task_data, size_t index);
+
+  size_t BufferPayloadSize(const picojson::object &o) const;
+
+  SceneParser(const SceneParser &);
+  SceneParser &operator=(const SceneParser &);
+
+  Scene *scene_;
+  std::string *err_;
+  const std::string &base_dir_;
+  const unsigned char *bin_data_;
+  size_t bin_size_;
+  const SharedStorage &bin_storage_;
+  LoadStats *stats_;  // Stats of the thread which runs the parser.
+  TaskExecutor executor_;
+  void *executor_data_;
+  int num_threads_;
+  unsigned int load_sections_;
+  bool use_mmap_;
+  bool is_binary_;
+  bool defer_image_decoding_;
+  bool lazy_extras_;
+  bool failed_;
+  bool has_default_scene_;
+  bool parallel_;
+  bool has_section_[SECTION_UNKNOWN];
+  std::deque<LoadTask> tasks_;  // deque, since LoadTask is costly to copy.
+};
+
+template <typename Iter>
+bool SceneParser::parse_object_item(picojson::input<Iter> &in,
+                                    const std::string &key) {
+  SectionKind kind = FindSectionKind(key);
+  if ((kind != SECTION_UNKNOWN) && !(load_sections_ & (1u << kind))) {
+    // Remember that the section exists for the REQUIRE_* checks.
+    in.skip_ws();
+    if (in.getc() == '{') {
+      has_section_[kind] = true;
+    }
+    in.ungetc();
+    return SkipJSONValue(in);
+  }
+
+  if (kind != SECTION_UNKNOWN) {
+    SectionContext ctx(this, kind);
+    return picojson::_parse(ctx, in);
+  }
+
+  if ((key.compare("asset") == 0) || (key.compare("scene") == 0)) {
+    picojson::value v;
+    if (!ParseItemJSON(in, &v, SECTION_UNKNOWN)) {
+      return false;
+    }
+
+    if (key.compare("scene") == 0) {
+      if (v.is<std::string>()) {
+        scene_->defaultScene = v.get<std::string>();
+        has_default_scene_ = true;
+      }
+    } else if (v.is<picojson::object>()) {
+      ScopedRawProperties raw(lazy_extras_);
+      ParseAsset(&scene_->asset, err_, v.get<picojson::object>());
+    }
+    return true;
+  }
+
+  if ((key.compare("extras") == 0) || (key.compare("extensions") == 0)) {
+    picojson::object root;
+    if (lazy_extras_) {
+      if (!CaptureJSONValue(in, &root[key])) {
+        return false;
+      }
+    } else {
+      picojson::default_parse_context ctx(&root[key]);
+      if (!picojson::_parse(ctx, in)) {
+        return false;
+      }
+    }
+
+    ScopedRawProperties raw(lazy_extras_);
+    ParseExtrasProperty(&scene_->extras, root);
+    ParseExtensionsProperty(&scene_->extensions, root);
+    return true;
+  }
+
+  // Skip unsupported properties without building DOM.
+  picojson::null_parse_context ctx;
+  return picojson::_parse(ctx, in);
+}
+
+bool SceneParser::ParseInvalidItem(SectionKind kind) {
+  if (kind == SECTION_SCENES) {
+    if (err_) {
+      (*err_) += "`scenes' does not contain an object.";
+    }
+  } else {
+    if (err_) {
+      (*err_) += "Invalid object in glTF section.\n";
+    }
+  }
+  failed_ = true;
+  return false;
+}
+
+// Returns the decoded size of the "uri" of `o` if it is a data URI, else 0.
+static size_t DataURIPayloadSize(const picojson::object &o) {
+  picojson::object::const_iterator it = o.find("uri");
+  if ((it == o.end()) || !it->second.is<std::string>()) {
+    return 0;
+  }
+  const std::string &uri = it->second.get<std::string>();
+  size_t offset = DataURIPayloadOffset(uri);
+  return offset ? Base64DecodedSize(uri.data() + offset, uri.size() - offset)
+                : 0;
+}
+
+// Returns the number of bytes ParseBuffer() copies into the data of buffer
+// `o`, or 0 if it refers to a mapped file or to the binary body instead.
+size_t SceneParser::BufferPayloadSize(const picojson::object &o) const {
+  double byteLength = 0.0;
+  picojson::object::const_iterator it = o.find("uri");
+  if (!ParseNumberProperty(&byteLength, NULL, o, "byteLength", false) ||
+      (it == o.end()) || !it->second.is<std::string>()) {
+    return 0;
+  }
+  const std::string &uri = it->second.get<std::string>();
+  if (DataURIPayloadOffset(uri) > 0) {
+    // Decoded from the data URI.
+  } else if (is_binary_ && (uri.compare("data:,") == 0)) {
+    if (!bin_storage_.Empty()) {
+      return 0;
+    }
+  } else if (use_mmap_) {
+    return 0;
+  }
+  return static_cast<size_t>(byteLength);
+}
+
+bool SceneParser::DeferSectionItem(SectionKind kind, const std::string &id,
+                                   picojson::value *v, size_t dom_bytes) {
+  tasks_.push_back(LoadTask());
+  LoadTask &task = tasks_.back();
+  task.kind = kind;
+  task.id = id;
+  task.json.swap(*v);
+  task.dom_bytes = dom_bytes;
+  task.err_pos = err_ ? err_->size() : 0;
+  // The tasks don't take payloads themselves(see RunLoadTask).
+  const picojson::object &o = task.json.get<picojson::object>();
+  if (kind == SECTION_BUFFERS) {
+    TakePayload(&task.buffer.data, BufferPayloadSize(o));
+  } else if (defer_image_decoding_) {
+    TakePayload(&task.image.encoded, DataURIPayloadSize(o));
+  }
+  return true;
+}
+
+void SceneParser::DeferImageData(Image *image, const unsigned char *bytes,
+                                 size_t size) {
+  tasks_.push_back(LoadTask());
+  LoadTask &task = tasks_.back();
+  task.kind = SECTION_IMAGES;
+  task.image_dst = image;
+  task.bytes = bytes;
+  task.size = size;
+  task.err_pos = err_ ? err_->size() : 0;
+}
+
+// Runs on a worker thread. Only touches `task` and read-only parser state.
+void SceneParser::RunLoadTask(LoadTask *task) {
+  ScopedLoadStats scope(stats_ ? &task->stats : NULL);
+  ScopedRawProperties raw(lazy_extras_);
+  // The pool of the calling thread is not shared with the other tasks.
+  ScopedPayloadPool payloads(NULL);
+
+  if (task->image_dst) {
+    task->ret = LoadImageData(task->image_dst, &task->err,
+                              task->image_dst->width, task->image_dst->height,
+                              task->bytes, static_cast<int>(task->size));
+    return;
+  }
+
+  const picojson::object &o = task->json.get<picojson::object>();
+  if (task->kind == SECTION_BUFFERS) {
+    task->ret = ParseBuffer(&task->buffer, &task->err, o, base_dir_, use_mmap_,
+                            is_binary_, bin_data_, bin_size_, bin_storage_);
+  } else {
+    task->ret = ParseImage(&task->image, &task->err, o, base_dir_, use_mmap_,
+                           defer_image_decoding_, is_binary_, bin_data_,
+                           bin_size_);
+  }
+}
+
+void SceneParser::RunLoadTaskFunc(void *task_data, size_t index) {
+  SceneParser *parser = static_cast<SceneParser *>(task_data);
+  parser->RunLoadTask(&parser->tasks_[index]);
+}
+
+bool SceneParser::FinishLoadTasks() {
+  if (tasks_.empty()) {
+    return true;
+  }
+
+  RunTasks(executor_, executor_data_, num_threads_, RunLoadTaskFunc, this,
+           tasks_.size());
+
+  if (stats_) {
+    // Up to `num_threads_`(any number with an executor) tasks may have run at
+    // the same time, so the sum of that many largest peaks bounds the
+    // transient memory on top of the current one.
+    std::vector<size_t> peaks(tasks_.size());
+    for (size_t i = 0; i < tasks_.size(); i++) {
+      const LoadStats &task_stats = tasks_[i].stats;
+      peaks[i] = task_stats.peak;
+      stats_->total += task_stats.total;
+      stats_->count += task_stats.count;
+    }
+    std::sort(peaks.begin(), peaks.end(), std::greater<size_t>());
+    size_t concurrency = peaks.size();
+    if (!executor_ && (num_threads_ > 0)) {
+      concurrency = std::min(concurrency, static_cast<size_t>(num_threads_));
+    }
+    size_t bound = 0;
+    for (size_t i = 0; i < concurrency; i++) {
+      bound += peaks[i];
+    }
+    stats_->peak = std::max(stats_->peak, stats_->current + bound);
+  }
+
+  std::string merged;
+  size_t pos = 0;
+  bool ret = true;
+  for (size_t i = 0; i < tasks_.size(); i++) {
+    LoadTask &task = tasks_[i];
+    if (err_) {
+      merged.append(*err_, pos, task.err_pos - pos);
+      merged += task.err;
+      pos = task.err_pos;
+    }
+
+    if (!task.ret) {
+      ret = false;
+      break;
+    }
+
+    if (task.image_dst) {
+      // Already decoded in place.
+    } else if (task.kind == SECTION_BUFFERS) {
+      MoveAssign(&scene_->buffers[task.id], &task.buffer);
+    } else {
+      MoveAssign(&scene_->images[task.id], &task.image);
+    }
+  }
+
+  if (err_) {
+    if (ret) {
+      merged.append(*err_, pos, std::string::npos);
+    }
+    err_->swap(merged);
+  }
+
+  for (size_t i = 0; i < tasks_.size(); i++) {
+    TrackFree(tasks_[i].dom_bytes);
+  }
+  tasks_.clear();
+
+  if (!ret) {
+    failed_ = true;
+  }
+
+  return ret;
+}
+
+bool SceneParser::ParseSectionItem(SectionKind kind, const std::string &id,
+                                   const picojson::object &o) {
+  ScopedRawProperties raw(lazy_extras_);
+  bool ret = true;
+
+  switch (kind) {
+    case SECTION_BUFFERS: {
+      Buffer buffer;
+      TakePayload(&buffer.data, BufferPayloadSize(o));
+      ret = ParseBuffer(&buffer, err_, o, base_dir_, use_mmap_, is_binary_,
+                        bin_data_, bin_size_, bin_storage_);
+      if (ret) {
+        MoveAssign(&scene_->buffers[id], &buffer);
+      }
+      break;
+    }
+    case SECTION_BUFFER_VIEWS: {
+      BufferView bufferView;
+      ret = ParseBufferView(&bufferView, err_, o);
+      if (ret) {
+        MoveAssign(&scene_->bufferViews[id], &bufferView);
+      }
+      break;
+    }
+    case SECTION_ACCESSORS: {
+      Accessor accessor;
+      ret = ParseAccessor(&accessor, err_, o);
+      if (ret) {
+        MoveAssign(&scene_->accessors[id], &accessor);
+      }
+      break;
+    }
+    case SECTION_MESHES: {
+      Mesh mesh;
+      ret = ParseMesh(&mesh, err_, o);
+      if (ret) {
+        MoveAssign(&scene_->meshes[id], &mesh);
+      }
+      break;
+    }
+    case SECTION_NODES: {
+      Node node;
+      ret = ParseNode(&node, err_, o);
+      if (ret) {
+        MoveAssign(&scene_->nodes[id], &node);
+      }
+      break;
+    }
+    case SECTION_SCENES: {
+      StringArray nodes;
+      ret = ParseStringArrayProperty(&nodes, err_, o, "nodes", false);
+      if (ret) {
+        MoveAssign(&scene_->scenes[id], &nodes);
+      }
+      break;
+    }
+    case SECTION_MATERIALS: {
+      Material material;
+      ret = ParseMaterial(&material, err_, o);
+      if (ret) {
+        MoveAssign(&scene_->materials[id], &material);
+      }
+      break;
+    }
+    case SECTION_IMAGES: {
+      // Images stored in a bufferView are loaded in LoadBufferViewImages(),
+      // since bufferViews may appear after images in the document.
+      // Decoded images take a payload once their size is known.
+      Image image;
+      if (defer_image_decoding_) {
+        TakePayload(&image.encoded, DataURIPayloadSize(o));
+      }
+      ret = ParseImage(&image, err_, o, base_dir_, use_mmap_,
+                       defer_image_decoding_, is_binary_, bin_data_,
+                       bin_size_);
+      if (ret) {
+        MoveAssign(&scene_->images[id], &image);
+      }
+      break;
+    }
+    case SECTION_TEXTURES: {
+      Texture texture;
+      ret = ParseTexture(&texture, err_, o, base_dir_);
+      if (ret) {
+        MoveAssign(&scene_->textures[id], &texture);
+      }
+      break;
+    }
+    case SECTION_SHADERS: {
+      Shader shader;
+      TakePayload(&shader.source, DataURIPayloadSize(o));
+      ret = ParseShader(&shader, err_, o, base_dir_, is_binary_, bin_data_,
+                        bin_size_);
+      if (ret) {
+        MoveAssign(&scene_->shaders[id], &shader);
+      }
+      break;
+    }
+    case SECTION_PROGRAMS: {
+      Program program;
+      ret = ParseProgram(&program, err_, o);
+      if (ret) {
+        MoveAssign(&scene_->programs[id], &program);
+      }
+      break;
+    }
+    case SECTION_TECHNIQUES: {
+      Technique technique;
+      ret = ParseTechnique(&technique, err_, o);
+      if (ret) {
+        MoveAssign(&scene_->techniques[id], &technique);
+      }
+      break;
+    }
+    case SECTION_ANIMATIONS: {
+      Animation animation;
+      ret = ParseAnimation(&animation, err_, o);
+      if (ret) {
+        MoveAssign(&scene_->animations[id], &animation);
+      }
+      break;
+    }
+    case SECTION_SAMPLERS: {
+      Sampler sampler;
+      ret = ParseSampler(&sampler, err_, o);
+      if (ret) {
+        MoveAssign(&scene_->samplers[id], &sampler);
+      }
+      break;
+    }
+    case SECTION_SKINS: {
+      Skin skin;
+      ret = ParseSkin(&skin, err_, o);
+      if (ret) {
+        MoveAssign(&scene_->skins[id], &skin);
+      }
+      break;
+    }
+    case SECTION_UNKNOWN:
+      break;
+  }
+
+  if (!ret) {
+    failed_ = true;
+  }
+
+  return ret;
+}
+
+bool SceneParser::LoadBufferViewImages() {
+  if (!(load_sections_ & LOAD_BUFFERS) ||
+      !(load_sections_ & LOAD_BUFFER_VIEWS)) {
+    return true;
+  }
+
+  bool ret = true;
+  SceneMap<Image>::type::iterator it(scene_->images.begin());
+  SceneMap<Image>::type::iterator itEnd(scene_->images.end());
+  for (; ret && (it != itEnd); it++) {
+    Image &image = it->second;
+    if (image.bufferView.empty()) {
+      continue;
+    }
+
+    // Load image from the buffer view.
+    size_t size = 0;
+    const unsigned char *bytes =
+        FindBufferViewData(&size, err_, *scene_, image.bufferView);
+    if (!bytes) {
+      ret = false;
+      break;
+    }
+
+    if (defer_image_decoding_) {
+      // Decoded by DecodeImage().
+    } else if (parallel_) {
+      int w, h, comp;
+      if (stbi_info_from_memory(bytes, static_cast<int>(size), &w, &h, &comp)) {
+        TakePayload(&image.image, static_cast<size_t>(w * h * comp));
+      }
+      DeferImageData(&image, bytes, size);
+    } else {
+      ret = LoadImageData(&image, err_, image.width, image.height, bytes,
+                          static_cast<int>(size));
+    }
+  }
+
+  // A failed decode precedes the error which stopped the loop, if any.
+  if (!FinishLoadTasks()) {
+    return false;
+  }
+
+  return ret;
+}
+
+// Decodes `image` of `scene` which was loaded with deferred decoding into
+// `out`(which may be `image` itself).
+static bool DecodeImageData(Image *out, std::string *err, const Scene &scene,
+                            const Image &image) {
+  if (!image.encoded.empty()) {
+    return LoadImageData(out, err, 0, 0, &image.encoded.at(0),
+                         static_cast<int>(image.encoded.size()));
+  }
+
+  if (!image.encodedPath.empty()) {
+    std::vector<unsigned char> bytes;
+    if (!ReadWholeFile(&bytes, err, image.encodedPath)) {
+      return false;
+    }
+    if (bytes.empty()) {
+      if (err) {
+        (*err) += "Image is empty.\n";
+      }
+      return false;
+    }
+    return LoadImageData(out, err, 0, 0, &bytes.at(0),
+                         static_cast<int>(bytes.size()));
+  }
+
+  if (!image.bufferView.empty()) {
+    size_t size = 0;
+    const unsigned char *bytes =
+        FindBufferViewData(&size, err, scene, image.bufferView);
+    if (!bytes) {
+      return false;
+    }
+    return LoadImageData(out, err, image.width, image.height, bytes,
+                         static_cast<int>(size));
+  }
+
+  if (err) {
+    (*err) += "Image has no data to decode.\n";
+  }
+  return false;
+}
+
+bool DecodeImage(Scene *scene, const std::string &id, std::string *err) {
+  SceneMap<Image>::type::iterator it = scene->images.find(id);
+  if (it == scene->images.end()) {
+    if (err) {
+      (*err) += "Image \"" + id + "\" not found in the scene.\n";
+    }
+    return false;
+  }
+
+  Image &image = it->second;
+  if (!image.image.empty()) {
+    return true;
+  }
+
+  if (!DecodeImageData(&image, err, *scene, image)) {
+    return false;
+  }
+
+  std::vector<unsigned char>().swap(image.encoded);
+  return true;
+}
+
+const Image *ImageCache::Get(const Scene &scene, const std::string &id,
+                             std::string *err) {
+  SceneMap<Image>::type::const_iterator image = scene.images.find(id);
+  if (image == scene.images.end()) {
+    if (err) {
+      (*err) += "Image \"" + id + "\" not found in the scene.\n";
+    }
+    return NULL;
+  }
+
+  if (!image->second.image.empty()) {
+    return &image->second;
+  }
+
+  Key key(std::make_pair(&scene, scene.generation), id);
+  std::map<Key, EntryList::iterator>::iterator it = index_.find(key);
+  if (it != index_.end()) {
+    // Move to the front.
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &entries_.front().second;
+  }
+
+  entries_.push_front(std::make_pair(key, Image()));
+  Image &entry = entries_.front().second;
+  if (!DecodeImageData(&entry, err, scene, image->second)) {
+    entries_.pop_front();
+    return NULL;
+  }
+
+  // Everything but the encoded bytes.
+  entry.name = image->second.name;
+  entry.bufferView = image->second.bufferView;
+  entry.mimeType = image->second.mimeType;
+  entry.encodedPath = image->second.encodedPath;
+  entry.extras = image->second.extras;
+  entry.extensions = image->second.extensions;
+  index_[key] = entries_.begin();
+  size_ += entry.image.size();
+
+  Evict();
+
+  return &entry;
+}
+
+void ImageCache::Clear() {
+  entries_.clear();
+  index_.clear();
+  size_ = 0;
+}
+
+void ImageCache::SetCapacity(size_t capacity) {
+  capacity_ = capacity;
+  Evict();
+}
+
+// Drops least recently used images until the cache fits in the capacity.
+// The most recently used one is kept even if it alone exceeds the capacity.
+void ImageCache::Evict() {
+  while ((size_ > capacity_) && (entries_.size() > 1)) {
+    size_ -= entries_.back().second.image.size();
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+}
+
+int GetComponentSizeInBytes(int componentType) {
+  switch (componentType) {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      return 1;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      return 2;
+    case TINYGLTF_COMPONENT_TYPE_INT:
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+      return 4;
+    case TINYGLTF_COMPONENT_TYPE_DOUBLE:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+int GetTypeSizeInComponents(int type) {
+  switch (type) {
+    case TINYGLTF_TYPE_SCALAR:
+      return 1;
+    case TINYGLTF_TYPE_VEC2:
+      return 2;
+    case TINYGLTF_TYPE_VEC3:
+      return 3;
+    case TINYGLTF_TYPE_VEC4:
+    case TINYGLTF_TYPE_MAT2:
+      return 4;
+    case TINYGLTF_TYPE_MAT3:
+      return 9;
+    case TINYGLTF_TYPE_MAT4:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+bool AccessorReader::Init(const Scene &scene, const std::string &id,
+                          std::string *err) {
+  SceneMap<Accessor>::type::const_iterator it = scene.accessors.find(id);
+  if (it == scene.accessors.end()) {
+    (*this) = AccessorReader();
+    if (err) {
+      (*err) += "accessor \"" + id + "\" not found in the scene.\n";
+    }
+    return false;
+  }
+  return Init(scene, it->second, err);
+}
+
+bool AccessorReader::Init(const Scene &scene, const Accessor &accessor,
+                          std::string *err) {
+  (*this) = AccessorReader();
+
+  size_t component_size =
+      static_cast<size_t>(GetComponentSizeInBytes(accessor.componentType));
+  int num_components = GetTypeSizeInComponents(accessor.type);
+  if ((component_size == 0) || (num_components == 0)) {
+    if (err) {
+      (*err) += "Invalid componentType or type of accessor.\n";
+    }
+    return false;
+  }
+
+  size_t element_size = component_size * static_cast<size_t>(num_components);
+  size_t stride = accessor.byteStride ? accessor.byteStride : element_size;
+  if (stride < element_size) {
+    if (err) {
+      (*err) += "Invalid byteStride of accessor. Must be 0 or equal or more "
+                "than the element size.\n";
+    }
+    return false;
+  }
+
+  size_t size = 0;
+  const unsigned char *bytes =
+      FindBufferViewData(&size, err, scene, accessor.bufferView);
+  if (!bytes) {
+    return false;
+  }
+
+  // The last element must end within the bufferView(without overflow).
+  size_t offset = accessor.byteOffset;
+  if ((offset > size) ||
+      ((accessor.count > 0) &&
+       ((element_size > size - offset) ||
+        (accessor.count - 1 > (size - offset - element_size) / stride)))) {
+    if (err) {
+      (*err) += "Accessor exceeds bufferView \"" + accessor.bufferView +
+                "\".\n";
+    }
+    return false;
+  }
+
+  data_ = bytes + offset;
+  count_ = accessor.count;
+  byte_stride_ = stride;
+  component_type_ = accessor.componentType;
+  type_ = accessor.type;
+  num_components_ = num_components;
+  return true;
+}
+
+// Scale which maps the range of the integer type T to [0, 1] or [-1, 1].
+template <typename T>
+static float NormalizedScale() {
+  return 1.0f / static_cast<float>(std::numeric_limits<T>::max());
+}
+
+// Converts `count` elements of N components of type T, `stride` bytes apart.
+// N is known at compile time, so the inner loop is unrolled. Values below
+// `lo` are clamped(the minimum of a signed normalized integer maps to -1).
+template <typename T, int N>
+static void ConvertElementsToFloat(float *out, const unsigned char *src,
+                                   size_t count, size_t stride, float scale,
+                                   float lo) {
+  for (size_t i = 0; i < count; i++, src += stride, out += N) {
+    T v[N];
+    memcpy(v, src, sizeof(v));
+    for (int c = 0; c < N; c++) {
+      float f = static_cast<float>(v[c]) * scale;
+      out[c] = (f < lo) ? lo : f;
+    }
+  }
+}
+
+template <typename T, int N>
+static void ConvertElementsToUInt32(unsigned int *out, const unsigned char *src,
+                                    size_t count, size_t stride) {
+  for (size_t i = 0; i < count; i++, src += stride, out += N) {
+    T v[N];
+    memcpy(v, src, sizeof(v));
+    for (int c = 0; c < N; c++) {
+      out[c] = static_cast<unsigned int>(v[c]);
+    }
+  }
+}
+
+#if defined(TINYGLTF_SIMD_X86)
+
+// Components of 8 and 16 bit integer types widened to 32 bit integers. The
+// type is selected by the unused second argument.
+
+TINYGLTF_TARGET_SSSE3
+static inline __m128i Load4AsInt32SSE(const unsigned char *p, signed char) {
+  int bytes;
+  memcpy(&bytes, p, 4);
+  __m128i v = _mm_cvtsi32_si128(bytes);
+  v = _mm_unpacklo_epi8(v, v);
+  return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 24);
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline __m128i Load4AsInt32SSE(const unsigned char *p, unsigned char) {
+  int bytes;
+  memcpy(&bytes, p, 4);
+  const __m128i zero = _mm_setzero_si128();
+  __m128i v = _mm_cvtsi32_si128(bytes);
+  return _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, zero), zero);
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline __m128i Load4AsInt32SSE(const unsigned char *p, short) {
+  __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+  return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline __m128i Load4AsInt32SSE(const unsigned char *p,
+                                      unsigned short) {
+  __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+  return _mm_unpacklo_epi16(v, _mm_setzero_si128());
+}
+
+TINYGLTF_TARGET_AVX2
+static inline __m256i Load8AsInt32AVX2(const unsigned char *p, signed char) {
+  return _mm256_cvtepi8_epi32(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+}
+
+TINYGLTF_TARGET_AVX2
+static inline __m256i Load8AsInt32AVX2(const unsigned char *p, unsigned char) {
+  return _mm256_cvtepu8_epi32(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+}
+
+TINYGLTF_TARGET_AVX2
+static inline __m256i Load8AsInt32AVX2(const unsigned char *p, short) {
+  return _mm256_cvtepi16_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+
+TINYGLTF_TARGET_AVX2
+static inline __m256i Load8AsInt32AVX2(const unsigned char *p,
+                                       unsigned short) {
+  return _mm256_cvtepu16_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+
+// The kernels convert as many of the `n` packed components as they handle in
+// full vectors, and return how many.
+
+template <typename T>
+TINYGLTF_TARGET_SSSE3 static size_t ConvertToFloatSSE(float *out,
+                                                      const unsigned char *src,
+                                                      size_t n, float scale,
+                                                      float lo) {
+  const __m128 s = _mm_set1_ps(scale);
+  const __m128 l = _mm_set1_ps(lo);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 f = _mm_cvtepi32_ps(Load4AsInt32SSE(src + i * sizeof(T), T()));
+    _mm_storeu_ps(out + i, _mm_max_ps(_mm_mul_ps(f, s), l));
+  }
+  return i;
+}
+
+template <typename T>
+TINYGLTF_TARGET_AVX2 static size_t ConvertToFloatAVX2(float *out,
+                                                      const unsigned char *src,
+                                                      size_t n, float scale,
+                                                      float lo) {
+  const __m256 s = _mm256_set1_ps(scale);
+  const __m256 l = _mm256_set1_ps(lo);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 f = _mm256_cvtepi32_ps(Load8AsInt32AVX2(src + i * sizeof(T), T()));
+    _mm256_storeu_ps(out + i, _mm256_max_ps(_mm256_mul_ps(f, s), l));
+  }
+  return i;
+}
+
+template <typename T>
+TINYGLTF_TARGET_SSSE3 static size_t ConvertToUInt32SSE(
+    unsigned int *out, const unsigned char *src, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                     Load4AsInt32SSE(src + i * sizeof(T), T()));
+  }
+  return i;
+}
+
+template <typename T>
+TINYGLTF_TARGET_AVX2 static size_t ConvertToUInt32AVX2(
+    unsigned int *out, const unsigned char *src, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                        Load8AsInt32AVX2(src + i * sizeof(T), T()));
+  }
+  return i;
+}
+
+template <typename T>
+static size_t ConvertToFloatSIMD(float *out, const unsigned char *src,
+                                 size_t n, float scale, float lo) {
+  int features = GetSIMDFeatures();
+  if (features & TINYGLTF_SIMD_AVX2) {
+    return ConvertToFloatAVX2<T>(out, src, n, scale, lo);
+  }
+  if (features & TINYGLTF_SIMD_SSSE3) {
+    return ConvertToFloatSSE<T>(out, src, n, scale, lo);
+  }
+  return 0;
+}
+
+template <typename T>
+static size_t ConvertToUInt32SIMD(unsigned int *out, const unsigned char *src,
+                                  size_t n) {
+  int features = GetSIMDFeatures();
+  if (features & TINYGLTF_SIMD_AVX2) {
+    return ConvertToUInt32AVX2<T>(out, src, n);
+  }
+  if (features & TINYGLTF_SIMD_SSSE3) {
+    return ConvertToUInt32SSE<T>(out, src, n);
+  }
+  return 0;
+}
+
+#elif defined(TINYGLTF_SIMD_NEON)
+
+// Components of 8 and 16 bit integer types widened to 32 bit integers. The
+// type is selected by the unused second argument.
+
+static inline int32x4x2_t Load8AsInt32NEON(const unsigned char *p,
+                                           signed char) {
+  int16x8_t w = vmovl_s8(vreinterpret_s8_u8(vld1_u8(p)));
+  int32x4x2_t r;
+  r.val[0] = vmovl_s16(vget_low_s16(w));
+  r.val[1] = vmovl_s16(vget_high_s16(w));
+  return r;
+}
+
+static inline int32x4x2_t Load8AsInt32NEON(const unsigned char *p,
+                                           unsigned char) {
+  uint16x8_t w = vmovl_u8(vld1_u8(p));
+  int32x4x2_t r;
+  r.val[0] = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(w)));
+  r.val[1] = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(w)));
+  return r;
+}
+
+static inline int32x4x2_t Load8AsInt32NEON(const unsigned char *p, short) {
+  int16x8_t w = vreinterpretq_s16_u8(vld1q_u8(p));
+  int32x4x2_t r;
+  r.val[0] = vmovl_s16(vget_low_s16(w));
+  r.val[1] = vmovl_s16(vget_high_s16(w));
+  return r;
+}
+
+static inline int32x4x2_t Load8AsInt32NEON(const unsigned char *p,
+                                           unsigned short) {
+  uint16x8_t w = vreinterpretq_u16_u8(vld1q_u8(p));
+  int32x4x2_t r;
+  r.val[0] = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(w)));
+  r.val[1] = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(w)));
+  return r;
+}
+
+// The kernels convert as many of the `n` packed components as they handle in
+// full vectors, and return how many.
+
+template <typename T>
+static size_t ConvertToFloatSIMD(float *out, const unsigned char *src,
+                                 size_t n, float scale, float lo) {
+  const float32x4_t l = vdupq_n_f32(lo);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    int32x4x2_t v = Load8AsInt32NEON(src + i * sizeof(T), T());
+    vst1q_f32(out + i, vmaxq_f32(vmulq_n_f32(vcvtq_f32_s32(v.val[0]), scale),
+                                 l));
+    vst1q_f32(out + i + 4,
+              vmaxq_f32(vmulq_n_f32(vcvtq_f32_s32(v.val[1]), scale), l));
+  }
+  return i;
+}
+
+template <typename T>
+static size_t ConvertToUInt32SIMD(unsigned int *out, const unsigned char *src,
+                                  size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    int32x4x2_t v = Load8AsInt32NEON(src + i * sizeof(T), T());
+    vst1q_u32(out + i, vreinterpretq_u32_s32(v.val[0]));
+    vst1q_u32(out + i + 4, vreinterpretq_u32_s32(v.val[1]));
+  }
+  return i;
+}
+
+#endif
+
+// SIMD conversion of packed components, for the 8 and 16 bit integer types.
+template <typename T>
+struct PackedConverter {
+  static size_t ToFloat(float *, const unsigned char *, size_t, float, float) {
+    return 0;
+  }
+  static size_t ToUInt32(unsigned int *, const unsigned char *, size_t) {
+    return 0;
+  }
+};
+
+#if defined(TINYGLTF_SIMD_X86) || defined(TINYGLTF_SIMD_NEON)
+#define TINYGLTF_PACKED_CONVERTER(ctype)                                   \
+  template <>                                                              \
+  struct PackedConverter<ctype> {                                          \
+    static size_t ToFloat(float *out, const unsigned char *src, size_t n,  \
+                          float scale, float lo) {                         \
+      return ConvertToFloatSIMD<ctype>(out, src, n, scale, lo);            \
+    }                                                                      \
+    static size_t ToUInt32(unsigned int *out, const unsigned char *src,    \
+                           size_t n) {                                     \
+      return ConvertToUInt32SIMD<ctype>(out, src, n);                      \
+    }                                                                      \
+  };
+
+TINYGLTF_PACKED_CONVERTER(signed char)
+TINYGLTF_PACKED_CONVERTER(unsigned char)
+TINYGLTF_PACKED_CONVERTER(short)
+TINYGLTF_PACKED_CONVERTER(unsigned short)
+
+#undef TINYGLTF_PACKED_CONVERTER
+#endif
+
+// Converts `count` elements of `n` components of type T, `stride` bytes
+// apart, with the kernel specialized for `n`.
+template <typename T>
+static void ConvertComponentsToFloat(float *out, const unsigned char *src,
+                                     size_t count, size_t stride, int n,
+                                     bool normalized) {
+  float scale = 1.0f;
+  float lo = -std::numeric_limits<float>::infinity();  // No clamping.
+  if (normalized && std::numeric_limits<T>::is_integer) {
+    scale = NormalizedScale<T>();
+    if (std::numeric_limits<T>::is_signed) {
+      lo = -1.0f;
+    }
+  }
+
+  if (stride == sizeof(T) * static_cast<size_t>(n)) {
+    // Tightly packed, so all the components are converted as one run.
+    size_t total = count * static_cast<size_t>(n);
+    size_t i = PackedConverter<T>::ToFloat(out, src, total, scale, lo);
+    ConvertElementsToFloat<T, 1>(out + i, src + i * sizeof(T), total - i,
+                                 sizeof(T), scale, lo);
+    return;
+  }
+
+  switch (n) {
+    case 1:
+      ConvertElementsToFloat<T, 1>(out, src, count, stride, scale, lo);
+      break;
+    case 2:
+      ConvertElementsToFloat<T, 2>(out, src, count, stride, scale, lo);
+      break;
+    case 3:
+      ConvertElementsToFloat<T, 3>(out, src, count, stride, scale, lo);
+      break;
+    case 4:
+      ConvertElementsToFloat<T, 4>(out, src, count, stride, scale, lo);
+      break;
+    case 9:
+      ConvertElementsToFloat<T, 9>(out, src, count, stride, scale, lo);
+      break;
+    case 16:
+      ConvertElementsToFloat<T, 16>(out, src, count, stride, scale, lo);
+      break;
+  }
+}
+
+template <typename T>
+static void ConvertComponentsToUInt32(unsigned int *out,
+                                      const unsigned char *src, size_t count,
+                                      size_t stride, int n) {
+  if (stride == sizeof(T) * static_cast<size_t>(n)) {
+    size_t total = count * static_cast<size_t>(n);
+    if (sizeof(T) == sizeof(unsigned int)) {
+      if (total > 0) {
+        memcpy(out, src, total * sizeof(T));
+      }
+      return;
+    }
+    size_t i = PackedConverter<T>::ToUInt32(out, src, total);
+    ConvertElementsToUInt32<T, 1>(out + i, src + i * sizeof(T), total - i,
+                                  sizeof(T));
+    return;
+  }
+
+  switch (n) {
+    case 1:
+      ConvertElementsToUInt32<T, 1>(out, src, count, stride);
+      break;
+    case 2:
+      ConvertElementsToUInt32<T, 2>(out, src, count, stride);
+      break;
+    case 3:
+      ConvertElementsToUInt32<T, 3>(out, src, count, stride);
+      break;
+    case 4:
+      ConvertElementsToUInt32<T, 4>(out, src, count, stride);
+      break;
+    case 9:
+      ConvertElementsToUInt32<T, 9>(out, src, count, stride);
+      break;
+    case 16:
+      ConvertElementsToUInt32<T, 16>(out, src, count, stride);
+      break;
+  }
+}
+
+void AccessorReader::ReadAsFloat(float *out, bool normalized) const {
+  if (!data_ || (count_ == 0)) {
+    return;
+  }
+
+  switch (component_type_) {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+      ConvertComponentsToFloat<signed char>(out, data_, count_, byte_stride_,
+                                            num_components_, normalized);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      ConvertComponentsToFloat<unsigned char>(out, data_, count_, byte_stride_,
+                                              num_components_, normalized);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+      ConvertComponentsToFloat<short>(out, data_, count_, byte_stride_,
+                                      num_components_, normalized);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      ConvertComponentsToFloat<unsigned short>(
+          out, data_, count_, byte_stride_, num_components_, normalized);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_INT:
+      ConvertComponentsToFloat<int>(out, data_, count_, byte_stride_,
+                                    num_components_, normalized);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+      ConvertComponentsToFloat<unsigned int>(out, data_, count_, byte_stride_,
+                                             num_components_, normalized);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+      if (byte_stride_ ==
+          sizeof(float) * static_cast<size_t>(num_components_)) {
+        // Nothing to convert.
+        memcpy(out, data_, count_ * byte_stride_);
+      } else {
+        ConvertComponentsToFloat<float>(out, data_, count_, byte_stride_,
+                                        num_components_, false);
+      }
+      break;
+    case TINYGLTF_COMPONENT_TYPE_DOUBLE:
+      ConvertComponentsToFloat<double>(out, data_, count_, byte_stride_,
+                                       num_components_, false);
+      break;
+  }
+}
+
+bool AccessorReader::ReadAsUInt32(unsigned int *out) const {
+  if (!data_) {
+    return false;
+  }
+
+  switch (component_type_) {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+      ConvertComponentsToUInt32<signed char>(out, data_, count_, byte_stride_,
+                                             num_components_);
+      return true;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      ConvertComponentsToUInt32<unsigned char>(out, data_, count_,
+                                               byte_stride_, num_components_);
+      return true;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+      ConvertComponentsToUInt32<short>(out, data_, count_, byte_stride_,
+                                       num_components_);
+      return true;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      ConvertComponentsToUInt32<unsigned short>(out, data_, count_,
+                                                byte_stride_, num_components_);
+      return true;
+    case TINYGLTF_COMPONENT_TYPE_INT:
+      ConvertComponentsToUInt32<int>(out, data_, count_, byte_stride_,
+                                     num_components_);
+      return true;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+      ConvertComponentsToUInt32<unsigned int>(out, data_, count_, byte_stride_,
+                                              num_components_);
+      return true;
+    default:
+      return false;
+  }
+}
+
+void VertexLayout::Add(const std::string &semantic, int componentType,
+                       int numComponents, bool normalized, bool optional) {
+  size_t align = std::max(alignment, static_cast<size_t>(1));
+  VertexElement element;
+  element.semantic = semantic;
+  element.offset = (stride + align - 1) / align * align;
+  element.componentType = componentType;
+  element.numComponents = numComponents;
+  element.normalized = normalized;
+  element.optional = optional;
+  memset(element.pad, 0, sizeof(element.pad));
+  elements.push_back(element);
+
+  size_t end = element.offset +
+               static_cast<size_t>(GetComponentSizeInBytes(componentType)) *
+                   static_cast<size_t>(std::max(numComponents, 0));
+  stride = (end + align - 1) / align * align;
+}
+
+// Vertices converted at a time, so the staging buffers and the part of the
+// output being written stay in the cache.
+static const size_t kVertexChunkSize = 256;
+
+// Largest value of T which is exactly representable as float. The maxima of
+// 32 bit integers are not, and would round up out of range.
+template <typename T>
+static float QuantizeMax() {
+  float m = static_cast<float>(std::numeric_limits<T>::max());
+  return (sizeof(T) < 4) ? m : m * (1.0f - 1.0f / 16777216.0f);
+}
+
+// Clamps `f * scale` to [lo, hi](NaN becomes `lo`) and rounds it half away
+// from zero. The SIMD kernels compute exactly the same.
+template <typename T>
+static T QuantizeValue(float f, float scale, float lo, float hi) {
+  float v = f * scale;
+  v = (v > lo) ? v : lo;
+  v = (v < hi) ? v : hi;
+  return static_cast<T>(v + ((v < 0.0f) ? -0.5f : 0.5f));
+}
+
+template <typename T>
+static void QuantizeScalar(unsigned char *out, const float *in, size_t n,
+                           float scale, float lo, float hi) {
+  for (size_t i = 0; i < n; i++) {
+    T v = QuantizeValue<T>(in[i], scale, lo, hi);
+    memcpy(out + i * sizeof(T), &v, sizeof(T));
+  }
+}
+
+#if defined(TINYGLTF_SIMD_X86)
+
+// Stores 8 int32 values, already within the range of the type selected by
+// the unused last argument.
+
+TINYGLTF_TARGET_SSSE3
+static inline void StoreInt32x8SSE(unsigned char *p, __m128i a, __m128i b,
+                                   signed char) {
+  __m128i v = _mm_packs_epi32(a, b);
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packs_epi16(v, v));
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline void StoreInt32x8SSE(unsigned char *p, __m128i a, __m128i b,
+                                   unsigned char) {
+  __m128i v = _mm_packs_epi32(a, b);
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packus_epi16(v, v));
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline void StoreInt32x8SSE(unsigned char *p, __m128i a, __m128i b,
+                                   short) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_packs_epi32(a, b));
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline void StoreInt32x8SSE(unsigned char *p, __m128i a, __m128i b,
+                                   unsigned short) {
+  // No unsigned saturation from 32 to 16 bit before SSE4.1, so bias the
+  // values into the signed range and back.
+  const __m128i bias32 = _mm_set1_epi32(32768);
+  const __m128i bias16 = _mm_set1_epi16(-32768);
+  __m128i v =
+      _mm_packs_epi32(_mm_sub_epi32(a, bias32), _mm_sub_epi32(b, bias32));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_xor_si128(v, bias16));
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline __m128i QuantizeSSE(__m128 f, __m128 scale, __m128 lo,
+                                  __m128 hi) {
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+  __m128 v = _mm_mul_ps(f, scale);
+  v = _mm_max_ps(v, lo);  // Returns `lo` for NaN.
+  v = _mm_min_ps(v, hi);
+  __m128 h = _mm_or_ps(half, _mm_and_ps(v, sign_mask));
+  return _mm_cvttps_epi32(_mm_add_ps(v, h));
+}
+
+template <typename T>
+TINYGLTF_TARGET_SSSE3 static size_t QuantizeSSSE3(unsigned char *out,
+                                                  const float *in, size_t n,
+                                                  float scale, float lo,
+                                                  float hi) {
+  const __m128 s = _mm_set1_ps(scale);
+  const __m128 l = _mm_set1_ps(lo);
+  const __m128 h = _mm_set1_ps(hi);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i a = QuantizeSSE(_mm_loadu_ps(in + i), s, l, h);
+    __m128i b = QuantizeSSE(_mm_loadu_ps(in + i + 4), s, l, h);
+    StoreInt32x8SSE(out + i * sizeof(T), a, b, T());
+  }
+  return i;
+}
+
+// Quantizes as many of the `n` values as it handles in full vectors, and
+// returns how many.
+template <typename T>
+static size_t QuantizeSIMD(unsigned char *out, const float *in, size_t n,
+                           float scale, float lo, float hi) {
+  if (!(GetSIMDFeatures() & TINYGLTF_SIMD_SSSE3)) {
+    return 0;
+  }
+  return QuantizeSSSE3<T>(out, in, n, scale, lo, hi);
+}
+
+#elif defined(TINYGLTF_SIMD_NEON)
+
+// Stores 8 int32 values, already within the range of the type selected by
+// the unused last argument.
+
+static inline void StoreInt32x8NEON(unsigned char *p, int32x4_t a, int32x4_t b,
+                                    signed char) {
+  int8x8_t v = vqmovn_s16(vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+  vst1_u8(p, vreinterpret_u8_s8(v));
+}
+
+static inline void StoreInt32x8NEON(unsigned char *p, int32x4_t a, int32x4_t b,
+                                    unsigned char) {
+  vst1_u8(p, vqmovun_s16(vcombine_s16(vqmovn_s32(a), vqmovn_s32(b))));
+}
+
+static inline void StoreInt32x8NEON(unsigned char *p, int32x4_t a, int32x4_t b,
+                                    short) {
+  int16x8_t v = vcombine_s16(vqmovn_s32(a), vqmovn_s32(b));
+  vst1q_u8(p, vreinterpretq_u8_s16(v));
+}
+
+static inline void StoreInt32x8NEON(unsigned char *p, int32x4_t a, int32x4_t b,
+                                    unsigned short) {
+  uint16x8_t v = vcombine_u16(vqmovun_s32(a), vqmovun_s32(b));
+  vst1q_u8(p, vreinterpretq_u8_u16(v));
+}
+
+static inline int32x4_t QuantizeNEON(float32x4_t f, float scale,
+                                     float32x4_t lo, float32x4_t hi) {
+  float32x4_t v = vmulq_n_f32(f, scale);
+  v = vbslq_f32(vcgtq_f32(v, lo), v, lo);  // `lo` for NaN.
+  v = vbslq_f32(vcltq_f32(v, hi), v, hi);
+  float32x4_t h = vbslq_f32(vcltq_f32(v, vdupq_n_f32(0.0f)),
+                            vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+  return vcvtq_s32_f32(vaddq_f32(v, h));
+}
+
+// Quantizes as many of the `n` values as it handles in full vectors, and
+// returns how many.
+template <typename T>
+static size_t QuantizeSIMD(unsigned char *out, const float *in, size_t n,
+                           float scale, float lo, float hi) {
+  const float32x4_t l = vdupq_n_f32(lo);
+  const float32x4_t h = vdupq_n_f32(hi);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    int32x4_t a = QuantizeNEON(vld1q_f32(in + i), scale, l, h);
+    int32x4_t b = QuantizeNEON(vld1q_f32(in + i + 4), scale, l, h);
+    StoreInt32x8NEON(out + i * sizeof(T), a, b, T());
+  }
+  return i;
+}
+
+#endif
+
+// SIMD quantization, for the 8 and 16 bit integer types.
+template <typename T>
+struct PackedQuantizer {
+  static size_t Quantize(unsigned char *, const float *, size_t, float, float,
+                         float) {
+    return 0;
+  }
+};
+
+#if defined(TINYGLTF_SIMD_X86) || defined(TINYGLTF_SIMD_NEON)
+#define TINYGLTF_PACKED_QUANTIZER(ctype)                                  \
+  template <>                                                             \
+  struct PackedQuantizer<ctype> {                                         \
+    static size_t Quantize(unsigned char *out, const float *in, size_t n, \
+                           float scale, float lo, float hi) {             \
+      return QuantizeSIMD<ctype>(out, in, n, scale, lo, hi);              \
+    }                                                                     \
+  };
+
+TINYGLTF_PACKED_QUANTIZER(signed char)
+TINYGLTF_PACKED_QUANTIZER(unsigned char)
+TINYGLTF_PACKED_QUANTIZER(short)
+TINYGLTF_PACKED_QUANTIZER(unsigned short)
+
+#undef TINYGLTF_PACKED_QUANTIZER
+#endif
+
+// Converts `n` floats to packed components of type T. With `normalized`, the
+// floats are in [0, 1] or [-1, 1].
+template <typename T>
+static void QuantizeComponents(unsigned char *out, const float *in, size_t n,
+                               bool normalized) {
+  float hi = QuantizeMax<T>();
+  float lo = std::numeric_limits<T>::is_signed
+                 ? static_cast<float>(std::numeric_limits<T>::min())
+                 : 0.0f;
+  float scale = 1.0f;
+  if (normalized) {
+    scale = static_cast<float>(std::numeric_limits<T>::max());
+    lo = std::numeric_limits<T>::is_signed ? -hi : 0.0f;
+  }
+
+  size_t i = PackedQuantizer<T>::Quantize(out, in, n, scale, lo, hi);
+  QuantizeScalar<T>(out + i * sizeof(T), in + i, n - i, scale, lo, hi);
+}
+
+// Converts `n` unsigned ints to packed components of type T by value.
+template <typename T>
+static void NarrowComponents(unsigned char *out, const unsigned int *in,
+                             size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    T v = static_cast<T>(in[i]);
+    memcpy(out + i * sizeof(T), &v, sizeof(T));
+  }
+}
+
+// Copies `count` elements of `src_n` components to elements of `dst_n`
+// components, dropping the extra ones and filling the missing ones from
+// (0, 0, 0, `one`).
+template <typename T>
+static void RepackComponents(T *dst, int dst_n, const T *src, int src_n,
+                             size_t count, T one) {
+  int n = std::min(dst_n, src_n);
+  for (size_t i = 0; i < count; i++, dst += dst_n, src += src_n) {
+    int c = 0;
+    for (; c < n; c++) {
+      dst[c] = src[c];
+    }
+    for (; c < dst_n; c++) {
+      dst[c] = (c == 3) ? one : T(0);
+    }
+  }
+}
+
+// Writes `count` packed elements of `Bytes` bytes each `stride` bytes apart.
+template <size_t Bytes>
+static void ScatterElements(unsigned char *dst, size_t stride,
+                            const unsigned char *src, size_t count) {
+  for (size_t i = 0; i < count; i++, dst += stride, src += Bytes) {
+    memcpy(dst, src, Bytes);
+  }
+}
+
+static void Scatter(unsigned char *dst, size_t stride, const unsigned char *src,
+                    size_t count, size_t bytes) {
+  switch (bytes) {
+    case 1:
+      ScatterElements<1>(dst, stride, src, count);
+      break;
+    case 2:
+      ScatterElements<2>(dst, stride, src, count);
+      break;
+    case 3:
+      ScatterElements<3>(dst, stride, src, count);
+      break;
+    case 4:
+      ScatterElements<4>(dst, stride, src, count);
+      break;
+    case 6:
+      ScatterElements<6>(dst, stride, src, count);
+      break;
+    case 8:
+      ScatterElements<8>(dst, stride, src, count);
+      break;
+    case 12:
+      ScatterElements<12>(dst, stride, src, count);
+      break;
+    case 16:
+      ScatterElements<16>(dst, stride, src, count);
+      break;
+    default:
+      for (size_t i = 0; i < count; i++) {
+        memcpy(dst + i * stride, src + i * bytes, bytes);
+      }
+      break;
+  }
+}
+
+// Staging buffers of InterleaveVertices().
+typedef struct {
+  std::vector<float> source;  // Components as read from the accessor.
+  std::vector<float> floats;  // Components of the vertex element.
+  std::vector<unsigned int> source_uints;
+  std::vector<unsigned int> uints;
+  std::vector<unsigned char> packed;  // Vertex elements in their format.
+} VertexStaging;
+
+// Converts vertices [first, first + n) of one element into `out`. `reader`
+// is NULL for a missing optional attribute.
+static void InterleaveElement(unsigned char *out, VertexStaging *staging,
+                              const VertexLayout &layout,
+                              const VertexElement &element,
+                              const AccessorReader *reader, size_t first,
+                              size_t n) {
+  const int dst_n = element.numComponents;
+  const int src_n = reader ? reader->NumComponents() : 0;
+  const size_t size = static_cast<size_t>(dst_n) * n;
+  const int type = element.componentType;
+  const bool by_value =
+      reader && !element.normalized &&
+      (type != TINYGLTF_COMPONENT_TYPE_FLOAT) &&
+      (reader->ComponentType() != TINYGLTF_COMPONENT_TYPE_FLOAT) &&
+      (reader->ComponentType() != TINYGLTF_COMPONENT_TYPE_DOUBLE);
+  unsigned char *packed = &staging->packed.at(0);
+
+  if (by_value) {
+    // Integers to integers, exactly(floats lose precision above 2^24).
+    const unsigned int *values = &staging->source_uints.at(0);
+    reader->Slice(first, n).ReadAsUInt32(&staging->source_uints.at(0));
+    if (src_n != dst_n) {
+      RepackComponents(&staging->uints.at(0), dst_n, values, src_n, n, 1u);
+      values = &staging->uints.at(0);
+    }
+    switch (type) {
+      case TINYGLTF_COMPONENT_TYPE_BYTE:
+        NarrowComponents<signed char>(packed, values, size);
+        break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        NarrowComponents<unsigned char>(packed, values, size);
+        break;
+      case TINYGLTF_COMPONENT_TYPE_SHORT:
+        NarrowComponents<short>(packed, values, size);
+        break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        NarrowComponents<unsigned short>(packed, values, size);
+        break;
+      default:
+        NarrowComponents<unsigned int>(packed, values, size);
+        break;
+    }
+  } else {
+    const float *values = &staging->source.at(0);
+    if (reader) {
+      reader->Slice(first, n).ReadAsFloat(&staging->source.at(0),
+                                          element.normalized);
+    }
+    if (src_n != dst_n) {
+      RepackComponents(&staging->floats.at(0), dst_n, values, src_n, n, 1.0f);
+      values = &staging->floats.at(0);
+    }
+    switch (type) {
+      case TINYGLTF_COMPONENT_TYPE_BYTE:
+        QuantizeComponents<signed char>(packed, values, size,
+                                        element.normalized);
+        break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        QuantizeComponents<unsigned char>(packed, values, size,
+                                          element.normalized);
+        break;
+      case TINYGLTF_COMPONENT_TYPE_SHORT:
+        QuantizeComponents<short>(packed, values, size, element.normalized);
+        break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        QuantizeComponents<unsigned short>(packed, values, size,
+                                           element.normalized);
+        break;
+      case TINYGLTF_COMPONENT_TYPE_INT:
+        QuantizeComponents<int>(packed, values, size, element.normalized);
+        break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        QuantizeComponents<unsigned int>(packed, values, size,
+                                         element.normalized);
+        break;
+      default:
+        memcpy(packed, values, size * sizeof(float));
+        break;
+    }
+  }
+
+  size_t bytes = static_cast<size_t>(GetComponentSizeInBytes(type)) *
+                 static_cast<size_t>(dst_n);
+  Scatter(out + first * layout.stride + element.offset, layout.stride, packed,
+          n, bytes);
+}
+
+bool InterleaveVertices(std::vector<unsigned char> *out, std::string *err,
+                        const Scene &scene, const Primitive &primitive,
+                        const VertexLayout &layout) {
+  out->clear();
+
+  std::vector<AccessorReader> readers(layout.elements.size());
+  std::vector<bool> present(layout.elements.size(), false);
+  size_t count = 0;
+  bool has_count = false;
+  int max_components = 1;
+  for (size_t i = 0; i < layout.elements.size(); i++) {
+    const VertexElement &element = layout.elements[i];
+    size_t component_size =
+        static_cast<size_t>(GetComponentSizeInBytes(element.componentType));
+    if ((component_size == 0) ||
+        (element.componentType == TINYGLTF_COMPONENT_TYPE_DOUBLE) ||
+        (element.numComponents < 1) || (element.numComponents > 4) ||
+        (element.offset + component_size *
+                              static_cast<size_t>(element.numComponents) >
+         layout.stride)) {
+      if (err) {
+        (*err) += "Invalid vertex layout element \"" + element.semantic +
+                  "\".\n";
+      }
+      return false;
+    }
+
+    StringMap::const_iterator it = primitive.attributes.find(element.semantic);
+    if (it == primitive.attributes.end()) {
+      if (element.optional) {
+        continue;
+      }
+      if (err) {
+        (*err) += "Attribute \"" + element.semantic +
+                  "\" not found in the primitive.\n";
+      }
+      return false;
+    }
+
+    if (!readers[i].Init(scene, it->second, err)) {
+      return false;
+    }
+    if (has_count && (readers[i].Count() != count)) {
+      if (err) {
+        (*err) += "Attribute \"" + element.semantic +
+                  "\" has a different count from the other attributes.\n";
+      }
+      return false;
+    }
+    present[i] = true;
+    count = readers[i].Count();
+    has_count = true;
+    max_components = std::max(max_components, readers[i].NumComponents());
+  }
+
+  if (!has_count) {
+    if (err) {
+      (*err) += "No attribute of the vertex layout found in the primitive.\n";
+    }
+    return false;
+  }
+
+  out->resize(count * layout.stride, 0);
+  if (count == 0) {
+    return true;
+  }
+
+  size_t chunk = std::min(count, kVertexChunkSize);
+  size_t max_source = chunk * static_cast<size_t>(max_components);
+  VertexStaging staging;
+  staging.source.resize(max_source);
+  staging.floats.resize(chunk * 4);
+  staging.source_uints.resize(max_source);
+  staging.uints.resize(chunk * 4);
+  staging.packed.resize(chunk * 4 * sizeof(float));
+
+  for (size_t first = 0; first < count; first += chunk) {
+    size_t n = std::min(chunk, count - first);
+    for (size_t i = 0; i < layout.elements.size(); i++) {
+      InterleaveElement(&out->at(0), &staging, layout, layout.elements[i],
+                        present[i] ? &readers[i] : NULL, first, n);
+    }
+  }
+
+  return true;
+}
+
+// Shared by the tasks of the parallel InterleaveVertices().
+typedef struct {
+  std::vector<unsigned char> *out;
+  std::vector<std::string> errs;
+  std::vector<char> rets;
+  const Scene *scene;
+  const Primitive *const *primitives;
+  const VertexLayout *layout;
+} InterleaveJob;
+
+static void RunInterleaveTask(void *task_data, size_t index) {
+  InterleaveJob *job = static_cast<InterleaveJob *>(task_data);
+  job->rets[index] = InterleaveVertices(&job->out[index], &job->errs[index],
+                                        *job->scene, *job->primitives[index],
+                                        *job->layout);
+}
+
+bool InterleaveVertices(std::vector<unsigned char> *out, std::string *err,
+                        const Scene &scene, const Primitive *const *primitives,
+                        size_t count, const VertexLayout &layout,
+                        int num_threads, TaskExecutor executor,
+                        void *user_ptr) {
+  InterleaveJob job;
+  job.out = out;
+  job.errs.resize(count);
+  job.rets.resize(count, 0);
+  job.scene = &scene;
+  job.primitives = primitives;
+  job.layout = &layout;
+  RunTasks(executor, user_ptr, num_threads, RunInterleaveTask, &job, count);
+
+  bool ret = true;
+  for (size_t i = 0; i < count; i++) {
+    if (err) {
+      (*err) += job.errs[i];
+    }
+    ret = ret && job.rets[i];
+  }
+  return ret;
+}
+
+// Starting values of the running minimum and maximum of T.
+template <typename T>
+static T BoundsMinStart() {
+  return std::numeric_limits<T>::has_infinity
+             ? std::numeric_limits<T>::infinity()
+             : std::numeric_limits<T>::max();
+}
+
+template <typename T>
+static T BoundsMaxStart() {
+  return std::numeric_limits<T>::has_infinity
+             ? -std::numeric_limits<T>::infinity()
+             : std::numeric_limits<T>::min();
+}
+
+// Updates the running `lo` and `hi` of the `n` components with `count`
+// elements `stride` bytes apart. Comparisons are false for NaN, which keeps
+// the running value, like the SIMD min/max instructions below.
+template <typename T>
+static void UpdateBoundsScalar(T *lo, T *hi, const unsigned char *src,
+                               size_t count, size_t stride, int n) {
+  for (size_t i = 0; i < count; i++, src += stride) {
+    for (int c = 0; c < n; c++) {
+      T v;
+      memcpy(&v, src + static_cast<size_t>(c) * sizeof(T), sizeof(T));
+      lo[c] = (v < lo[c]) ? v : lo[c];
+      hi[c] = (v > hi[c]) ? v : hi[c];
+    }
+  }
+}
+
+// Merges `lanes` values of vectors of running bounds, whose first lane holds
+// component `first % n`, into `lo` and `hi`.
+template <typename T>
+static void MergeBoundsLanes(T *lo, T *hi, const T *vlo, const T *vhi,
+                             size_t first, size_t lanes, int n) {
+  for (size_t j = 0; j < lanes; j++) {
+    size_t c = (first + j) % static_cast<size_t>(n);
+    lo[c] = (vlo[j] < lo[c]) ? vlo[j] : lo[c];
+    hi[c] = (vhi[j] > hi[c]) ? vhi[j] : hi[c];
+  }
+}
+
+#if defined(TINYGLTF_SIMD_X86)
+
+// Running minimum and maximum of vectors of T, selected by the unused last
+// argument. `v` is the first operand so that a NaN in it keeps the running
+// value. SSE2 lacks some integer min/max, which are compare and select here.
+
+TINYGLTF_TARGET_SSSE3
+static inline __m128i SelectSSE(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline void UpdateBoundsSSE(__m128i v, __m128i *lo, __m128i *hi,
+                                   signed char) {
+  *lo = SelectSSE(_mm_cmpgt_epi8(*lo, v), v, *lo);
+  *hi = SelectSSE(_mm_cmpgt_epi8(v, *hi), v, *hi);
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline void UpdateBoundsSSE(__m128i v, __m128i *lo, __m128i *hi,
+                                   unsigned char) {
+  *lo = _mm_min_epu8(v, *lo);
+  *hi = _mm_max_epu8(v, *hi);
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline void UpdateBoundsSSE(__m128i v, __m128i *lo, __m128i *hi,
+                                   short) {
+  *lo = _mm_min_epi16(v, *lo);
+  *hi = _mm_max_epi16(v, *hi);
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline void UpdateBoundsSSE(__m128i v, __m128i *lo, __m128i *hi,
+                                   unsigned short) {
+  const __m128i bias = _mm_set1_epi16(-32768);
+  __m128i sv = _mm_xor_si128(v, bias);
+  *lo = SelectSSE(_mm_cmpgt_epi16(_mm_xor_si128(*lo, bias), sv), v, *lo);
+  *hi = SelectSSE(_mm_cmpgt_epi16(sv, _mm_xor_si128(*hi, bias)), v, *hi);
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline void UpdateBoundsSSE(__m128i v, __m128i *lo, __m128i *hi, int) {
+  *lo = SelectSSE(_mm_cmpgt_epi32(*lo, v), v, *lo);
+  *hi = SelectSSE(_mm_cmpgt_epi32(v, *hi), v, *hi);
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline void UpdateBoundsSSE(__m128i v, __m128i *lo, __m128i *hi,
+                                   unsigned int) {
+  const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+  __m128i sv = _mm_xor_si128(v, bias);
+  *lo = SelectSSE(_mm_cmpgt_epi32(_mm_xor_si128(*lo, bias), sv), v, *lo);
+  *hi = SelectSSE(_mm_cmpgt_epi32(sv, _mm_xor_si128(*hi, bias)), v, *hi);
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline void UpdateBoundsSSE(__m128i v, __m128i *lo, __m128i *hi,
+                                   float) {
+  __m128 f = _mm_castsi128_ps(v);
+  *lo = _mm_castps_si128(_mm_min_ps(f, _mm_castsi128_ps(*lo)));
+  *hi = _mm_castps_si128(_mm_max_ps(f, _mm_castsi128_ps(*hi)));
+}
+
+TINYGLTF_TARGET_SSSE3
+static inline void UpdateBoundsSSE(__m128i v, __m128i *lo, __m128i *hi,
+                                   double) {
+  __m128d d = _mm_castsi128_pd(v);
+  *lo = _mm_castpd_si128(_mm_min_pd(d, _mm_castsi128_pd(*lo)));
+  *hi = _mm_castpd_si128(_mm_max_pd(d, _mm_castsi128_pd(*hi)));
+}
+
+TINYGLTF_TARGET_AVX2
+static inline void UpdateBoundsAVX2(__m256i v, __m256i *lo, __m256i *hi,
+                                    signed char) {
+  *lo = _mm256_min_epi8(v, *lo);
+  *hi = _mm256_max_epi8(v, *hi);
+}
+
+TINYGLTF_TARGET_AVX2
+static inline void UpdateBoundsAVX2(__m256i v, __m256i *lo, __m256i *hi,
+                                    unsigned char) {
+  *lo = _mm256_min_epu8(v, *lo);
+  *hi = _mm256_max_epu8(v, *hi);
+}
+
+TINYGLTF_TARGET_AVX2
+static inline void UpdateBoundsAVX2(__m256i v, __m256i *lo, __m256i *hi,
+                                    short) {
+  *lo = _mm256_min_epi16(v, *lo);
+  *hi = _mm256_max_epi16(v, *hi);
+}
+
+TINYGLTF_TARGET_AVX2
+static inline void UpdateBoundsAVX2(__m256i v, __m256i *lo, __m256i *hi,
+                                    unsigned short) {
+  *lo = _mm256_min_epu16(v, *lo);
+  *hi = _mm256_max_epu16(v, *hi);
+}
+
+TINYGLTF_TARGET_AVX2
+static inline void UpdateBoundsAVX2(__m256i v, __m256i *lo, __m256i *hi,
+                                    int) {
+  *lo = _mm256_min_epi32(v, *lo);
+  *hi = _mm256_max_epi32(v, *hi);
+}
+
+TINYGLTF_TARGET_AVX2
+static inline void UpdateBoundsAVX2(__m256i v, __m256i *lo, __m256i *hi,
+                                    unsigned int) {
+  *lo = _mm256_min_epu32(v, *lo);
+  *hi = _mm256_max_epu32(v, *hi);
+}
+
+TINYGLTF_TARGET_AVX2
+static inline void UpdateBoundsAVX2(__m256i v, __m256i *lo, __m256i *hi,
+                                    float) {
+  __m256 f = _mm256_castsi256_ps(v);
+  *lo = _mm256_castps_si256(_mm256_min_ps(f, _mm256_castsi256_ps(*lo)));
+  *hi = _mm256_castps_si256(_mm256_max_ps(f, _mm256_castsi256_ps(*hi)));
+}
+
+TINYGLTF_TARGET_AVX2
+static inline void UpdateBoundsAVX2(__m256i v, __m256i *lo, __m256i *hi,
+                                    double) {
+  __m256d d = _mm256_castsi256_pd(v);
+  *lo = _mm256_castpd_si256(_mm256_min_pd(d, _mm256_castsi256_pd(*lo)));
+  *hi = _mm256_castpd_si256(_mm256_max_pd(d, _mm256_castsi256_pd(*hi)));
+}
+
+// The packed kernels keep N vectors of running bounds, so that lane j of
+// vector k always sees component (k * lanes + j) % N. They update `lo` and
+// `hi` with as many of the `count` elements as fill whole groups of N
+// vectors, and return how many.
+
+template <typename T, int N>
+TINYGLTF_TARGET_SSSE3 static size_t UpdateBoundsPackedSSE(
+    T *lo, T *hi, const unsigned char *src, size_t count) {
+  const size_t lanes = 16 / sizeof(T);
+  size_t groups = count / lanes;
+  T vlo[16 / sizeof(T)];
+  T vhi[16 / sizeof(T)];
+  std::fill(vlo, vlo + lanes, BoundsMinStart<T>());
+  std::fill(vhi, vhi + lanes, BoundsMaxStart<T>());
+  __m128i acc_lo[N];
+  __m128i acc_hi[N];
+  for (int k = 0; k < N; k++) {
+    acc_lo[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(vlo));
+    acc_hi[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(vhi));
+  }
+
+  for (size_t g = 0; g < groups; g++, src += N * 16) {
+    for (int k = 0; k < N; k++) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src) + k);
+      UpdateBoundsSSE(v, &acc_lo[k], &acc_hi[k], T());
+    }
+  }
+
+  for (int k = 0; k < N; k++) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(vlo), acc_lo[k]);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(vhi), acc_hi[k]);
+    MergeBoundsLanes(lo, hi, vlo, vhi, static_cast<size_t>(k) * lanes, lanes,
+                     N);
+  }
+  return groups * lanes;
+}
+
+template <typename T, int N>
+TINYGLTF_TARGET_AVX2 static size_t UpdateBoundsPackedAVX2(
+    T *lo, T *hi, const unsigned char *src, size_t count) {
+  const size_t lanes = 32 / sizeof(T);
+  size_t groups = count / lanes;
+  T vlo[32 / sizeof(T)];
+  T vhi[32 / sizeof(T)];
+  std::fill(vlo, vlo + lanes, BoundsMinStart<T>());
+  std::fill(vhi, vhi + lanes, BoundsMaxStart<T>());
+  __m256i acc_lo[N];
+  __m256i acc_hi[N];
+  for (int k = 0; k < N; k++) {
+    acc_lo[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(vlo));
+    acc_hi[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(vhi));
+  }
+
+  for (size_t g = 0; g < groups; g++, src += N * 32) {
+    for (int k = 0; k < N; k++) {
+      __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src) + k);
+      UpdateBoundsAVX2(v, &acc_lo[k], &acc_hi[k], T());
+    }
+  }
+
+  for (int k = 0; k < N; k++) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(vlo), acc_lo[k]);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(vhi), acc_hi[k]);
+    MergeBoundsLanes(lo, hi, vlo, vhi, static_cast<size_t>(k) * lanes, lanes,
+                     N);
+  }
+  return groups * lanes;
+}
+
+// Strided elements of up to 16 bytes, one vector per element. Reads up to 16
+// bytes from each element, so it stops where that would pass the end of the
+// last element, and returns how many elements it processed.
+template <typename T>
+TINYGLTF_TARGET_SSSE3 static size_t UpdateBoundsStridedSSE(
+    T *lo, T *hi, const unsigned char *src, size_t count, size_t stride,
+    int n) {
+  const size_t lanes = 16 / sizeof(T);
+  size_t elem = static_cast<size_t>(n) * sizeof(T);
+  if ((count == 0) || ((count - 1) * stride + elem < 16)) {
+    return 0;
+  }
+  // Elements [0, last) can be read as a whole vector.
+  size_t last = ((count - 1) * stride + elem - 16) / stride + 1;
+
+  T vlo[16 / sizeof(T)];
+  T vhi[16 / sizeof(T)];
+  std::fill(vlo, vlo + lanes, BoundsMinStart<T>());
+  std::fill(vhi, vhi + lanes, BoundsMaxStart<T>());
+  __m128i acc_lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(vlo));
+  __m128i acc_hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(vhi));
+  for (size_t i = 0; i < last; i++, src += stride) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    UpdateBoundsSSE(v, &acc_lo, &acc_hi, T());
+  }
+
+  // Lanes past the element hold other data and are dropped.
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(vlo), acc_lo);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(vhi), acc_hi);
+  MergeBoundsLanes(lo, hi, vlo, vhi, 0, static_cast<size_t>(n), n);
+  return last;
+}
+
+template <typename T, int N>
+static size_t UpdateBoundsPackedSIMD(T *lo, T *hi, const unsigned char *src,
+                                     size_t count) {
+  int features = GetSIMDFeatures();
+  if (features & TINYGLTF_SIMD_AVX2) {
+    return UpdateBoundsPackedAVX2<T, N>(lo, hi, src, count);
+  }
+  if (features & TINYGLTF_SIMD_SSSE3) {
+    return UpdateBoundsPackedSSE<T, N>(lo, hi, src, count);
+  }
+  return 0;
+}
+
+template <typename T>
+static size_t UpdateBoundsStridedSIMD(T *lo, T *hi, const unsigned char *src,
+                                      size_t count, size_t stride, int n) {
+  if (GetSIMDFeatures() & TINYGLTF_SIMD_SSSE3) {
+    return UpdateBoundsStridedSSE<T>(lo, hi, src, count, stride, n);
+  }
+  return 0;
+}
+
+#elif defined(TINYGLTF_SIMD_NEON)
+
+// Running minimum and maximum of vectors of T, selected by the unused last
+// argument. Floats compare and select, since vminq/vmaxq return NaN when
+// either operand is NaN.
+
+#define TINYGLTF_BOUNDS_NEON(ctype, sfx)                                      \
+  static inline void UpdateBoundsNEON(uint8x16_t v, uint8x16_t *lo,          \
+                                      uint8x16_t *hi, ctype) {               \
+    *lo = vreinterpretq_u8_##sfx(vminq_##sfx(vreinterpretq_##sfx##_u8(v),    \
+                                             vreinterpretq_##sfx##_u8(*lo))); \
+    *hi = vreinterpretq_u8_##sfx(vmaxq_##sfx(vreinterpretq_##sfx##_u8(v),    \
+                                             vreinterpretq_##sfx##_u8(*hi))); \
+  }
+
+TINYGLTF_BOUNDS_NEON(signed char, s8)
+TINYGLTF_BOUNDS_NEON(short, s16)
+TINYGLTF_BOUNDS_NEON(unsigned short, u16)
+TINYGLTF_BOUNDS_NEON(int, s32)
+TINYGLTF_BOUNDS_NEON(unsigned int, u32)
+
+#undef TINYGLTF_BOUNDS_NEON
+
+static inline void UpdateBoundsNEON(uint8x16_t v, uint8x16_t *lo,
+                                    uint8x16_t *hi, unsigned char) {
+  *lo = vminq_u8(v, *lo);
+  *hi = vmaxq_u8(v, *hi);
+}
+
+static inline void UpdateBoundsNEON(uint8x16_t v, uint8x16_t *lo,
+                                    uint8x16_t *hi, float) {
+  float32x4_t f = vreinterpretq_f32_u8(v);
+  float32x4_t l = vreinterpretq_f32_u8(*lo);
+  float32x4_t h = vreinterpretq_f32_u8(*hi);
+  *lo = vreinterpretq_u8_f32(vbslq_f32(vcltq_f32(f, l), f, l));
+  *hi = vreinterpretq_u8_f32(vbslq_f32(vcgtq_f32(f, h), f, h));
+}
+
+// See UpdateBoundsPackedSSE.
+template <typename T, int N>
+static size_t UpdateBoundsPackedNEON(T *lo, T *hi, const unsigned char *src,
+                                     size_t count) {
+  const size_t lanes = 16 / sizeof(T);
+  size_t groups = count / lanes;
+  T vlo[16 / sizeof(T)];
+  T vhi[16 / sizeof(T)];
+  std::fill(vlo, vlo + lanes, BoundsMinStart<T>());
+  std::fill(vhi, vhi + lanes, BoundsMaxStart<T>());
+  uint8x16_t acc_lo[N];
+  uint8x16_t acc_hi[N];
+  for (int k = 0; k < N; k++) {
+    acc_lo[k] = vld1q_u8(reinterpret_cast<const unsigned char *>(vlo));
+    acc_hi[k] = vld1q_u8(reinterpret_cast<const unsigned char *>(vhi));
+  }
+
+  for (size_t g = 0; g < groups; g++, src += N * 16) {
+    for (int k = 0; k < N; k++) {
+      UpdateBoundsNEON(vld1q_u8(src + k * 16), &acc_lo[k], &acc_hi[k], T());
+    }
+  }
+
+  for (int k = 0; k < N; k++) {
+    vst1q_u8(reinterpret_cast<unsigned char *>(vlo), acc_lo[k]);
+    vst1q_u8(reinterpret_cast<unsigned char *>(vhi), acc_hi[k]);
+    MergeBoundsLanes(lo, hi, vlo, vhi, static_cast<size_t>(k) * lanes, lanes,
+                     N);
+  }
+  return groups * lanes;
+}
+
+// See UpdateBoundsStridedSSE.
+template <typename T>
+static size_t UpdateBoundsStridedNEON(T *lo, T *hi, const unsigned char *src,
+                                      size_t count, size_t stride, int n) {
+  const size_t lanes = 16 / sizeof(T);
+  size_t elem = static_cast<size_t>(n) * sizeof(T);
+  if ((count == 0) || ((count - 1) * stride + elem < 16)) {
+    return 0;
+  }
+  size_t last = ((count - 1) * stride + elem - 16) / stride + 1;
+
+  T vlo[16 / sizeof(T)];
+  T vhi[16 / sizeof(T)];
+  std::fill(vlo, vlo + lanes, BoundsMinStart<T>());
+  std::fill(vhi, vhi + lanes, BoundsMaxStart<T>());
+  uint8x16_t acc_lo = vld1q_u8(reinterpret_cast<const unsigned char *>(vlo));
+  uint8x16_t acc_hi = vld1q_u8(reinterpret_cast<const unsigned char *>(vhi));
+  for (size_t i = 0; i < last; i++, src += stride) {
+    UpdateBoundsNEON(vld1q_u8(src), &acc_lo, &acc_hi, T());
+  }
+
+  vst1q_u8(reinterpret_cast<unsigned char *>(vlo), acc_lo);
+  vst1q_u8(reinterpret_cast<unsigned char *>(vhi), acc_hi);
+  MergeBoundsLanes(lo, hi, vlo, vhi, 0, static_cast<size_t>(n), n);
+  return last;
+}
+
+template <typename T, int N>
+static size_t UpdateBoundsPackedSIMD(T *lo, T *hi, const unsigned char *src,
+                                     size_t count) {
+  return UpdateBoundsPackedNEON<T, N>(lo, hi, src, count);
+}
+
+template <typename T>
+static size_t UpdateBoundsStridedSIMD(T *lo, T *hi, const unsigned char *src,
+                                      size_t count, size_t stride, int n) {
+  return UpdateBoundsStridedNEON<T>(lo, hi, src, count, stride, n);
+}
+
+#endif
+
+// SIMD bounds of the component types which have SIMD min/max.
+template <typename T>
+struct BoundsUpdater {
+  static size_t Packed(T *, T *, const unsigned char *, size_t, int) {
+    return 0;
+  }
+  static size_t Strided(T *, T *, const unsigned char *, size_t, size_t,
+                        int) {
+    return 0;
+  }
+};
+
+#if defined(TINYGLTF_SIMD_X86) || defined(TINYGLTF_SIMD_NEON)
+#define TINYGLTF_BOUNDS_UPDATER(ctype)                                       \
+  template <>                                                                \
+  struct BoundsUpdater<ctype> {                                              \
+    static size_t Packed(ctype *lo, ctype *hi, const unsigned char *src,     \
+                         size_t count, int n) {                              \
+      switch (n) {                                                           \
+        case 1:                                                              \
+          return UpdateBoundsPackedSIMD<ctype, 1>(lo, hi, src, count);       \
+        case 2:                                                              \
+          return UpdateBoundsPackedSIMD<ctype, 2>(lo, hi, src, count);       \
+        case 3:                                                              \
+          return UpdateBoundsPackedSIMD<ctype, 3>(lo, hi, src, count);       \
+        case 4:                                                              \
+          return UpdateBoundsPackedSIMD<ctype, 4>(lo, hi, src, count);       \
+        default:                                                             \
+          return 0;                                                          \
+      }                                                                      \
+    }                                                                        \
+    static size_t Strided(ctype *lo, ctype *hi, const unsigned char *src,    \
+                          size_t count, size_t stride, int n) {              \
+      return UpdateBoundsStridedSIMD<ctype>(lo, hi, src, count, stride, n);  \
+    }                                                                        \
+  };
+
+TINYGLTF_BOUNDS_UPDATER(signed char)
+TINYGLTF_BOUNDS_UPDATER(unsigned char)
+TINYGLTF_BOUNDS_UPDATER(short)
+TINYGLTF_BOUNDS_UPDATER(unsigned short)
+TINYGLTF_BOUNDS_UPDATER(int)
+TINYGLTF_BOUNDS_UPDATER(unsigned int)
+TINYGLTF_BOUNDS_UPDATER(float)
+#if defined(TINYGLTF_SIMD_X86)
+TINYGLTF_BOUNDS_UPDATER(double)
+#endif
+
+#undef TINYGLTF_BOUNDS_UPDATER
+#endif
+
+// Updates the running `lo` and `hi` of the `n` components with `count`
+// elements `stride` bytes apart.
+template <typename T>
+static void UpdateBounds(T *lo, T *hi, const unsigned char *src, size_t count,
+                         size_t stride, int n) {
+  size_t i = 0;
+  if (stride == static_cast<size_t>(n) * sizeof(T)) {
+    i = BoundsUpdater<T>::Packed(lo, hi, src, count, n);
+  } else if (stride >= static_cast<size_t>(n) * sizeof(T) &&
+             (static_cast<size_t>(n) * sizeof(T) <= 16)) {
+    i = BoundsUpdater<T>::Strided(lo, hi, src, count, stride, n);
+  }
+  UpdateBoundsScalar(lo, hi, src + i * stride, count - i, stride, n);
+}
+
+// Elements per task of ComputeAccessorBounds.
+static const size_t kBoundsTaskSize = 64 * 1024;
+
+// Shared by the tasks of ComputeAccessorBounds.
+template <typename T>
+struct BoundsJob {
+  const AccessorReader *reader;
+  std::vector<T> lo;  // `NumComponents()` per task.
+  std::vector<T> hi;
+};
+
+template <typename T>
+static void RunBoundsTask(void *task_data, size_t index) {
+  BoundsJob<T> *job = static_cast<BoundsJob<T> *>(task_data);
+  const AccessorReader &reader = *job->reader;
+  size_t n = static_cast<size_t>(reader.NumComponents());
+  size_t first = index * kBoundsTaskSize;
+  size_t count = std::min(kBoundsTaskSize, reader.Count() - first);
+  UpdateBounds(&job->lo.at(index * n), &job->hi.at(index * n),
+               reader.Data() + first * reader.ByteStride(), count,
+               reader.ByteStride(), reader.NumComponents());
+}
+
+template <typename T>
+static void ComputeBounds(std::vector<double> *min_values,
+                          std::vector<double> *max_values,
+                          const AccessorReader &reader, int num_threads,
+                          TaskExecutor executor, void *user_ptr) {
+  size_t n = static_cast<size_t>(reader.NumComponents());
+  size_t tasks = (reader.Count() + kBoundsTaskSize - 1) / kBoundsTaskSize;
+  BoundsJob<T> job;
+  job.reader = &reader;
+  job.lo.resize(tasks * n, BoundsMinStart<T>());
+  job.hi.resize(tasks * n, BoundsMaxStart<T>());
+#ifdef TINYGLTF_USE_THREADS
+  bool parallel = (executor != NULL) || (num_threads > 1);
+#else
+  bool parallel = (executor != NULL);
+#endif
+  if (parallel && (tasks > 1)) {
+    RunTasks(executor, user_ptr, num_threads, RunBoundsTask<T>, &job, tasks);
+  } else {
+    for (size_t i = 0; i < tasks; i++) {
+      RunBoundsTask<T>(&job, i);
+    }
+  }
+
+  min_values->resize(n);
+  max_values->resize(n);
+  for (size_t c = 0; c < n; c++) {
+    T lo = job.lo[c];
+    T hi = job.hi[c];
+    for (size_t i = 1; i < tasks; i++) {
+      lo = (job.lo[i * n + c] < lo) ? job.lo[i * n + c] : lo;
+      hi = (job.hi[i * n + c] > hi) ? job.hi[i * n + c] : hi;
+    }
+    (*min_values)[c] = static_cast<double>(lo);
+    (*max_values)[c] = static_cast<double>(hi);
+  }
+}
+
+void ComputeAccessorBounds(std::vector<double> *min_values,
+                           std::vector<double> *max_values,
+                           const AccessorReader &reader, int num_threads,
+                           TaskExecutor executor, void *user_ptr) {
+  min_values->clear();
+  max_values->clear();
+  if (!reader.Data() || (reader.Count() == 0)) {
+    return;
+  }
+
+  switch (reader.ComponentType()) {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+      ComputeBounds<signed char>(min_values, max_values, reader, num_threads,
+                                 executor, user_ptr);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      ComputeBounds<unsigned char>(min_values, max_values, reader,
+                                   num_threads, executor, user_ptr);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+      ComputeBounds<short>(min_values, max_values, reader, num_threads,
+                           executor, user_ptr);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      ComputeBounds<unsigned short>(min_values, max_values, reader,
+                                    num_threads, executor, user_ptr);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_INT:
+      ComputeBounds<int>(min_values, max_values, reader, num_threads,
+                         executor, user_ptr);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+      ComputeBounds<unsigned int>(min_values, max_values, reader, num_threads,
+                                  executor, user_ptr);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+      ComputeBounds<float>(min_values, max_values, reader, num_threads,
+                           executor, user_ptr);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_DOUBLE:
+      ComputeBounds<double>(min_values, max_values, reader, num_threads,
+                            executor, user_ptr);
+      break;
+    default:
+      break;
+  }
+}
+
+// Relative tolerance of supplied bounds of float components, which exporters
+// often print with fewer digits than a float has.
+static const double kBoundsTolerance = 1e-5;
+
+template <typename A>
+static bool BoundsMatch(const A &supplied, const std::vector<double> &computed,
+                        bool exact) {
+  if (supplied.size() != computed.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < computed.size(); i++) {
+    double d = fabs(supplied[i] - computed[i]);
+    if (exact ? (d != 0.0)
+              : !(d <= kBoundsTolerance * std::max(1.0, fabs(computed[i])))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Shared by the tasks of UpdateAccessorBounds.
+typedef struct {
+  const Scene *scene;
+  std::vector<const Accessor *> accessors;
+  std::vector<std::string> errs;
+  std::vector<char> rets;
+  std::vector<std::vector<double> > mins;
+  std::vector<std::vector<double> > maxs;
+} AccessorBoundsJob;
+
+static void RunAccessorBoundsTask(void *task_data, size_t index) {
+  AccessorBoundsJob *job = static_cast<AccessorBoundsJob *>(task_data);
+  AccessorReader reader;
+  if (!reader.Init(*job->scene, *job->accessors[index], &job->errs[index])) {
+    return;
+  }
+  ComputeAccessorBounds(&job->mins[index], &job->maxs[index], reader);
+  job->rets[index] = 1;
+}
+
+bool UpdateAccessorBounds(Scene *scene, std::string *err, AccessorBounds mode,
+                          int num_threads, TaskExecutor executor,
+                          void *user_ptr) {
+  if (mode == BOUNDS_KEEP) {
+    return true;
+  }
+
+  std::vector<Accessor *> accessors;
+  std::vector<const std::string *> ids;
+  for (SceneMap<Accessor>::type::iterator it = scene->accessors.begin();
+       it != scene->accessors.end(); it++) {
+    const Accessor &accessor = it->second;
+    bool supplied =
+        !accessor.minValues.empty() || !accessor.maxValues.empty();
+    if ((mode == BOUNDS_FILL_MISSING) && supplied) {
+      continue;
+    }
+    accessors.push_back(&it->second);
+    ids.push_back(&it->first);
+  }
+
+  // Computed into plain vectors on the tasks, and assigned to `Scene` on the
+  // calling thread, which owns the arena(with TINYGLTF_USE_ARENA).
+  size_t count = accessors.size();
+  AccessorBoundsJob job;
+  job.scene = scene;
+  job.accessors.assign(accessors.begin(), accessors.end());
+  job.errs.resize(count);
+  job.rets.resize(count, 0);
+  job.mins.resize(count);
+  job.maxs.resize(count);
+  RunTasks(executor, user_ptr, num_threads, RunAccessorBoundsTask, &job,
+           count);
+
+  bool ret = true;
+  for (size_t i = 0; i < count; i++) {
+    Accessor *accessor = accessors[i];
+    if (!job.rets[i]) {
+      if (err) {
+        (*err) += job.errs[i];
+      }
+      ret = false;
+      continue;
+    }
+
+    bool supplied =
+        !accessor->minValues.empty() || !accessor->maxValues.empty();
+    if ((mode == BOUNDS_VERIFY) && supplied) {
+      bool exact = (accessor->componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) &&
+                   (accessor->componentType != TINYGLTF_COMPONENT_TYPE_DOUBLE);
+      if (!BoundsMatch(accessor->minValues, job.mins[i], exact) ||
+          !BoundsMatch(accessor->maxValues, job.maxs[i], exact)) {
+        if (err) {
+          (*err) += "min/max of accessor \"" + *ids[i] +
+                    "\" don't match its data.\n";
+        }
+        ret = false;
+      }
+      continue;
+    }
+
+    accessor->minValues.assign(job.mins[i].begin(), job.mins[i].end());
+    accessor->maxValues.assign(job.maxs[i].begin(), job.maxs[i].end());
+  }
+
+  return ret;
+}
+
+// Fills `ids` of a CompiledSection with the keys of `m` and allocates one
+// item per key. std::map iterates in key order, so `ids` ends up sorted.
+template <typename T, typename M>
+static void CollectIds(CompiledSection<T> *section, const M &m) {
+  section->ids.reserve(m.size());
+  typename M::const_iterator it(m.begin());
+  for (; it != m.end(); it++) {
+    section->ids.push_back(it->first);
+  }
+  section->items.resize(m.size());
+}
+
+// Resolves references by string id to indices for CompileScene().
+class SceneCompiler {
+ public:
+  SceneCompiler(CompiledScene *compiled, std::string *err)
+      : compiled_(compiled), err_(err), ok_(true) {}
+
+  bool Compile(const Scene &scene);
+
+ private:
+  // Returns the index of `id` in `section`, or -1 if `id` is empty or
+  // missing. A missing id is an error reported with `kind`, and `parent_kind`
+  // and `parent_id` of the referring object.
+  template <typename T>
+  int Resolve(const CompiledSection<T> &section, const std::string &id,
+              const char *kind, const char *parent_kind,
+              const std::string &parent_id) {
+    if (id.empty()) {
+      return -1;
+    }
+    int index = section.Find(id);
+    if (index < 0) {
+      if (err_) {
+        (*err_) += std::string(kind) + " `" + id + "` referenced by " +
+                   parent_kind + " `" + parent_id + "` not found.\n";
+      }
+      ok_ = false;
+    }
+    return index;
+  }
+
+  // `AnimationSampler::input` and `output` name parameters of the animation,
+  // whose values are accessor ids.
+  int ResolveParameter(const Animation &animation, const std::string &name,
+                       const std::string &animation_id) {
+    ParameterMap::const_iterator param = animation.parameters.find(name);
+    if (param == animation.parameters.end()) {
+      if (err_) {
+        (*err_) += "parameter `" + name + "` referenced by animation `" +
+                   animation_id + "` not found.\n";
+      }
+      ok_ = false;
+      return -1;
+    }
+    return Resolve(compiled_->accessors, param->second.string_value,
+                   "accessor", "animation", animation_id);
+  }
+
+  // Finds the joints of `skin` under the skeletons of `node`, by
+  // `Node::jointName`. Requires the nodes to be compiled.
+  void ResolveJoints(std::vector<int> *joints, const Skin &skin,
+                     const Node &node, const std::string &node_id);
+
+  CompiledScene *compiled_;
+  std::string *err_;
+  bool ok_;
+};
+
+void SceneCompiler::ResolveJoints(std::vector<int> *joints, const Skin &skin,
+                                  const Node &node,
+                                  const std::string &node_id) {
+  const CompiledSection<CompiledNode> &nodes = compiled_->nodes;
+  std::map<std::string, int> by_name;
+  std::vector<int> stack;
+  std::vector<char> visited(nodes.size(), 0);
+  // Pushed last to first, so that the first skeleton is searched first.
+  for (size_t k = node.skeletons.size(); k > 0; k--) {
+    int root = Resolve(nodes, node.skeletons[k - 1], "node", "node", node_id);
+    if (root >= 0) {
+      stack.push_back(root);
+    }
+  }
+  while (!stack.empty()) {
+    size_t n = static_cast<size_t>(stack.back());
+    stack.pop_back();
+    if (visited[n]) {
+      continue;
+    }
+    visited[n] = 1;
+    const std::string &name = nodes[n].node->jointName;
+    if (!name.empty()) {
+      // The first one found wins, as in a depth first search.
+      by_name.insert(std::make_pair(name, static_cast<int>(n)));
+    }
+    for (size_t k = nodes[n].children.size(); k > 0; k--) {
+      stack.push_back(nodes[n].children[k - 1]);
+    }
+  }
+
+  joints->resize(skin.jointNames.size());
+  for (size_t k = 0; k < skin.jointNames.size(); k++) {
+    std::map<std::string, int>::const_iterator it =
+        by_name.find(skin.jointNames[k]);
+    (*joints)[k] = (it != by_name.end()) ? it->second : -1;
+    if (it == by_name.end()) {
+      if (err_) {
+        (*err_) += "joint `" + skin.jointNames[k] +
+                   "` not found under the skeletons of node `" + node_id +
+                   "`.\n";
+      }
+      ok_ = false;
+    }
+  }
+}
+
+bool SceneCompiler::Compile(const Scene &scene) {
+  CompiledScene &c = *compiled_;
+
+  CollectIds(&c.accessors, scene.accessors);
+  CollectIds(&c.animations, scene.animations);
+  CollectIds(&c.buffers, scene.buffers);
+  CollectIds(&c.bufferViews, scene.bufferViews);
+  CollectIds(&c.materials, scene.materials);
+  CollectIds(&c.meshes, scene.meshes);
+  CollectIds(&c.nodes, scene.nodes);
+  CollectIds(&c.textures, scene.textures);
+  CollectIds(&c.images, scene.images);
+  CollectIds(&c.shaders, scene.shaders);
+  CollectIds(&c.programs, scene.programs);
+  CollectIds(&c.techniques, scene.techniques);
+  CollectIds(&c.samplers, scene.samplers);
+  CollectIds(&c.skins, scene.skins);
+  CollectIds(&c.scenes, scene.scenes);
+
+  size_t i = 0;
+  for (SceneMap<Buffer>::type::const_iterator it(scene.buffers.begin());
+       it != scene.buffers.end(); it++, i++) {
+    c.buffers.items[i].buffer = &it->second;
+  }
+
+  i = 0;
+  for (SceneMap<BufferView>::type::const_iterator it(
+           scene.bufferViews.begin());
+       it != scene.bufferViews.end(); it++, i++) {
+    CompiledBufferView &view = c.bufferViews.items[i];
+    view.bufferView = &it->second;
+    view.buffer = Resolve(c.buffers, it->second.buffer, "buffer", "bufferView",
+                          it->first);
+    view.pad0 = 0;
+  }
+
+  i = 0;
+  for (SceneMap<Accessor>::type::const_iterator it(
+           scene.accessors.begin());
+       it != scene.accessors.end(); it++, i++) {
+    CompiledAccessor &accessor = c.accessors.items[i];
+    accessor.accessor = &it->second;
+    accessor.bufferView = Resolve(c.bufferViews, it->second.bufferView,
+                                  "bufferView", "accessor", it->first);
+    accessor.pad0 = 0;
+  }
+
+  i = 0;
+  for (SceneMap<Mesh>::type::const_iterator it(scene.meshes.begin());
+       it != scene.meshes.end(); it++, i++) {
+    CompiledMesh &mesh = c.meshes.items[i];
+    mesh.mesh = &it->second;
+    mesh.primitives.resize(it->second.primitives.size());
+    for (size_t p = 0; p < it->second.primitives.size(); p++) {
+      const Primitive &src = it->second.primitives[p];
+      CompiledPrimitive &primitive = mesh.primitives[p];
+      primitive.primitive = &src;
+      primitive.attributes.reserve(src.attributes.size());
+      for (StringMap::const_iterator attrib(
+               src.attributes.begin());
+           attrib != src.attributes.end(); attrib++) {
+        CompiledAttribute attribute;
+        attribute.semantic = &attrib->first;
+        attribute.accessor = Resolve(c.accessors, attrib->second, "accessor",
+                                     "mesh", it->first);
+        attribute.pad0 = 0;
+        primitive.attributes.push_back(attribute);
+      }
+      primitive.material =
+          Resolve(c.materials, src.material, "material", "mesh", it->first);
+      primitive.indices =
+          Resolve(c.accessors, src.indices, "accessor", "mesh", it->first);
+    }
+  }
+
+  i = 0;
+  for (SceneMap<Node>::type::const_iterator it(scene.nodes.begin());
+       it != scene.nodes.end(); it++, i++) {
+    CompiledNode &node = c.nodes.items[i];
+    node.node = &it->second;
+    node.parent = -1;
+    node.skin = -1;
+  }
+  i = 0;
+  for (SceneMap<Node>::type::const_iterator it(scene.nodes.begin());
+       it != scene.nodes.end(); it++, i++) {
+    CompiledNode &node = c.nodes.items[i];
+    node.children.reserve(it->second.children.size());
+    for (size_t k = 0; k < it->second.children.size(); k++) {
+      int child = Resolve(c.nodes, it->second.children[k], "node", "node",
+                          it->first);
+      if (child < 0) {
+        continue;
+      }
+      node.children.push_back(child);
+      // glTF nodes form a tree. Keep the first parent if not.
+      if (c.nodes.items[static_cast<size_t>(child)].parent < 0) {
+        c.nodes.items[static_cast<size_t>(child)].parent = static_cast<int>(i);
+      }
+    }
+    node.meshes.reserve(it->second.meshes.size());
+    for (size_t k = 0; k < it->second.meshes.size(); k++) {
+      int mesh =
+          Resolve(c.meshes, it->second.meshes[k], "mesh", "node", it->first);
+      if (mesh >= 0) {
+        node.meshes.push_back(mesh);
+      }
+    }
+  }
+
+  i = 0;
+  for (SceneMap<StringArray>::type::const_iterator it(scene.scenes.begin());
+       it != scene.scenes.end(); it++, i++) {
+    CompiledSceneNodes &nodes = c.scenes.items[i];
+    nodes.nodes.reserve(it->second.size());
+    for (size_t k = 0; k < it->second.size(); k++) {
+      int node = Resolve(c.nodes, it->second[k], "node", "scene", it->first);
+      if (node >= 0) {
+        nodes.nodes.push_back(node);
+      }
+    }
+  }
+  c.defaultScene = c.scenes.Find(scene.defaultScene);
+
+  i = 0;
+  for (SceneMap<Skin>::type::const_iterator it(scene.skins.begin());
+       it != scene.skins.end(); it++, i++) {
+    CompiledSkin &skin = c.skins.items[i];
+    skin.skin = &it->second;
+    skin.inverseBindMatrices = Resolve(c.accessors,
+                                       it->second.inverseBindMatrices,
+                                       "accessor", "skin", it->first);
+    skin.pad0 = 0;
+  }
+
+  i = 0;
+  for (SceneMap<Node>::type::const_iterator it(scene.nodes.begin());
+       it != scene.nodes.end(); it++, i++) {
+    CompiledNode &node = c.nodes.items[i];
+    node.skin = Resolve(c.skins, it->second.skin, "skin", "node", it->first);
+    if (node.skin >= 0) {
+      ResolveJoints(&node.joints,
+                    *c.skins[static_cast<size_t>(node.skin)].skin,
+                    it->second, it->first);
+    }
+  }
+
+  i = 0;
+  for (SceneMap<Shader>::type::const_iterator it(scene.shaders.begin());
+       it != scene.shaders.end(); it++, i++) {
+    c.shaders.items[i].shader = &it->second;
+  }
+
+  i = 0;
+  for (SceneMap<Program>::type::const_iterator it(
+           scene.programs.begin());
+       it != scene.programs.end(); it++, i++) {
+    CompiledProgram &program = c.programs.items[i];
+    program.program = &it->second;
+    program.vertexShader = Resolve(c.shaders, it->second.vertexShader,
+                                   "shader", "program", it->first);
+    program.fragmentShader = Resolve(c.shaders, it->second.fragmentShader,
+                                     "shader", "program", it->first);
+  }
+
+  i = 0;
+  for (SceneMap<Technique>::type::const_iterator it(
+           scene.techniques.begin());
+       it != scene.techniques.end(); it++, i++) {
+    CompiledTechnique &technique = c.techniques.items[i];
+    technique.technique = &it->second;
+    technique.program = Resolve(c.programs, it->second.program, "program",
+                                "technique", it->first);
+    technique.pad0 = 0;
+  }
+
+  i = 0;
+  for (SceneMap<Material>::type::const_iterator it(
+           scene.materials.begin());
+       it != scene.materials.end(); it++, i++) {
+    CompiledMaterial &material = c.materials.items[i];
+    material.material = &it->second;
+    material.technique = Resolve(c.techniques, it->second.technique,
+                                 "technique", "material", it->first);
+    material.pad0 = 0;
+  }
+
+  i = 0;
+  for (SceneMap<Sampler>::type::const_iterator it(
+           scene.samplers.begin());
+       it != scene.samplers.end(); it++, i++) {
+    c.samplers.items[i].sampler = &it->second;
+  }
+
+  i = 0;
+  for (SceneMap<Image>::type::const_iterator it(scene.images.begin());
+       it != scene.images.end(); it++, i++) {
+    CompiledImage &image = c.images.items[i];
+    image.image = &it->second;
+    image.bufferView = Resolve(c.bufferViews, it->second.bufferView,
+                               "bufferView", "image", it->first);
+    image.pad0 = 0;
+  }
+
+  i = 0;
+  for (SceneMap<Texture>::type::const_iterator it(
+           scene.textures.begin());
+       it != scene.textures.end(); it++, i++) {
+    CompiledTexture &texture = c.textures.items[i];
+    texture.texture = &it->second;
+    texture.sampler = Resolve(c.samplers, it->second.sampler, "sampler",
+                              "texture", it->first);
+    texture.source =
+        Resolve(c.images, it->second.source, "image", "texture", it->first);
+  }
+
+  i = 0;
+  for (SceneMap<Animation>::type::const_iterator it(
+           scene.animations.begin());
+       it != scene.animations.end(); it++, i++) {
+    const Animation &src = it->second;
+    CompiledAnimation &animation = c.animations.items[i];
+    animation.animation = &src;
+
+    // Samplers are local to the animation. Their ids are the keys of
+    // `src.samplers`, in the same order as `animation.samplers`.
+    CompiledSection<CompiledAnimationSampler> samplers;
+    CollectIds(&samplers, src.samplers);
+    size_t s = 0;
+    for (SceneMap<AnimationSampler>::type::const_iterator sampler(
+             src.samplers.begin());
+         sampler != src.samplers.end(); sampler++, s++) {
+      CompiledAnimationSampler &dst = samplers.items[s];
+      dst.sampler = &sampler->second;
+      dst.input = ResolveParameter(src, sampler->second.input, it->first);
+      dst.output = ResolveParameter(src, sampler->second.output, it->first);
+    }
+    animation.samplers.swap(samplers.items);
+
+    animation.channels.resize(src.channels.size());
+    for (size_t k = 0; k < src.channels.size(); k++) {
+      CompiledAnimationChannel &channel = animation.channels[k];
+      channel.channel = &src.channels[k];
+      channel.sampler = Resolve(samplers, src.channels[k].sampler, "sampler",
+                                "animation", it->first);
+      channel.node = Resolve(c.nodes, src.channels[k].target_id, "node",
+                             "animation", it->first);
+    }
+  }
+
+  return ok_;
+}
+
+bool CompileScene(CompiledScene *compiled, std::string *err,
+                  const Scene &scene) {
+  *compiled = CompiledScene();
+  SceneCompiler compiler(compiled, err);
+  return compiler.Compile(scene);
+}
+
+// Flags of TransformHierarchy::flags_.
+enum TransformFlags {
+  TRANSFORM_TRS = 0x01,      // The local matrix is composed from TRS.
+  TRANSFORM_CHANGED = 0x02   // In `changed_`.
+};
+
+// Composes a column major matrix from translation, rotation(x, y, z, w) and
+// scale: T * R * S.
+static void ComposeMatrix(float *m, const float *t, const float *r,
+                          const float *s) {
+  float x = r[0], y = r[1], z = r[2], w = r[3];
+  m[0] = (1.0f - 2.0f * (y * y + z * z)) * s[0];
+  m[1] = 2.0f * (x * y + z * w) * s[0];
+  m[2] = 2.0f * (x * z - y * w) * s[0];
+  m[3] = 0.0f;
+  m[4] = 2.0f * (x * y - z * w) * s[1];
+  m[5] = (1.0f - 2.0f * (x * x + z * z)) * s[1];
+  m[6] = 2.0f * (y * z + x * w) * s[1];
+  m[7] = 0.0f;
+  m[8] = 2.0f * (x * z + y * w) * s[2];
+  m[9] = 2.0f * (y * z - x * w) * s[2];
+  m[10] = (1.0f - 2.0f * (x * x + y * y)) * s[2];
+  m[11] = 0.0f;
+  m[12] = t[0];
+  m[13] = t[1];
+  m[14] = t[2];
+  m[15] = 1.0f;
+}
+
+// Inverse of ComposeMatrix for matrices without shear. A negative
+// determinant is folded into the x scale.
+static void DecomposeMatrix(float *t, float *r, float *s, const float *m) {
+  t[0] = m[12];
+  t[1] = m[13];
+  t[2] = m[14];
+
+  for (int c = 0; c < 3; c++) {
+    const float *col = m + 4 * c;
+    s[c] = std::sqrt(col[0] * col[0] + col[1] * col[1] + col[2] * col[2]);
+  }
+  float det = m[0] * (m[5] * m[10] - m[9] * m[6]) -
+              m[4] * (m[1] * m[10] - m[9] * m[2]) +
+              m[8] * (m[1] * m[6] - m[5] * m[2]);
+  if (det < 0.0f) {
+    s[0] = -s[0];
+  }
+
+  // Rotation matrix, rows by columns.
+  float a[3][3];
+  for (int c = 0; c < 3; c++) {
+    float inv = (s[c] != 0.0f) ? 1.0f / s[c] : 0.0f;
+    for (int row = 0; row < 3; row++) {
+      a[row][c] = m[4 * c + row] * inv;
+    }
+  }
+
+  float trace = a[0][0] + a[1][1] + a[2][2];
+  if (trace > 0.0f) {
+    float k = 0.5f / std::sqrt(trace + 1.0f);
+    r[0] = (a[2][1] - a[1][2]) * k;
+    r[1] = (a[0][2] - a[2][0]) * k;
+    r[2] = (a[1][0] - a[0][1]) * k;
+    r[3] = 0.25f / k;
+  } else if ((a[0][0] > a[1][1]) && (a[0][0] > a[2][2])) {
+    float k = 2.0f * std::sqrt(1.0f + a[0][0] - a[1][1] - a[2][2]);
+    r[0] = 0.25f * k;
+    r[1] = (a[0][1] + a[1][0]) / k;
+    r[2] = (a[0][2] + a[2][0]) / k;
+    r[3] = (a[2][1] - a[1][2]) / k;
+  } else if (a[1][1] > a[2][2]) {
+    float k = 2.0f * std::sqrt(1.0f + a[1][1] - a[0][0] - a[2][2]);
+    r[0] = (a[0][1] + a[1][0]) / k;
+    r[1] = 0.25f * k;
+    r[2] = (a[1][2] + a[2][1]) / k;
+    r[3] = (a[0][2] - a[2][0]) / k;
+  } else {
+    float k = 2.0f * std::sqrt(1.0f + a[2][2] - a[0][0] - a[1][1]);
+    r[0] = (a[0][2] + a[2][0]) / k;
+    r[1] = (a[1][2] + a[2][1]) / k;
+    r[2] = 0.25f * k;
+    r[3] = (a[1][0] - a[0][1]) / k;
+  }
+}
+
+// out = a * b, column major. `out` may not alias `a` or `b`.
+static inline void MultiplyMatrixScalar(float *out, const float *a,
+                                        const float *b) {
+  for (int c = 0; c < 4; c++) {
+    for (int row = 0; row < 4; row++) {
+      out[4 * c + row] =
+          a[row] * b[4 * c] + a[4 + row] * b[4 * c + 1] +
+          a[8 + row] * b[4 * c + 2] + a[12 + row] * b[4 * c + 3];
+    }
+  }
+}
+
+// The kernels compute the world matrices of positions [first, last) in
+// parents first order: the local matrix for a root, otherwise the world
+// matrix of the parent times the local matrix.
+
+static void ComputeWorldMatricesScalar(float *worlds, const float *locals,
+                                       const int *parents, size_t first,
+                                       size_t last) {
+  for (size_t i = first; i < last; i++) {
+    if (parents[i] < 0) {
+      memcpy(worlds + 16 * i, locals + 16 * i, 16 * sizeof(float));
+    } else {
+      MultiplyMatrixScalar(worlds + 16 * i,
+                           worlds + 16 * static_cast<size_t>(parents[i]),
+                           locals + 16 * i);
+    }
+  }
+}
+
+#if defined(TINYGLTF_SIMD_X86)
+
+TINYGLTF_TARGET_SSSE3
+static void ComputeWorldMatricesSSE(float *worlds, const float *locals,
+                                    const int *parents, size_t first,
+                                    size_t last) {
+  for (size_t i = first; i < last; i++) {
+    const float *b = locals + 16 * i;
+    float *out = worlds + 16 * i;
+    if (parents[i] < 0) {
+      memcpy(out, b, 16 * sizeof(float));
+      continue;
+    }
+    const float *a = worlds + 16 * static_cast<size_t>(parents[i]);
+    __m128 a0 = _mm_loadu_ps(a);
+    __m128 a1 = _mm_loadu_ps(a + 4);
+    __m128 a2 = _mm_loadu_ps(a + 8);
+    __m128 a3 = _mm_loadu_ps(a + 12);
+    for (int c = 0; c < 4; c++) {
+      __m128 col = _mm_mul_ps(a0, _mm_set1_ps(b[4 * c]));
+      col = _mm_add_ps(col, _mm_mul_ps(a1, _mm_set1_ps(b[4 * c + 1])));
+      col = _mm_add_ps(col, _mm_mul_ps(a2, _mm_set1_ps(b[4 * c + 2])));
+      col = _mm_add_ps(col, _mm_mul_ps(a3, _mm_set1_ps(b[4 * c + 3])));
+      _mm_storeu_ps(out + 4 * c, col);
+    }
+  }
+}
+
+#elif defined(TINYGLTF_SIMD_NEON)
+
+static void ComputeWorldMatricesNEON(float *worlds, const float *locals,
+                                     const int *parents, size_t first,
+                                     size_t last) {
+  for (size_t i = first; i < last; i++) {
+    const float *b = locals + 16 * i;
+    float *out = worlds + 16 * i;
+    if (parents[i] < 0) {
+      memcpy(out, b, 16 * sizeof(float));
+      continue;
+    }
+    const float *a = worlds + 16 * static_cast<size_t>(parents[i]);
+    float32x4_t a0 = vld1q_f32(a);
+    float32x4_t a1 = vld1q_f32(a + 4);
+    float32x4_t a2 = vld1q_f32(a + 8);
+    float32x4_t a3 = vld1q_f32(a + 12);
+    for (int c = 0; c < 4; c++) {
+      float32x4_t col = vmulq_n_f32(a0, b[4 * c]);
+      col = vmlaq_n_f32(col, a1, b[4 * c + 1]);
+      col = vmlaq_n_f32(col, a2, b[4 * c + 2]);
+      col = vmlaq_n_f32(col, a3, b[4 * c + 3]);
+      vst1q_f32(out + 4 * c, col);
+    }
+  }
+}
+
+#endif
+
+static void ComputeWorldMatrices(float *worlds, const float *locals,
+                                 const int *parents, size_t first,
+                                 size_t last) {
+#if defined(TINYGLTF_SIMD_X86)
+  if (GetSIMDFeatures() & TINYGLTF_SIMD_SSSE3) {
+    ComputeWorldMatricesSSE(worlds, locals, parents, first, last);
+    return;
+  }
+#elif defined(TINYGLTF_SIMD_NEON)
+  ComputeWorldMatricesNEON(worlds, locals, parents, first, last);
+  return;
+#endif
+  ComputeWorldMatricesScalar(worlds, locals, parents, first, last);
+}
+
+bool TransformHierarchy::Build(const CompiledScene &compiled,
+                               std::string *err) {
+  const std::vector<CompiledNode> &nodes = compiled.nodes.items;
+  size_t n = nodes.size();
+  order_.clear();
+  order_.reserve(n);
+  positions_.assign(n, -1);
+  parents_.assign(n, -1);
+  changed_.clear();
+
+  // Depth first from the roots, following an edge only from the parent kept
+  // by CompileScene. The nodes not reached are on a cycle or below one, and
+  // are then traversed from a node of each cycle.
+  bool ret = true;
+  std::vector<int> stack;
+  std::vector<bool> seen(n, false);
+  for (int pass = 0; pass < 2; pass++) {
+    for (size_t root = 0; root < n; root++) {
+      int start = static_cast<int>(root);
+      if (positions_[root] >= 0) {
+        continue;
+      }
+      if (pass == 0) {
+        if (nodes[root].parent >= 0) {
+          continue;
+        }
+      } else {
+        // Walk up until a node repeats, which is on the cycle. The traversal
+        // from a cycle reaches every node below it, so no walk enters the
+        // nodes of an earlier one, and each node is walked at most once.
+        while (!seen[static_cast<size_t>(start)]) {
+          seen[static_cast<size_t>(start)] = true;
+          start = nodes[static_cast<size_t>(start)].parent;
+        }
+        if (err) {
+          (*err) += "Node `" + compiled.nodes.ids[static_cast<size_t>(start)] +
+                    "` is part of a cycle in the node hierarchy.\n";
+        }
+        ret = false;
+      }
 
-  delete[] str;
+      stack.push_back(start);
+      while (!stack.empty()) {
+        int node = stack.back();
+        stack.pop_back();
+        int pos = static_cast<int>(order_.size());
+        positions_[static_cast<size_t>(node)] = pos;
+        order_.push_back(node);
+        const std::vector<int> &children =
+            nodes[static_cast<size_t>(node)].children;
+        for (size_t k = children.size(); k-- > 0;) {
+          int child = children[k];
+          size_t c = static_cast<size_t>(child);
+          if ((nodes[c].parent == node) && (child != start) &&
+              (positions_[c] < 0)) {
+            // The position of the parent is known when the child is popped.
+            parents_[c] = node;
+            stack.push_back(child);
+          }
+        }
+      }
+    }
+  }
 
-  return s;
-#else
+  // `parents_` held node indices so far.
+  std::vector<int> parents(n, -1);
+  for (size_t pos = 0; pos < n; pos++) {
+    int parent = parents_[static_cast<size_t>(order_[pos])];
+    if (parent >= 0) {
+      parents[pos] = positions_[static_cast<size_t>(parent)];
+    }
+  }
+  parents_.swap(parents);
 
-#if defined(TARGET_OS_IPHONE) || defined(TARGET_IPHONE_SIMULATOR)
-  // no expansion
-  std::string s = filepath;
-#else
-  std::string s;
-  wordexp_t p;
+  subtree_end_.assign(n, 0);
+  for (size_t pos = n; pos-- > 0;) {
+    subtree_end_[pos] = std::max(subtree_end_[pos], static_cast<int>(pos) + 1);
+    if (parents_[pos] >= 0) {
+      int &end = subtree_end_[static_cast<size_t>(parents_[pos])];
+      end = std::max(end, subtree_end_[pos]);
+    }
+  }
 
-  if (filepath.empty()) {
-    return "";
+  translations_.assign(3 * n, 0.0f);
+  rotations_.assign(4 * n, 0.0f);
+  scales_.assign(3 * n, 1.0f);
+  locals_.resize(16 * n);
+  worlds_.resize(16 * n);
+  flags_.assign(n, TRANSFORM_TRS);
+  for (size_t pos = 0; pos < n; pos++) {
+    const Node *node = nodes[static_cast<size_t>(order_[pos])].node;
+    float *t = &translations_[3 * pos];
+    float *r = &rotations_[4 * pos];
+    float *s = &scales_[3 * pos];
+    r[3] = 1.0f;
+    if (node->matrix.size() == 16) {
+      float *m = &locals_[16 * pos];
+      for (size_t i = 0; i < 16; i++) {
+        m[i] = static_cast<float>(node->matrix[i]);
+      }
+      DecomposeMatrix(t, r, s, m);
+      flags_[pos] = 0;
+      continue;
+    }
+    if (node->translation.size() == 3) {
+      for (size_t i = 0; i < 3; i++) {
+        t[i] = static_cast<float>(node->translation[i]);
+      }
+    }
+    if (node->rotation.size() == 4) {
+      for (size_t i = 0; i < 4; i++) {
+        r[i] = static_cast<float>(node->rotation[i]);
+      }
+    }
+    if (node->scale.size() == 3) {
+      for (size_t i = 0; i < 3; i++) {
+        s[i] = static_cast<float>(node->scale[i]);
+      }
+    }
+    ComposeMatrix(&locals_[16 * pos], t, r, s);
   }
 
-  // char** w;
-  int ret = wordexp(filepath.c_str(), &p, 0);
-  if (ret) {
-    // err
-    s = filepath;
-    return s;
+  if (n > 0) {
+    ComputeWorldMatrices(&worlds_[0], &locals_[0], &parents_[0], 0, n);
   }
+  return ret;
+}
 
-  // Use first element only.
-  if (p.we_wordv) {
-    s = std::string(p.we_wordv[0]);
-    wordfree(&p);
+int TransformHierarchy::Parent(int node) const {
+  int parent = parents_[static_cast<size_t>(positions_[node])];
+  return (parent < 0) ? -1 : order_[static_cast<size_t>(parent)];
+}
+
+void TransformHierarchy::MarkChanged(size_t pos, bool trs) {
+  if (trs) {
+    flags_[pos] |= TRANSFORM_TRS;
   } else {
-    s = filepath;
+    flags_[pos] &= static_cast<unsigned char>(~TRANSFORM_TRS);
+  }
+  if (!(flags_[pos] & TRANSFORM_CHANGED)) {
+    flags_[pos] |= TRANSFORM_CHANGED;
+    changed_.push_back(static_cast<int>(pos));
   }
+}
 
-#endif
+void TransformHierarchy::SetTranslation(int node, const float translation[3]) {
+  size_t pos = static_cast<size_t>(positions_[static_cast<size_t>(node)]);
+  memcpy(&translations_[3 * pos], translation, 3 * sizeof(float));
+  MarkChanged(pos, true);
+}
 
-  return s;
-#endif
+void TransformHierarchy::SetRotation(int node, const float rotation[4]) {
+  size_t pos = static_cast<size_t>(positions_[static_cast<size_t>(node)]);
+  memcpy(&rotations_[4 * pos], rotation, 4 * sizeof(float));
+  MarkChanged(pos, true);
 }
 
-static std::string JoinPath(const std::string &path0,
-                            const std::string &path1) {
-  if (path0.empty()) {
-    return path1;
-  } else {
-    // check '/'
-    char lastChar = *path0.rbegin();
-    if (lastChar != '/') {
-      return path0 + std::string("/") + path1;
-    } else {
-      return path0 + path1;
-    }
-  }
+void TransformHierarchy::SetScale(int node, const float scale[3]) {
+  size_t pos = static_cast<size_t>(positions_[static_cast<size_t>(node)]);
+  memcpy(&scales_[3 * pos], scale, 3 * sizeof(float));
+  MarkChanged(pos, true);
 }
 
-static std::string FindFile(const std::vector<std::string> &paths,
-                            const std::string &filepath) {
-  for (size_t i = 0; i < paths.size(); i++) {
-    std::string absPath = ExpandFilePath(JoinPath(paths[i], filepath));
-    if (FileExists(absPath)) {
-      return absPath;
+void TransformHierarchy::SetLocalMatrix(int node, const float matrix[16]) {
+  size_t pos = static_cast<size_t>(positions_[static_cast<size_t>(node)]);
+  memcpy(&locals_[16 * pos], matrix, 16 * sizeof(float));
+  DecomposeMatrix(&translations_[3 * pos], &rotations_[4 * pos],
+                  &scales_[3 * pos], matrix);
+  MarkChanged(pos, false);
+}
+
+void TransformHierarchy::Update() {
+  if (changed_.empty()) {
+    return;
+  }
+
+  for (size_t i = 0; i < changed_.size(); i++) {
+    size_t pos = static_cast<size_t>(changed_[i]);
+    if (flags_[pos] & TRANSFORM_TRS) {
+      ComposeMatrix(&locals_[16 * pos], &translations_[3 * pos],
+                    &rotations_[4 * pos], &scales_[3 * pos]);
     }
+    flags_[pos] &= static_cast<unsigned char>(~TRANSFORM_CHANGED);
   }
 
-  return std::string();
+  // Each changed subtree once, skipping those within an updated one.
+  std::sort(changed_.begin(), changed_.end());
+  int end = 0;
+  for (size_t i = 0; i < changed_.size(); i++) {
+    int pos = changed_[i];
+    if (pos < end) {
+      continue;
+    }
+    end = subtree_end_[static_cast<size_t>(pos)];
+    ComputeWorldMatrices(&worlds_[0], &locals_[0], &parents_[0],
+                         static_cast<size_t>(pos), static_cast<size_t>(end));
+  }
+  changed_.clear();
 }
 
-// std::string GetFilePathExtension(const std::string& FileName)
-//{
-//    if(FileName.find_last_of(".") != std::string::npos)
-//        return FileName.substr(FileName.find_last_of(".")+1);
-//    return "";
-//}
+const float *TransformHierarchy::Translation(int node) const {
+  return &translations_[3 * static_cast<size_t>(positions_[node])];
+}
 
-static std::string GetBaseDir(const std::string &filepath) {
-  if (filepath.find_last_of("/\\") != std::string::npos)
-    return filepath.substr(0, filepath.find_last_of("/\\"));
-  return "";
+const float *TransformHierarchy::Rotation(int node) const {
+  return &rotations_[4 * static_cast<size_t>(positions_[node])];
 }
 
-// std::string base64_encode(unsigned char const* , unsigned int len);
-std::string base64_decode(std::string const &s);
+const float *TransformHierarchy::Scale(int node) const {
+  return &scales_[3 * static_cast<size_t>(positions_[node])];
+}
 
-/*
-   base64.cpp and base64.h
+const float *TransformHierarchy::LocalMatrix(int node) const {
+  return &locals_[16 * static_cast<size_t>(positions_[node])];
+}
 
-   Copyright (C) 2004-2008 René Nyffenegger
+const float *TransformHierarchy::WorldMatrix(int node) const {
+  return &worlds_[16 * static_cast<size_t>(positions_[node])];
+}
 
-   This source code is provided 'as-is', without any express or implied
-   warranty. In no event will the author be held liable for any damages
-   arising from the use of this software.
+// Returns the last key of `times[0, count)` at or before `t`(0 if `t` is
+// before the first), starting the search from the previous result `cursor`.
+static size_t SeekKey(const float *times, size_t count, float t,
+                      size_t cursor) {
+  size_t k = std::min(cursor, count - 1);
+  if (t < times[k]) {
+    if ((k > 0) && !(t < times[k - 1])) {
+      return k - 1;
+    }
+    size_t upper =
+        static_cast<size_t>(std::upper_bound(times, times + k, t) - times);
+    return (upper > 0) ? upper - 1 : 0;
+  }
 
-   Permission is granted to anyone to use this software for any purpose,
-   including commercial applications, and to alter it and redistribute it
-   freely, subject to the following restrictions:
+  // Playback moves forward by a few keys at most, usually.
+  for (int step = 0; step < 4; step++) {
+    if ((k + 1 >= count) || (t < times[k + 1])) {
+      return k;
+    }
+    k++;
+  }
+  size_t upper = static_cast<size_t>(
+      std::upper_bound(times + k, times + count, t) - times);
+  return upper - 1;
+}
 
-   1. The origin of this source code must not be misrepresented; you must not
-      claim that you wrote the original source code. If you use this source code
-      in a product, an acknowledgment in the product documentation would be
-      appreciated but is not required.
+// Linear interpolation of `n` 4 float values: out = from + (to - from) * f.
+static void LerpKeysScalar(float *out, const float *from, const float *to,
+                           const float *factors, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    for (size_t c = 0; c < 4; c++) {
+      out[4 * i + c] =
+          from[4 * i + c] + (to[4 * i + c] - from[4 * i + c]) * factors[i];
+    }
+  }
+}
 
-   2. Altered source versions must be plainly marked as such, and must not be
-      misrepresented as being the original source code.
+// Terms of the series in SlerpWeights. With 16, the weights are within 2.3e-6
+// of the exact ones. The error is largest for cos(theta) near 0(rotations
+// half a turn apart), and below 3e-7 for cos(theta) of 0.2 and more.
+static const int kSlerpTerms = 16;
+
+// 1 / (i * (2i + 1)) for the terms of the series in SlerpWeights.
+static const float kSlerpCoefficients[kSlerpTerms] = {
+    0.0f,          1.0f / 3.0f,   1.0f / 10.0f,  1.0f / 21.0f,
+    1.0f / 36.0f,  1.0f / 55.0f,  1.0f / 78.0f,  1.0f / 105.0f,
+    1.0f / 136.0f, 1.0f / 171.0f, 1.0f / 210.0f, 1.0f / 253.0f,
+    1.0f / 300.0f, 1.0f / 351.0f, 1.0f / 406.0f, 1.0f / 465.0f};
+
+// Computes the slerp weights sin((1 - t) * theta) / sin(theta) and
+// sin(t * theta) / sin(theta) for cos(theta) = `d` in [0, 1] without
+// trigonometry, as the series sum of b_i(t) * (d - 1)^i where b_0(t) = t and
+// b_i(t) = b_{i-1}(t) * (t^2 - i^2) / (i * (2i + 1))[Eberly, "A Fast and
+// Accurate Algorithm for Computing SLERP", 2011].
+static inline void SlerpWeights(float *w0, float *w1, float d, float t) {
+  float s = 1.0f - t;
+  float dm1 = d - 1.0f;
+  float term0 = s;
+  float term1 = t;
+  *w0 = s;
+  *w1 = t;
+  for (int i = 1; i < kSlerpTerms; i++) {
+    float k = kSlerpCoefficients[i] * dm1;
+    float ii = static_cast<float>(i * i);
+    term0 *= (s * s - ii) * k;
+    term1 *= (t * t - ii) * k;
+    *w0 += term0;
+    *w1 += term1;
+  }
+}
 
-   3. This notice may not be removed or altered from any source distribution.
+// Spherical interpolation of `n` unit quaternions along the shortest arc.
+static void SlerpKeysScalar(float *out, const float *from, const float *to,
+                            const float *factors, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    const float *a = from + 4 * i;
+    const float *b = to + 4 * i;
+    float d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    float sign = (d < 0.0f) ? -1.0f : 1.0f;
+    float w0, w1;
+    SlerpWeights(&w0, &w1, std::min(d * sign, 1.0f), factors[i]);
+    w1 *= sign;
+    for (size_t c = 0; c < 4; c++) {
+      out[4 * i + c] = a[c] * w0 + b[c] * w1;
+    }
+  }
+}
 
-   René Nyffenegger rene.nyffenegger@adp-gmbh.ch
+#if defined(TINYGLTF_SIMD_X86)
 
-*/
+TINYGLTF_TARGET_SSSE3
+static void LerpKeysSSE(float *out, const float *from, const float *to,
+                        const float *factors, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    __m128 a = _mm_loadu_ps(from + 4 * i);
+    __m128 b = _mm_loadu_ps(to + 4 * i);
+    __m128 f = _mm_set1_ps(factors[i]);
+    _mm_storeu_ps(out + 4 * i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), f)));
+  }
+}
 
-#ifdef __clang__
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wexit-time-destructors"
-#pragma clang diagnostic ignored "-Wglobal-constructors"
-#pragma clang diagnostic ignored "-Wsign-conversion"
-#pragma clang diagnostic ignored "-Wconversion"
-#endif
-static const std::string base64_chars =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-    "abcdefghijklmnopqrstuvwxyz"
-    "0123456789+/";
+// Same as SlerpKeysScalar, 4 quaternions at a time transposed to one vector
+// per component. Returns how many quaternions it processed.
+TINYGLTF_TARGET_SSSE3
+static size_t SlerpKeysSSE(float *out, const float *from, const float *to,
+                           const float *factors, size_t n) {
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+  const __m128 one = _mm_set1_ps(1.0f);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 ax = _mm_loadu_ps(from + 4 * i);
+    __m128 ay = _mm_loadu_ps(from + 4 * i + 4);
+    __m128 az = _mm_loadu_ps(from + 4 * i + 8);
+    __m128 aw = _mm_loadu_ps(from + 4 * i + 12);
+    _MM_TRANSPOSE4_PS(ax, ay, az, aw);
+    __m128 bx = _mm_loadu_ps(to + 4 * i);
+    __m128 by = _mm_loadu_ps(to + 4 * i + 4);
+    __m128 bz = _mm_loadu_ps(to + 4 * i + 8);
+    __m128 bw = _mm_loadu_ps(to + 4 * i + 12);
+    _MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+    __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+                          _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+    // Flip `b` for the shortest arc.
+    __m128 sign = _mm_and_ps(d, sign_mask);
+    d = _mm_xor_ps(d, sign);
+    bx = _mm_xor_ps(bx, sign);
+    by = _mm_xor_ps(by, sign);
+    bz = _mm_xor_ps(bz, sign);
+    bw = _mm_xor_ps(bw, sign);
+    d = _mm_min_ps(d, one);
+
+    // See SlerpWeights.
+    __m128 t = _mm_loadu_ps(factors + i);
+    __m128 s = _mm_sub_ps(one, t);
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 s2 = _mm_mul_ps(s, s);
+    __m128 dm1 = _mm_sub_ps(d, one);
+    __m128 term0 = s;
+    __m128 term1 = t;
+    __m128 w0 = s;
+    __m128 w1 = t;
+    for (int k = 1; k < kSlerpTerms; k++) {
+      __m128 c = _mm_mul_ps(_mm_set1_ps(kSlerpCoefficients[k]), dm1);
+      __m128 kk = _mm_set1_ps(static_cast<float>(k * k));
+      term0 = _mm_mul_ps(term0, _mm_mul_ps(_mm_sub_ps(s2, kk), c));
+      term1 = _mm_mul_ps(term1, _mm_mul_ps(_mm_sub_ps(t2, kk), c));
+      w0 = _mm_add_ps(w0, term0);
+      w1 = _mm_add_ps(w1, term1);
+    }
 
-static inline bool is_base64(unsigned char c) {
-  return (isalnum(c) || (c == '+') || (c == '/'));
+    __m128 qx = _mm_add_ps(_mm_mul_ps(ax, w0), _mm_mul_ps(bx, w1));
+    __m128 qy = _mm_add_ps(_mm_mul_ps(ay, w0), _mm_mul_ps(by, w1));
+    __m128 qz = _mm_add_ps(_mm_mul_ps(az, w0), _mm_mul_ps(bz, w1));
+    __m128 qw = _mm_add_ps(_mm_mul_ps(aw, w0), _mm_mul_ps(bw, w1));
+    _MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+    _mm_storeu_ps(out + 4 * i, qx);
+    _mm_storeu_ps(out + 4 * i + 4, qy);
+    _mm_storeu_ps(out + 4 * i + 8, qz);
+    _mm_storeu_ps(out + 4 * i + 12, qw);
+  }
+  return i;
 }
 
-std::string base64_decode(std::string const &encoded_string) {
-  int in_len = static_cast<int>(encoded_string.size());
-  int i = 0;
-  int j = 0;
-  int in_ = 0;
-  unsigned char char_array_4[4], char_array_3[3];
-  std::string ret;
+static void LerpKeys(float *out, const float *from, const float *to,
+                     const float *factors, size_t n) {
+  if (GetSIMDFeatures() & TINYGLTF_SIMD_SSSE3) {
+    LerpKeysSSE(out, from, to, factors, n);
+    return;
+  }
+  LerpKeysScalar(out, from, to, factors, n);
+}
 
-  while (in_len-- && (encoded_string[in_] != '=') &&
-         is_base64(encoded_string[in_])) {
-    char_array_4[i++] = encoded_string[in_];
-    in_++;
-    if (i == 4) {
-      for (i = 0; i < 4; i++)
-        char_array_4[i] =
-            static_cast<unsigned char>(base64_chars.find(char_array_4[i]));
+static void SlerpKeys(float *out, const float *from, const float *to,
+                      const float *factors, size_t n) {
+  size_t i = 0;
+  if (GetSIMDFeatures() & TINYGLTF_SIMD_SSSE3) {
+    i = SlerpKeysSSE(out, from, to, factors, n);
+  }
+  SlerpKeysScalar(out + 4 * i, from + 4 * i, to + 4 * i, factors + i, n - i);
+}
 
-      char_array_3[0] =
-          (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] =
-          ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+#elif defined(TINYGLTF_SIMD_NEON)
 
-      for (i = 0; (i < 3); i++) ret += char_array_3[i];
-      i = 0;
-    }
+static void LerpKeys(float *out, const float *from, const float *to,
+                     const float *factors, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    float32x4_t a = vld1q_f32(from + 4 * i);
+    float32x4_t b = vld1q_f32(to + 4 * i);
+    vst1q_f32(out + 4 * i, vmlaq_n_f32(a, vsubq_f32(b, a), factors[i]));
   }
+}
 
-  if (i) {
-    for (j = i; j < 4; j++) char_array_4[j] = 0;
+// Same as SlerpKeysScalar, 4 quaternions at a time deinterleaved to one
+// vector per component.
+static void SlerpKeys(float *out, const float *from, const float *to,
+                      const float *factors, size_t n) {
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4x4_t a = vld4q_f32(from + 4 * i);
+    float32x4x4_t b = vld4q_f32(to + 4 * i);
+    float32x4_t d = vmulq_f32(a.val[0], b.val[0]);
+    d = vmlaq_f32(d, a.val[1], b.val[1]);
+    d = vmlaq_f32(d, a.val[2], b.val[2]);
+    d = vmlaq_f32(d, a.val[3], b.val[3]);
+    // Flip `b` for the shortest arc.
+    uint32x4_t negative = vcltq_f32(d, zero);
+    d = vabsq_f32(d);
+    for (int c = 0; c < 4; c++) {
+      b.val[c] = vbslq_f32(negative, vnegq_f32(b.val[c]), b.val[c]);
+    }
+    d = vminq_f32(d, one);
+
+    // See SlerpWeights.
+    float32x4_t t = vld1q_f32(factors + i);
+    float32x4_t s = vsubq_f32(one, t);
+    float32x4_t t2 = vmulq_f32(t, t);
+    float32x4_t s2 = vmulq_f32(s, s);
+    float32x4_t dm1 = vsubq_f32(d, one);
+    float32x4_t term0 = s;
+    float32x4_t term1 = t;
+    float32x4_t w0 = s;
+    float32x4_t w1 = t;
+    for (int k = 1; k < kSlerpTerms; k++) {
+      float32x4_t c = vmulq_n_f32(dm1, kSlerpCoefficients[k]);
+      float32x4_t kk = vdupq_n_f32(static_cast<float>(k * k));
+      term0 = vmulq_f32(term0, vmulq_f32(vsubq_f32(s2, kk), c));
+      term1 = vmulq_f32(term1, vmulq_f32(vsubq_f32(t2, kk), c));
+      w0 = vaddq_f32(w0, term0);
+      w1 = vaddq_f32(w1, term1);
+    }
 
-    for (j = 0; j < 4; j++)
-      char_array_4[j] =
-          static_cast<unsigned char>(base64_chars.find(char_array_4[j]));
+    float32x4x4_t q;
+    for (int c = 0; c < 4; c++) {
+      q.val[c] = vmlaq_f32(vmulq_f32(a.val[c], w0), b.val[c], w1);
+    }
+    vst4q_f32(out + 4 * i, q);
+  }
+  SlerpKeysScalar(out + 4 * i, from + 4 * i, to + 4 * i, factors + i, n - i);
+}
 
-    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-    char_array_3[1] =
-        ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+#else
 
-    for (j = 0; (j < i - 1); j++) ret += char_array_3[j];
-  }
+static void LerpKeys(float *out, const float *from, const float *to,
+                     const float *factors, size_t n) {
+  LerpKeysScalar(out, from, to, factors, n);
+}
 
-  return ret;
+static void SlerpKeys(float *out, const float *from, const float *to,
+                      const float *factors, size_t n) {
+  SlerpKeysScalar(out, from, to, factors, n);
 }
-#ifdef __clang__
-#pragma clang diagnostic pop
+
 #endif
 
-static bool LoadExternalFile(std::vector<unsigned char> *out, std::string *err,
-                             const std::string &filename,
-                             const std::string &basedir, size_t reqBytes,
-                             bool checkSize) {
-  out->clear();
+// Paths of the animation channels evaluated by AnimationState.
+enum AnimationPath {
+  ANIMATION_PATH_TRANSLATION,
+  ANIMATION_PATH_ROTATION,
+  ANIMATION_PATH_SCALE,
+  ANIMATION_PATH_UNKNOWN
+};
 
-  std::vector<std::string> paths;
-  paths.push_back(basedir);
-  paths.push_back(".");
+static AnimationPath GetAnimationPath(const std::string &path) {
+  if (path.compare("translation") == 0) {
+    return ANIMATION_PATH_TRANSLATION;
+  } else if (path.compare("rotation") == 0) {
+    return ANIMATION_PATH_ROTATION;
+  } else if (path.compare("scale") == 0) {
+    return ANIMATION_PATH_SCALE;
+  }
+  return ANIMATION_PATH_UNKNOWN;
+}
 
-  std::string filepath = FindFile(paths, filename);
-  if (filepath.empty()) {
+// Reads the float accessor `index` of `compiled`, expected to be of `type`,
+// into `out` with `out_components` floats per element(padded with 0).
+// Returns the number of elements, or 0 with an error in `err`.
+static size_t ReadAnimationAccessor(std::vector<float> *out, std::string *err,
+                                    const Scene &scene,
+                                    const CompiledScene &compiled, int index,
+                                    int type, size_t out_components,
+                                    const std::string &animation_id) {
+  const std::string &id = compiled.accessors.ids[static_cast<size_t>(index)];
+  AccessorReader reader;
+  if (!reader.Init(scene, *compiled.accessors[static_cast<size_t>(index)]
+                              .accessor,
+                   err)) {
+    return 0;
+  }
+  if ((reader.Type() != type) || (reader.Count() == 0)) {
     if (err) {
-      (*err) += "File not found : " + filename + "\n";
+      (*err) += "accessor `" + id + "` referenced by animation `" +
+                animation_id + "` has an unexpected type or no elements.\n";
     }
-    return false;
+    return 0;
   }
 
-  std::ifstream f(filepath.c_str(), std::ifstream::binary);
-  if (!f) {
-    if (err) {
-      (*err) += "File open error : " + filepath + "\n";
+  size_t n = static_cast<size_t>(reader.NumComponents());
+  std::vector<float> elements(reader.Count() * n);
+  reader.ReadAsFloat(&elements.at(0));
+  size_t first = out->size();
+  out->resize(first + reader.Count() * out_components, 0.0f);
+  for (size_t i = 0; i < reader.Count(); i++) {
+    memcpy(&(*out)[first + i * out_components], &elements[i * n],
+           n * sizeof(float));
+  }
+  return reader.Count();
+}
+
+bool AnimationSet::Build(const Scene &scene, const CompiledScene &compiled,
+                         std::string *err) {
+  translationTracks.clear();
+  rotationTracks.clear();
+  scaleTracks.clear();
+  times.clear();
+  values.clear();
+  durations.assign(compiled.animations.size(), 0.0f);
+
+  // Offsets and counts of the key times read so far, by input accessor.
+  std::map<int, std::pair<size_t, size_t> > inputs;
+  bool ret = true;
+  for (size_t a = 0; a < compiled.animations.size(); a++) {
+    const CompiledAnimation &animation = compiled.animations[a];
+    const std::string &animation_id = compiled.animations.ids[a];
+    for (size_t k = 0; k < animation.channels.size(); k++) {
+      const CompiledAnimationChannel &channel = animation.channels[k];
+      if ((channel.node < 0) || (channel.sampler < 0)) {
+        // Reported by CompileScene.
+        ret = false;
+        continue;
+      }
+      const CompiledAnimationSampler &sampler =
+          animation.samplers[static_cast<size_t>(channel.sampler)];
+      if ((sampler.input < 0) || (sampler.output < 0)) {
+        ret = false;
+        continue;
+      }
+
+      AnimationPath path = GetAnimationPath(channel.channel->target_path);
+      if (path == ANIMATION_PATH_UNKNOWN) {
+        if (err) {
+          (*err) += "Unsupported target path `" +
+                    channel.channel->target_path + "` in animation `" +
+                    animation_id + "`.\n";
+        }
+        ret = false;
+        continue;
+      }
+      const std::string &interpolation = sampler.sampler->interpolation;
+      bool step = (interpolation.compare("STEP") == 0);
+      if (!step && !interpolation.empty() &&
+          (interpolation.compare("LINEAR") != 0)) {
+        if (err) {
+          (*err) += "Unsupported interpolation `" + interpolation +
+                    "` in animation `" + animation_id + "`.\n";
+        }
+        ret = false;
+        continue;
+      }
+
+      std::map<int, std::pair<size_t, size_t> >::iterator input =
+          inputs.find(sampler.input);
+      if (input == inputs.end()) {
+        size_t first = times.size();
+        size_t count =
+            ReadAnimationAccessor(&times, err, scene, compiled, sampler.input,
+                                  TINYGLTF_TYPE_SCALAR, 1, animation_id);
+        for (size_t i = first + 1; i < first + count; i++) {
+          if (times[i] < times[i - 1]) {
+            if (err) {
+              (*err) += "Key times of animation `" + animation_id +
+                        "` are not in increasing order.\n";
+            }
+            count = 0;
+            break;
+          }
+        }
+        input = inputs.insert(std::make_pair(sampler.input,
+                                             std::make_pair(first, count)))
+                    .first;
+      }
+
+      AnimationTrack track;
+      track.times = input->second.first;
+      track.values = values.size() / 4;
+      track.count = ReadAnimationAccessor(
+          &values, err, scene, compiled, sampler.output,
+          (path == ANIMATION_PATH_ROTATION) ? TINYGLTF_TYPE_VEC4
+                                            : TINYGLTF_TYPE_VEC3,
+          4, animation_id);
+      if ((input->second.second == 0) || (track.count == 0)) {
+        values.resize(track.values * 4);
+        ret = false;
+        continue;
+      }
+      if (track.count != input->second.second) {
+        if (err) {
+          (*err) += "Sampler input and output of animation `" + animation_id +
+                    "` have different counts.\n";
+        }
+        values.resize(track.values * 4);
+        ret = false;
+        continue;
+      }
+      track.node = channel.node;
+      track.animation = static_cast<int>(a);
+      track.step = step;
+      memset(track.pad, 0, sizeof(track.pad));
+      durations[a] =
+          std::max(durations[a], times[track.times + track.count - 1]);
+
+      if (path == ANIMATION_PATH_TRANSLATION) {
+        translationTracks.push_back(track);
+      } else if (path == ANIMATION_PATH_ROTATION) {
+        rotationTracks.push_back(track);
+      } else {
+        scaleTracks.push_back(track);
+      }
     }
-    return false;
   }
 
-  f.seekg(0, f.end);
-  size_t sz = static_cast<size_t>(f.tellg());
-  std::vector<unsigned char> buf(sz);
+  return ret;
+}
 
-  f.seekg(0, f.beg);
-  f.read(reinterpret_cast<char *>(&buf.at(0)),
-         static_cast<std::streamsize>(sz));
-  f.close();
+void AnimationState::Init(const AnimationSet *set) {
+  set_ = set;
+  translation_cursors_.assign(set->translationTracks.size(), 0);
+  rotation_cursors_.assign(set->rotationTracks.size(), 0);
+  scale_cursors_.assign(set->scaleTracks.size(), 0);
+}
 
-  if (checkSize) {
-    if (reqBytes == sz) {
-      out->swap(buf);
-      return true;
-    } else {
-      std::stringstream ss;
-      ss << "File size mismatch : " << filepath << ", requestedBytes "
-         << reqBytes << ", but got " << sz << std::endl;
-      if (err) {
-        (*err) += ss.str();
+void AnimationState::GatherKeys(const std::vector<AnimationTrack> &tracks,
+                                std::vector<size_t> *cursors,
+                                const float *times, bool per_animation) {
+  size_t n = tracks.size();
+  from_.resize(4 * n);
+  to_.resize(4 * n);
+  factors_.resize(n);
+  results_.resize(4 * n);
+
+  const float *key_times = set_->times.empty() ? NULL : &set_->times[0];
+  const float *key_values = set_->values.empty() ? NULL : &set_->values[0];
+  for (size_t i = 0; i < n; i++) {
+    const AnimationTrack &track = tracks[i];
+    float t = per_animation ? times[track.animation] : times[0];
+    const float *track_times = key_times + track.times;
+    size_t k = SeekKey(track_times, track.count, t, (*cursors)[i]);
+    (*cursors)[i] = k;
+
+    float f = 0.0f;
+    size_t next = k;
+    if ((k + 1 < track.count) && (t > track_times[k])) {
+      next = k + 1;
+      float span = track_times[next] - track_times[k];
+      f = (span > 0.0f) ? (t - track_times[k]) / span : 1.0f;
+      f = std::min(f, 1.0f);
+      if (track.step) {
+        f = 0.0f;
       }
-      return false;
     }
+    memcpy(&from_[4 * i], key_values + 4 * (track.values + k),
+           4 * sizeof(float));
+    memcpy(&to_[4 * i], key_values + 4 * (track.values + next),
+           4 * sizeof(float));
+    factors_[i] = f;
   }
+}
 
-  out->swap(buf);
-  return true;
+void AnimationState::Evaluate(const float *times, bool per_animation,
+                              TransformHierarchy *transforms) {
+  if (!set_) {
+    return;
+  }
+
+  const std::vector<AnimationTrack> &translations = set_->translationTracks;
+  if (!translations.empty()) {
+    GatherKeys(translations, &translation_cursors_, times, per_animation);
+    LerpKeys(&results_[0], &from_[0], &to_[0], &factors_[0],
+             translations.size());
+    for (size_t i = 0; i < translations.size(); i++) {
+      transforms->SetTranslation(translations[i].node, &results_[4 * i]);
+    }
+  }
+
+  const std::vector<AnimationTrack> &rotations = set_->rotationTracks;
+  if (!rotations.empty()) {
+    GatherKeys(rotations, &rotation_cursors_, times, per_animation);
+    SlerpKeys(&results_[0], &from_[0], &to_[0], &factors_[0],
+              rotations.size());
+    for (size_t i = 0; i < rotations.size(); i++) {
+      transforms->SetRotation(rotations[i].node, &results_[4 * i]);
+    }
+  }
+
+  const std::vector<AnimationTrack> &scales = set_->scaleTracks;
+  if (!scales.empty()) {
+    GatherKeys(scales, &scale_cursors_, times, per_animation);
+    LerpKeys(&results_[0], &from_[0], &to_[0], &factors_[0], scales.size());
+    for (size_t i = 0; i < scales.size(); i++) {
+      transforms->SetScale(scales[i].node, &results_[4 * i]);
+    }
+  }
 }
 
-static bool LoadImageData(Image *image, std::string *err, int req_width,
-                          int req_height, const unsigned char *bytes,
-                          int size) {
-  int w, h, comp;
-  unsigned char *data = stbi_load_from_memory(bytes, size, &w, &h, &comp, 0);
-  if (!data) {
-    if (err) {
-      (*err) += "Unknown image format.\n";
+void AnimationState::Evaluate(float time, TransformHierarchy *transforms) {
+  Evaluate(&time, false, transforms);
+}
+
+void AnimationState::Evaluate(const float *times,
+                              TransformHierarchy *transforms) {
+  Evaluate(times, true, transforms);
+}
+
+// Keys of an animation sampler being rewritten by CompressAnimations.
+typedef struct {
+  Animation *animation;
+  std::string sampler;  // Id in `animation->samplers`.
+  std::string input;    // Accessors of the keys being replaced.
+  std::string output;
+  std::vector<float> times;
+  std::vector<float> values;  // `components` floats per key.
+  size_t components;
+  AnimationPath path;
+  bool step;
+  char pad[3];
+} KeyframeSampler;
+
+// Path of the channels of `animation` targeting `sampler_id`, or
+// ANIMATION_PATH_UNKNOWN when there's none or they disagree.
+static AnimationPath GetSamplerPath(const Animation &animation,
+                                    const std::string &sampler_id) {
+  AnimationPath path = ANIMATION_PATH_UNKNOWN;
+  bool found = false;
+  for (size_t i = 0; i < animation.channels.size(); i++) {
+    const AnimationChannel &channel = animation.channels[i];
+    if (channel.sampler.compare(sampler_id) != 0) {
+      continue;
     }
-    return false;
+    AnimationPath p = GetAnimationPath(channel.target_path);
+    if (found && (p != path)) {
+      return ANIMATION_PATH_UNKNOWN;
+    }
+    path = p;
+    found = true;
   }
+  return path;
+}
 
-  if (w < 1 || h < 1) {
+// Reads the float accessor referenced by parameter `parameter` of
+// `animation` into `out`, and its id into `id`. Returns the number of
+// elements, or 0 with an error in `err`.
+static size_t ReadKeyframeAccessor(std::vector<float> *out, std::string *id,
+                                   std::string *err, const Scene &scene,
+                                   const Animation &animation,
+                                   const std::string &parameter, int type,
+                                   const std::string &animation_id) {
+  ParameterMap::const_iterator it = animation.parameters.find(parameter);
+  if (it == animation.parameters.end()) {
     if (err) {
-      (*err) += "Unknown image format.\n";
+      (*err) += "Parameter `" + parameter + "` of animation `" +
+                animation_id + "` not found.\n";
     }
-    return false;
+    return 0;
   }
-
-  if (req_width > 0) {
-    if (req_width != w) {
-      if (err) {
-        (*err) += "Image width mismatch.\n";
-      }
-      return false;
+  *id = it->second.string_value;
+  SceneMap<Accessor>::type::const_iterator accessor =
+      scene.accessors.find(*id);
+  if (accessor == scene.accessors.end()) {
+    if (err) {
+      (*err) += "accessor `" + *id + "` referenced by animation `" +
+                animation_id + "` not found.\n";
     }
+    return 0;
   }
 
-  if (req_height > 0) {
-    if (req_height != h) {
-      if (err) {
-        (*err) += "Image height mismatch.\n";
-      }
-      return false;
+  AccessorReader reader;
+  if (!reader.Init(scene, accessor->second, err)) {
+    return 0;
+  }
+  if ((reader.Type() != type) || (reader.Count() == 0)) {
+    if (err) {
+      (*err) += "accessor `" + *id + "` referenced by animation `" +
+                animation_id + "` has an unexpected type or no elements.\n";
     }
+    return 0;
   }
-
-  image->width = w;
-  image->height = h;
-  image->component = comp;
-  image->image.resize(static_cast<size_t>(w * h * comp));
-  std::copy(data, data + w * h * comp, image->image.begin());
-
-  return true;
+  out->resize(reader.Count() * static_cast<size_t>(reader.NumComponents()));
+  reader.ReadAsFloat(&out->at(0));
+  return reader.Count();
 }
 
-static bool IsDataURI(const std::string &in) {
-  std::string header = "data:application/octet-stream;base64,";
-  if (in.find(header) == 0) {
-    return true;
+// Interpolates key values `a` and `b` of `n` components by `f` into `out`.
+static void InterpolateKeyframe(float *out, const float *a, const float *b,
+                                float f, size_t n, AnimationPath path) {
+  if (path == ANIMATION_PATH_ROTATION) {
+    SlerpKeysScalar(out, a, b, &f, 1);
+    return;
   }
-
-  header = "data:image/png;base64,";
-  if (in.find(header) == 0) {
-    return true;
+  for (size_t c = 0; c < n; c++) {
+    out[c] = a[c] + (b[c] - a[c]) * f;
   }
+}
 
-  header = "data:image/jpeg;base64,";
-  if (in.find(header) == 0) {
-    return true;
+// Distance between key values `a` and `b`: the angle between rotations,
+// otherwise the Euclidean distance.
+static double KeyframeError(const float *a, const float *b, size_t n,
+                            AnimationPath path) {
+  if (path == ANIMATION_PATH_ROTATION) {
+    double dot = 0.0, aa = 0.0, bb = 0.0;
+    for (size_t c = 0; c < 4; c++) {
+      dot += static_cast<double>(a[c]) * static_cast<double>(b[c]);
+      aa += static_cast<double>(a[c]) * static_cast<double>(a[c]);
+      bb += static_cast<double>(b[c]) * static_cast<double>(b[c]);
+    }
+    if ((aa <= 0.0) || (bb <= 0.0)) {
+      return (aa == bb) ? 0.0 : 3.14159265358979323846;
+    }
+    double d = std::min(std::fabs(dot) / std::sqrt(aa * bb), 1.0);
+    return 2.0 * std::acos(d);
   }
 
-  header = "data:text/plain;base64,";
-  if (in.find(header) == 0) {
-    return true;
+  double sum = 0.0;
+  for (size_t c = 0; c < n; c++) {
+    double d = static_cast<double>(a[c]) - static_cast<double>(b[c]);
+    sum += d * d;
   }
+  return std::sqrt(sum);
+}
 
-  return false;
+// Samples the keys of `sampler` every 1 / `rate` seconds from the first to
+// the last key time.
+static void ResampleKeyframes(KeyframeSampler *sampler, double rate) {
+  const std::vector<float> &times = sampler->times;
+  size_t n = sampler->components;
+  float first = times.front();
+  float last = times.back();
+  if (!(last > first)) {
+    return;
+  }
+
+  // Samples closer to the last key than a 1000th of a period are dropped.
+  double end = static_cast<double>(last) - 0.001 / rate;
+  size_t steps = static_cast<size_t>(
+      std::floor((static_cast<double>(last) - first) * rate));
+  std::vector<float> new_times;
+  std::vector<float> new_values;
+  new_times.reserve(steps + 2);
+  new_values.reserve((steps + 2) * n);
+  size_t cursor = 0;
+  for (size_t i = 0; i <= steps; i++) {
+    double t = static_cast<double>(first) + static_cast<double>(i) / rate;
+    if ((i > 0) && (t > end)) {
+      break;
+    }
+    float time = static_cast<float>(t);
+    size_t k = SeekKey(&times[0], times.size(), time, cursor);
+    cursor = k;
+    size_t next = std::min(k + 1, times.size() - 1);
+    float span = times[next] - times[k];
+    float f = (span > 0.0f) ? std::min((time - times[k]) / span, 1.0f) : 0.0f;
+    new_times.push_back(time);
+    new_values.resize(new_values.size() + n);
+    InterpolateKeyframe(&new_values[new_values.size() - n],
+                        &sampler->values[k * n], &sampler->values[next * n],
+                        std::max(f, 0.0f), n, sampler->path);
+  }
+  new_times.push_back(last);
+  new_values.insert(new_values.end(), sampler->values.end() - n,
+                    sampler->values.end());
+
+  sampler->times.swap(new_times);
+  sampler->values.swap(new_values);
 }
 
-static bool DecodeDataURI(std::vector<unsigned char> *out,
-                          const std::string &in, size_t reqBytes,
-                          bool checkSize) {
-  std::string header = "data:application/octet-stream;base64,";
-  std::string data;
-  if (in.find(header) == 0) {
-    data = base64_decode(in.substr(header.size()));  // cut mime string.
+// Rounds translations to multiples of `options.translationStep` and the
+// components of rotations to `options.rotationBits` bit fixed point.
+static void QuantizeKeyframes(KeyframeSampler *sampler,
+                              const AnimationCompression &options) {
+  std::vector<float> &values = sampler->values;
+  if ((sampler->path == ANIMATION_PATH_TRANSLATION) &&
+      (options.translationStep > 0.0)) {
+    double step = options.translationStep;
+    for (size_t i = 0; i < values.size(); i++) {
+      values[i] = static_cast<float>(
+          std::floor(static_cast<double>(values[i]) / step + 0.5) * step);
+    }
+  } else if ((sampler->path == ANIMATION_PATH_ROTATION) &&
+             (options.rotationBits > 0)) {
+    double scale = static_cast<double>((1 << (options.rotationBits - 1)) - 1);
+    for (size_t i = 0; i + 4 <= values.size(); i += 4) {
+      double q[4];
+      double length = 0.0;
+      for (size_t c = 0; c < 4; c++) {
+        q[c] = std::floor(static_cast<double>(values[i + c]) * scale + 0.5) /
+               scale;
+        length += q[c] * q[c];
+      }
+      if (length > 0.0) {
+        length = std::sqrt(length);
+        for (size_t c = 0; c < 4; c++) {
+          values[i + c] = static_cast<float>(q[c] / length);
+        }
+      }
+    }
   }
+}
 
-  if (data.empty()) {
-    header = "data:image/jpeg;base64,";
-    if (in.find(header) == 0) {
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
+// Removes the keys of `sampler` which the remaining ones reproduce within
+// `tolerance`. The first and the last keys are always kept.
+static void RemoveRedundantKeyframes(KeyframeSampler *sampler,
+                                     double tolerance) {
+  const std::vector<float> &times = sampler->times;
+  const std::vector<float> &values = sampler->values;
+  size_t count = times.size();
+  size_t n = sampler->components;
+  if (count < 3) {
+    return;
+  }
+
+  std::vector<char> kept(count, 0);
+  kept[0] = 1;
+  kept[count - 1] = 1;
+  if (sampler->step) {
+    // A key repeating the value of the previous one changes nothing.
+    size_t previous = 0;
+    for (size_t i = 1; i + 1 < count; i++) {
+      if (KeyframeError(&values[i * n], &values[previous * n], n,
+                        sampler->path) > tolerance) {
+        kept[i] = 1;
+        previous = i;
+      }
+    }
+  } else {
+    // Ramer-Douglas-Peucker: keep the key of a range farthest from the
+    // interpolation of its ends while that's beyond the tolerance, and
+    // repeat on both halves.
+    std::vector<std::pair<size_t, size_t> > ranges;
+    ranges.push_back(std::make_pair(static_cast<size_t>(0), count - 1));
+    std::vector<float> sample(n);
+    while (!ranges.empty()) {
+      size_t first = ranges.back().first;
+      size_t last = ranges.back().second;
+      ranges.pop_back();
+      float span = times[last] - times[first];
+      double max_error = tolerance;
+      size_t farthest = first;
+      for (size_t i = first + 1; i < last; i++) {
+        float f = (span > 0.0f) ? (times[i] - times[first]) / span : 0.0f;
+        InterpolateKeyframe(&sample[0], &values[first * n], &values[last * n],
+                            f, n, sampler->path);
+        double error =
+            KeyframeError(&sample[0], &values[i * n], n, sampler->path);
+        if (error > max_error) {
+          max_error = error;
+          farthest = i;
+        }
+      }
+      if (farthest != first) {
+        kept[farthest] = 1;
+        ranges.push_back(std::make_pair(first, farthest));
+        ranges.push_back(std::make_pair(farthest, last));
+      }
     }
   }
 
-  if (data.empty()) {
-    header = "data:image/png;base64,";
-    if (in.find(header) == 0) {
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
+  size_t j = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (kept[i]) {
+      sampler->times[j] = times[i];
+      const float *key = &values[i * n];
+      std::copy(key, key + n, &sampler->values[j * n]);
+      j++;
     }
   }
+  sampler->times.resize(j);
+  sampler->values.resize(j * n);
+}
 
-  if (data.empty()) {
-    header = "data:text/plain;base64,";
-    if (in.find(header) == 0) {
-      data = base64_decode(in.substr(header.size()));
-    }
+// Returns `base`, or `base` followed by "_1", "_2", ... if `base` is already
+// a key of `m`.
+template <typename M>
+static std::string UniqueId(const M &m, const std::string &base) {
+  std::string id = base;
+  for (int i = 1; m.find(id) != m.end(); i++) {
+    std::stringstream ss;
+    ss << base << "_" << i;
+    id = ss.str();
   }
+  return id;
+}
 
-  if (data.empty()) {
-    return false;
+// Removes the accessors of `ids` which no mesh, animation or skin of `scene`
+// refers to, and adds their bufferViews to `views`.
+static void RemoveUnusedAccessors(Scene *scene, std::set<std::string> *views,
+                                  const std::set<std::string> &ids) {
+  std::set<std::string> used;
+  for (SceneMap<Mesh>::type::const_iterator it = scene->meshes.begin();
+       it != scene->meshes.end(); it++) {
+    for (size_t i = 0; i < it->second.primitives.size(); i++) {
+      const Primitive &primitive = it->second.primitives[i];
+      used.insert(primitive.indices);
+      for (StringMap::const_iterator attribute =
+               primitive.attributes.begin();
+           attribute != primitive.attributes.end(); attribute++) {
+        used.insert(attribute->second);
+      }
+    }
+  }
+  for (SceneMap<Animation>::type::const_iterator it =
+           scene->animations.begin();
+       it != scene->animations.end(); it++) {
+    for (ParameterMap::const_iterator parameter =
+             it->second.parameters.begin();
+         parameter != it->second.parameters.end(); parameter++) {
+      used.insert(parameter->second.string_value);
+    }
+  }
+  for (SceneMap<Skin>::type::const_iterator it = scene->skins.begin();
+       it != scene->skins.end(); it++) {
+    used.insert(it->second.inverseBindMatrices);
   }
 
-  if (checkSize) {
-    if (data.size() != reqBytes) {
-      return false;
+  for (std::set<std::string>::const_iterator id = ids.begin();
+       id != ids.end(); id++) {
+    SceneMap<Accessor>::type::iterator accessor = scene->accessors.find(*id);
+    if ((accessor != scene->accessors.end()) && (used.count(*id) == 0)) {
+      views->insert(accessor->second.bufferView);
+      scene->accessors.erase(accessor);
     }
-    out->resize(reqBytes);
-  } else {
-    out->resize(data.size());
   }
-  std::copy(data.begin(), data.end(), out->begin());
-  return true;
 }
 
-static void ParseObjectProperty(Value *ret, const picojson::object &o) {
-  tinygltf::Value::Object vo;
-  picojson::object::const_iterator it(o.begin());
-  picojson::object::const_iterator itEnd(o.end());
-
-  for (; it != itEnd; it++) {
-    picojson::value v = it->second;
-
-    if (v.is<bool>()) {
-      vo[it->first] = tinygltf::Value(v.get<bool>());
-    } else if (v.is<double>()) {
-      vo[it->first] = tinygltf::Value(v.get<double>());
-    } else if (v.is<int64_t>()) {
-      vo[it->first] =
-          tinygltf::Value(static_cast<int>(v.get<int64_t>()));  // truncate
-    } else if (v.is<std::string>()) {
-      vo[it->first] = tinygltf::Value(v.get<std::string>());
-    } else if (v.is<picojson::object>()) {
-      tinygltf::Value child_value;
-      ParseObjectProperty(&child_value, v.get<picojson::object>());
+// Removes the bufferViews of `ids` which no accessor, image or shader of
+// `scene` refers to, and adds their buffers to `buffers`.
+static void RemoveUnusedBufferViews(Scene *scene,
+                                    std::set<std::string> *buffers,
+                                    const std::set<std::string> &ids) {
+  std::set<std::string> used;
+  for (SceneMap<Accessor>::type::const_iterator it = scene->accessors.begin();
+       it != scene->accessors.end(); it++) {
+    used.insert(it->second.bufferView);
+  }
+  for (SceneMap<Image>::type::const_iterator it = scene->images.begin();
+       it != scene->images.end(); it++) {
+    used.insert(it->second.bufferView);
+  }
+  for (SceneMap<Shader>::type::const_iterator it = scene->shaders.begin();
+       it != scene->shaders.end(); it++) {
+    const Value &extensions = it->second.extensions;
+    if (extensions.Has("KHR_binary_glTF")) {
+      const Value &binary = extensions.Get("KHR_binary_glTF");
+      if (binary.Has("bufferView")) {
+        used.insert(binary.Get("bufferView").Get<std::string>());
+      }
     }
-    // TODO(syoyo) binary, array
   }
 
-  (*ret) = tinygltf::Value(vo);
+  for (std::set<std::string>::const_iterator id = ids.begin();
+       id != ids.end(); id++) {
+    SceneMap<BufferView>::type::iterator view = scene->bufferViews.find(*id);
+    if ((view != scene->bufferViews.end()) && (used.count(*id) == 0)) {
+      buffers->insert(view->second.buffer);
+      scene->bufferViews.erase(view);
+    }
+  }
 }
 
-static bool ParseExtrasProperty(Value *ret, const picojson::object &o) {
-  picojson::object::const_iterator it = o.find("extras");
-  if (it == o.end()) {
-    return false;
+// Removes the bytes of buffer `id` which no bufferView covers, moving the
+// bufferViews accordingly(their offsets keep the alignment to 16 bytes).
+// Removes the buffer when no bufferView refers to it.
+static void CompactBuffer(Scene *scene, const std::string &id) {
+  SceneMap<Buffer>::type::iterator buffer = scene->buffers.find(id);
+  if (buffer == scene->buffers.end()) {
+    return;
   }
 
-  // FIXME(syoyo) Currently we only support `object` type for extras property.
-  if (!it->second.is<picojson::object>()) {
-    return false;
+  std::vector<std::pair<size_t, BufferView *> > views;
+  for (SceneMap<BufferView>::type::iterator it = scene->bufferViews.begin();
+       it != scene->bufferViews.end(); it++) {
+    if (it->second.buffer.compare(id) == 0) {
+      views.push_back(std::make_pair(it->second.byteOffset, &it->second));
+    }
+  }
+  if (views.empty()) {
+    scene->buffers.erase(buffer);
+    return;
+  }
+  std::sort(views.begin(), views.end());
+
+  // Moves ranges of overlapping bufferViews together.
+  const unsigned char *data = buffer->second.Data();
+  size_t size = buffer->second.Size();
+  std::vector<unsigned char> compacted;
+  std::vector<size_t> offsets(views.size());
+  size_t range_begin = 0;
+  size_t range_end = 0;
+  size_t range_offset = 0;
+  bool moved = false;
+  for (size_t i = 0; i < views.size(); i++) {
+    const BufferView &view = *views[i].second;
+    size_t begin = std::min(view.byteOffset, size);
+    size_t end = begin + std::min(view.byteLength, size - begin);
+    if ((i == 0) || (begin >= range_end)) {
+      range_begin = begin;
+      range_end = end;
+      range_offset = ((compacted.size() + 15) & ~static_cast<size_t>(15)) +
+                     (begin & 15);
+      compacted.resize(range_offset);
+    } else {
+      range_end = std::max(range_end, end);
+    }
+    compacted.resize(range_offset + (range_end - range_begin));
+    memcpy(&compacted[range_offset], data + range_begin,
+           range_end - range_begin);
+    offsets[i] = range_offset + (view.byteOffset - range_begin);
+    moved = moved || (offsets[i] != view.byteOffset);
+  }
+  if (!moved && (compacted.size() == size)) {
+    return;
   }
 
-  ParseObjectProperty(ret, it->second.get<picojson::object>());
-
-  return true;
+  for (size_t i = 0; i < views.size(); i++) {
+    views[i].second->byteOffset = offsets[i];
+  }
+  buffer->second.SetView(SharedStorage(), NULL, 0);
+  buffer->second.data.swap(compacted);
 }
 
-static bool ParseBooleanProperty(bool *ret, std::string *err,
-                                 const picojson::object &o,
-                                 const std::string &property, bool required) {
-  picojson::object::const_iterator it = o.find(property);
-  if (it == o.end()) {
-    if (required) {
-      if (err) {
-        (*err) += "'" + property + "' property is missing.\n";
-      }
+// Reads, resamples, quantizes and simplifies the keys of `sampler_id` of
+// `animation`. `out->animation` is left NULL for a sampler which is not
+// compressed(e.g. of an unknown target path).
+// Returns false and set error string to `err` if there's an error.
+static bool CompressKeyframes(KeyframeSampler *out, std::string *err,
+                              const Scene &scene, Animation *animation,
+                              const std::string &animation_id,
+                              const std::string &sampler_id,
+                              const AnimationCompression &options) {
+  const AnimationSampler &sampler = animation->samplers[sampler_id];
+  out->animation = NULL;
+  memset(out->pad, 0, sizeof(out->pad));
+  out->path = GetSamplerPath(*animation, sampler_id);
+  out->step = (sampler.interpolation.compare("STEP") == 0);
+  if ((out->path == ANIMATION_PATH_UNKNOWN) ||
+      (!out->step && !sampler.interpolation.empty() &&
+       (sampler.interpolation.compare("LINEAR") != 0))) {
+    return true;
+  }
+  out->sampler = sampler_id;
+  out->components = (out->path == ANIMATION_PATH_ROTATION) ? 4 : 3;
+
+  size_t count = ReadKeyframeAccessor(&out->times, &out->input, err, scene,
+                                      *animation, sampler.input,
+                                      TINYGLTF_TYPE_SCALAR, animation_id);
+  size_t value_count = ReadKeyframeAccessor(
+      &out->values, &out->output, err, scene, *animation, sampler.output,
+      (out->path == ANIMATION_PATH_ROTATION) ? TINYGLTF_TYPE_VEC4
+                                             : TINYGLTF_TYPE_VEC3,
+      animation_id);
+  if ((count == 0) || (value_count == 0)) {
+    return false;
+  }
+  if (count != value_count) {
+    if (err) {
+      (*err) += "Sampler input and output of animation `" + animation_id +
+                "` have different counts.\n";
     }
     return false;
   }
-
-  if (!it->second.is<bool>()) {
-    if (required) {
+  for (size_t i = 1; i < count; i++) {
+    if (!(out->times[i] >= out->times[i - 1])) {
       if (err) {
-        (*err) += "'" + property + "' property is not a bool type.\n";
+        (*err) += "Key times of animation `" + animation_id +
+                  "` are not in increasing order.\n";
       }
+      return false;
     }
-    return false;
   }
 
-  if (ret) {
-    (*ret) = it->second.get<bool>();
+  if ((options.sampleRate > 0.0) && !out->step) {
+    ResampleKeyframes(out, options.sampleRate);
   }
-
+  QuantizeKeyframes(out, options);
+  double tolerance = options.scaleTolerance;
+  if (out->path == ANIMATION_PATH_TRANSLATION) {
+    tolerance = options.translationTolerance;
+  } else if (out->path == ANIMATION_PATH_ROTATION) {
+    tolerance = options.rotationTolerance;
+  }
+  if (tolerance > 0.0) {
+    RemoveRedundantKeyframes(out, tolerance);
+  }
+  out->animation = animation;
   return true;
 }
 
-static bool ParseNumberProperty(double *ret, std::string *err,
-                                const picojson::object &o,
-                                const std::string &property, bool required) {
-  picojson::object::const_iterator it = o.find(property);
-  if (it == o.end()) {
-    if (required) {
-      if (err) {
-        (*err) += "'" + property + "' property is missing.\n";
-      }
+// A FLOAT accessor written by CompressAnimations.
+typedef struct {
+  const std::vector<float> *data;
+  std::string id;  // The id of the accessor it replaces, until it's added.
+  int type;
+  int pad0;
+} KeyframeAccessor;
+
+// Points parameter `name` of a sampler in `animation` to accessor `index`.
+// When `name` is taken by another accessor or by a sampler left as
+// is(`reserved`), another parameter of `index` is used, or a new one.
+static void AssignKeyframeParameter(
+    std::string *name, Animation *animation,
+    std::map<std::string, size_t> *assigned,
+    const std::set<std::string> &reserved, size_t index) {
+  std::map<std::string, size_t>::const_iterator it = assigned->find(*name);
+  if ((reserved.count(*name) == 0) &&
+      ((it == assigned->end()) || (it->second == index))) {
+    (*assigned)[*name] = index;
+    return;
+  }
+  for (it = assigned->begin(); it != assigned->end(); it++) {
+    if (it->second == index) {
+      *name = it->first;
+      return;
     }
-    return false;
   }
-
-  if (!it->second.is<double>()) {
-    if (required) {
-      if (err) {
-        (*err) += "'" + property + "' property is not a number type.\n";
-      }
+  std::string base = *name;
+  for (int i = 1;; i++) {
+    std::stringstream ss;
+    ss << base << "_" << i;
+    if ((animation->parameters.find(ss.str()) ==
+         animation->parameters.end()) &&
+        (assigned->find(ss.str()) == assigned->end())) {
+      *name = ss.str();
+      break;
     }
-    return false;
-  }
-
-  if (ret) {
-    (*ret) = it->second.get<double>();
   }
-
-  return true;
+  (*assigned)[*name] = index;
 }
 
-static bool ParseNumberArrayProperty(std::vector<double> *ret, std::string *err,
-                                     const picojson::object &o,
-                                     const std::string &property,
-                                     bool required) {
-  picojson::object::const_iterator it = o.find(property);
-  if (it == o.end()) {
-    if (required) {
-      if (err) {
-        (*err) += "'" + property + "' property is missing.\n";
-      }
+bool CompressAnimations(Scene *scene, std::string *err,
+                        const AnimationCompression &options) {
+  if ((options.rotationBits != 0) &&
+      ((options.rotationBits < 2) || (options.rotationBits > 24))) {
+    if (err) {
+      (*err) += "Invalid rotationBits of AnimationCompression. Must be 0 or "
+                "between 2 and 24.\n";
     }
     return false;
   }
+  if (!(options.sampleRate > 0.0) && !(options.translationStep > 0.0) &&
+      (options.rotationBits == 0) && !(options.translationTolerance > 0.0) &&
+      !(options.rotationTolerance > 0.0) && !(options.scaleTolerance > 0.0)) {
+    return true;
+  }
 
-  if (!it->second.is<picojson::array>()) {
-    if (required) {
-      if (err) {
-        (*err) += "'" + property + "' property is not an array.\n";
+  bool ret = true;
+  std::vector<KeyframeSampler> samplers;
+  for (SceneMap<Animation>::type::iterator it = scene->animations.begin();
+       it != scene->animations.end(); it++) {
+    for (SceneMap<AnimationSampler>::type::const_iterator sampler =
+             it->second.samplers.begin();
+         sampler != it->second.samplers.end(); sampler++) {
+      KeyframeSampler keys;
+      if (!CompressKeyframes(&keys, err, *scene, &it->second, it->first,
+                             sampler->first, options)) {
+        ret = false;
+      } else if (keys.animation) {
+        samplers.push_back(keys);
       }
     }
-    return false;
+  }
+  if (samplers.empty()) {
+    return ret;
   }
 
-  ret->clear();
-  const picojson::array &arr = it->second.get<picojson::array>();
-  for (size_t i = 0; i < arr.size(); i++) {
-    if (!arr[i].is<double>()) {
-      if (required) {
-        if (err) {
-          (*err) += "'" + property + "' property is not a number.\n";
-        }
-      }
-      return false;
+  // New accessors, with key times shared between samplers where equal.
+  std::vector<KeyframeAccessor> accessors;
+  std::vector<std::pair<size_t, size_t> > sampler_accessors;
+  std::map<std::vector<float>, size_t> times;
+  std::set<std::string> replaced;
+  for (size_t i = 0; i < samplers.size(); i++) {
+    const KeyframeSampler &sampler = samplers[i];
+    std::map<std::vector<float>, size_t>::iterator input =
+        times.find(sampler.times);
+    if (input == times.end()) {
+      KeyframeAccessor accessor;
+      accessor.data = &sampler.times;
+      accessor.id = sampler.input;
+      accessor.type = TINYGLTF_TYPE_SCALAR;
+      accessor.pad0 = 0;
+      input = times.insert(std::make_pair(sampler.times, accessors.size()))
+                  .first;
+      accessors.push_back(accessor);
+    }
+    KeyframeAccessor accessor;
+    accessor.data = &sampler.values;
+    accessor.id = sampler.output;
+    accessor.type = (sampler.components == 4) ? TINYGLTF_TYPE_VEC4
+                                              : TINYGLTF_TYPE_VEC3;
+    accessor.pad0 = 0;
+    sampler_accessors.push_back(std::make_pair(input->second,
+                                               accessors.size()));
+    accessors.push_back(accessor);
+    replaced.insert(sampler.input);
+    replaced.insert(sampler.output);
+  }
+
+  // The keys go to the end of the buffer which held the first ones.
+  std::string buffer_id;
+  {
+    const Accessor &accessor = scene->accessors[samplers[0].output];
+    SceneMap<BufferView>::type::const_iterator view =
+        scene->bufferViews.find(accessor.bufferView);
+    if (view != scene->bufferViews.end()) {
+      buffer_id = view->second.buffer;
     }
-    ret->push_back(arr[i].get<double>());
   }
 
-  return true;
-}
+  // Parameters of each animation: names used by samplers left as is are
+  // kept, the others are pointed to the new accessors.
+  std::vector<std::pair<std::pair<Animation *, std::string>, size_t> >
+      parameters;
+  for (size_t begin = 0; begin < samplers.size();) {
+    Animation *animation = samplers[begin].animation;
+    size_t end = begin;
+    while ((end < samplers.size()) && (samplers[end].animation == animation)) {
+      end++;
+    }
 
-static bool ParseStringProperty(
-    std::string *ret, std::string *err, const picojson::object &o,
-    const std::string &property, bool required,
-    const std::string &parent_node = std::string()) {
-  picojson::object::const_iterator it = o.find(property);
-  if (it == o.end()) {
-    if (required) {
-      if (err) {
-        (*err) += "'" + property + "' property is missing";
-        if (parent_node.empty()) {
-          (*err) += ".\n";
-        } else {
-          (*err) += " in `" + parent_node + "'.\n";
-        }
+    std::set<std::string> rewritten;
+    for (size_t i = begin; i < end; i++) {
+      rewritten.insert(samplers[i].sampler);
+    }
+    std::set<std::string> reserved;
+    std::set<std::string> stale;
+    for (SceneMap<AnimationSampler>::type::const_iterator sampler =
+             animation->samplers.begin();
+         sampler != animation->samplers.end(); sampler++) {
+      if (rewritten.count(sampler->first)) {
+        stale.insert(sampler->second.input);
+        stale.insert(sampler->second.output);
+      } else {
+        reserved.insert(sampler->second.input);
+        reserved.insert(sampler->second.output);
       }
     }
-    return false;
-  }
 
-  if (!it->second.is<std::string>()) {
-    if (required) {
-      if (err) {
-        (*err) += "'" + property + "' property is not a string type.\n";
+    std::map<std::string, size_t> assigned;
+    for (size_t i = begin; i < end; i++) {
+      AnimationSampler &sampler = animation->samplers[samplers[i].sampler];
+      AssignKeyframeParameter(&sampler.input, animation, &assigned, reserved,
+                              sampler_accessors[i].first);
+      AssignKeyframeParameter(&sampler.output, animation, &assigned, reserved,
+                              sampler_accessors[i].second);
+    }
+    for (std::set<std::string>::const_iterator name = stale.begin();
+         name != stale.end(); name++) {
+      if ((reserved.count(*name) == 0) && (assigned.count(*name) == 0)) {
+        animation->parameters.erase(*name);
       }
     }
-    return false;
+    for (std::map<std::string, size_t>::const_iterator it = assigned.begin();
+         it != assigned.end(); it++) {
+      Parameter &parameter = animation->parameters[it->first];
+      parameter.string_value.clear();
+      parameter.number_array.clear();
+      parameters.push_back(
+          std::make_pair(std::make_pair(animation, it->first), it->second));
+    }
+    begin = end;
+  }
+
+  // Drops the replaced data before adding the new one, so that the new
+  // accessors may take the ids of the ones they replace.
+  std::set<std::string> views;
+  std::set<std::string> buffers;
+  RemoveUnusedAccessors(scene, &views, replaced);
+  RemoveUnusedBufferViews(scene, &buffers, views);
+  for (std::set<std::string>::const_iterator it = buffers.begin();
+       it != buffers.end(); it++) {
+    CompactBuffer(scene, *it);
+  }
+
+  if (buffer_id.empty()) {
+    buffer_id = UniqueId(scene->buffers, "animations");
+  }
+  Buffer &buffer = scene->buffers[buffer_id];
+  buffer.MakeOwned();
+  std::string view_id = UniqueId(scene->bufferViews, buffer_id + "_keys");
+  BufferView &view = scene->bufferViews[view_id];
+  view.buffer = buffer_id;
+  view.byteOffset = (buffer.data.size() + 15) & ~static_cast<size_t>(15);
+  view.byteLength = 0;
+  view.target = 0;
+  view.pad0 = 0;
+
+  for (size_t i = 0; i < accessors.size(); i++) {
+    KeyframeAccessor &keys = accessors[i];
+    keys.id = UniqueId(scene->accessors, keys.id);
+    Accessor &accessor = scene->accessors[keys.id];
+    accessor.bufferView = view_id;
+    accessor.byteOffset = view.byteLength;
+    accessor.byteStride = 0;
+    accessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+    accessor.pad0 = 0;
+    accessor.type = keys.type;
+    accessor.pad1 = 0;
+
+    const std::vector<float> &data = *keys.data;
+    size_t n = static_cast<size_t>(GetTypeSizeInComponents(keys.type));
+    accessor.count = data.size() / n;
+    accessor.minValues.assign(data.begin(), data.begin() + n);
+    accessor.maxValues.assign(data.begin(), data.begin() + n);
+    for (size_t k = n; k < data.size(); k++) {
+      accessor.minValues[k % n] = std::min(accessor.minValues[k % n],
+                                           static_cast<double>(data[k]));
+      accessor.maxValues[k % n] = std::max(accessor.maxValues[k % n],
+                                           static_cast<double>(data[k]));
+    }
+
+    view.byteLength += data.size() * sizeof(float);
   }
 
-  if (ret) {
-    (*ret) = it->second.get<std::string>();
+  buffer.data.resize(view.byteOffset + view.byteLength);
+  for (size_t i = 0; i < accessors.size(); i++) {
+    const std::vector<float> &data = *accessors[i].data;
+    memcpy(&buffer.data[view.byteOffset +
+                        scene->accessors[accessors[i].id].byteOffset],
+           &data[0], data.size() * sizeof(float));
   }
 
-  return true;
+  for (size_t i = 0; i < parameters.size(); i++) {
+    Animation *animation = parameters[i].first.first;
+    animation->parameters[parameters[i].first.second].string_value =
+        accessors[parameters[i].second].id;
+  }
+
+  return ret;
 }
 
-static bool ParseStringArrayProperty(std::vector<std::string> *ret,
-                                     std::string *err,
-                                     const picojson::object &o,
-                                     const std::string &property,
-                                     bool required) {
-  picojson::object::const_iterator it = o.find(property);
-  if (it == o.end()) {
-    if (required) {
-      if (err) {
-        (*err) += "'" + property + "' property is missing.\n";
-      }
+// Inverse of an affine column major matrix. A singular matrix gives the
+// identity.
+static void InvertAffineMatrix(float *out, const float *m) {
+  // Cofactors of the upper 3x3, rows by columns of the inverse.
+  float a00 = m[5] * m[10] - m[9] * m[6];
+  float a01 = m[8] * m[6] - m[4] * m[10];
+  float a02 = m[4] * m[9] - m[8] * m[5];
+  float a10 = m[9] * m[2] - m[1] * m[10];
+  float a11 = m[0] * m[10] - m[8] * m[2];
+  float a12 = m[8] * m[1] - m[0] * m[9];
+  float a20 = m[1] * m[6] - m[5] * m[2];
+  float a21 = m[4] * m[2] - m[0] * m[6];
+  float a22 = m[0] * m[5] - m[4] * m[1];
+  float det = m[0] * a00 + m[4] * a10 + m[8] * a20;
+  if (det == 0.0f) {
+    static const float kIdentity[16] = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+                                        0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+                                        0.0f, 0.0f, 0.0f, 1.0f};
+    memcpy(out, kIdentity, sizeof(kIdentity));
+    return;
+  }
+  float inv = 1.0f / det;
+  out[0] = a00 * inv;
+  out[1] = a10 * inv;
+  out[2] = a20 * inv;
+  out[3] = 0.0f;
+  out[4] = a01 * inv;
+  out[5] = a11 * inv;
+  out[6] = a21 * inv;
+  out[7] = 0.0f;
+  out[8] = a02 * inv;
+  out[9] = a12 * inv;
+  out[10] = a22 * inv;
+  out[11] = 0.0f;
+  for (int row = 0; row < 3; row++) {
+    out[12 + row] = -(out[row] * m[12] + out[4 + row] * m[13] +
+                      out[8 + row] * m[14]);
+  }
+  out[15] = 1.0f;
+}
+
+bool SkinJoints::Init(const Scene &scene, const CompiledScene &compiled,
+                      int node_index, std::string *err) {
+  joints.clear();
+  bindMatrices.clear();
+  node = -1;
+
+  if ((node_index < 0) ||
+      (static_cast<size_t>(node_index) >= compiled.nodes.size())) {
+    if (err) {
+      (*err) += "Invalid node index for skin joints.\n";
     }
     return false;
   }
-
-  if (!it->second.is<picojson::array>()) {
-    if (required) {
-      if (err) {
-        (*err) += "'" + property + "' property is not an array.\n";
-      }
+  const CompiledNode &compiled_node =
+      compiled.nodes[static_cast<size_t>(node_index)];
+  if (compiled_node.skin < 0) {
+    if (err) {
+      (*err) += "Node has no skin.\n";
     }
     return false;
   }
-
-  ret->clear();
-  const picojson::array &arr = it->second.get<picojson::array>();
-  for (size_t i = 0; i < arr.size(); i++) {
-    if (!arr[i].is<std::string>()) {
-      if (required) {
-        if (err) {
-          (*err) += "'" + property + "' property is not a string.\n";
-        }
-      }
-      return false;
+  const CompiledSkin &skin =
+      compiled.skins[static_cast<size_t>(compiled_node.skin)];
+  if (skin.inverseBindMatrices < 0) {
+    if (err) {
+      (*err) += "Skin has no inverseBindMatrices accessor.\n";
     }
-    ret->push_back(arr[i].get<std::string>());
+    return false;
   }
 
-  return true;
-}
-
-static bool ParseStringMapProperty(std::map<std::string, std::string> *ret,
-                                   std::string *err, const picojson::object &o,
-                                   const std::string &property, bool required) {
-  picojson::object::const_iterator it = o.find(property);
-  if (it == o.end()) {
-    if (required) {
-      if (err) {
-        (*err) += "'" + property + "' property is missing.\n";
-      }
-    }
+  AccessorReader reader;
+  if (!reader.Init(scene,
+                   *compiled.accessors[static_cast<size_t>(
+                                           skin.inverseBindMatrices)]
+                        .accessor,
+                   err)) {
     return false;
   }
-
-  // Make sure we are dealing with an object / dictionary.
-  if (!it->second.is<picojson::object>()) {
-    if (required) {
-      if (err) {
-        (*err) += "'" + property + "' property is not an object.\n";
-      }
+  size_t num_joints = compiled_node.joints.size();
+  if ((reader.Type() != TINYGLTF_TYPE_MAT4) || (reader.Count() < num_joints)) {
+    if (err) {
+      (*err) += "inverseBindMatrices must be a MAT4 accessor with an element "
+                "per joint.\n";
     }
     return false;
   }
 
-  ret->clear();
-  const picojson::object &dict = it->second.get<picojson::object>();
-
-  picojson::object::const_iterator dictIt(dict.begin());
-  picojson::object::const_iterator dictItEnd(dict.end());
-
-  for (; dictIt != dictItEnd; ++dictIt) {
-    // Check that the value is a string.
-    if (!dictIt->second.is<std::string>()) {
-      if (required) {
-        if (err) {
-          (*err) += "'" + property + "' value is not a string.\n";
-        }
-      }
-      return false;
+  std::vector<float> inverse_binds(reader.Count() * 16);
+  if (!inverse_binds.empty()) {
+    reader.ReadAsFloat(&inverse_binds.at(0));
+  }
+  float bind_shape[16] = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+                          0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+  const NumberArray &bind_shape_matrix = skin.skin->bindShapeMatrix;
+  if (bind_shape_matrix.size() == 16) {
+    for (size_t i = 0; i < 16; i++) {
+      bind_shape[i] = static_cast<float>(bind_shape_matrix[i]);
     }
+  }
 
-    // Insert into the list.
-    (*ret)[dictIt->first] = dictIt->second.get<std::string>();
+  joints.assign(compiled_node.joints.begin(), compiled_node.joints.end());
+  bindMatrices.resize(num_joints * 16);
+  for (size_t j = 0; j < num_joints; j++) {
+    MultiplyMatrixScalar(&bindMatrices[16 * j], &inverse_binds[16 * j],
+                         bind_shape);
   }
+  node = node_index;
   return true;
 }
 
-static bool ParseKHRBinaryExtension(const picojson::object &o, std::string *err,
-                                    std::string *buffer_view,
-                                    std::string *mime_type, int *image_width,
-                                    int *image_height) {
-  picojson::object j = o;
+void SkinJoints::ComputeMatrices(std::vector<float> *matrices,
+                                 const TransformHierarchy &hierarchy) const {
+  matrices->resize(joints.size() * 16);
+  if (joints.empty()) {
+    return;
+  }
+  float inverse_world[16];
+  InvertAffineMatrix(inverse_world, hierarchy.WorldMatrix(node));
+  for (size_t j = 0; j < joints.size(); j++) {
+    float *out = &matrices->at(16 * j);
+    if (joints[j] < 0) {
+      static const float kIdentity[16] = {
+          1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+          0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+      memcpy(out, kIdentity, sizeof(kIdentity));
+      continue;
+    }
+    float joint[16];
+    MultiplyMatrixScalar(joint, hierarchy.WorldMatrix(joints[j]),
+                         &bindMatrices[16 * j]);
+    MultiplyMatrixScalar(out, inverse_world, joint);
+  }
+}
 
-  if (j.find("extensions") == j.end()) {
+// Finds attribute `semantic` of `primitive`, which must have `count`
+// elements unless it is the first one read(`*count` is 0), and its
+// dequantization.
+static bool InitSkinAttribute(AccessorReader *reader,
+                              QuantizedAttribute *quantized, size_t *count,
+                              std::string *err, const Scene &scene,
+                              const Primitive &primitive,
+                              const std::string &semantic) {
+  StringMap::const_iterator it = primitive.attributes.find(semantic);
+  if (it == primitive.attributes.end()) {
     if (err) {
-      (*err) += "`extensions' property is missing.\n";
+      (*err) += "Attribute \"" + semantic + "\" not found in the primitive.\n";
     }
     return false;
   }
-
-  if (!(j["extensions"].is<picojson::object>())) {
+  if (!reader->Init(scene, it->second, err) ||
+      !quantized->Init(scene.accessors.find(it->second)->second, err)) {
+    return false;
+  }
+  if ((*count != 0) && (reader->Count() != *count)) {
     if (err) {
-      (*err) += "Invalid `extensions' property.\n";
+      (*err) += "Attribute \"" + semantic +
+                "\" has a different count from the other attributes.\n";
     }
     return false;
   }
+  *count = reader->Count();
+  return true;
+}
 
-  picojson::object ext = j["extensions"].get<picojson::object>();
-
-  if (ext.find("KHR_binary_glTF") == ext.end()) {
+bool SkinnedPrimitive::Init(const Scene &scene, const Primitive &primitive,
+                            std::string *err) {
+  positions.clear();
+  normals.clear();
+  joints.clear();
+  weights.clear();
+  numJoints = 0;
+
+  size_t count = 0;
+  AccessorReader position, normal, joint, weight;
+  QuantizedAttribute quantized[4];
+  if (!InitSkinAttribute(&position, &quantized[0], &count, err, scene,
+                         primitive, "POSITION") ||
+      !InitSkinAttribute(&joint, &quantized[1], &count, err, scene, primitive,
+                         "JOINT") ||
+      !InitSkinAttribute(&weight, &quantized[2], &count, err, scene,
+                         primitive, "WEIGHT")) {
+    return false;
+  }
+  bool has_normals = (primitive.attributes.find("NORMAL") !=
+                      primitive.attributes.end());
+  if (has_normals && !InitSkinAttribute(&normal, &quantized[3], &count, err,
+                                        scene, primitive, "NORMAL")) {
+    return false;
+  }
+  if ((position.NumComponents() != 3) ||
+      (has_normals && (normal.NumComponents() != 3))) {
     if (err) {
-      (*err) +=
-          "`KHR_binary_glTF' property is missing in extension property.\n";
+      (*err) += "POSITION and NORMAL must have 3 components.\n";
     }
     return false;
   }
-
-  if (!(ext["KHR_binary_glTF"].is<picojson::object>())) {
+  size_t n = static_cast<size_t>(joint.NumComponents());
+  if ((n > 4) || (weight.NumComponents() != joint.NumComponents())) {
     if (err) {
-      (*err) += "Invalid `KHR_binary_glTF' property.\n";
+      (*err) += "JOINT and WEIGHT must have the same number of components, "
+                "at most 4.\n";
     }
     return false;
   }
+  if (count == 0) {
+    return true;
+  }
 
-  picojson::object k = ext["KHR_binary_glTF"].get<picojson::object>();
+  std::vector<float> source(count * n);
+  std::vector<float> joint_values(count * n);
+  quantized[1].Dequantize(&joint_values.at(0), joint);
+  if (quantized[2].IsQuantized()) {
+    quantized[2].Dequantize(&source.at(0), weight);
+  } else {
+    weight.ReadAsFloat(&source.at(0), /* normalized */ true);
+  }
+  joints.resize(count * 4, 0);
+  weights.resize(count * 4, 0.0f);
+  for (size_t v = 0; v < count; v++) {
+    for (size_t k = 0; k < n; k++) {
+      float value = joint_values[v * n + k];
+      if (quantized[1].IsQuantized()) {
+        value = std::floor(value + 0.5f);  // Decoded with rounding errors.
+      }
+      if (!(value >= 0.0f) || (value > 65535.0f) ||
+          (value != std::floor(value))) {
+        if (err) {
+          std::stringstream ss;
+          ss << "Invalid joint index " << value << " of vertex " << v
+             << ".\n";
+          (*err) += ss.str();
+        }
+        joints.clear();
+        weights.clear();
+        return false;
+      }
+      unsigned short index = static_cast<unsigned short>(value);
+      joints[4 * v + k] = index;
+      weights[4 * v + k] = source[v * n + k];
+      numJoints = std::max(numJoints, static_cast<size_t>(index) + 1);
+    }
+  }
 
-  if (!ParseStringProperty(buffer_view, err, k, "bufferView", true)) {
-    return false;
+  positions.resize(count * 3);
+  quantized[0].Dequantize(&positions.at(0), position);
+  if (has_normals) {
+    normals.resize(count * 3);
+    if (quantized[3].IsQuantized()) {
+      quantized[3].Dequantize(&normals.at(0), normal);
+    } else {
+      normal.ReadAsFloat(&normals.at(0), /* normalized */ true);
+    }
   }
+  return true;
+}
 
-  if (mime_type) {
-    ParseStringProperty(mime_type, err, k, "mimeType", false);
+// The kernels skin vertices [first, last) of `primitive`: the joint matrices
+// weighted by the vertex are summed, and the position(w = 1) and normal
+// (w = 0) are transformed by the sum. `normals` may be NULL.
+
+static inline void NormalizeVector(float *v) {
+  float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  if (length > 0.0f) {
+    float inv = 1.0f / length;
+    v[0] *= inv;
+    v[1] *= inv;
+    v[2] *= inv;
   }
+}
 
-  if (image_width) {
-    double width = 0.0;
-    if (ParseNumberProperty(&width, err, k, "width", false)) {
-      (*image_width) = static_cast<int>(width);
+static void SkinVerticesScalar(float *positions, float *normals,
+                               const SkinnedPrimitive &primitive,
+                               const float *matrices, size_t first,
+                               size_t last) {
+  for (size_t v = first; v < last; v++) {
+    const unsigned short *joints = &primitive.joints[4 * v];
+    const float *weights = &primitive.weights[4 * v];
+    // Upper 3 rows of the weighted sum, column major.
+    float m[12] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+                   0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (size_t k = 0; k < 4; k++) {
+      const float *joint = matrices + 16 * static_cast<size_t>(joints[k]);
+      for (size_t c = 0; c < 4; c++) {
+        for (size_t row = 0; row < 3; row++) {
+          m[3 * c + row] += joint[4 * c + row] * weights[k];
+        }
+      }
     }
-  }
 
-  if (image_height) {
-    double height = 0.0;
-    if (ParseNumberProperty(&height, err, k, "height", false)) {
-      (*image_height) = static_cast<int>(height);
+    const float *p = &primitive.positions[3 * v];
+    for (size_t row = 0; row < 3; row++) {
+      positions[3 * v + row] =
+          m[row] * p[0] + m[3 + row] * p[1] + m[6 + row] * p[2] + m[9 + row];
+    }
+    if (normals) {
+      const float *n = &primitive.normals[3 * v];
+      for (size_t row = 0; row < 3; row++) {
+        normals[3 * v + row] =
+            m[row] * n[0] + m[3 + row] * n[1] + m[6 + row] * n[2];
+      }
+      NormalizeVector(normals + 3 * v);
     }
   }
-
-  return true;
 }
 
-static bool ParseAsset(Asset *asset, std::string *err,
-                       const picojson::object &o) {
-  ParseStringProperty(&asset->generator, err, o, "generator", false);
-  ParseBooleanProperty(&asset->premultipliedAlpha, err, o, "premultipliedAlpha",
-                       false);
+#if defined(TINYGLTF_SIMD_X86)
 
-  ParseStringProperty(&asset->version, err, o, "version", false);
+// Stores x, y and z of `v` to `out`. With `padded`, the 4th float after them
+// may be overwritten too(by the next vertex of the same range).
+TINYGLTF_TARGET_SSSE3
+static inline void StoreVector3SSE(float *out, __m128 v, bool padded) {
+  if (padded) {
+    _mm_storeu_ps(out, v);
+  } else {
+    float tmp[4];
+    _mm_storeu_ps(tmp, v);
+    out[0] = tmp[0];
+    out[1] = tmp[1];
+    out[2] = tmp[2];
+  }
+}
 
-  picojson::object::const_iterator profile = o.find("profile");
-  if (profile != o.end()) {
-    const picojson::value &v = profile->second;
-    if (v.contains("api") & v.get("api").is<std::string>()) {
-      asset->profile_api = v.get("api").get<std::string>();
+// x, y and z of `v` divided by their length, unless it is 0.
+TINYGLTF_TARGET_SSSE3
+static inline __m128 NormalizeVectorSSE(__m128 v) {
+  const __m128 xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+  v = _mm_and_ps(v, xyz);
+  __m128 sq = _mm_mul_ps(v, v);
+  sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+  sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 0, 3, 2)));
+  __m128 nonzero = _mm_cmpgt_ps(sq, _mm_setzero_ps());
+  return _mm_and_ps(_mm_div_ps(v, _mm_sqrt_ps(sq)), nonzero);
+}
+
+TINYGLTF_TARGET_SSSE3
+static void SkinVerticesSSE(float *positions, float *normals,
+                            const SkinnedPrimitive &primitive,
+                            const float *matrices, size_t first, size_t last) {
+  for (size_t v = first; v < last; v++) {
+    const unsigned short *joints = &primitive.joints[4 * v];
+    const float *weights = &primitive.weights[4 * v];
+    __m128 c0 = _mm_setzero_ps();
+    __m128 c1 = _mm_setzero_ps();
+    __m128 c2 = _mm_setzero_ps();
+    __m128 c3 = _mm_setzero_ps();
+    for (size_t k = 0; k < 4; k++) {
+      const float *joint = matrices + 16 * static_cast<size_t>(joints[k]);
+      __m128 w = _mm_set1_ps(weights[k]);
+      c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_loadu_ps(joint), w));
+      c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_loadu_ps(joint + 4), w));
+      c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_loadu_ps(joint + 8), w));
+      c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_loadu_ps(joint + 12), w));
     }
-    if (v.contains("version") & v.get("version").is<std::string>()) {
-      asset->profile_version = v.get("version").get<std::string>();
+
+    bool padded = (v + 1 < last);
+    const float *p = &primitive.positions[3 * v];
+    __m128 q = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p[0])),
+                   _mm_mul_ps(c1, _mm_set1_ps(p[1]))),
+        _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p[2])), c3));
+    StoreVector3SSE(positions + 3 * v, q, padded);
+    if (normals) {
+      const float *n = &primitive.normals[3 * v];
+      __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(n[0])),
+                                       _mm_mul_ps(c1, _mm_set1_ps(n[1]))),
+                            _mm_mul_ps(c2, _mm_set1_ps(n[2])));
+      StoreVector3SSE(normals + 3 * v, NormalizeVectorSSE(r), padded);
     }
   }
+}
 
-  return true;
+// Same as SkinVerticesSSE with two columns per vector, which halves the
+// work of summing the joint matrices.
+TINYGLTF_TARGET_AVX2
+static void SkinVerticesAVX2(float *positions, float *normals,
+                             const SkinnedPrimitive &primitive,
+                             const float *matrices, size_t first,
+                             size_t last) {
+  for (size_t v = first; v < last; v++) {
+    const unsigned short *joints = &primitive.joints[4 * v];
+    const float *weights = &primitive.weights[4 * v];
+    __m256 c01 = _mm256_setzero_ps();
+    __m256 c23 = _mm256_setzero_ps();
+    for (size_t k = 0; k < 4; k++) {
+      const float *joint = matrices + 16 * static_cast<size_t>(joints[k]);
+      __m256 w = _mm256_set1_ps(weights[k]);
+      c01 = _mm256_add_ps(c01, _mm256_mul_ps(_mm256_loadu_ps(joint), w));
+      c23 = _mm256_add_ps(c23, _mm256_mul_ps(_mm256_loadu_ps(joint + 8), w));
+    }
+
+    bool padded = (v + 1 < last);
+    const float *p = &primitive.positions[3 * v];
+    __m256 s = _mm256_add_ps(
+        _mm256_mul_ps(c01, _mm256_setr_ps(p[0], p[0], p[0], p[0], p[1], p[1],
+                                          p[1], p[1])),
+        _mm256_mul_ps(c23, _mm256_setr_ps(p[2], p[2], p[2], p[2], 1.0f, 1.0f,
+                                          1.0f, 1.0f)));
+    __m128 q = _mm_add_ps(_mm256_castps256_ps128(s),
+                          _mm256_extractf128_ps(s, 1));
+    StoreVector3SSE(positions + 3 * v, q, padded);
+    if (normals) {
+      const float *n = &primitive.normals[3 * v];
+      __m256 t = _mm256_mul_ps(c01, _mm256_setr_ps(n[0], n[0], n[0], n[0],
+                                                   n[1], n[1], n[1], n[1]));
+      __m128 r = _mm_add_ps(
+          _mm_add_ps(_mm256_castps256_ps128(t), _mm256_extractf128_ps(t, 1)),
+          _mm_mul_ps(_mm256_castps256_ps128(c23), _mm_set1_ps(n[2])));
+      StoreVector3SSE(normals + 3 * v, NormalizeVectorSSE(r), padded);
+    }
+  }
 }
 
-static bool ParseImage(Image *image, std::string *err,
-                       const picojson::object &o, const std::string &basedir,
-                       bool is_binary, const unsigned char *bin_data,
-                       size_t bin_size) {
-  std::string uri;
-  if (!ParseStringProperty(&uri, err, o, "uri", true)) {
-    return false;
+static void SkinVerticesRange(float *positions, float *normals,
+                              const SkinnedPrimitive &primitive,
+                              const float *matrices, size_t first,
+                              size_t last) {
+  int features = GetSIMDFeatures();
+  if (features & TINYGLTF_SIMD_AVX2) {
+    SkinVerticesAVX2(positions, normals, primitive, matrices, first, last);
+    return;
+  }
+  if (features & TINYGLTF_SIMD_SSSE3) {
+    SkinVerticesSSE(positions, normals, primitive, matrices, first, last);
+    return;
   }
+  SkinVerticesScalar(positions, normals, primitive, matrices, first, last);
+}
 
-  ParseStringProperty(&image->name, err, o, "name", false);
+#elif defined(TINYGLTF_SIMD_NEON)
 
-  std::vector<unsigned char> img;
+// Stores x, y and z of `v` to `out`. With `padded`, the 4th float after them
+// may be overwritten too(by the next vertex of the same range).
+static inline void StoreVector3NEON(float *out, float32x4_t v, bool padded) {
+  if (padded) {
+    vst1q_f32(out, v);
+  } else {
+    vst1_f32(out, vget_low_f32(v));
+    out[2] = vgetq_lane_f32(v, 2);
+  }
+}
 
-  if (is_binary) {
-    // Still binary glTF accepts external dataURI. First try external resources.
-    bool loaded = false;
-    if (IsDataURI(uri)) {
-      loaded = DecodeDataURI(&img, uri, 0, false);
-    } else {
-      // Assume external .bin file.
-      loaded = LoadExternalFile(&img, err, uri, basedir, 0, false);
+static void SkinVerticesRange(float *positions, float *normals,
+                              const SkinnedPrimitive &primitive,
+                              const float *matrices, size_t first,
+                              size_t last) {
+  for (size_t v = first; v < last; v++) {
+    const unsigned short *joints = &primitive.joints[4 * v];
+    const float *weights = &primitive.weights[4 * v];
+    float32x4_t c0 = vdupq_n_f32(0.0f);
+    float32x4_t c1 = vdupq_n_f32(0.0f);
+    float32x4_t c2 = vdupq_n_f32(0.0f);
+    float32x4_t c3 = vdupq_n_f32(0.0f);
+    for (size_t k = 0; k < 4; k++) {
+      const float *joint = matrices + 16 * static_cast<size_t>(joints[k]);
+      c0 = vmlaq_n_f32(c0, vld1q_f32(joint), weights[k]);
+      c1 = vmlaq_n_f32(c1, vld1q_f32(joint + 4), weights[k]);
+      c2 = vmlaq_n_f32(c2, vld1q_f32(joint + 8), weights[k]);
+      c3 = vmlaq_n_f32(c3, vld1q_f32(joint + 12), weights[k]);
     }
 
-    if (!loaded) {
-      // load data from (embedded) binary data
+    bool padded = (v + 1 < last);
+    const float *p = &primitive.positions[3 * v];
+    float32x4_t q = vmlaq_n_f32(c3, c0, p[0]);
+    q = vmlaq_n_f32(q, c1, p[1]);
+    q = vmlaq_n_f32(q, c2, p[2]);
+    StoreVector3NEON(positions + 3 * v, q, padded);
+    if (normals) {
+      const float *n = &primitive.normals[3 * v];
+      float32x4_t r = vmulq_n_f32(c0, n[0]);
+      r = vmlaq_n_f32(r, c1, n[1]);
+      r = vmlaq_n_f32(r, c2, n[2]);
+      StoreVector3NEON(normals + 3 * v, r, padded);
+      NormalizeVector(normals + 3 * v);
+    }
+  }
+}
 
-      if ((bin_size == 0) || (bin_data == NULL)) {
-        if (err) {
-          (*err) += "Invalid binary data.\n";
-        }
-        return false;
-      }
+#else
 
-      // There should be "extensions" property.
-      // "extensions":{"KHR_binary_glTF":{"bufferView": "id", ...
+static void SkinVerticesRange(float *positions, float *normals,
+                              const SkinnedPrimitive &primitive,
+                              const float *matrices, size_t first,
+                              size_t last) {
+  SkinVerticesScalar(positions, normals, primitive, matrices, first, last);
+}
 
-      std::string buffer_view;
-      std::string mime_type;
-      int image_width;
-      int image_height;
-      bool ret = ParseKHRBinaryExtension(o, err, &buffer_view, &mime_type,
-                                         &image_width, &image_height);
-      if (!ret) {
-        return false;
-      }
+#endif
 
-      if (uri.compare("data:,") == 0) {
-        // ok
-      } else {
-        if (err) {
-          (*err) += "Invalid URI for binary data.\n";
-        }
-        return false;
-      }
+// Vertices per task of SkinVertices.
+static const size_t kSkinTaskSize = 4096;
 
-      // Just only save some information here. Loading actual image data from
-      // bufferView is done in other place.
-      image->bufferView = buffer_view;
-      image->mimeType = mime_type;
-      image->width = image_width;
-      image->height = image_height;
+// Shared by the tasks of SkinVertices.
+typedef struct {
+  float *positions;
+  float *normals;
+  const SkinnedPrimitive *primitive;
+  const float *matrices;
+} SkinJob;
+
+static void RunSkinTask(void *task_data, size_t index) {
+  SkinJob *job = static_cast<SkinJob *>(task_data);
+  size_t first = index * kSkinTaskSize;
+  size_t last =
+      std::min(first + kSkinTaskSize, job->primitive->NumVertices());
+  SkinVerticesRange(job->positions, job->normals, *job->primitive,
+                    job->matrices, first, last);
+}
 
-      return true;
+bool SkinVertices(float *positions, float *normals, std::string *err,
+                  const SkinnedPrimitive &primitive,
+                  const float *joint_matrices, size_t num_joints,
+                  int num_threads, TaskExecutor executor, void *user_ptr) {
+  if (primitive.numJoints > num_joints) {
+    if (err) {
+      std::stringstream ss;
+      ss << "Joint index " << (primitive.numJoints - 1) << " is out of "
+         << num_joints << " joint matrices.\n";
+      (*err) += ss.str();
     }
-  } else {
-    if (IsDataURI(uri)) {
-      if (!DecodeDataURI(&img, uri, 0, false)) {
-        if (err) {
-          (*err) += "Failed to decode 'uri' for image parameter.\n";
-        }
-        return false;
-      }
-    } else {
-      // Assume external file
-      if (!LoadExternalFile(&img, err, uri, basedir, 0, false)) {
-        if (err) {
-          (*err) += "Failed to load external 'uri'. for image parameter\n";
-        }
-        return false;
-      }
-      if (img.empty()) {
-        if (err) {
-          (*err) += "Image is empty.\n";
-        }
-        return false;
-      }
+    return false;
+  }
+  if (normals && primitive.normals.empty() && (primitive.NumVertices() > 0)) {
+    if (err) {
+      (*err) += "The skinned primitive has no normals.\n";
     }
+    return false;
   }
 
-  return LoadImageData(image, err, 0, 0, &img.at(0),
-                       static_cast<int>(img.size()));
+  SkinJob job;
+  job.positions = positions;
+  job.normals = normals;
+  job.primitive = &primitive;
+  job.matrices = joint_matrices;
+  size_t tasks = (primitive.NumVertices() + kSkinTaskSize - 1) / kSkinTaskSize;
+#ifdef TINYGLTF_USE_THREADS
+  bool parallel = (executor != NULL) || (num_threads > 1);
+#else
+  bool parallel = (executor != NULL);
+#endif
+  if (parallel && (tasks > 1)) {
+    RunTasks(executor, user_ptr, num_threads, RunSkinTask, &job, tasks);
+  } else {
+    for (size_t i = 0; i < tasks; i++) {
+      RunSkinTask(&job, i);
+    }
+  }
+  return true;
 }
 
-static bool ParseTexture(Texture *texture, std::string *err,
-                         const picojson::object &o,
-                         const std::string &basedir) {
-  (void)basedir;
+// Number `key` of the object `value`, which may be stored as a double or an
+// int.
+static bool GetValueNumber(double *out, const Value &value,
+                           const std::string &key) {
+  if (!value.IsObject() || !value.Has(key)) {
+    return false;
+  }
+  const Value &number = value.Get(key);
+  if (number.IsNumber()) {
+    *out = number.Get<double>();
+    return true;
+  }
+  if (number.IsInt()) {
+    *out = static_cast<double>(number.Get<int>());
+    return true;
+  }
+  return false;
+}
 
-  if (!ParseStringProperty(&texture->sampler, err, o, "sampler", true)) {
+// Finds the bytes of the "compressedData" of `extension`.
+static bool FindCompressedData(const unsigned char **data, size_t *size,
+                               std::string *view_id, std::string *err,
+                               const Scene &scene, const Value &extension,
+                               const std::string &mesh_id) {
+  double byte_offset = 0.0;
+  double count = 0.0;
+  const Value *compressed = NULL;
+  if (extension.IsObject() && extension.Has("compressedData")) {
+    compressed = &extension.Get("compressedData");
+  }
+  if (!compressed || !compressed->IsObject() ||
+      !compressed->Has("bufferView") ||
+      !compressed->Get("bufferView").IsString() ||
+      !GetValueNumber(&count, *compressed, "count") || (count < 0.0)) {
+    if (err) {
+      (*err) += "Invalid compressedData of mesh `" + mesh_id + "`.\n";
+    }
     return false;
   }
+  GetValueNumber(&byte_offset, *compressed, "byteOffset");
+  *view_id = compressed->Get("bufferView").Get<std::string>();
 
-  if (!ParseStringProperty(&texture->source, err, o, "source", true)) {
+  SceneMap<BufferView>::type::const_iterator view =
+      scene.bufferViews.find(*view_id);
+  if (view == scene.bufferViews.end()) {
+    if (err) {
+      (*err) += "bufferView `" + *view_id + "` referenced by mesh `" +
+                mesh_id + "` not found.\n";
+    }
     return false;
   }
+  SceneMap<Buffer>::type::const_iterator buffer =
+      scene.buffers.find(view->second.buffer);
+  size_t offset = static_cast<size_t>(std::max(byte_offset, 0.0));
+  *size = static_cast<size_t>(count);
+  if ((buffer == scene.buffers.end()) ||
+      (offset + *size > view->second.byteLength) ||
+      (view->second.byteOffset + view->second.byteLength >
+       buffer->second.Size())) {
+    if (err) {
+      (*err) += "compressedData of mesh `" + mesh_id +
+                "` is outside of its buffer.\n";
+    }
+    return false;
+  }
+  *data = buffer->second.Data() + view->second.byteOffset + offset;
+  return true;
+}
 
-  ParseStringProperty(&texture->name, err, o, "name", false);
+// Shared by the tasks of DecodeMeshes.
+typedef struct {
+  std::vector<std::pair<std::string, const Mesh *> > meshes;
+  std::vector<std::vector<DecodedAccessor> > outs;
+  std::vector<std::string> views;  // Of the compressed data.
+  std::vector<std::string> errs;
+  std::vector<char> rets;
+  const Scene *scene;
+  const std::string *extension;
+  MeshDecodeFunc decoder;
+  void *decoder_data;
+} MeshDecodeJob;
+
+static void RunMeshDecodeTask(void *task_data, size_t index) {
+  MeshDecodeJob *job = static_cast<MeshDecodeJob *>(task_data);
+  const std::string &mesh_id = job->meshes[index].first;
+  const Mesh &mesh = *job->meshes[index].second;
+  const Value &extension = mesh.extensions.Get(*job->extension);
+  const unsigned char *data = NULL;
+  size_t size = 0;
+  std::string *err = &job->errs[index];
+  if (!FindCompressedData(&data, &size, &job->views[index], err, *job->scene,
+                          extension, mesh_id)) {
+    return;
+  }
+  if (!job->decoder(&job->outs[index], err, *job->scene, mesh, extension,
+                    data, size, job->decoder_data)) {
+    (*err) += "Failed to decode mesh `" + mesh_id + "`.\n";
+    return;
+  }
+
+  // Checks the sizes here, so that storing them can't fail.
+  const std::vector<DecodedAccessor> &out = job->outs[index];
+  for (size_t i = 0; i < out.size(); i++) {
+    SceneMap<Accessor>::type::const_iterator accessor =
+        job->scene->accessors.find(out[i].accessor);
+    if (accessor == job->scene->accessors.end()) {
+      (*err) += "accessor `" + out[i].accessor + "` decoded from mesh `" +
+                mesh_id + "` not found.\n";
+      return;
+    }
+    size_t element_size =
+        static_cast<size_t>(
+            GetComponentSizeInBytes(accessor->second.componentType)) *
+        static_cast<size_t>(GetTypeSizeInComponents(accessor->second.type));
+    if (out[i].data.size() != accessor->second.count * element_size) {
+      (*err) += "Decoded data of accessor `" + out[i].accessor +
+                "` doesn't match its count and type.\n";
+      return;
+    }
+  }
+  job->rets[index] = 1;
+}
 
-  double format = TINYGLTF_TEXTURE_FORMAT_RGBA;
-  ParseNumberProperty(&format, err, o, "format", false);
+bool DecodeMeshes(Scene *scene, std::string *err, const std::string &extension,
+                  MeshDecodeFunc decoder, void *decoder_data, int num_threads,
+                  TaskExecutor executor, void *user_ptr) {
+  MeshDecodeJob job;
+  for (SceneMap<Mesh>::type::const_iterator it = scene->meshes.begin();
+       it != scene->meshes.end(); it++) {
+    if (it->second.extensions.Has(extension)) {
+      job.meshes.push_back(std::make_pair(it->first, &it->second));
+    }
+  }
+  if (job.meshes.empty()) {
+    return true;
+  }
+  size_t count = job.meshes.size();
+  job.outs.resize(count);
+  job.views.resize(count);
+  job.errs.resize(count);
+  job.rets.resize(count, 0);
+  job.scene = scene;
+  job.extension = &extension;
+  job.decoder = decoder;
+  job.decoder_data = decoder_data;
+  RunTasks(executor, user_ptr, num_threads, RunMeshDecodeTask, &job, count);
+
+  bool ret = true;
+  std::string buffer_id;
+  std::set<std::string> views;
+  for (size_t i = 0; i < count; i++) {
+    if (err) {
+      (*err) += job.errs[i];
+    }
+    if (!job.rets[i]) {
+      ret = false;
+      continue;
+    }
+    const std::string &mesh_id = job.meshes[i].first;
+    const std::vector<DecodedAccessor> &out = job.outs[i];
+    views.insert(job.views[i]);
+    Value &extensions = scene->meshes[mesh_id].extensions;
+    extensions.Get<Value::Object>().erase(extension);
+    if (extensions.Keys().empty()) {
+      Value().Swap(extensions);
+    }
+    if (out.empty()) {
+      continue;
+    }
 
-  double internalFormat = TINYGLTF_TEXTURE_FORMAT_RGBA;
-  ParseNumberProperty(&internalFormat, err, o, "internalFormat", false);
+    if (buffer_id.empty()) {
+      buffer_id = UniqueId(scene->buffers, "decoded");
+    }
+    Buffer &buffer = scene->buffers[buffer_id];
+    std::string view_id = UniqueId(scene->bufferViews, mesh_id + "_decoded");
+    BufferView &view = scene->bufferViews[view_id];
+    view.buffer = buffer_id;
+    view.byteOffset = (buffer.data.size() + 15) & ~static_cast<size_t>(15);
+    view.byteLength = 0;
+    view.target = 0;
+    view.pad0 = 0;
+    for (size_t k = 0; k < out.size(); k++) {
+      Accessor &accessor = scene->accessors[out[k].accessor];
+      accessor.bufferView = view_id;
+      accessor.byteOffset = (view.byteLength + 15) & ~static_cast<size_t>(15);
+      accessor.byteStride = 0;
+      view.byteLength = accessor.byteOffset + out[k].data.size();
+      buffer.data.resize(view.byteOffset + view.byteLength);
+      if (!out[k].data.empty()) {
+        memcpy(&buffer.data[view.byteOffset + accessor.byteOffset],
+               &out[k].data[0], out[k].data.size());
+      }
+    }
+  }
 
-  double target = TINYGLTF_TEXTURE_TARGET_TEXTURE2D;
-  ParseNumberProperty(&target, err, o, "target", false);
+  std::set<std::string> buffers;
+  RemoveUnusedBufferViews(scene, &buffers, views);
+  for (std::set<std::string>::const_iterator it = buffers.begin();
+       it != buffers.end(); it++) {
+    CompactBuffer(scene, *it);
+  }
 
-  double type = TINYGLTF_TEXTURE_TYPE_UNSIGNED_BYTE;
-  ParseNumberProperty(&type, err, o, "type", false);
+  return ret;
+}
 
-  texture->format = static_cast<int>(format);
-  texture->internalFormat = static_cast<int>(internalFormat);
-  texture->target = static_cast<int>(target);
-  texture->type = static_cast<int>(type);
+// Open3DGC(SC3DMC) decoding, following the stream layout and the FastAC
+// arithmetic coding of the reference o3dgc library. Streams with a permuted
+// vertex order are not supported, and int attributes are skipped.
+
+static const unsigned int kO3DGCStartCode = 0x00001F1;
+static const unsigned int kO3DGCMaxLong = 2147483647u;
+static const unsigned int kO3DGCMaxAttributes = 256;
+static const unsigned int kO3DGCMaxDim = 32;
+static const unsigned int kO3DGCMaxQuantBits = 30;
+static const int kO3DGCBinarizationACEGC = 4;
+static const int kO3DGCBinarizationASCII = 5;
+static const int kO3DGCNoPrediction = 0;
+static const int kO3DGCDifferentialPrediction = 1;
+static const int kO3DGCParallelogramPrediction = 5;
+static const int kO3DGCSurfNormalsPrediction = 6;
+
+// Signed value of the zigzag coded `value`(0, -1, 1, -2, ...).
+static int O3DGCToInt(unsigned int value) {
+  return (value & 1) ? -static_cast<int>(value >> 1) - 1
+                     : static_cast<int>(value >> 1);
+}
+
+// Reads the values of an Open3DGC stream: little endian in binary streams,
+// 7 bits per byte in ASCII ones. Reads past the end return 0 and set
+// `Failed`.
+class O3DGCStream {
+ public:
+  O3DGCStream(const unsigned char *data, size_t size)
+      : data_(data), size_(size), ascii_(false), failed_(false) {}
+
+  bool Failed() const { return failed_; }
+  bool IsASCII() const { return ascii_; }
+  void SetASCII(bool ascii) { ascii_ = ascii; }
+
+  unsigned char ReadUChar(size_t *pos) {
+    if (*pos >= size_) {
+      failed_ = true;
+      return 0;
+    }
+    return data_[(*pos)++];
+  }
+
+  unsigned int ReadUInt32Binary(size_t *pos) {
+    unsigned int value = 0;
+    for (int i = 0; i < 4; i++) {
+      value |= static_cast<unsigned int>(ReadUChar(pos)) << (8 * i);
+    }
+    return value;
+  }
 
-  return true;
-}
+  unsigned int ReadUInt32ASCII(size_t *pos) {
+    unsigned int value = 0;
+    for (int i = 0; i < 5; i++) {
+      value |= static_cast<unsigned int>(ReadUChar(pos)) << (7 * i);
+    }
+    return value;
+  }
 
-static bool ParseBuffer(Buffer *buffer, std::string *err,
-                        const picojson::object &o, const std::string &basedir,
-                        bool is_binary = false,
-                        const unsigned char *bin_data = NULL,
-                        size_t bin_size = 0) {
-  double byteLength;
-  if (!ParseNumberProperty(&byteLength, err, o, "byteLength", true)) {
-    return false;
+  unsigned int ReadUInt32(size_t *pos) {
+    return ascii_ ? ReadUInt32ASCII(pos) : ReadUInt32Binary(pos);
   }
 
-  std::string uri;
-  if (!ParseStringProperty(&uri, err, o, "uri", true)) {
-    return false;
+  float ReadFloat32(size_t *pos) {
+    unsigned int bits = ReadUInt32(pos);
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
   }
 
-  picojson::object::const_iterator type = o.find("type");
-  if (type != o.end()) {
-    if (type->second.is<std::string>()) {
-      const std::string &ty = (type->second).get<std::string>();
-      if (ty.compare("arraybuffer") == 0) {
-        // buffer.type = "arraybuffer";
-      }
+  // Variable length value of ASCII streams: a 7 bits symbol, followed by 6
+  // bits symbols while it and each of them are all ones. Kept modulo 2^32,
+  // which gives back negative values written as unsigned.
+  unsigned int ReadUIntASCII(size_t *pos) {
+    unsigned int value = ReadUChar(pos);
+    if (value == 127) {
+      unsigned int symbol;
+      int shift = 0;
+      do {
+        symbol = ReadUChar(pos);
+        if (shift < 32) {
+          value += (symbol >> 1) << shift;
+        }
+        shift += 6;
+      } while ((symbol & 1) && !failed_);
     }
+    return value;
   }
 
-  size_t bytes = static_cast<size_t>(byteLength);
-  if (is_binary) {
-    // Still binary glTF accepts external dataURI. First try external resources.
-    bool loaded = false;
-    if (IsDataURI(uri)) {
-      loaded = DecodeDataURI(&buffer->data, uri, bytes, true);
-    } else {
-      // Assume external .bin file.
-      loaded = LoadExternalFile(&buffer->data, err, uri, basedir, bytes, true);
+  int ReadIntASCII(size_t *pos) { return O3DGCToInt(ReadUIntASCII(pos)); }
+
+  // Points `bytes` at the `size` bytes at `pos`, and skips them.
+  bool ReadBytes(const unsigned char **bytes, size_t *pos, size_t size) {
+    if ((*pos > size_) || (size > size_ - *pos)) {
+      failed_ = true;
+      return false;
     }
+    *bytes = data_ + *pos;
+    *pos += size;
+    return true;
+  }
 
-    if (!loaded) {
-      // load data from (embedded) binary data
+ private:
+  const unsigned char *data_;
+  size_t size_;
+  bool ascii_;
+  bool failed_;
+};
 
-      if ((bin_size == 0) || (bin_data == NULL)) {
-        if (err) {
-          (*err) += "Invalid binary data.\n";
-        }
-        return false;
+// Adaptive probability of the bit 0, in 1/8192.
+class O3DGCBitModel {
+ public:
+  O3DGCBitModel()
+      : bit_0_count(1),
+        bit_count(2),
+        bit_0_prob(1u << 12),
+        update_cycle(4),
+        bits_until_update(4) {}
+
+  void Update() {
+    bit_count += update_cycle;
+    if (bit_count > (1u << 13)) {
+      bit_count = (bit_count + 1) >> 1;
+      bit_0_count = (bit_0_count + 1) >> 1;
+      if (bit_0_count == bit_count) {
+        bit_count++;
       }
+    }
+    unsigned int scale = 0x80000000u / bit_count;
+    bit_0_prob = (bit_0_count * scale) >> (31 - 13);
+    update_cycle = std::min((5 * update_cycle) >> 2, 64u);
+    bits_until_update = update_cycle;
+  }
 
-      if (byteLength > bin_size) {
-        if (err) {
-          std::stringstream ss;
-          ss << "Invalid `byteLength'. Must be equal or less than binary size: "
-                "`byteLength' = "
-             << byteLength << ", binary size = " << bin_size << std::endl;
-          (*err) += ss.str();
-        }
-        return false;
+  unsigned int bit_0_count;
+  unsigned int bit_count;
+  unsigned int bit_0_prob;
+  unsigned int update_cycle;
+  unsigned int bits_until_update;
+};
+
+// Adaptive distribution of 2 to 2048 symbols, in 1/32768.
+class O3DGCDataModel {
+ public:
+  explicit O3DGCDataModel(unsigned int num_symbols)
+      : distribution(num_symbols),
+        counts(num_symbols, 1),
+        total_count(0),
+        update_cycle(num_symbols),
+        symbols_until_update(0) {
+    Update();
+    update_cycle = symbols_until_update = (num_symbols + 6) >> 1;
+  }
+
+  void Update() {
+    unsigned int num_symbols = static_cast<unsigned int>(counts.size());
+    total_count += update_cycle;
+    if (total_count > (1u << 15)) {
+      total_count = 0;
+      for (unsigned int i = 0; i < num_symbols; i++) {
+        counts[i] = (counts[i] + 1) >> 1;
+        total_count += counts[i];
       }
+    }
+    unsigned int scale = 0x80000000u / total_count;
+    unsigned int sum = 0;
+    for (unsigned int i = 0; i < num_symbols; i++) {
+      distribution[i] = (scale * sum) >> (31 - 15);
+      sum += counts[i];
+    }
+    update_cycle = std::min((5 * update_cycle) >> 2, (num_symbols + 6) << 3);
+    symbols_until_update = update_cycle;
+  }
 
-      if (uri.compare("data:,") == 0) {
-        // @todo { check uri }
-        buffer->data.resize(static_cast<size_t>(byteLength));
-        memcpy(&(buffer->data.at(0)), bin_data,
-               static_cast<size_t>(byteLength));
+  std::vector<unsigned int> distribution;
+  std::vector<unsigned int> counts;
+  unsigned int total_count;
+  unsigned int update_cycle;
+  unsigned int symbols_until_update;
+};
+
+// Arithmetic decoder of `size` bytes. Bytes past the end are read as 0.
+class O3DGCArithmeticDecoder {
+ public:
+  O3DGCArithmeticDecoder()
+      : data_(NULL), size_(0), pos_(0), value_(0), length_(0),
+        failed_(false) {}
+
+  bool Failed() const { return failed_; }
+
+  void Start(const unsigned char *data, size_t size) {
+    data_ = data;
+    size_ = size;
+    pos_ = 0;
+    value_ = 0;
+    length_ = 0xFFFFFFFFu;
+    for (int i = 0; i < 4; i++) {
+      value_ = (value_ << 8) | NextByte();
+    }
+  }
+
+  unsigned int DecodeBit(O3DGCBitModel *model) {
+    unsigned int x = model->bit_0_prob * (length_ >> 13);
+    unsigned int bit = (value_ >= x) ? 1 : 0;
+    if (bit) {
+      value_ -= x;
+      length_ -= x;
+    } else {
+      length_ = x;
+      model->bit_0_count++;
+    }
+    Renormalize();
+    if (--model->bits_until_update == 0) {
+      model->Update();
+    }
+    return bit;
+  }
 
+  // Bit of probability 1/2.
+  unsigned int DecodeBit() {
+    unsigned int x = (1u << 12) * (length_ >> 13);
+    unsigned int bit = (value_ >= x) ? 1 : 0;
+    if (bit) {
+      value_ -= x;
+      length_ -= x;
+    } else {
+      length_ = x;
+    }
+    Renormalize();
+    return bit;
+  }
+
+  unsigned int Decode(O3DGCDataModel *model) {
+    unsigned int s = 0;
+    unsigned int n = static_cast<unsigned int>(model->counts.size());
+    unsigned int x = 0;
+    unsigned int y = length_;
+    length_ >>= 15;
+    for (unsigned int m = n >> 1; m != s; m = (s + n) >> 1) {
+      unsigned int z = length_ * model->distribution[m];
+      if (z > value_) {
+        n = m;
+        y = z;
       } else {
-        if (err) {
-          (*err) += "Invalid URI for binary data.\n";
-        }
-        return false;
+        s = m;
+        x = z;
       }
     }
+    value_ -= x;
+    length_ = y - x;
+    Renormalize();
+    model->counts[s]++;
+    if (--model->symbols_until_update == 0) {
+      model->Update();
+    }
+    return s;
+  }
 
-  } else {
-    if (IsDataURI(uri)) {
-      if (!DecodeDataURI(&buffer->data, uri, bytes, true)) {
-        if (err) {
-          (*err) += "Failed to decode 'uri'.\n";
-        }
-        return false;
-      }
-    } else {
-      // Assume external .bin file.
-      if (!LoadExternalFile(&buffer->data, err, uri, basedir, bytes, true)) {
-        return false;
+  // Exp-Golomb code of order `k`: a unary prefix coded with `model`, then the
+  // bits of the remainder.
+  unsigned int DecodeExpGolomb(int k, O3DGCBitModel *model) {
+    unsigned int value = 0;
+    while (DecodeBit(model)) {
+      if (k >= 31) {
+        failed_ = true;
+        return 0;
       }
+      value += 1u << k;
+      k++;
     }
+    while (k--) {
+      value += DecodeBit() << k;
+    }
+    return value;
   }
 
-  ParseStringProperty(&buffer->name, err, o, "name", false);
+  // Symbol of `model`, followed by an exp-Golomb coded excess when it is
+  // `escape`.
+  unsigned int DecodeEscaped(O3DGCDataModel *model, O3DGCBitModel *bit_model,
+                             unsigned int escape, int k) {
+    unsigned int value = Decode(model);
+    if (value == escape) {
+      value += DecodeExpGolomb(k, bit_model);
+    }
+    return value;
+  }
 
-  return true;
-}
+ private:
+  unsigned int NextByte() { return (pos_ < size_) ? data_[pos_++] : 0; }
 
-static bool ParseBufferView(BufferView *bufferView, std::string *err,
-                            const picojson::object &o) {
-  std::string buffer;
-  if (!ParseStringProperty(&buffer, err, o, "buffer", true)) {
-    return false;
+  void Renormalize() {
+    while (length_ < (1u << 24)) {
+      value_ = (value_ << 8) | NextByte();
+      length_ <<= 8;
+    }
   }
 
-  double byteOffset;
-  if (!ParseNumberProperty(&byteOffset, err, o, "byteOffset", true)) {
-    return false;
-  }
+  const unsigned char *data_;
+  size_t size_;
+  size_t pos_;
+  unsigned int value_;
+  unsigned int length_;
+  bool failed_;
+};
 
-  double byteLength = 0.0;
-  ParseNumberProperty(&byteLength, err, o, "byteLength", false);
+// Quantized array of an Open3DGC stream.
+typedef struct {
+  size_t count;
+  unsigned int dim;
+  unsigned int bits;
+  float min_values[kO3DGCMaxDim];
+  float max_values[kO3DGCMaxDim];
+} O3DGCArray;
 
-  double target = 0.0;
-  ParseNumberProperty(&target, err, o, "target", false);
-  int targetValue = static_cast<int>(target);
-  if ((targetValue == TINYGLTF_TARGET_ARRAY_BUFFER) ||
-      (targetValue == TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER)) {
-    // OK
-  } else {
-    targetValue = 0;
+typedef struct {
+  size_t num_triangles;
+  O3DGCArray coords;
+  O3DGCArray normals;
+  std::vector<O3DGCArray> attributes;  // Float attributes.
+  size_t num_int_attributes;           // Not decoded.
+} O3DGCHeader;
+
+// Codings of the values of the connectivity.
+enum O3DGCCoding { O3DGC_UINT, O3DGC_INT, O3DGC_BIT };
+
+enum O3DGCArrayKind { O3DGC_COORDS, O3DGC_NORMALS, O3DGC_ATTRIBUTE };
+
+// Best two predictions of a vertex, ordered by (c, b, a).
+typedef struct {
+  int a;
+  int b;
+  int c;
+  unsigned int values[kO3DGCMaxDim];
+} O3DGCPredictor;
+
+// Inserts the prediction (a, b, c) in the sorted `predictors`, keeping at most
+// two of them. Returns its index, or -1 if it is already there or dropped.
+static int InsertO3DGCPredictor(O3DGCPredictor *predictors, size_t *num,
+                                int a, int b, int c) {
+  size_t i = 0;
+  for (; i < *num; i++) {
+    const O3DGCPredictor &p = predictors[i];
+    if ((p.c == c) && (p.b == b) && (p.a == a)) {
+      return -1;
+    }
+    if ((c < p.c) || ((c == p.c) && ((b < p.b) || ((b == p.b) && (a < p.a))))) {
+      break;
+    }
   }
-  bufferView->target = targetValue;
+  if (i == 2) {
+    return -1;
+  }
+  if (*num < 2) {
+    (*num)++;
+  }
+  for (size_t j = *num - 1; j > i; j--) {
+    predictors[j] = predictors[j - 1];
+  }
+  predictors[i].a = a;
+  predictors[i].b = b;
+  predictors[i].c = c;
+  return static_cast<int>(i);
+}
 
-  ParseStringProperty(&bufferView->name, err, o, "name", false);
+// Face of the cube around the largest component of `n`(0: +z, 1: -z, 2: +y,
+// 3: -y, 4: +x, 5: -x), and the two other components in its frame.
+static int O3DGCSphereToCube(const double *n, double *a, double *b) {
+  double ax = std::fabs(n[0]);
+  double ay = std::fabs(n[1]);
+  double az = std::fabs(n[2]);
+  if ((az >= ax) && (az >= ay)) {
+    *a = (n[2] >= 0.0) ? n[0] : -n[0];
+    *b = (n[2] >= 0.0) ? n[1] : -n[1];
+    return (n[2] >= 0.0) ? 0 : 1;
+  }
+  if ((ay >= ax) && (ay >= az)) {
+    *a = (n[1] >= 0.0) ? n[2] : -n[2];
+    *b = (n[1] >= 0.0) ? n[0] : -n[0];
+    return (n[1] >= 0.0) ? 2 : 3;
+  }
+  *a = (n[0] >= 0.0) ? n[1] : -n[1];
+  *b = (n[0] >= 0.0) ? n[2] : -n[2];
+  return (n[0] >= 0.0) ? 4 : 5;
+}
 
-  bufferView->buffer = buffer;
-  bufferView->byteOffset = static_cast<size_t>(byteOffset);
-  bufferView->byteLength = static_cast<size_t>(byteLength);
+// Unit vector of the components `a` and `b` in the frame of `face`.
+static void O3DGCCubeToSphere(float *n, float a, float b, int face) {
+  float sign = (face & 1) ? -1.0f : 1.0f;
+  float c = std::sqrt(std::max(0.0f, 1.0f - a * a - b * b));
+  int axis = 2 - (face >> 1);  // Of the largest component.
+  n[axis] = sign * c;
+  n[(axis + 1) % 3] = sign * a;
+  n[(axis + 2) % 3] = sign * b;
+}
+
+// Decodes an Open3DGC stream: the header, then the triangles, then the arrays
+// in the order of the stream.
+class O3DGCDecoder {
+ public:
+  O3DGCDecoder(const unsigned char *data, size_t size)
+      : stream_(data, size),
+        pos_(0),
+        num_vertices_(0),
+        max_valence_(0),
+        has_order_(false) {}
+
+  bool DecodeHeader(O3DGCHeader *header, std::string *err);
+
+  bool DecodeTriangles(const O3DGCHeader &header, std::string *err);
+
+  // Decodes the next array into `out`(`array.count` elements of
+  // `array.dim`).
+  bool DecodeArray(std::vector<float> *out, std::string *err,
+                   const O3DGCArray &array, O3DGCArrayKind kind);
+
+  // The triangles in their order before encoding.
+  bool GetTriangles(std::vector<int> *out, std::string *err) const;
 
+ private:
+  bool ReadArrayHeader(O3DGCArray *array, unsigned int dim);
+  bool LoadValues(std::vector<int> *out, std::string *err,
+                  O3DGCCoding ascii_coding, O3DGCCoding binary_coding,
+                  unsigned int escape, size_t max_count);
+  void AddCorner(int vertex, size_t corner);
+  void PredictNormals(std::vector<float> *predicted, std::vector<int> *faces);
+
+  O3DGCStream stream_;
+  size_t pos_;
+  size_t num_vertices_;
+  unsigned int max_valence_;
+  bool has_order_;
+  std::vector<int> triangles_;  // In the order of decoding.
+  std::vector<int> order_;      // Where they were, relative to the previous.
+  // The triangles around each vertex in the order of decoding(up to
+  // `max_valence_` of them), as lists of the corners of `triangles_`.
+  std::vector<int> first_corner_;
+  std::vector<int> last_corner_;
+  std::vector<int> next_corner_;
+  std::vector<unsigned int> valences_;
+  std::vector<unsigned int> coords_;  // Quantized, to predict the normals.
+};
+
+bool O3DGCDecoder::ReadArrayHeader(O3DGCArray *array, unsigned int dim) {
+  array->dim = dim;
+  if ((dim == 0) || (dim > kO3DGCMaxDim)) {
+    return false;
+  }
+  for (unsigned int i = 0; i < dim; i++) {
+    array->min_values[i] = stream_.ReadFloat32(&pos_);
+    array->max_values[i] = stream_.ReadFloat32(&pos_);
+  }
   return true;
 }
 
-static bool ParseAccessor(Accessor *accessor, std::string *err,
-                          const picojson::object &o) {
-  std::string bufferView;
-  if (!ParseStringProperty(&bufferView, err, o, "bufferView", true)) {
+bool O3DGCDecoder::DecodeHeader(O3DGCHeader *header, std::string *err) {
+  pos_ = 0;
+  if (stream_.ReadUInt32Binary(&pos_) != kO3DGCStartCode) {
+    pos_ = 0;
+    if (stream_.ReadUInt32ASCII(&pos_) != kO3DGCStartCode) {
+      (*err) += "Not an Open3DGC stream.\n";
+      return false;
+    }
+    stream_.SetASCII(true);
+  }
+  stream_.ReadUInt32(&pos_);   // Size of the stream.
+  stream_.ReadUChar(&pos_);    // Encoding mode.
+  stream_.ReadFloat32(&pos_);  // Crease angle.
+  stream_.ReadUChar(&pos_);    // CCW, solid, convex and triangular flags.
+  O3DGCArray empty = O3DGCArray();
+  header->num_triangles = 0;
+  header->num_int_attributes = 0;
+  header->coords = empty;
+  header->normals = empty;
+  header->coords.count = stream_.ReadUInt32(&pos_);
+  header->normals.count = stream_.ReadUInt32(&pos_);
+  unsigned int num_float_attributes = stream_.ReadUInt32(&pos_);
+  unsigned int num_int_attributes = stream_.ReadUInt32(&pos_);
+  bool ret = (num_float_attributes <= kO3DGCMaxAttributes) &&
+             (num_int_attributes <= kO3DGCMaxAttributes);
+  if (ret && header->coords.count) {
+    header->num_triangles = stream_.ReadUInt32(&pos_);
+    ret = ReadArrayHeader(&header->coords, 3);
+    header->coords.bits = stream_.ReadUChar(&pos_);
+  }
+  if (ret && header->normals.count) {
+    stream_.ReadUInt32(&pos_);  // Number of normal indices.
+    ret = ReadArrayHeader(&header->normals, 3);
+    stream_.ReadUChar(&pos_);  // Per vertex.
+    header->normals.bits = stream_.ReadUChar(&pos_);
+  }
+  header->attributes.assign(ret ? num_float_attributes : 0, empty);
+  for (size_t i = 0; ret && (i < header->attributes.size()); i++) {
+    O3DGCArray &attribute = header->attributes[i];
+    attribute.count = stream_.ReadUInt32(&pos_);
+    if (attribute.count) {
+      stream_.ReadUInt32(&pos_);  // Number of indices.
+      ret = ReadArrayHeader(&attribute, stream_.ReadUChar(&pos_));
+      stream_.ReadUChar(&pos_);  // Per vertex.
+      stream_.ReadUChar(&pos_);  // Type.
+      attribute.bits = stream_.ReadUChar(&pos_);
+    }
+  }
+  for (unsigned int i = 0; ret && (i < num_int_attributes); i++) {
+    if (stream_.ReadUInt32(&pos_)) {
+      header->num_int_attributes++;
+      stream_.ReadUInt32(&pos_);  // Number of indices.
+      stream_.ReadUChar(&pos_);   // Dimension.
+      stream_.ReadUChar(&pos_);   // Per vertex.
+      stream_.ReadUChar(&pos_);   // Type.
+    }
+  }
+  for (size_t i = 0; ret && (i < header->attributes.size() + 2); i++) {
+    const O3DGCArray &array =
+        (i == 0) ? header->coords
+                 : ((i == 1) ? header->normals : header->attributes[i - 2]);
+    ret = (array.count == 0) ||
+          ((array.bits > 0) && (array.bits <= kO3DGCMaxQuantBits));
+  }
+  if (!ret || stream_.Failed()) {
+    (*err) += "Invalid Open3DGC header.\n";
     return false;
   }
+  return true;
+}
 
-  double byteOffset;
-  if (!ParseNumberProperty(&byteOffset, err, o, "byteOffset", true)) {
-    return false;
+bool O3DGCDecoder::LoadValues(std::vector<int> *out, std::string *err,
+                              O3DGCCoding ascii_coding,
+                              O3DGCCoding binary_coding, unsigned int escape,
+                              size_t max_count) {
+  out->clear();
+  if (stream_.IsASCII()) {
+    stream_.ReadUInt32ASCII(&pos_);  // Size.
+    size_t count = stream_.ReadUInt32ASCII(&pos_);
+    if (count > max_count) {
+      (*err) += "Invalid Open3DGC connectivity.\n";
+      return false;
+    }
+    out->reserve(count + 6);
+    while ((out->size() < count) && !stream_.Failed()) {
+      if (ascii_coding == O3DGC_BIT) {
+        unsigned int bits = stream_.ReadUChar(&pos_);
+        for (int i = 0; i < 7; i++) {
+          out->push_back((bits >> i) & 1);
+        }
+      } else if (ascii_coding == O3DGC_INT) {
+        out->push_back(stream_.ReadIntASCII(&pos_));
+      } else {
+        out->push_back(static_cast<int>(stream_.ReadUIntASCII(&pos_)));
+      }
+    }
+    return true;
   }
 
-  double componentType;
-  if (!ParseNumberProperty(&componentType, err, o, "componentType", true)) {
+  size_t header_size = (binary_coding == O3DGC_BIT) ? 8 : 12;
+  size_t size = stream_.ReadUInt32Binary(&pos_);
+  size_t count = stream_.ReadUInt32Binary(&pos_);
+  if (count == 0) {
+    return true;
+  }
+  unsigned int min_value = 0;
+  if (binary_coding == O3DGC_INT) {
+    min_value = stream_.ReadUInt32Binary(&pos_) - kO3DGCMaxLong;
+  } else if (binary_coding == O3DGC_UINT) {
+    min_value = stream_.ReadUInt32Binary(&pos_);
+  }
+  const unsigned char *bytes = NULL;
+  if ((count > max_count) || (size < header_size) ||
+      !stream_.ReadBytes(&bytes, &pos_, size - header_size)) {
+    (*err) += "Invalid Open3DGC connectivity.\n";
     return false;
   }
+  O3DGCArithmeticDecoder decoder;
+  decoder.Start(bytes, size - header_size);
+  O3DGCBitModel bit_model;
+  O3DGCDataModel model(
+      std::max(escape + ((binary_coding == O3DGC_INT) ? 2 : 1), 2u));
+  out->resize(count);
+  for (size_t i = 0; i < count; i++) {
+    unsigned int value = 0;
+    if (binary_coding == O3DGC_BIT) {
+      value = decoder.DecodeBit(&bit_model);
+    } else if (binary_coding == O3DGC_INT) {
+      value = decoder.DecodeEscaped(&model, &bit_model, escape, 0);
+    } else {
+      value = decoder.Decode(&model);
+    }
+    (*out)[i] = static_cast<int>(value + min_value);
+  }
+  return true;
+}
 
-  double count = 0.0;
-  if (!ParseNumberProperty(&count, err, o, "count", true)) {
-    return false;
+void O3DGCDecoder::AddCorner(int vertex, size_t corner) {
+  if (valences_[vertex] >= max_valence_) {
+    return;
+  }
+  valences_[vertex]++;
+  if (last_corner_[vertex] < 0) {
+    first_corner_[vertex] = static_cast<int>(corner);
+  } else {
+    next_corner_[last_corner_[vertex]] = static_cast<int>(corner);
   }
+  last_corner_[vertex] = static_cast<int>(corner);
+}
 
-  std::string type;
-  if (!ParseStringProperty(&type, err, o, "type", true)) {
+// Reads the next value of `values` in `value`.
+static bool NextO3DGCValue(int *value, const std::vector<int> &values,
+                           size_t *it) {
+  if (*it >= values.size()) {
     return false;
   }
+  *value = values[(*it)++];
+  return true;
+}
 
-  if (type.compare("SCALAR") == 0) {
-    accessor->type = TINYGLTF_TYPE_SCALAR;
-  } else if (type.compare("VEC2") == 0) {
-    accessor->type = TINYGLTF_TYPE_VEC2;
-  } else if (type.compare("VEC3") == 0) {
-    accessor->type = TINYGLTF_TYPE_VEC3;
-  } else if (type.compare("VEC4") == 0) {
-    accessor->type = TINYGLTF_TYPE_VEC4;
-  } else if (type.compare("MAT2") == 0) {
-    accessor->type = TINYGLTF_TYPE_MAT2;
-  } else if (type.compare("MAT3") == 0) {
-    accessor->type = TINYGLTF_TYPE_MAT3;
-  } else if (type.compare("MAT4") == 0) {
-    accessor->type = TINYGLTF_TYPE_MAT4;
-  } else {
-    std::stringstream ss;
-    ss << "Unsupported `type` for accessor object. Got \"" << type << "\"\n";
-    if (err) {
-      (*err) += ss.str();
-    }
+bool O3DGCDecoder::DecodeTriangles(const O3DGCHeader &header,
+                                   std::string *err) {
+  unsigned char mask = stream_.ReadUChar(&pos_);
+  if (mask & 1) {
+    (*err) += "Open3DGC streams with a vertex order are not supported.\n";
+    return false;
+  }
+  has_order_ = (mask & 2) != 0;
+  max_valence_ = stream_.ReadUInt32(&pos_);
+  num_vertices_ = header.coords.count;
+  size_t num_triangles = header.num_triangles;
+  size_t max_count = 3 * num_triangles + num_vertices_ + 7;
+  std::vector<int> num_fans, degrees, configs, operations, indices;
+  if (!LoadValues(&num_fans, err, O3DGC_UINT, O3DGC_INT, 4, max_count) ||
+      !LoadValues(&degrees, err, O3DGC_UINT, O3DGC_INT, 16, max_count) ||
+      !LoadValues(&configs, err, O3DGC_UINT, O3DGC_UINT, 10, max_count) ||
+      !LoadValues(&operations, err, O3DGC_BIT, O3DGC_BIT, 0, max_count) ||
+      !LoadValues(&indices, err, O3DGC_INT, O3DGC_INT, 8, max_count) ||
+      (has_order_ &&
+       !LoadValues(&order_, err, O3DGC_UINT, O3DGC_INT, 16, max_count))) {
     return false;
   }
 
-  double byteStride = 0.0;
-  ParseNumberProperty(&byteStride, err, o, "byteStride", false);
-
-  ParseStringProperty(&accessor->name, err, o, "name", false);
-
-  accessor->minValues.clear();
-  accessor->maxValues.clear();
-  ParseNumberArrayProperty(&accessor->minValues, err, o, "min", false);
-  ParseNumberArrayProperty(&accessor->maxValues, err, o, "max", false);
+  triangles_.resize(3 * num_triangles);
+  first_corner_.assign(num_vertices_, -1);
+  last_corner_.assign(num_vertices_, -1);
+  next_corner_.assign(3 * num_triangles, -1);
+  valences_.assign(num_vertices_, 0);
+
+  // Configurations of the triangle fans around a vertex: the visited vertex
+  // they start and end with(-1 for none), and whether the vertices between
+  // are new ones or read from `operations`.
+  static const int kFirst[10] = {0, 0, -1, -1, 0, 1, -1, 1, 1, -1};
+  static const int kLast[10] = {1, 1, 0, 1, -1, -1, -1, 0, 0, -1};
+  static const bool kOperations[10] = {false, true,  false, false, false,
+                                       false, false, false, true,  true};
+
+  std::vector<int> visited;
+  std::vector<int> visited_valences;
+  std::vector<int> fan;
+  size_t it_fans = 0, it_degrees = 0, it_configs = 0, it_operations = 0;
+  size_t it_indices = 0;
+  int vertex_count = 0;
+  size_t triangle_count = 0;
+  int num_vertices = static_cast<int>(num_vertices_);
+  bool ret = true;
+  for (int focus = 0; ret && (focus < num_vertices); focus++) {
+    if (focus == vertex_count) {
+      vertex_count++;
+    }
 
-  accessor->count = static_cast<size_t>(count);
-  accessor->bufferView = bufferView;
-  accessor->byteOffset = static_cast<size_t>(byteOffset);
-  accessor->byteStride = static_cast<size_t>(byteStride);
+    // Vertices after `focus` in its triangles, by increasing index and then
+    // number of triangles.
+    visited.clear();
+    visited_valences.clear();
+    int num_conquered = 0;
+    for (int e = first_corner_[focus]; e >= 0; e = next_corner_[e]) {
+      num_conquered++;
+      const int *triangle = &triangles_[3 * (e / 3)];
+      for (int k = 0; k < 3; k++) {
+        int v = triangle[k];
+        if (v <= focus) {
+          continue;
+        }
+        std::vector<int>::iterator it =
+            std::lower_bound(visited.begin(), visited.end(), v);
+        size_t j = static_cast<size_t>(it - visited.begin());
+        if ((it != visited.end()) && (*it == v)) {
+          visited_valences[j]++;
+        } else {
+          visited.insert(it, v);
+          visited_valences.insert(visited_valences.begin() + j, 1);
+        }
+      }
+    }
+    for (size_t x = 1; (visited.size() > 2) && (x < visited.size()); x++) {
+      if (visited_valences[x] != 1) {
+        continue;
+      }
+      for (size_t y = x;
+           (y > 0) && (visited_valences[y] < visited_valences[y - 1]); y--) {
+        std::swap(visited_valences[y], visited_valences[y - 1]);
+        std::swap(visited[y], visited[y - 1]);
+      }
+    }
 
-  {
-    int comp = static_cast<int>(componentType);
-    if (comp >= TINYGLTF_COMPONENT_TYPE_BYTE &&
-        comp <= TINYGLTF_COMPONENT_TYPE_DOUBLE) {
-      // OK
-      accessor->componentType = comp;
-    } else {
-      std::stringstream ss;
-      ss << "Invalid `componentType` in accessor. Got " << comp << "\n";
-      if (err) {
-        (*err) += ss.str();
+    int fans = 0;
+    ret = NextO3DGCValue(&fans, num_fans, &it_fans);
+    for (int f = 0; ret && (f < fans); f++) {
+      int degree = 0;
+      int config = 0;
+      ret = NextO3DGCValue(&degree, degrees, &it_degrees) &&
+            NextO3DGCValue(&config, configs, &it_configs) && (config >= 0) &&
+            (config < 10);
+      if (!ret) {
+        break;
+      }
+      degree += 2 - num_conquered;
+      fan.assign(1, focus);
+      int first = kFirst[config];
+      int last = kLast[config];
+      if (first >= 0) {
+        ret = (static_cast<size_t>(first) < visited.size());
+        fan.push_back(ret ? visited[first] : 0);
+      }
+      int middle = degree - ((first >= 0) ? 1 : 0) - ((last >= 0) ? 1 : 0);
+      for (int u = 0; ret && (u < middle); u++) {
+        int operation = 0;
+        if (kOperations[config]) {
+          ret = NextO3DGCValue(&operation, operations, &it_operations);
+        }
+        if (operation == 1) {
+          int index = 0;
+          ret = NextO3DGCValue(&index, indices, &it_indices);
+          if (index < 0) {
+            ret = ret && (static_cast<size_t>(-(index + 1)) < visited.size());
+            index = ret ? visited[-(index + 1)] : 0;
+          } else {
+            ret = ret && (index < num_vertices - focus);
+            index += focus;
+          }
+          fan.push_back(index);
+        } else {
+          ret = ret && (vertex_count < num_vertices);
+          visited.push_back(vertex_count);
+          fan.push_back(vertex_count++);
+        }
+      }
+      if (ret && (last >= 0)) {
+        ret = (static_cast<size_t>(last) < visited.size());
+        fan.push_back(ret ? visited[last] : 0);
+      }
+
+      for (size_t k = 2; ret && (k < fan.size()); k++) {
+        ret = (triangle_count < num_triangles);
+        if (ret) {
+          size_t t = 3 * triangle_count++;
+          triangles_[t + 0] = focus;
+          triangles_[t + 1] = fan[k - 1];
+          triangles_[t + 2] = fan[k];
+          for (size_t c = t; c < t + 3; c++) {
+            AddCorner(triangles_[c], c);
+          }
+        }
       }
-      return false;
     }
   }
-
-  ParseExtrasProperty(&(accessor->extras), o);
-
+  if (!ret || (triangle_count != num_triangles) ||
+      (has_order_ && (order_.size() < num_triangles)) || stream_.Failed()) {
+    (*err) += "Invalid Open3DGC connectivity.\n";
+    return false;
+  }
   return true;
 }
 
-static bool ParsePrimitive(Primitive *primitive, std::string *err,
-                           const picojson::object &o) {
-  if (!ParseStringProperty(&primitive->material, err, o, "material", true,
-                           "mesh.primitive")) {
-    return false;
+void O3DGCDecoder::PredictNormals(std::vector<float> *predicted,
+                                  std::vector<int> *faces) {
+  predicted->resize(2 * faces->size());
+  for (size_t v = 0; v < faces->size(); v++) {
+    // Sum of the normals of the triangles around `v`.
+    double n[3] = {0.0, 0.0, 0.0};
+    for (int e = first_corner_[v]; e >= 0; e = next_corner_[e]) {
+      double p[3][3];
+      for (int k = 0; k < 3; k++) {
+        const unsigned int *q = &coords_[3 * triangles_[3 * (e / 3) + k]];
+        for (int i = 0; i < 3; i++) {
+          p[k][i] = static_cast<double>(static_cast<int>(q[i]));
+        }
+      }
+      double e1[3], e2[3];
+      for (int i = 0; i < 3; i++) {
+        e1[i] = p[1][i] - p[0][i];
+        e2[i] = p[2][i] - p[0][i];
+      }
+      n[0] += e1[1] * e2[2] - e1[2] * e2[1];
+      n[1] += e1[2] * e2[0] - e1[0] * e2[2];
+      n[2] += e1[0] * e2[1] - e1[1] * e2[0];
+    }
+    float norm = static_cast<float>(
+        std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]));
+    if (norm == 0.0f) {
+      norm = 1.0f;
+    }
+    double a = 0.0, b = 0.0;
+    int face = O3DGCSphereToCube(n, &a, &b);
+    // The face of the normal is coded relative to the predicted one.
+    int actual = static_cast<signed char>(face + (*faces)[v]);
+    (*faces)[v] = actual;
+    if ((actual >> 1) != (face >> 1)) {
+      a = 0.0;
+      b = 0.0;
+    }
+    (*predicted)[2 * v + 0] = static_cast<float>(a) / norm;
+    (*predicted)[2 * v + 1] = static_cast<float>(b) / norm;
   }
+}
 
-  double mode = static_cast<double>(TINYGLTF_MODE_TRIANGLES);
-  ParseNumberProperty(&mode, err, o, "mode", false);
-
-  int primMode = static_cast<int>(mode);
-  primitive->mode = primMode;
-
-  primitive->indices = "";
-  ParseStringProperty(&primitive->indices, err, o, "indices", false);
+bool O3DGCDecoder::DecodeArray(std::vector<float> *out, std::string *err,
+                               const O3DGCArray &array, O3DGCArrayKind kind) {
+  bool ascii = stream_.IsASCII();
+  size_t start = pos_;
+  size_t size = stream_.ReadUInt32(&pos_);
+  unsigned char mask = stream_.ReadUChar(&pos_);
+  int binarization = (mask >> 4) & 7;
+  int prediction = mask & 7;
+  if (stream_.Failed() || (size < pos_ - start) ||
+      (binarization !=
+       (ascii ? kO3DGCBinarizationASCII : kO3DGCBinarizationACEGC))) {
+    (*err) += "Invalid Open3DGC array.\n";
+    return false;
+  }
+  // ASCII streams keep the indices of the predictions after the values.
+  size = size - (pos_ - start);
+  size_t pred_pos = pos_ + size;
+  O3DGCArithmeticDecoder decoder;
+  O3DGCBitModel bit_model;
+  unsigned int exp_k = 0;
+  unsigned int escape = 0;
+  if (ascii) {
+    stream_.ReadUInt32(&pred_pos);  // Size of the indices.
+  } else {
+    const unsigned char *bytes = NULL;
+    if (!stream_.ReadBytes(&bytes, &pos_, size)) {
+      (*err) += "Invalid Open3DGC array.\n";
+      return false;
+    }
+    decoder.Start(bytes, size);
+    exp_k = decoder.DecodeExpGolomb(0, &bit_model);
+    escape = decoder.DecodeExpGolomb(0, &bit_model);
+    if ((exp_k > 31) || (escape > 2046)) {
+      (*err) += "Invalid Open3DGC array.\n";
+      return false;
+    }
+  }
+  O3DGCDataModel value_model(escape + 2);
+  O3DGCDataModel pred_model(3);
 
-  ParseStringMapProperty(&primitive->attributes, err, o, "attributes", false);
+  unsigned int dim = array.dim;
+  std::vector<float> predicted;  // Normals predicted from the positions.
+  std::vector<int> faces;
+  if (prediction == kO3DGCSurfNormalsPrediction) {
+    if ((kind != O3DGC_NORMALS) || (array.count > coords_.size() / 3)) {
+      (*err) += "Unsupported prediction of Open3DGC attributes.\n";
+      return false;
+    }
+    faces.resize(array.count);
+    O3DGCDataModel face_model(12);
+    for (size_t v = 0; v < array.count; v++) {
+      faces[v] = ascii ? stream_.ReadIntASCII(&pos_)
+                       : O3DGCToInt(decoder.Decode(&face_model));
+    }
+    PredictNormals(&predicted, &faces);
+    dim = 2;
+  }
+
+  // Quantized values, modulo 2^32.
+  std::vector<unsigned int> quantized(array.count * dim);
+  O3DGCPredictor predictors[2];
+  bool ret = true;
+  for (size_t v = 0; ret && (v < array.count); v++) {
+    int vertex = static_cast<int>(v);
+    size_t num_preds = 0;
+    for (int e = ((prediction != kO3DGCNoPrediction) && (v < num_vertices_))
+                     ? first_corner_[v]
+                     : -1;
+         e >= 0; e = next_corner_[e]) {
+      const int *triangle = &triangles_[3 * (e / 3)];
+      if (prediction == kO3DGCParallelogramPrediction) {
+        int a = triangle[0];
+        int b = triangle[1];
+        if (triangle[0] == vertex) {
+          a = triangle[1];
+          b = triangle[2];
+        } else if (triangle[1] == vertex) {
+          b = triangle[2];
+        }
+        for (int f = ((a < vertex) && (b < vertex)) ? first_corner_[a] : -1;
+             f >= 0; f = next_corner_[f]) {
+          const int *opposite = &triangles_[3 * (f / 3)];
+          int c = -1;
+          bool found_b = false;
+          for (int k = 0; k < 3; k++) {
+            int x = opposite[k];
+            found_b = found_b || (x == b);
+            if ((x < vertex) && (x != a) && (x != b)) {
+              c = x;
+            }
+          }
+          int p = ((c != -1) && found_b)
+                      ? InsertO3DGCPredictor(predictors, &num_preds,
+                                             std::min(a, b), std::max(a, b),
+                                             -c - 1)
+                      : -1;
+          for (unsigned int i = 0; (p >= 0) && (i < dim); i++) {
+            predictors[p].values[i] = quantized[a * dim + i] +
+                                      quantized[b * dim + i] -
+                                      quantized[c * dim + i];
+          }
+        }
+      }
+      if ((prediction == kO3DGCSurfNormalsPrediction) ||
+          (prediction == kO3DGCParallelogramPrediction) ||
+          (prediction == kO3DGCDifferentialPrediction)) {
+        for (int k = 0; k < 3; k++) {
+          int w = triangle[k];
+          int p = (w < vertex)
+                      ? InsertO3DGCPredictor(predictors, &num_preds, -1, -1, w)
+                      : -1;
+          for (unsigned int i = 0; (p >= 0) && (i < dim); i++) {
+            predictors[p].values[i] = quantized[w * dim + i];
+          }
+        }
+      }
+    }
 
-  ParseExtrasProperty(&(primitive->extras), o);
+    // Residuals of the best of several predictions, of the previous value, or
+    // the values themselves.
+    const unsigned int *base = NULL;
+    if (num_preds > 1) {
+      unsigned int best = ascii ? stream_.ReadUChar(&pred_pos)
+                                : decoder.Decode(&pred_model);
+      ret = (best < num_preds);
+      base = predictors[ret ? best : 0].values;
+    } else if ((v > 0) && (prediction != kO3DGCNoPrediction)) {
+      base = &quantized[(v - 1) * dim];
+    }
+    for (unsigned int i = 0; i < dim; i++) {
+      unsigned int value =
+          ascii ? stream_.ReadUIntASCII(&pos_)
+                : decoder.DecodeEscaped(&value_model, &bit_model, escape,
+                                        static_cast<int>(exp_k));
+      if (base) {
+        value = base[i] + static_cast<unsigned int>(O3DGCToInt(value));
+      }
+      quantized[v * dim + i] = value;
+    }
+  }
+  pos_ = pred_pos;
+  if (!ret || stream_.Failed() || decoder.Failed()) {
+    (*err) += "Invalid Open3DGC array.\n";
+    return false;
+  }
 
+  out->resize(array.count * array.dim);
+  if (prediction == kO3DGCSurfNormalsPrediction) {
+    // Differences to the predicted normals, in [-2, 2].
+    float step =
+        4.0f / static_cast<float>((1u << (array.bits + 1)) - 1);
+    for (size_t v = 0; v < array.count; v++) {
+      if ((faces[v] < 0) || (faces[v] > 5)) {
+        (*err) += "Invalid Open3DGC normal.\n";
+        return false;
+      }
+      float a = static_cast<float>(static_cast<int>(quantized[2 * v])) * step -
+                2.0f + predicted[2 * v];
+      float b =
+          static_cast<float>(static_cast<int>(quantized[2 * v + 1])) * step -
+          2.0f + predicted[2 * v + 1];
+      O3DGCCubeToSphere(&(*out)[3 * v], a, b, faces[v]);
+    }
+  } else {
+    float steps[kO3DGCMaxDim];
+    for (unsigned int i = 0; i < dim; i++) {
+      float range = array.max_values[i] - array.min_values[i];
+      steps[i] = (range > 0.0f)
+                     ? range / static_cast<float>((1u << array.bits) - 1)
+                     : 1.0f;
+    }
+    for (size_t k = 0; k < quantized.size(); k++) {
+      (*out)[k] = static_cast<float>(static_cast<int>(quantized[k])) *
+                      steps[k % dim] +
+                  array.min_values[k % dim];
+    }
+  }
+  if (kind == O3DGC_COORDS) {
+    coords_.swap(quantized);
+  }
   return true;
 }
 
-static bool ParseMesh(Mesh *mesh, std::string *err, const picojson::object &o) {
-  ParseStringProperty(&mesh->name, err, o, "name", false);
+bool O3DGCDecoder::GetTriangles(std::vector<int> *out,
+                                std::string *err) const {
+  if (!has_order_) {
+    *out = triangles_;
+    return true;
+  }
+  size_t num_triangles = triangles_.size() / 3;
+  out->assign(triangles_.size(), 0);
+  int next = 0;
+  for (size_t i = 0; i < num_triangles; i++) {
+    int t = order_[i] + next;
+    if ((t < 0) || (static_cast<size_t>(t) >= num_triangles)) {
+      (*err) += "Invalid Open3DGC triangle order.\n";
+      return false;
+    }
+    std::copy(&triangles_[3 * i], &triangles_[3 * i] + 3, &(*out)[3 * t]);
+    next = t + 1;
+  }
+  return true;
+}
 
-  mesh->primitives.clear();
-  picojson::object::const_iterator primObject = o.find("primitives");
-  if ((primObject != o.end()) && (primObject->second).is<picojson::array>()) {
-    const picojson::array &primArray =
-        (primObject->second).get<picojson::array>();
-    for (size_t i = 0; i < primArray.size(); i++) {
-      Primitive primitive;
-      if (ParsePrimitive(&primitive, err,
-                         primArray[i].get<picojson::object>())) {
-        // Only add the primitive if the parsing succeeds.
-        mesh->primitives.push_back(primitive);
+bool DecodeOpen3DGCMesh(std::vector<DecodedAccessor> *out, std::string *err,
+                        const Scene &scene, const Mesh &mesh,
+                        const Value &extension, const unsigned char *data,
+                        size_t size, void *user_ptr) {
+  (void)user_ptr;
+  const Value &compressed = extension.Get("compressedData");
+
+  // Arrays of the attributes: -2 for the positions, -1 for the normals, or
+  // the index of the float attribute.
+  std::map<std::string, int> arrays;
+  std::vector<std::string> indices;
+  size_t num_indices = 0;
+  size_t max_count = 0;
+  for (size_t i = 0; i < mesh.primitives.size(); i++) {
+    const Primitive &primitive = mesh.primitives[i];
+    SceneMap<Accessor>::type::const_iterator accessor =
+        scene.accessors.find(primitive.indices);
+    if ((primitive.mode != TINYGLTF_MODE_TRIANGLES) ||
+        (accessor == scene.accessors.end())) {
+      (*err) += "Primitives compressed with Open3DGC must be indexed "
+                "triangles.\n";
+      return false;
+    }
+    indices.push_back(primitive.indices);
+    num_indices += accessor->second.count;
+    for (StringMap::const_iterator it = primitive.attributes.begin();
+         it != primitive.attributes.end(); it++) {
+      accessor = scene.accessors.find(it->second);
+      if (accessor == scene.accessors.end()) {
+        (*err) += "accessor `" + it->second + "` not found.\n";
+        return false;
+      }
+      max_count = std::max(max_count, accessor->second.count);
+      double index = -2.0;
+      if (it->first == "NORMAL") {
+        index = -1.0;
+      } else if ((it->first != "POSITION") &&
+                 (!GetValueNumber(&index,
+                                  compressed.Get("floatAttributesIndexes"),
+                                  it->second) ||
+                  (index < 0.0))) {
+        (*err) += "accessor `" + it->second +
+                  "` is missing from floatAttributesIndexes.\n";
+        return false;
       }
+      arrays[it->second] = static_cast<int>(index);
     }
   }
 
-  ParseExtrasProperty(&(mesh->extras), o);
-
-  return true;
-}
+  O3DGCDecoder decoder(data, size);
+  O3DGCHeader header;
+  if (!decoder.DecodeHeader(&header, err)) {
+    return false;
+  }
+  // Bounds what is allocated by the counts of the accessors.
+  bool ret = (3 * header.num_triangles == num_indices) &&
+             (header.coords.count <= max_count) &&
+             (header.normals.count <= max_count);
+  for (size_t i = 0; i < header.attributes.size(); i++) {
+    ret = ret && (header.attributes[i].count <=
+                  std::max(max_count, header.num_triangles));
+  }
+  if (!ret) {
+    (*err) += "Open3DGC data doesn't match the accessors of the mesh.\n";
+    return false;
+  }
 
-static bool ParseNode(Node *node, std::string *err, const picojson::object &o) {
-  ParseStringProperty(&node->name, err, o, "name", false);
+  std::vector<std::vector<float> > values(header.attributes.size() + 2);
+  if (!decoder.DecodeTriangles(header, err) ||
+      (header.coords.count &&
+       !decoder.DecodeArray(&values[0], err, header.coords, O3DGC_COORDS)) ||
+      (header.normals.count &&
+       !decoder.DecodeArray(&values[1], err, header.normals,
+                            O3DGC_NORMALS))) {
+    return false;
+  }
+  for (size_t i = 0; i < header.attributes.size(); i++) {
+    if (header.attributes[i].count &&
+        !decoder.DecodeArray(&values[i + 2], err, header.attributes[i],
+                             O3DGC_ATTRIBUTE)) {
+      return false;
+    }
+  }
+  std::vector<int> triangles;
+  if (!decoder.GetTriangles(&triangles, err)) {
+    return false;
+  }
 
-  ParseNumberArrayProperty(&node->rotation, err, o, "rotation", false);
-  ParseNumberArrayProperty(&node->scale, err, o, "scale", false);
-  ParseNumberArrayProperty(&node->translation, err, o, "translation", false);
-  ParseNumberArrayProperty(&node->matrix, err, o, "matrix", false);
-  ParseStringArrayProperty(&node->meshes, err, o, "meshes", false);
+  for (std::map<std::string, int>::const_iterator it = arrays.begin();
+       it != arrays.end(); it++) {
+    const Accessor &accessor = scene.accessors.find(it->first)->second;
+    size_t index = static_cast<size_t>(it->second + 2);
+    if ((it->second < -2) || (index >= values.size()) ||
+        (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT)) {
+      (*err) += "accessor `" + it->first + "` doesn't match its Open3DGC "
+                "data.\n";
+      return false;
+    }
+    const O3DGCArray &array =
+        (index == 0) ? header.coords
+                     : ((index == 1) ? header.normals
+                                     : header.attributes[index - 2]);
+    size_t dim = static_cast<size_t>(GetTypeSizeInComponents(accessor.type));
+    if ((dim != array.dim) || (accessor.count > array.count)) {
+      (*err) += "accessor `" + it->first + "` doesn't match its Open3DGC "
+                "data.\n";
+      return false;
+    }
+    out->push_back(DecodedAccessor());
+    out->back().accessor = it->first;
+    out->back().data.resize(accessor.count * dim * sizeof(float));
+    if (accessor.count) {
+      memcpy(&out->back().data[0], &values[index][0],
+             out->back().data.size());
+    }
+  }
 
-  node->children.clear();
-  picojson::object::const_iterator childrenObject = o.find("children");
-  if ((childrenObject != o.end()) &&
-      (childrenObject->second).is<picojson::array>()) {
-    const picojson::array &childrenArray =
-        (childrenObject->second).get<picojson::array>();
-    for (size_t i = 0; i < childrenArray.size(); i++) {
-      if (!childrenArray[i].is<std::string>()) {
-        if (err) {
-          (*err) += "Invalid `children` array.\n";
-        }
+  // The indices of the primitives follow each other in the triangles.
+  std::set<std::string> decoded;
+  size_t offset = 0;
+  for (size_t i = 0; i < indices.size(); i++) {
+    const Accessor &accessor = scene.accessors.find(indices[i])->second;
+    offset += accessor.count;
+    if (!decoded.insert(indices[i]).second) {
+      continue;
+    }
+    int component_size = GetComponentSizeInBytes(accessor.componentType);
+    unsigned int max_index =
+        (component_size == 1) ? 0xFFu
+                              : ((component_size == 2) ? 0xFFFFu
+                                                       : 0xFFFFFFFFu);
+    if ((accessor.type != TINYGLTF_TYPE_SCALAR) ||
+        ((accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) &&
+         (accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) &&
+         (accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT))) {
+      (*err) += "Indices of Open3DGC primitives must be unsigned "
+                "integers.\n";
+      return false;
+    }
+    out->push_back(DecodedAccessor());
+    out->back().accessor = indices[i];
+    std::vector<unsigned char> &bytes = out->back().data;
+    bytes.resize(accessor.count * static_cast<size_t>(component_size));
+    for (size_t k = 0; k < accessor.count; k++) {
+      unsigned int value =
+          static_cast<unsigned int>(triangles[offset - accessor.count + k]);
+      if (value > max_index) {
+        (*err) += "Decoded index doesn't fit the indices of its primitive.\n";
         return false;
       }
-      const std::string &childrenNode = childrenArray[i].get<std::string>();
-      node->children.push_back(childrenNode);
+      for (int b = 0; b < component_size; b++) {
+        bytes[k * component_size + b] =
+            static_cast<unsigned char>(value >> (8 * b));
+      }
     }
   }
+  if (header.num_int_attributes) {
+    std::stringstream ss;
+    ss << "Skipped " << header.num_int_attributes
+       << " int attribute(s) of an Open3DGC mesh: they are not supported.\n";
+    (*err) += ss.str();
+  }
+  return true;
+}
 
-  ParseExtrasProperty(&(node->extras), o);
-
+// Reads array `key` of the object `value` into `out`. Returns false if it is
+// missing or has a non-number.
+static bool GetValueNumbers(std::vector<double> *out, const Value &value,
+                            const std::string &key) {
+  out->clear();
+  if (!value.Has(key) || !value.Get(key).IsArray()) {
+    return false;
+  }
+  const Value &array = value.Get(key);
+  for (size_t i = 0; i < array.ArrayLen(); i++) {
+    const Value &number = array.Get(static_cast<int>(i));
+    if (number.IsNumber()) {
+      out->push_back(number.Get<double>());
+    } else if (number.IsInt()) {
+      out->push_back(static_cast<double>(number.Get<int>()));
+    } else {
+      return false;
+    }
+  }
   return true;
 }
 
-static bool ParseParameterProperty(Parameter *param, std::string *err,
-                                   const picojson::object &o,
-                                   const std::string &prop, bool required) {
-  double num_val;
+static const char *const kQuantizedAttributes = "WEB3D_quantized_attributes";
 
-  // A parameter value can either be a string or an array of either a boolean or
-  // a number. Booleans of any kind aren't supported here. Granted, it
-  // complicates the Parameter structure and breaks it semantically in the sense
-  // that the client probably works off the assumption that if the string is
-  // empty the vector is used, etc. Would a tagged union work?
-  if (ParseStringProperty(&param->string_value, err, o, prop, false)) {
-    // Found string property.
-    return true;
-  } else if (ParseNumberArrayProperty(&param->number_array, err, o, prop,
-                                      false)) {
-    // Found a number array.
-    return true;
-  } else if (ParseNumberProperty(&num_val, err, o, prop, false)) {
-    param->number_array.push_back(num_val);
+bool QuantizedAttribute::Init(const Accessor &accessor, std::string *err) {
+  decodeMatrix.clear();
+  decodedMin.clear();
+  decodedMax.clear();
+  numComponents = 0;
+
+  if (!accessor.extensions.Has(kQuantizedAttributes)) {
     return true;
-  } else {
-    if (required) {
-      if (err) {
-        (*err) += "parameter must be a string or number / number array.\n";
-      }
+  }
+  const Value &extension = accessor.extensions.Get(kQuantizedAttributes);
+  int n = GetTypeSizeInComponents(accessor.type);
+  std::vector<double> matrix;
+  if (!extension.IsObject() ||
+      !GetValueNumbers(&matrix, extension, "decodeMatrix") || (n < 1) ||
+      (n > 4) || (matrix.size() != static_cast<size_t>((n + 1) * (n + 1)))) {
+    if (err) {
+      (*err) += std::string("Invalid ") + kQuantizedAttributes +
+                " extension of an accessor.\n";
     }
     return false;
   }
-}
-
-static bool ParseMaterial(Material *material, std::string *err,
-                          const picojson::object &o) {
-  ParseStringProperty(&material->name, err, o, "name", false);
-  ParseStringProperty(&material->technique, err, o, "technique", false);
-
-  material->values.clear();
-  picojson::object::const_iterator valuesIt = o.find("values");
+  if (extension.Has("decodedMin")) {
+    GetValueNumbers(&decodedMin, extension, "decodedMin");
+  }
+  if (extension.Has("decodedMax")) {
+    GetValueNumbers(&decodedMax, extension, "decodedMax");
+  }
 
-  if ((valuesIt != o.end()) && (valuesIt->second).is<picojson::object>()) {
-    const picojson::object &values_object =
-        (valuesIt->second).get<picojson::object>();
+  decodeMatrix.resize(matrix.size());
+  for (size_t i = 0; i < matrix.size(); i++) {
+    decodeMatrix[i] = static_cast<float>(matrix[i]);
+  }
+  numComponents = n;
+  return true;
+}
 
-    picojson::object::const_iterator it(values_object.begin());
-    picojson::object::const_iterator itEnd(values_object.end());
+// Multiples of 1, 2, 3 and 4 components, so that a run of
+// kDequantizePeriod floats starts with the first component.
+static const size_t kDequantizePeriod = 12;
 
-    for (; it != itEnd; it++) {
-      Parameter param;
-      if (ParseParameterProperty(&param, err, values_object, it->first,
-                                 false)) {
-        material->values[it->first] = param;
-      }
-    }
+// values[i] = values[i] * scale[i % n] + offset[i % n] for `count` floats.
+static void ScaleOffsetScalar(float *values, size_t count, const float *scale,
+                              const float *offset, size_t n) {
+  for (size_t i = 0; i < count; i++) {
+    values[i] = values[i] * scale[i % n] + offset[i % n];
   }
+}
 
-  ParseExtrasProperty(&(material->extras), o);
+// The kernels take `scale` and `offset` repeated to kDequantizePeriod floats,
+// and return how many floats they processed, a multiple of it.
+
+#if defined(TINYGLTF_SIMD_X86)
+
+TINYGLTF_TARGET_SSSE3
+static size_t ScaleOffsetSSE(float *values, size_t count, const float *scale,
+                             const float *offset) {
+  __m128 s0 = _mm_loadu_ps(scale);
+  __m128 s1 = _mm_loadu_ps(scale + 4);
+  __m128 s2 = _mm_loadu_ps(scale + 8);
+  __m128 o0 = _mm_loadu_ps(offset);
+  __m128 o1 = _mm_loadu_ps(offset + 4);
+  __m128 o2 = _mm_loadu_ps(offset + 8);
+  size_t i = 0;
+  for (; i + kDequantizePeriod <= count; i += kDequantizePeriod) {
+    float *v = values + i;
+    _mm_storeu_ps(v, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(v), s0), o0));
+    _mm_storeu_ps(v + 4, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(v + 4), s1), o1));
+    _mm_storeu_ps(v + 8, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(v + 8), s2), o2));
+  }
+  return i;
+}
 
-  return true;
+// Two periods at a time.
+TINYGLTF_TARGET_AVX2
+static size_t ScaleOffsetAVX2(float *values, size_t count, const float *scale,
+                              const float *offset) {
+  float scale2[2 * kDequantizePeriod];
+  float offset2[2 * kDequantizePeriod];
+  memcpy(scale2, scale, kDequantizePeriod * sizeof(float));
+  memcpy(scale2 + kDequantizePeriod, scale, kDequantizePeriod * sizeof(float));
+  memcpy(offset2, offset, kDequantizePeriod * sizeof(float));
+  memcpy(offset2 + kDequantizePeriod, offset,
+         kDequantizePeriod * sizeof(float));
+  __m256 s0 = _mm256_loadu_ps(scale2);
+  __m256 s1 = _mm256_loadu_ps(scale2 + 8);
+  __m256 s2 = _mm256_loadu_ps(scale2 + 16);
+  __m256 o0 = _mm256_loadu_ps(offset2);
+  __m256 o1 = _mm256_loadu_ps(offset2 + 8);
+  __m256 o2 = _mm256_loadu_ps(offset2 + 16);
+  size_t i = 0;
+  for (; i + 2 * kDequantizePeriod <= count; i += 2 * kDequantizePeriod) {
+    float *v = values + i;
+    _mm256_storeu_ps(
+        v, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(v), s0), o0));
+    _mm256_storeu_ps(
+        v + 8, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(v + 8), s1), o1));
+    _mm256_storeu_ps(
+        v + 16, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(v + 16), s2), o2));
+  }
+  return i;
 }
 
-static bool ParseShader(Shader *shader, std::string *err,
-                        const picojson::object &o, const std::string &basedir,
-                        bool is_binary = false,
-                        const unsigned char *bin_data = NULL,
-                        size_t bin_size = 0) {
-  std::string uri;
-  if (!ParseStringProperty(&uri, err, o, "uri", true)) {
-    return false;
+static size_t ScaleOffsetSIMD(float *values, size_t count, const float *scale,
+                              const float *offset) {
+  int features = GetSIMDFeatures();
+  size_t i = 0;
+  if (features & TINYGLTF_SIMD_AVX2) {
+    i = ScaleOffsetAVX2(values, count, scale, offset);
   }
+  if (features & TINYGLTF_SIMD_SSSE3) {
+    i += ScaleOffsetSSE(values + i, count - i, scale, offset);
+  }
+  return i;
+}
 
-  if (is_binary) {
-    // Still binary glTF accepts external dataURI. First try external resources.
-    bool loaded = false;
-    if (IsDataURI(uri)) {
-      loaded = DecodeDataURI(&shader->source, uri, 0, false);
-    } else {
-      // Assume external .bin file.
-      loaded = LoadExternalFile(&shader->source, err, uri, basedir, 0, false);
-    }
-
-    if (!loaded) {
-      // load data from (embedded) binary data
+#elif defined(TINYGLTF_SIMD_NEON)
+
+static size_t ScaleOffsetSIMD(float *values, size_t count, const float *scale,
+                              const float *offset) {
+  float32x4_t s0 = vld1q_f32(scale);
+  float32x4_t s1 = vld1q_f32(scale + 4);
+  float32x4_t s2 = vld1q_f32(scale + 8);
+  float32x4_t o0 = vld1q_f32(offset);
+  float32x4_t o1 = vld1q_f32(offset + 4);
+  float32x4_t o2 = vld1q_f32(offset + 8);
+  size_t i = 0;
+  for (; i + kDequantizePeriod <= count; i += kDequantizePeriod) {
+    float *v = values + i;
+    vst1q_f32(v, vmlaq_f32(o0, vld1q_f32(v), s0));
+    vst1q_f32(v + 4, vmlaq_f32(o1, vld1q_f32(v + 4), s1));
+    vst1q_f32(v + 8, vmlaq_f32(o2, vld1q_f32(v + 8), s2));
+  }
+  return i;
+}
 
-      if ((bin_size == 0) || (bin_data == NULL)) {
-        if (err) {
-          (*err) += "Invalid binary data.\n";
-        }
-        return false;
-      }
+#else
 
-      // There should be "extensions" property.
-      // "extensions":{"KHR_binary_glTF":{"bufferView": "id", ...
+static size_t ScaleOffsetSIMD(float *values, size_t count, const float *scale,
+                              const float *offset) {
+  (void)values;
+  (void)count;
+  (void)scale;
+  (void)offset;
+  return 0;
+}
 
-      std::string buffer_view;
-      std::string mime_type;
-      int image_width;
-      int image_height;
-      bool ret = ParseKHRBinaryExtension(o, err, &buffer_view, &mime_type,
-                                         &image_width, &image_height);
-      if (!ret) {
-        return false;
-      }
+#endif
 
-      if (uri.compare("data:,") == 0) {
-        // ok
-      } else {
-        if (err) {
-          (*err) += "Invalid URI for binary data.\n";
-        }
-        return false;
+void QuantizedAttribute::Dequantize(float *out,
+                                    const AccessorReader &reader) const {
+  reader.ReadAsFloat(out);
+  size_t n = static_cast<size_t>(numComponents);
+  if ((n == 0) || (static_cast<size_t>(reader.NumComponents()) != n)) {
+    return;
+  }
+  size_t count = reader.Count() * n;
+  const float *m = &decodeMatrix[0];
+
+  // A scale and an offset per component, when the upper n x n part of the
+  // matrix is diagonal.
+  bool diagonal = true;
+  for (size_t c = 0; c < n; c++) {
+    for (size_t row = 0; row < n; row++) {
+      diagonal = diagonal && ((row == c) || (m[c * (n + 1) + row] == 0.0f));
+    }
+  }
+  if (diagonal) {
+    float scale[kDequantizePeriod];
+    float offset[kDequantizePeriod];
+    for (size_t i = 0; i < kDequantizePeriod; i++) {
+      scale[i] = m[(i % n) * (n + 2)];
+      offset[i] = m[n * (n + 1) + (i % n)];
+    }
+    size_t i = ScaleOffsetSIMD(out, count, scale, offset);
+    ScaleOffsetScalar(out + i, count - i, scale, offset, n);
+    return;
+  }
+
+  for (size_t i = 0; i < count; i += n) {
+    float q[4];
+    memcpy(q, out + i, n * sizeof(float));
+    for (size_t row = 0; row < n; row++) {
+      float v = m[n * (n + 1) + row];
+      for (size_t c = 0; c < n; c++) {
+        v += m[c * (n + 1) + row] * q[c];
       }
+      out[i + row] = v;
     }
-  } else {
-    // Load shader source from data uri
-    // TODO(syoyo): Support ascii or utf-8 data uris.
-    if (IsDataURI(uri)) {
-      if (!DecodeDataURI(&shader->source, uri, 0, false)) {
-        if (err) {
-          (*err) += "Failed to decode 'uri' for shader parameter.\n";
-        }
-        return false;
+  }
+}
+
+// Range of the integers of `component_type` for QuantizeAttributes. Returns
+// false for other types.
+static bool GetQuantizedRange(double *lo, double *hi, int component_type) {
+  switch (component_type) {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+      *lo = -128.0;
+      *hi = 127.0;
+      return true;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      *lo = 0.0;
+      *hi = 255.0;
+      return true;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+      *lo = -32768.0;
+      *hi = 32767.0;
+      return true;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      *lo = 0.0;
+      *hi = 65535.0;
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Quantized data of an accessor, waiting to be stored by QuantizeAttributes.
+typedef struct {
+  std::string accessor;
+  std::string buffer;  // Which held the float data.
+  std::vector<unsigned char> data;
+} QuantizedData;
+
+// Quantizes the float elements of `reader` into `out`, and sets the bounds
+// and the extension of `accessor`.
+static void QuantizeAccessor(QuantizedData *out, Accessor *accessor,
+                             const AccessorReader &reader,
+                             int component_type) {
+  size_t n = static_cast<size_t>(reader.NumComponents());
+  size_t count = reader.Count();
+  std::vector<float> values(count * n);
+  if (!values.empty()) {
+    reader.ReadAsFloat(&values[0]);
+  }
+
+  std::vector<double> lo(n, 0.0);
+  std::vector<double> hi(n, 0.0);
+  std::vector<bool> found(n, false);
+  for (size_t i = 0; i < values.size(); i++) {
+    double v = static_cast<double>(values[i]);
+    size_t c = i % n;
+    if (v != v) {
+      continue;
+    }
+    lo[c] = found[c] ? std::min(lo[c], v) : v;
+    hi[c] = found[c] ? std::max(hi[c], v) : v;
+    found[c] = true;
+  }
+
+  double q_lo = 0.0;
+  double q_hi = 0.0;
+  GetQuantizedRange(&q_lo, &q_hi, component_type);
+  std::vector<double> scale(n);
+  for (size_t c = 0; c < n; c++) {
+    scale[c] = (hi[c] > lo[c]) ? (hi[c] - lo[c]) / (q_hi - q_lo) : 1.0;
+  }
+
+  size_t component_size =
+      static_cast<size_t>(GetComponentSizeInBytes(component_type));
+  out->data.resize(values.size() * component_size);
+  std::vector<double> q_min(n, q_hi);
+  std::vector<double> q_max(n, q_lo);
+  for (size_t i = 0; i < values.size(); i++) {
+    size_t c = i % n;
+    double q = std::floor((values[i] - lo[c]) / scale[c] + 0.5) + q_lo;
+    if (!(q >= q_lo)) {
+      q = q_lo;  // Also NaN.
+    } else if (q > q_hi) {
+      q = q_hi;
+    }
+    q_min[c] = std::min(q_min[c], q);
+    q_max[c] = std::max(q_max[c], q);
+    unsigned char *dst = &out->data[i * component_size];
+    if (component_size == 1) {
+      if (q_lo < 0.0) {
+        signed char b = static_cast<signed char>(q);
+        memcpy(dst, &b, 1);
+      } else {
+        *dst = static_cast<unsigned char>(q);
       }
     } else {
-      // Assume external file
-      if (!LoadExternalFile(&shader->source, err, uri, basedir, 0, false)) {
-        if (err) {
-          (*err) += "Failed to load external 'uri' for shader parameter.\n";
-        }
-        return false;
+      if (q_lo < 0.0) {
+        short s = static_cast<short>(q);
+        memcpy(dst, &s, 2);
+      } else {
+        unsigned short s = static_cast<unsigned short>(q);
+        memcpy(dst, &s, 2);
       }
-      if (shader->source.empty()) {
-        if (err) {
-          (*err) += "shader is empty.\n";  // This may be OK?
-        }
-        return false;
+    }
+  }
+
+  accessor->componentType = component_type;
+  accessor->byteStride = 0;
+  accessor->minValues.clear();
+  accessor->maxValues.clear();
+  if (count > 0) {
+    accessor->minValues.assign(q_min.begin(), q_min.end());
+    accessor->maxValues.assign(q_max.begin(), q_max.end());
+  }
+
+  // decoded = q * scale + (lo - q_lo * scale), column major.
+  accessor->extensions.SetType(OBJECT_TYPE);
+  Value &quantized =
+      accessor->extensions.Get<Value::Object>()[kQuantizedAttributes];
+  quantized.SetType(OBJECT_TYPE);
+  Value::Object &extension = quantized.Get<Value::Object>();
+  Value::Array matrix;
+  for (size_t c = 0; c <= n; c++) {
+    for (size_t row = 0; row <= n; row++) {
+      double v = 0.0;
+      if (c < n) {
+        v = (row == c) ? scale[c] : 0.0;
+      } else {
+        v = (row < n) ? (lo[row] - q_lo * scale[row]) : 1.0;
       }
+      matrix.push_back(Value(v));
     }
   }
+  Value::Array decoded_min;
+  Value::Array decoded_max;
+  for (size_t c = 0; c < n; c++) {
+    decoded_min.push_back(Value(lo[c]));
+    decoded_max.push_back(Value(hi[c]));
+  }
+  Value(matrix).Swap(extension["decodeMatrix"]);
+  Value(decoded_min).Swap(extension["decodedMin"]);
+  Value(decoded_max).Swap(extension["decodedMax"]);
+}
 
-  double type;
-  if (!ParseNumberProperty(&type, err, o, "type", true)) {
+bool QuantizeAttributes(Scene *scene, std::string *err,
+                        const std::string &semantic, int component_type) {
+  double q_lo, q_hi;
+  if (!GetQuantizedRange(&q_lo, &q_hi, component_type)) {
+    if (err) {
+      (*err) += "Invalid component type to quantize attributes to.\n";
+    }
     return false;
   }
 
-  shader->type = static_cast<int>(type);
+  std::set<std::string> ids;
+  for (SceneMap<Mesh>::type::const_iterator it = scene->meshes.begin();
+       it != scene->meshes.end(); it++) {
+    for (size_t i = 0; i < it->second.primitives.size(); i++) {
+      const StringMap &attributes = it->second.primitives[i].attributes;
+      StringMap::const_iterator attribute = attributes.find(semantic);
+      if (attribute != attributes.end()) {
+        ids.insert(attribute->second);
+      }
+    }
+  }
 
-  ParseExtrasProperty(&(shader->extras), o);
+  bool ret = true;
+  std::vector<QuantizedData> quantized;
+  std::set<std::string> views;
+  for (std::set<std::string>::const_iterator id = ids.begin();
+       id != ids.end(); id++) {
+    SceneMap<Accessor>::type::iterator accessor = scene->accessors.find(*id);
+    if (accessor == scene->accessors.end()) {
+      if (err) {
+        (*err) += "accessor `" + *id + "` not found.\n";
+      }
+      ret = false;
+      continue;
+    }
+    if (accessor->second.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
+      continue;  // Already integers.
+    }
+    AccessorReader reader;
+    if (!reader.Init(*scene, accessor->second, err)) {
+      ret = false;
+      continue;
+    }
+    if (reader.NumComponents() > 4) {
+      if (err) {
+        (*err) += "accessor `" + *id + "` has too many components to be " +
+                  "quantized.\n";
+      }
+      ret = false;
+      continue;
+    }
 
-  return true;
+    quantized.push_back(QuantizedData());
+    QuantizedData &data = quantized.back();
+    data.accessor = *id;
+    data.buffer = scene->bufferViews[accessor->second.bufferView].buffer;
+    views.insert(accessor->second.bufferView);
+    QuantizeAccessor(&data, &accessor->second, reader, component_type);
+    accessor->second.bufferView.clear();
+  }
+
+  // Drops the float data before adding the quantized data, so that the
+  // buffers don't grow.
+  std::set<std::string> buffers;
+  RemoveUnusedBufferViews(scene, &buffers, views);
+  for (std::set<std::string>::const_iterator it = buffers.begin();
+       it != buffers.end(); it++) {
+    CompactBuffer(scene, *it);
+  }
+
+  std::map<std::string, std::string> view_ids;  // By buffer.
+  for (size_t i = 0; i < quantized.size(); i++) {
+    const QuantizedData &data = quantized[i];
+    Buffer &buffer = scene->buffers[data.buffer];
+    buffer.MakeOwned();
+    std::string &view_id = view_ids[data.buffer];
+    if (view_id.empty()) {
+      view_id = UniqueId(scene->bufferViews, data.buffer + "_quantized");
+      BufferView &view = scene->bufferViews[view_id];
+      view.buffer = data.buffer;
+      view.byteOffset = (buffer.data.size() + 15) & ~static_cast<size_t>(15);
+      view.byteLength = 0;
+      view.target = TINYGLTF_TARGET_ARRAY_BUFFER;
+      view.pad0 = 0;
+    }
+    BufferView &view = scene->bufferViews[view_id];
+    Accessor &accessor = scene->accessors[data.accessor];
+    accessor.bufferView = view_id;
+    accessor.byteOffset = (view.byteLength + 3) & ~static_cast<size_t>(3);
+    view.byteLength = accessor.byteOffset + data.data.size();
+    buffer.data.resize(view.byteOffset + view.byteLength);
+    if (!data.data.empty()) {
+      memcpy(&buffer.data[view.byteOffset + accessor.byteOffset],
+             &data.data[0], data.data.size());
+    }
+  }
+
+  return ret;
 }
 
-static bool ParseProgram(Program *program, std::string *err,
-                         const picojson::object &o) {
-  ParseStringProperty(&program->name, err, o, "name", false);
+// Computes the heap usage of Scene objects for ComputeMemoryUsage(). Each
+// Of() returns the bytes owned by an object, excluding the object itself.
+class MemoryCounter {
+ public:
+  explicit MemoryCounter(MemoryUsage *usage) : usage_(usage) {}
 
-  if (!ParseStringProperty(&program->vertexShader, err, o, "vertexShader",
-                           true)) {
-    return false;
-  }
-  if (!ParseStringProperty(&program->fragmentShader, err, o, "fragmentShader",
-                           true)) {
-    return false;
+  size_t Of(const std::string &s) {
+    size_t n = StringHeapSize(s);
+    usage_->strings += n;
+    return n;
   }
 
-  // I suppose the list of attributes isn't needed, but a technique doesn't
-  // really make sense without it.
-  ParseStringArrayProperty(&program->attributes, err, o, "attributes", false);
-
-  ParseExtrasProperty(&(program->extras), o);
-
-  return true;
-}
+  template <typename T, typename A>
+  size_t Of(const std::vector<T, A> &v) {
+    size_t n = v.capacity() * sizeof(T);
+    for (size_t i = 0; i < v.size(); i++) {
+      n += Of(v[i]);
+    }
+    return n;
+  }
+
+  // Includes the map nodes.
+  template <typename T, typename C, typename A>
+  size_t Of(const std::map<std::string, T, C, A> &m) {
+    size_t n = 0;
+    typename std::map<std::string, T, C, A>::const_iterator it(m.begin());
+    for (; it != m.end(); ++it) {
+      n += kMapNodeOverhead +
+           sizeof(typename std::map<std::string, T, C, A>::value_type) +
+           Of(it->first) + Of(it->second);
+    }
+    return n;
+  }
+
+  size_t Of(double) { return 0; }
+  size_t Of(unsigned char) { return 0; }
+
+  // Heap kinds of Value live in a block of their own.
+  size_t Of(const Value &v) {
+    size_t n = 0;
+    if (v.IsRawJSON()) {
+      // Not parsed yet, and kept so.
+      n += sizeof(std::string) + Of(v.RawJSON());
+    } else if (v.IsString()) {
+      n += sizeof(std::string) + Of(v.Get<std::string>());
+    } else if (v.IsBinary()) {
+      n += sizeof(std::vector<unsigned char>) +
+           Of(v.Get<std::vector<unsigned char> >());
+    } else if (v.IsArray()) {
+      n += sizeof(Value::Array) + Of(v.Get<Value::Array>());
+    } else if (v.IsObject()) {
+      n += sizeof(Value::Object) + Of(v.Get<Value::Object>());
+    }
+    return n;
+  }
 
-static bool ParseTechniqueParameter(TechniqueParameter *param, std::string *err,
-                                    const picojson::object &o) {
-  double count = 1;
-  ParseNumberProperty(&count, err, o, "count", false);
+  // `extras` and `extensions` of an object.
+  template <typename T>
+  size_t OfExtras(const T &object) {
+    size_t n = Of(object.extras) + Of(object.extensions);
+    usage_->extras += n;
+    return n;
+  }
 
-  double type;
-  if (!ParseNumberProperty(&type, err, o, "type", true)) {
-    return false;
+  size_t Of(const Parameter &p) {
+    return Of(p.string_value) + Of(p.number_array);
   }
 
-  ParseStringProperty(&param->node, err, o, "node", false);
-  ParseStringProperty(&param->semantic, err, o, "semantic", false);
+  size_t Of(const Accessor &a) {
+    return Of(a.bufferView) + Of(a.name) + Of(a.minValues) +
+           Of(a.maxValues) + OfExtras(a);
+  }
 
-  ParseParameterProperty(&param->value, err, o, "value", false);
+  size_t Of(const AnimationChannel &c) {
+    return Of(c.sampler) + Of(c.target_id) + Of(c.target_path) +
+           OfExtras(c);
+  }
 
-  param->count = static_cast<int>(count);
-  param->type = static_cast<int>(type);
+  size_t Of(const AnimationSampler &s) {
+    return Of(s.input) + Of(s.interpolation) + Of(s.output) +
+           OfExtras(s);
+  }
 
-  return true;
-}
+  size_t Of(const Animation &a) {
+    return Of(a.name) + Of(a.channels) + Of(a.samplers) + Of(a.parameters) +
+           OfExtras(a);
+  }
 
-static bool ParseTechnique(Technique *technique, std::string *err,
-                           const picojson::object &o) {
-  ParseStringProperty(&technique->name, err, o, "name", false);
+  size_t Of(const Buffer &b) {
+    size_t data = b.data.capacity();
+    usage_->bufferData += data;
+    if (b.IsView()) {
+      usage_->sharedData += b.Size();
+    }
+    return Of(b.name) + data + OfExtras(b);
+  }
 
-  if (!ParseStringProperty(&technique->program, err, o, "program", true)) {
-    return false;
+  size_t Of(const BufferView &v) {
+    return Of(v.name) + Of(v.buffer) + OfExtras(v);
   }
 
-  ParseStringMapProperty(&technique->attributes, err, o, "attributes", false);
-  ParseStringMapProperty(&technique->uniforms, err, o, "uniforms", false);
+  size_t Of(const Material &m) {
+    return Of(m.name) + Of(m.technique) + Of(m.values) + OfExtras(m);
+  }
 
-  technique->parameters.clear();
-  picojson::object::const_iterator paramsIt = o.find("parameters");
+  size_t Of(const Primitive &p) {
+    return Of(p.attributes) + Of(p.material) + Of(p.indices) +
+           OfExtras(p);
+  }
 
-  // Verify parameters is an object
-  if ((paramsIt != o.end()) && (paramsIt->second).is<picojson::object>()) {
-    // For each parameter in params_object.
-    const picojson::object &params_object =
-        (paramsIt->second).get<picojson::object>();
+  size_t Of(const Mesh &m) {
+    return Of(m.name) + Of(m.primitives) + OfExtras(m);
+  }
 
-    picojson::object::const_iterator it(params_object.begin());
-    picojson::object::const_iterator itEnd(params_object.end());
+  size_t Of(const Node &n) {
+    return Of(n.camera) + Of(n.name) + Of(n.children) + Of(n.rotation) +
+           Of(n.scale) + Of(n.translation) + Of(n.matrix) + Of(n.meshes) +
+           Of(n.jointName) + Of(n.skeletons) + Of(n.skin) + OfExtras(n);
+  }
 
-    for (; it != itEnd; it++) {
-      TechniqueParameter param;
+  size_t Of(const Skin &s) {
+    return Of(s.name) + Of(s.bindShapeMatrix) + Of(s.inverseBindMatrices) +
+           Of(s.jointNames) + OfExtras(s);
+  }
 
-      // Skip non-objects
-      if (!it->second.is<picojson::object>()) continue;
+  size_t Of(const Texture &t) {
+    return Of(t.sampler) + Of(t.source) + Of(t.name) + OfExtras(t);
+  }
 
-      // Parse the technique parameter
-      const picojson::object &param_obj = it->second.get<picojson::object>();
-      if (ParseTechniqueParameter(&param, err, param_obj)) {
-        // Add if successful
-        technique->parameters[it->first] = param;
-      }
-    }
+  size_t Of(const Image &image) {
+    size_t pixels = image.image.capacity();
+    size_t encoded = image.encoded.capacity();
+    usage_->pixels += pixels;
+    usage_->encodedImages += encoded;
+    return Of(image.name) + pixels + Of(image.bufferView) +
+           Of(image.mimeType) + Of(image.encodedPath) + encoded +
+           OfExtras(image);
   }
 
-  ParseExtrasProperty(&(technique->extras), o);
+  size_t Of(const Shader &shader) {
+    return Of(shader.name) + Of(shader.source) + OfExtras(shader);
+  }
 
-  return true;
-}
+  size_t Of(const Program &program) {
+    return Of(program.name) + Of(program.vertexShader) +
+           Of(program.fragmentShader) + Of(program.attributes) +
+           OfExtras(program);
+  }
 
-static bool ParseAnimationChannel(AnimationChannel *channel, std::string *err,
-                                  const picojson::object &o) {
-  if (!ParseStringProperty(&channel->sampler, err, o, "sampler", true)) {
-    if (err) {
-      (*err) += "`sampler` field is missing in animation channels\n";
-    }
-    return false;
+  size_t Of(const TechniqueParameter &p) {
+    return Of(p.node) + Of(p.semantic) + Of(p.value);
   }
 
-  picojson::object::const_iterator targetIt = o.find("target");
-  if ((targetIt != o.end()) && (targetIt->second).is<picojson::object>()) {
-    const picojson::object &target_object =
-        (targetIt->second).get<picojson::object>();
+  size_t Of(const Technique &t) {
+    return Of(t.name) + Of(t.program) + Of(t.parameters) + Of(t.attributes) +
+           Of(t.uniforms) + OfExtras(t);
+  }
 
-    if (!ParseStringProperty(&channel->target_id, err, target_object, "id",
-                             true)) {
-      if (err) {
-        (*err) += "`id` field is missing in animation.channels.target\n";
-      }
-      return false;
-    }
+  size_t Of(const Sampler &s) { return Of(s.name) + OfExtras(s); }
 
-    if (!ParseStringProperty(&channel->target_path, err, target_object, "path",
-                             true)) {
-      if (err) {
-        (*err) += "`path` field is missing in animation.channels.target\n";
-      }
-      return false;
-    }
+  size_t Of(const Asset &a) {
+    return Of(a.generator) + Of(a.version) + Of(a.profile_api) +
+           Of(a.profile_version) + OfExtras(a);
   }
 
-  ParseExtrasProperty(&(channel->extras), o);
+ private:
+  MemoryUsage *usage_;
+};
 
-  return true;
+void ComputeMemoryUsage(MemoryUsage *usage, const Scene &scene) {
+  memset(usage, 0, sizeof(MemoryUsage));
+
+  MemoryCounter counter(usage);
+  usage->accessors = counter.Of(scene.accessors);
+  usage->animations = counter.Of(scene.animations);
+  usage->buffers = counter.Of(scene.buffers);
+  usage->bufferViews = counter.Of(scene.bufferViews);
+  usage->materials = counter.Of(scene.materials);
+  usage->meshes = counter.Of(scene.meshes);
+  usage->nodes = counter.Of(scene.nodes);
+  usage->textures = counter.Of(scene.textures);
+  usage->images = counter.Of(scene.images);
+  usage->shaders = counter.Of(scene.shaders);
+  usage->programs = counter.Of(scene.programs);
+  usage->techniques = counter.Of(scene.techniques);
+  usage->samplers = counter.Of(scene.samplers);
+  usage->skins = counter.Of(scene.skins);
+  usage->scenes = counter.Of(scene.scenes);
+  usage->other = sizeof(Scene) + counter.Of(scene.defaultScene) +
+                 counter.Of(scene.asset) + counter.OfExtras(scene);
+
+  usage->total = usage->accessors + usage->animations + usage->buffers +
+                 usage->bufferViews + usage->materials + usage->meshes +
+                 usage->nodes + usage->textures + usage->images +
+                 usage->shaders + usage->programs + usage->techniques +
+                 usage->samplers + usage->skins + usage->scenes +
+                 usage->other;
 }
 
-static bool ParseAnimation(Animation *animation, std::string *err,
-                           const picojson::object &o) {
-  {
-    picojson::object::const_iterator channelsIt = o.find("channels");
-    if ((channelsIt != o.end()) && (channelsIt->second).is<picojson::array>()) {
-      const picojson::array &channelArray =
-          (channelsIt->second).get<picojson::array>();
-      for (size_t i = 0; i < channelArray.size(); i++) {
-        AnimationChannel channel;
-        if (ParseAnimationChannel(&channel, err,
-                                  channelArray[i].get<picojson::object>())) {
-          // Only add the channel if the parsing succeeds.
-          animation->channels.push_back(channel);
-        }
-      }
+// Counts the items of sections while parsing, and reads only asset, accessor
+// counts and mesh primitives. Everything else is skipped by SkipJSONValue().
+class SceneScanner {
+ public:
+  explicit SceneScanner(SceneSummary *summary) : summary_(summary) {
+    for (int i = 0; i < SECTION_UNKNOWN; i++) {
+      counts_[i] = 0;
     }
   }
 
-  {
-    picojson::object::const_iterator samplerIt = o.find("samplers");
-    if ((samplerIt != o.end()) && (samplerIt->second).is<picojson::object>()) {
-      const picojson::object &sampler_object =
-          (samplerIt->second).get<picojson::object>();
+  // Fills the counts of `summary`. Must be called after parsing.
+  void Finish();
 
-      picojson::object::const_iterator it = sampler_object.begin();
-      picojson::object::const_iterator itEnd = sampler_object.end();
+  // -- picojson parse context interface for the root object --
 
-      for (; it != itEnd; it++) {
-        // Skip non-objects
-        if (!it->second.is<picojson::object>()) continue;
+  bool set_null() { return true; }
+  bool set_bool(bool) { return true; }
+#ifdef PICOJSON_USE_INT64
+  bool set_int64(int64_t) { return true; }
+#endif
+  bool set_number(double) { return true; }
+  template <typename Iter>
+  bool parse_string(picojson::input<Iter> &in) {
+    picojson::null_parse_context ctx;
+    return ctx.parse_string(in);
+  }
+  bool parse_array_start() { return true; }
+  template <typename Iter>
+  bool parse_array_item(picojson::input<Iter> &in, size_t) {
+    return SkipJSONValue(in);
+  }
+  bool parse_array_stop(size_t) { return true; }
+  bool parse_object_start() { return true; }
+  template <typename Iter>
+  bool parse_object_item(picojson::input<Iter> &in, const std::string &key);
 
-        const picojson::object &s = it->second.get<picojson::object>();
+ private:
+  // Parse context for the dictionary of a top level section.
+  class SectionContext {
+   public:
+    SectionContext(SceneScanner *scanner, SectionKind kind)
+        : scanner_(scanner), kind_(kind) {}
+
+    bool set_null() { return true; }
+    bool set_bool(bool) { return true; }
+#ifdef PICOJSON_USE_INT64
+    bool set_int64(int64_t) { return true; }
+#endif
+    bool set_number(double) { return true; }
+    template <typename Iter>
+    bool parse_string(picojson::input<Iter> &in) {
+      picojson::null_parse_context ctx;
+      return ctx.parse_string(in);
+    }
+    bool parse_array_start() { return true; }
+    template <typename Iter>
+    bool parse_array_item(picojson::input<Iter> &in, size_t) {
+      return SkipJSONValue(in);
+    }
+    bool parse_array_stop(size_t) { return true; }
+    bool parse_object_start() { return true; }
+    template <typename Iter>
+    bool parse_object_item(picojson::input<Iter> &in, const std::string &id);
+
+   private:
+    SceneScanner *scanner_;
+    SectionKind kind_;
+  };
+
+  SceneScanner(const SceneScanner &);
+  SceneScanner &operator=(const SceneScanner &);
+
+  SceneSummary *summary_;
+  int counts_[SECTION_UNKNOWN];
+  std::map<std::string, size_t> accessor_counts_;
+  std::vector<std::string> position_accessors_;
+  std::vector<std::string> index_accessors_;
+};
 
-        AnimationSampler sampler;
-        if (!ParseStringProperty(&sampler.input, err, s, "input", true)) {
-          if (err) {
-            (*err) += "`input` field is missing in animation.sampler\n";
-          }
-          return false;
-        }
-        if (!ParseStringProperty(&sampler.interpolation, err, s,
-                                 "interpolation", true)) {
-          if (err) {
-            (*err) += "`interpolation` field is missing in animation.sampler\n";
-          }
-          return false;
-        }
-        if (!ParseStringProperty(&sampler.output, err, s, "output", true)) {
-          if (err) {
-            (*err) += "`output` field is missing in animation.sampler\n";
-          }
-          return false;
-        }
+template <typename Iter>
+bool SceneScanner::parse_object_item(picojson::input<Iter> &in,
+                                     const std::string &key) {
+  SectionKind kind = FindSectionKind(key);
+  if (kind != SECTION_UNKNOWN) {
+    SectionContext ctx(this, kind);
+    return picojson::_parse(ctx, in);
+  }
 
-        animation->samplers[it->first] = sampler;
+  if ((key.compare("asset") == 0) || (key.compare("scene") == 0)) {
+    picojson::value v;
+    picojson::default_parse_context ctx(&v);
+    if (!picojson::_parse(ctx, in)) {
+      return false;
+    }
+
+    if (key.compare("scene") == 0) {
+      if (v.is<std::string>()) {
+        summary_->defaultScene = v.get<std::string>();
       }
+    } else if (v.is<picojson::object>()) {
+      ParseAsset(&summary_->asset, NULL, v.get<picojson::object>());
     }
+    return true;
   }
 
-  picojson::object::const_iterator parametersIt = o.find("parameters");
-  if ((parametersIt != o.end()) &&
-      (parametersIt->second).is<picojson::object>()) {
-    const picojson::object &parameters_object =
-        (parametersIt->second).get<picojson::object>();
+  return SkipJSONValue(in);
+}
 
-    picojson::object::const_iterator it(parameters_object.begin());
-    picojson::object::const_iterator itEnd(parameters_object.end());
+template <typename Iter>
+bool SceneScanner::SectionContext::parse_object_item(
+    picojson::input<Iter> &in, const std::string &id) {
+  scanner_->counts_[kind_]++;
+
+  if ((kind_ != SECTION_ACCESSORS) && (kind_ != SECTION_MESHES)) {
+    return SkipJSONValue(in);
+  }
+
+  picojson::value v;
+  picojson::default_parse_context ctx(&v);
+  if (!picojson::_parse(ctx, in)) {
+    return false;
+  }
+  if (!v.is<picojson::object>()) {
+    return true;
+  }
+  const picojson::object &o = v.get<picojson::object>();
 
-    for (; it != itEnd; it++) {
-      Parameter param;
-      if (ParseParameterProperty(&param, err, parameters_object, it->first,
-                                 false)) {
-        animation->parameters[it->first] = param;
-      }
-    }
+  if (kind_ == SECTION_ACCESSORS) {
+    double count = 0.0;
+    ParseNumberProperty(&count, NULL, o, "count", false);
+    scanner_->accessor_counts_[id] = static_cast<size_t>(count);
+    return true;
   }
-  ParseStringProperty(&animation->name, err, o, "name", false);
 
-  ParseExtrasProperty(&(animation->extras), o);
+  Mesh mesh;
+  ParseMesh(&mesh, NULL, o);
+  for (size_t i = 0; i < mesh.primitives.size(); i++) {
+    const Primitive &primitive = mesh.primitives[i];
+    StringMap::const_iterator position =
+        primitive.attributes.find("POSITION");
+    if (position != primitive.attributes.end()) {
+      scanner_->position_accessors_.push_back(position->second);
+    }
+    if (!primitive.indices.empty()) {
+      scanner_->index_accessors_.push_back(primitive.indices);
+    }
+  }
+  scanner_->summary_->numPrimitives += static_cast<int>(mesh.primitives.size());
 
   return true;
 }
 
-static bool ParseSampler(Sampler *sampler, std::string *err,
-                         const picojson::object &o) {
-  ParseStringProperty(&sampler->name, err, o, "name", false);
+void SceneScanner::Finish() {
+  summary_->numBuffers = counts_[SECTION_BUFFERS];
+  summary_->numBufferViews = counts_[SECTION_BUFFER_VIEWS];
+  summary_->numAccessors = counts_[SECTION_ACCESSORS];
+  summary_->numMeshes = counts_[SECTION_MESHES];
+  summary_->numNodes = counts_[SECTION_NODES];
+  summary_->numScenes = counts_[SECTION_SCENES];
+  summary_->numMaterials = counts_[SECTION_MATERIALS];
+  summary_->numImages = counts_[SECTION_IMAGES];
+  summary_->numTextures = counts_[SECTION_TEXTURES];
+  summary_->numShaders = counts_[SECTION_SHADERS];
+  summary_->numPrograms = counts_[SECTION_PROGRAMS];
+  summary_->numTechniques = counts_[SECTION_TECHNIQUES];
+  summary_->numAnimations = counts_[SECTION_ANIMATIONS];
+  summary_->numSamplers = counts_[SECTION_SAMPLERS];
+  summary_->numSkins = counts_[SECTION_SKINS];
+
+  // Accessors may appear after meshes in the document.
+  std::map<std::string, size_t>::const_iterator it;
+  for (size_t i = 0; i < position_accessors_.size(); i++) {
+    it = accessor_counts_.find(position_accessors_[i]);
+    if (it != accessor_counts_.end()) {
+      summary_->vertexCount += it->second;
+    }
+  }
+  for (size_t i = 0; i < index_accessors_.size(); i++) {
+    it = accessor_counts_.find(index_accessors_[i]);
+    if (it != accessor_counts_.end()) {
+      summary_->indexCount += it->second;
+    }
+  }
+}
 
-  double minFilter =
-      static_cast<double>(TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR);
-  double magFilter = static_cast<double>(TINYGLTF_TEXTURE_FILTER_LINEAR);
-  double wrapS = static_cast<double>(TINYGLTF_TEXTURE_WRAP_RPEAT);
-  double wrapT = static_cast<double>(TINYGLTF_TEXTURE_WRAP_RPEAT);
-  ParseNumberProperty(&minFilter, err, o, "minFilter", false);
-  ParseNumberProperty(&magFilter, err, o, "magFilter", false);
-  ParseNumberProperty(&wrapS, err, o, "wrapS", false);
-  ParseNumberProperty(&wrapT, err, o, "wrapT", false);
+// Generation of the next constructed or cleared `Scene`.
+static long g_scene_generation = 0;
 
-  sampler->minFilter = static_cast<int>(minFilter);
-  sampler->magFilter = static_cast<int>(magFilter);
-  sampler->wrapS = static_cast<int>(wrapS);
-  sampler->wrapT = static_cast<int>(wrapT);
+Scene::Scene() : generation(AtomicIncrement(&g_scene_generation)) {}
 
-  ParseExtrasProperty(&(sampler->extras), o);
+// Empties `c`. Swapping with a new container also binds it to the current
+// arena(TINYGLTF_USE_ARENA).
+template <typename T>
+static void ClearContainer(T *c) {
+  T().swap(*c);
+}
 
-  return true;
+void Scene::Clear() {
+  generation = AtomicIncrement(&g_scene_generation);
+  ClearContainer(&accessors);
+  ClearContainer(&animations);
+  ClearContainer(&buffers);
+  ClearContainer(&bufferViews);
+  ClearContainer(&materials);
+  ClearContainer(&meshes);
+  ClearContainer(&nodes);
+  ClearContainer(&textures);
+  ClearContainer(&images);
+  ClearContainer(&shaders);
+  ClearContainer(&programs);
+  ClearContainer(&techniques);
+  ClearContainer(&samplers);
+  ClearContainer(&skins);
+  ClearContainer(&scenes);
+  defaultScene.clear();
+  asset = Asset();
+  asset.premultipliedAlpha = false;
+  extras = Value();
+  extensions = Value();
+}
+
+void TinyGLTFLoader::RecycleScene(Scene *scene) {
+  for (SceneMap<Buffer>::type::iterator it(scene->buffers.begin());
+       it != scene->buffers.end(); it++) {
+    PoolPayload(&payloads_, &it->second.data);
+  }
+  for (SceneMap<Image>::type::iterator it(scene->images.begin());
+       it != scene->images.end(); it++) {
+    PoolPayload(&payloads_, &it->second.image);
+    PoolPayload(&payloads_, &it->second.encoded);
+  }
+  for (SceneMap<Shader>::type::iterator it(scene->shaders.begin());
+       it != scene->shaders.end(); it++) {
+    PoolPayload(&payloads_, &it->second.source);
+  }
+  scene->Clear();
 }
 
+void TinyGLTFLoader::ReleaseScratch() { PayloadPool().swap(payloads_); }
+
 bool TinyGLTFLoader::LoadFromString(Scene *scene, std::string *err,
                                     const char *str, unsigned int length,
                                     const std::string &base_dir,
                                     unsigned int check_sections) {
-  picojson::value v;
-  std::string perr = picojson::parse(v, str, str + length);
+  ScopedLoadStats stats(load_stats_);
+#ifdef TINYGLTF_USE_ARENA
+  ScopedArena arena(arena_);
+#endif
+  ScopedPayloadPool payloads(&payloads_);
+
+  scene->Clear();
+
+  SceneParser parser(scene, err, base_dir, use_mmap_, is_binary_, bin_data_,
+                     bin_size_, bin_storage_);
+#ifdef TINYGLTF_USE_THREADS
+  bool parallel = (executor_ != NULL) || (num_threads_ > 1);
+#else
+  bool parallel = (executor_ != NULL);
+#endif
+  if (parallel) {
+    parser.SetParallel(executor_, executor_data_, num_threads_);
+  }
+  parser.SetDeferredImageDecoding(defer_image_decoding_);
+  parser.SetLazyExtras(lazy_extras_);
+  parser.SetLoadSections(load_sections_);
+
+  std::string perr;
+  picojson::_parse(parser, str, str + length, &perr);
+
+  // Deferred loads precede any error which stopped parsing.
+  if (!parser.FinishLoadTasks()) {
+    return false;
+  }
+
+  if (parser.Failed()) {
+    return false;
+  }
 
   if (!perr.empty()) {
     if (err) {
@@ -2157,7 +12587,7 @@ bool TinyGLTFLoader::LoadFromString(Scene *scene, std::string *err,
     return false;
   }
 
-  if (v.contains("scene") && v.get("scene").is<std::string>()) {
+  if (parser.HasDefaultScene()) {
     // OK
   } else if (check_sections & REQUIRE_SCENE) {
     if (err) {
@@ -2166,7 +12596,7 @@ bool TinyGLTFLoader::LoadFromString(Scene *scene, std::string *err,
     return false;
   }
 
-  if (v.contains("scenes") && v.get("scenes").is<picojson::object>()) {
+  if (parser.HasSection(SECTION_SCENES)) {
     // OK
   } else if (check_sections & REQUIRE_SCENES) {
     if (err) {
@@ -2175,7 +12605,7 @@ bool TinyGLTFLoader::LoadFromString(Scene *scene, std::string *err,
     return false;
   }
 
-  if (v.contains("nodes") && v.get("nodes").is<picojson::object>()) {
+  if (parser.HasSection(SECTION_NODES)) {
     // OK
   } else if (check_sections & REQUIRE_NODES) {
     if (err) {
@@ -2184,7 +12614,7 @@ bool TinyGLTFLoader::LoadFromString(Scene *scene, std::string *err,
     return false;
   }
 
-  if (v.contains("accessors") && v.get("accessors").is<picojson::object>()) {
+  if (parser.HasSection(SECTION_ACCESSORS)) {
     // OK
   } else if (check_sections & REQUIRE_ACCESSORS) {
     if (err) {
@@ -2193,7 +12623,7 @@ bool TinyGLTFLoader::LoadFromString(Scene *scene, std::string *err,
     return false;
   }
 
-  if (v.contains("buffers") && v.get("buffers").is<picojson::object>()) {
+  if (parser.HasSection(SECTION_BUFFERS)) {
     // OK
   } else if (check_sections & REQUIRE_BUFFERS) {
     if (err) {
@@ -2202,8 +12632,7 @@ bool TinyGLTFLoader::LoadFromString(Scene *scene, std::string *err,
     return false;
   }
 
-  if (v.contains("bufferViews") &&
-      v.get("bufferViews").is<picojson::object>()) {
+  if (parser.HasSection(SECTION_BUFFER_VIEWS)) {
     // OK
   } else if (check_sections & REQUIRE_BUFFER_VIEWS) {
     if (err) {
@@ -2212,290 +12641,46 @@ bool TinyGLTFLoader::LoadFromString(Scene *scene, std::string *err,
     return false;
   }
 
-  scene->buffers.clear();
-  scene->bufferViews.clear();
-  scene->accessors.clear();
-  scene->meshes.clear();
-  scene->nodes.clear();
-  scene->defaultScene = "";
-
-  // 0. Parse Asset
-  if (v.contains("asset") && v.get("asset").is<picojson::object>()) {
-    const picojson::object &root = v.get("asset").get<picojson::object>();
-
-    ParseAsset(&scene->asset, err, root);
-  }
-
-  // 1. Parse Buffer
-  if (v.contains("buffers") && v.get("buffers").is<picojson::object>()) {
-    const picojson::object &root = v.get("buffers").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; it++) {
-      Buffer buffer;
-      if (!ParseBuffer(&buffer, err, (it->second).get<picojson::object>(),
-                       base_dir, is_binary_, bin_data_, bin_size_)) {
-        return false;
-      }
-
-      scene->buffers[it->first] = buffer;
-    }
-  }
-
-  // 2. Parse BufferView
-  if (v.contains("bufferViews") &&
-      v.get("bufferViews").is<picojson::object>()) {
-    const picojson::object &root = v.get("bufferViews").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; it++) {
-      BufferView bufferView;
-      if (!ParseBufferView(&bufferView, err,
-                           (it->second).get<picojson::object>())) {
-        return false;
-      }
-
-      scene->bufferViews[it->first] = bufferView;
-    }
-  }
-
-  // 3. Parse Accessor
-  if (v.contains("accessors") && v.get("accessors").is<picojson::object>()) {
-    const picojson::object &root = v.get("accessors").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; it++) {
-      Accessor accessor;
-      if (!ParseAccessor(&accessor, err,
-                         (it->second).get<picojson::object>())) {
-        return false;
-      }
-
-      scene->accessors[it->first] = accessor;
-    }
-  }
-
-  // 4. Parse Mesh
-  if (v.contains("meshes") && v.get("meshes").is<picojson::object>()) {
-    const picojson::object &root = v.get("meshes").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; it++) {
-      Mesh mesh;
-      if (!ParseMesh(&mesh, err, (it->second).get<picojson::object>())) {
-        return false;
-      }
-
-      scene->meshes[it->first] = mesh;
-    }
-  }
-
-  // 5. Parse Node
-  if (v.contains("nodes") && v.get("nodes").is<picojson::object>()) {
-    const picojson::object &root = v.get("nodes").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; it++) {
-      Node node;
-      if (!ParseNode(&node, err, (it->second).get<picojson::object>())) {
-        return false;
-      }
-
-      scene->nodes[it->first] = node;
-    }
-  }
-
-  // 6. Parse scenes.
-  if (v.contains("scenes") && v.get("scenes").is<picojson::object>()) {
-    const picojson::object &root = v.get("scenes").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; it++) {
-      if (!((it->second).is<picojson::object>())) {
-        if (err) {
-          (*err) += "`scenes' does not contain an object.";
-        }
-        return false;
-      }
-      const picojson::object &o = (it->second).get<picojson::object>();
-      std::vector<std::string> nodes;
-      if (!ParseStringArrayProperty(&nodes, err, o, "nodes", false)) {
-        return false;
-      }
-
-      scene->scenes[it->first] = nodes;
-    }
-  }
-
-  // 7. Parse default scenes.
-  if (v.contains("scene") && v.get("scene").is<std::string>()) {
-    const std::string defaultScene = v.get("scene").get<std::string>();
-
-    scene->defaultScene = defaultScene;
-  }
-
-  // 8. Parse Material
-  if (v.contains("materials") && v.get("materials").is<picojson::object>()) {
-    const picojson::object &root = v.get("materials").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; it++) {
-      Material material;
-      if (!ParseMaterial(&material, err,
-                         (it->second).get<picojson::object>())) {
-        return false;
-      }
-
-      scene->materials[it->first] = material;
-    }
-  }
-
-  // 9. Parse Image
-  if (v.contains("images") && v.get("images").is<picojson::object>()) {
-    const picojson::object &root = v.get("images").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; it++) {
-      Image image;
-      if (!ParseImage(&image, err, (it->second).get<picojson::object>(),
-                      base_dir, is_binary_, bin_data_, bin_size_)) {
-        return false;
-      }
-
-      if (!image.bufferView.empty()) {
-        // Load image from the buffer view.
-        if (scene->bufferViews.find(image.bufferView) ==
-            scene->bufferViews.end()) {
-          if (err) {
-            std::stringstream ss;
-            ss << "bufferView \"" << image.bufferView
-               << "\" not found in the scene." << std::endl;
-            (*err) += ss.str();
-          }
-          return false;
-        }
-
-        const BufferView &bufferView = scene->bufferViews[image.bufferView];
-        const Buffer &buffer = scene->buffers[bufferView.buffer];
-
-        bool ret = LoadImageData(&image, err, image.width, image.height,
-                                 &buffer.data[bufferView.byteOffset],
-                                 static_cast<int>(bufferView.byteLength));
-        if (!ret) {
-          return false;
-        }
-      }
-
-      scene->images[it->first] = image;
-    }
-  }
-
-  // 10. Parse Texture
-  if (v.contains("textures") && v.get("textures").is<picojson::object>()) {
-    const picojson::object &root = v.get("textures").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; it++) {
-      Texture texture;
-      if (!ParseTexture(&texture, err, (it->second).get<picojson::object>(),
-                        base_dir)) {
-        return false;
-      }
-
-      scene->textures[it->first] = texture;
-    }
-  }
-
-  // 11. Parse Shader
-  if (v.contains("shaders") && v.get("shaders").is<picojson::object>()) {
-    const picojson::object &root = v.get("shaders").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; ++it) {
-      Shader shader;
-      if (!ParseShader(&shader, err, (it->second).get<picojson::object>(),
-                       base_dir, is_binary_, bin_data_, bin_size_)) {
-        return false;
-      }
-
-      scene->shaders[it->first] = shader;
-    }
+  if (!parser.LoadBufferViewImages()) {
+    return false;
   }
 
-  // 12. Parse Program
-  if (v.contains("programs") && v.get("programs").is<picojson::object>()) {
-    const picojson::object &root = v.get("programs").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; ++it) {
-      Program program;
-      if (!ParseProgram(&program, err, (it->second).get<picojson::object>())) {
-        return false;
-      }
-
-      scene->programs[it->first] = program;
-    }
+  const unsigned int decoder_sections =
+      LOAD_MESHES | LOAD_BUFFERS | LOAD_BUFFER_VIEWS | LOAD_ACCESSORS;
+  if (mesh_decoder_ &&
+      ((load_sections_ & decoder_sections) == decoder_sections) &&
+      !DecodeMeshes(scene, err, mesh_extension_, mesh_decoder_,
+                    mesh_decoder_data_, num_threads_, executor_,
+                    executor_data_)) {
+    return false;
   }
 
-  // 13. Parse Technique
-  if (v.contains("techniques") && v.get("techniques").is<picojson::object>()) {
-    const picojson::object &root = v.get("techniques").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; ++it) {
-      Technique technique;
-      if (!ParseTechnique(&technique, err,
-                          (it->second).get<picojson::object>())) {
-        return false;
-      }
-
-      scene->techniques[it->first] = technique;
-    }
+  const unsigned int compression_sections =
+      LOAD_ANIMATIONS | LOAD_BUFFERS | LOAD_BUFFER_VIEWS | LOAD_ACCESSORS;
+  if (((load_sections_ & compression_sections) == compression_sections) &&
+      !CompressAnimations(scene, err, animation_compression_)) {
+    return false;
   }
 
-  // 14. Parse Animation
-  if (v.contains("animations") && v.get("animations").is<picojson::object>()) {
-    const picojson::object &root = v.get("animations").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; ++it) {
-      Animation animation;
-      if (!ParseAnimation(&animation, err,
-                          (it->second).get<picojson::object>())) {
-        return false;
-      }
-
-      scene->animations[it->first] = animation;
-    }
+  const unsigned int bounds_sections =
+      LOAD_BUFFERS | LOAD_BUFFER_VIEWS | LOAD_ACCESSORS;
+  if ((accessor_bounds_ != BOUNDS_KEEP) &&
+      ((load_sections_ & bounds_sections) == bounds_sections)) {
+    return UpdateAccessorBounds(scene, err, accessor_bounds_, num_threads_,
+                                executor_, executor_data_);
   }
 
-  // 15. Parse Sampler
-  if (v.contains("samplers") && v.get("samplers").is<picojson::object>()) {
-    const picojson::object &root = v.get("samplers").get<picojson::object>();
-
-    picojson::object::const_iterator it(root.begin());
-    picojson::object::const_iterator itEnd(root.end());
-    for (; it != itEnd; ++it) {
-      Sampler sampler;
-      if (!ParseSampler(&sampler, err, (it->second).get<picojson::object>())) {
-        return false;
-      }
+  return true;
+}
 
-      scene->samplers[it->first] = sampler;
+// Returns false if `size` bytes don't fit the `unsigned int` size of the
+// parser(4 GiB or more).
+static bool CheckDataSize(std::string *err, size_t size) {
+  if (size > static_cast<size_t>(std::numeric_limits<unsigned int>::max())) {
+    if (err) {
+      (*err) = "Data of 4 GiB or more is not supported.";
     }
+    return false;
   }
   return true;
 }
@@ -2514,8 +12699,23 @@ bool TinyGLTFLoader::LoadASCIIFromString(Scene *scene, std::string *err,
 bool TinyGLTFLoader::LoadASCIIFromFile(Scene *scene, std::string *err,
                                        const std::string &filename,
                                        unsigned int check_sections) {
+  ScopedLoadStats stats(load_stats_);
   std::stringstream ss;
 
+  if (use_mmap_) {
+    SharedStorage mapped;
+    if (!MapFile(&mapped, err, filename) ||
+        !CheckDataSize(err, mapped.Size())) {
+      return false;
+    }
+
+    // Parse JSON directly from the mapping.
+    return LoadASCIIFromString(
+        scene, err, reinterpret_cast<const char *>(mapped.Data()),
+        static_cast<unsigned int>(mapped.Size()), GetBaseDir(filename),
+        check_sections);
+  }
+
   std::ifstream f(filename.c_str());
   if (!f) {
     ss << "Failed to open file: " << filename << std::endl;
@@ -2527,7 +12727,6 @@ bool TinyGLTFLoader::LoadASCIIFromFile(Scene *scene, std::string *err,
 
   f.seekg(0, f.end);
   size_t sz = static_cast<size_t>(f.tellg());
-  std::vector<char> buf(sz);
 
   if (sz == 0) {
     if (err) {
@@ -2535,15 +12734,20 @@ bool TinyGLTFLoader::LoadASCIIFromFile(Scene *scene, std::string *err,
     }
     return false;
   }
+  if (!CheckDataSize(err, sz)) {
+    return false;
+  }
 
+  std::vector<char> buf(sz);
   f.seekg(0, f.beg);
   f.read(&buf.at(0), static_cast<std::streamsize>(sz));
   f.close();
 
+  TransientAlloc contents(sz);
   std::string basedir = GetBaseDir(filename);
 
   bool ret = LoadASCIIFromString(scene, err, &buf.at(0),
-                                 static_cast<unsigned int>(buf.size()), basedir,
+                                 static_cast<unsigned int>(sz), basedir,
                                  check_sections);
 
   return ret;
@@ -2554,6 +12758,27 @@ bool TinyGLTFLoader::LoadBinaryFromMemory(Scene *scene, std::string *err,
                                           unsigned int size,
                                           const std::string &base_dir,
                                           unsigned int check_sections) {
+  return LoadBinary(scene, err, bytes, size, SharedStorage(), base_dir,
+                    check_sections);
+}
+
+bool TinyGLTFLoader::LoadBinaryFromStorage(Scene *scene, std::string *err,
+                                           const SharedStorage &storage,
+                                           const std::string &base_dir,
+                                           unsigned int check_sections) {
+  if (!CheckDataSize(err, storage.Size())) {
+    return false;
+  }
+  return LoadBinary(scene, err, storage.Data(),
+                    static_cast<unsigned int>(storage.Size()), storage,
+                    base_dir, check_sections);
+}
+
+bool TinyGLTFLoader::LoadBinary(Scene *scene, std::string *err,
+                                const unsigned char *bytes, unsigned int size,
+                                const SharedStorage &storage,
+                                const std::string &base_dir,
+                                unsigned int check_sections) {
   if (size < 20) {
     if (err) {
       (*err) = "Too short data size for glTF Binary.";
@@ -2594,18 +12819,19 @@ bool TinyGLTFLoader::LoadBinaryFromMemory(Scene *scene, std::string *err,
     return false;
   }
 
-  // Extract JSON string.
-  std::string jsonString(reinterpret_cast<const char *>(&bytes[20]),
-                         scene_length);
-
   is_binary_ = true;
   bin_data_ = bytes + 20 + scene_length;
   bin_size_ =
       length - (20 + scene_length);  // extract header + JSON scene data.
+  bin_storage_ = storage;
 
   bool ret =
       LoadFromString(scene, err, reinterpret_cast<const char *>(&bytes[20]),
                      scene_length, base_dir, check_sections);
+
+  // Buffers hold their own reference to the storage.
+  bin_storage_ = SharedStorage();
+
   if (!ret) {
     return ret;
   }
@@ -2616,8 +12842,21 @@ bool TinyGLTFLoader::LoadBinaryFromMemory(Scene *scene, std::string *err,
 bool TinyGLTFLoader::LoadBinaryFromFile(Scene *scene, std::string *err,
                                         const std::string &filename,
                                         unsigned int check_sections) {
+  ScopedLoadStats stats(load_stats_);
   std::stringstream ss;
 
+  if (use_mmap_) {
+    SharedStorage mapped;
+    if (!MapFile(&mapped, err, filename) ||
+        !CheckDataSize(err, mapped.Size())) {
+      return false;
+    }
+
+    return LoadBinary(scene, err, mapped.Data(),
+                      static_cast<unsigned int>(mapped.Size()), mapped,
+                      GetBaseDir(filename), check_sections);
+  }
+
   std::ifstream f(filename.c_str(), std::ios::binary);
   if (!f) {
     ss << "Failed to open file: " << filename << std::endl;
@@ -2629,21 +12868,114 @@ bool TinyGLTFLoader::LoadBinaryFromFile(Scene *scene, std::string *err,
 
   f.seekg(0, f.end);
   size_t sz = static_cast<size_t>(f.tellg());
-  std::vector<char> buf(sz);
+  if (!CheckDataSize(err, sz)) {
+    return false;
+  }
 
+  std::vector<char> buf(sz);
   f.seekg(0, f.beg);
   f.read(&buf.at(0), static_cast<std::streamsize>(sz));
   f.close();
 
+  TransientAlloc contents(sz);
   std::string basedir = GetBaseDir(filename);
 
   bool ret = LoadBinaryFromMemory(
       scene, err, reinterpret_cast<unsigned char *>(&buf.at(0)),
-      static_cast<unsigned int>(buf.size()), basedir, check_sections);
+      static_cast<unsigned int>(sz), basedir, check_sections);
 
   return ret;
 }
 
+bool TinyGLTFLoader::ScanFromFile(SceneSummary *summary, std::string *err,
+                                  const std::string &filename) {
+  std::ifstream f(filename.c_str(), std::ios::binary);
+  if (!f) {
+    if (err) {
+      (*err) = "Failed to open file: " + filename + "\n";
+    }
+    return false;
+  }
+
+  summary->asset = Asset();
+  summary->asset.premultipliedAlpha = false;
+  summary->defaultScene.clear();
+  summary->numPrimitives = 0;
+  summary->vertexCount = 0;
+  summary->indexCount = 0;
+  summary->binaryLength = 0;
+  summary->isBinary = false;
+
+  unsigned char header[20];
+  f.read(reinterpret_cast<char *>(header), 20);
+  size_t header_size = static_cast<size_t>(f.gcount());
+
+  std::vector<char> json;
+  if ((header_size == 20) && (header[0] == 'g') && (header[1] == 'l') &&
+      (header[2] == 'T') && (header[3] == 'F')) {
+    unsigned int length;        // 4 bytes
+    unsigned int scene_length;  // 4 bytes
+    unsigned int scene_format;  // 4 bytes;
+
+    memcpy(&length, header + 8, 4);
+    swap4(&length);
+    memcpy(&scene_length, header + 12, 4);
+    swap4(&scene_length);
+    memcpy(&scene_format, header + 16, 4);
+    swap4(&scene_format);
+
+    if ((20 + scene_length >= length) || (scene_length < 1) ||
+        (scene_format != 0)) {  // 0 = JSON format.
+      if (err) {
+        (*err) = "Invalid glTF binary.";
+      }
+      return false;
+    }
+
+    // Read only the JSON scene data.
+    json.resize(scene_length);
+    f.read(&json.at(0), static_cast<std::streamsize>(scene_length));
+    if (static_cast<size_t>(f.gcount()) != scene_length) {
+      if (err) {
+        (*err) = "Invalid glTF binary.";
+      }
+      return false;
+    }
+
+    summary->isBinary = true;
+    summary->binaryLength = length - (20 + scene_length);
+  } else {
+    f.clear();
+    f.seekg(0, f.end);
+    size_t sz = static_cast<size_t>(f.tellg());
+    if (sz == 0) {
+      if (err) {
+        (*err) = "Empty file: " + filename + "\n";
+      }
+      return false;
+    }
+
+    json.resize(sz);
+    f.seekg(0, f.beg);
+    f.read(&json.at(0), static_cast<std::streamsize>(sz));
+  }
+
+  SceneScanner scanner(summary);
+  std::string perr;
+  const char *begin = &json.at(0);
+  picojson::_parse(scanner, begin, begin + json.size(), &perr);
+  if (!perr.empty()) {
+    if (err) {
+      (*err) = perr;
+    }
+    return false;
+  }
+
+  scanner.Finish();
+
+  return true;
+}
+
 }  // namespace tinygltf
 
 #endif  // TINYGLTF_LOADER_IMPLEMENTATION